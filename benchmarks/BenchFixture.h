@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include "ConfigLoader.h"
+#include "DeviceInstance.h"
+#include "EquipmentType.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+// 基准测试共用的数据：加载仓库自带的示例配置，按需把某个类型的设备复制到指定数量。
+namespace BenchFixture {
+
+inline QString sampleConfigPath()
+{
+    return QStringLiteral(EQUIPMENT_SAMPLE_CONFIG);
+}
+
+struct Model {
+    QJsonObject root;
+    QList<EquipmentType*> types;
+    QMap<QString, QList<DeviceInstance*>> devices;
+
+    Model() = default;
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    ~Model() { ConfigLoader::clear(types, devices); }
+
+    bool load(QString* error = nullptr)
+    {
+        ConfigLoader::clear(types, devices);
+        if (!ConfigLoader::readRoot(sampleConfigPath(), root, error)) {
+            return false;
+        }
+        ConfigLoader::buildModel(root.value("equipment_config").toObject(), types, devices);
+        return true;
+    }
+
+    // 把某个类型的工作状态模板补足到 paramCount 个参数（轮流复制已有参数并改用新 ID），随后重建模型；
+    // 设备取值中没有的新参数在加载时按默认值补齐
+    bool widenWorkStateTemplate(const QString& typeId, int paramCount)
+    {
+        QJsonObject configObj = root.value("equipment_config").toObject();
+        QJsonArray typesArray = configObj.value("equipment_types").toArray();
+        bool found = false;
+        for (int i = 0; i < typesArray.size(); ++i) {
+            QJsonObject typeObj = typesArray.at(i).toObject();
+            if (typeObj.value("type_id").toString() != typeId) {
+                continue;
+            }
+            QJsonObject templateObj = typeObj.value("work_state_template").toObject();
+            QJsonArray params = templateObj.value("parameters").toArray();
+            const int declared = params.size();
+            for (int n = declared; declared > 0 && n < paramCount; ++n) {
+                QJsonObject param = params.at(n % declared).toObject();
+                param.insert("id", QString("%1_%2").arg(param.value("id").toString()).arg(n));
+                param.insert("label", QString("%1 %2").arg(param.value("label").toString()).arg(n));
+                params.append(param);
+            }
+            templateObj.insert("parameters", params);
+            typeObj.insert("work_state_template", templateObj);
+            typesArray[i] = typeObj;
+            found = declared > 0;
+        }
+        if (!found) {
+            return false;
+        }
+        configObj.insert("equipment_types", typesArray);
+        root.insert("equipment_config", configObj);
+        ConfigLoader::clear(types, devices);
+        ConfigLoader::buildModel(configObj, types, devices);
+        return true;
+    }
+
+    EquipmentType* type(const QString& typeId) const
+    {
+        for (EquipmentType* t : types) {
+            if (t->getTypeId() == typeId) {
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    // 以该类型第一台设备为原型（取值与工作状态数量相同）补足到 count 台
+    void replicate(const QString& typeId, int count)
+    {
+        QList<DeviceInstance*>& list = devices[typeId];
+        EquipmentType* equipType = type(typeId);
+        if (list.isEmpty() || !equipType) {
+            return;
+        }
+        const DeviceInstance* proto = list.first();
+        for (int i = list.size(); i < count; ++i) {
+            DeviceInstance* device = new DeviceInstance(QString("%1_%2").arg(typeId).arg(i),
+                                                        QString("%1 %2").arg(equipType->getTypeName()).arg(i + 1),
+                                                        equipType);
+            device->setBasicValues(proto->getBasicValues());
+            device->setWorkStateCount(proto->getWorkStateCount());
+            for (int s = 0; s < proto->getWorkStateCount(); ++s) {
+                device->setWorkStateValues(s, proto->getWorkStateValues(s));
+            }
+            list.append(device);
+        }
+    }
+
+    int deviceCount() const
+    {
+        int total = 0;
+        for (const QList<DeviceInstance*>& list : devices) {
+            total += list.size();
+        }
+        return total;
+    }
+};
+
+}
@@ -0,0 +1,147 @@
+﻿#include "BenchFixture.h"
+#include "AtomicFileWriter.h"
+#include "BackupStore.h"
+#include "ConfigSerializer.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// 结构编辑保存前的备份：差量版本库与旧的整文件复制（*.backup_<时间>.json）对比，
+// 配置为 2000 台超短波设备，相邻两次备份只差一个字段
+class BackupBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        m_model.replicate(QStringLiteral("uhf"), kDevices);
+        QVERIFY(m_dir.isValid());
+        m_configFile = m_dir.filePath(QStringLiteral("backup.json"));
+
+        DeviceInstance* device = m_model.devices.value(QStringLiteral("uhf")).at(kDevices / 2);
+        for (int i = 0; i < 2; ++i) {
+            device->setWorkStateValue(0, QStringLiteral("power"), 10 + i);
+            QVERIFY(save());
+            QFile file(m_configFile);
+            QVERIFY(file.open(QIODevice::ReadOnly));
+            m_contents[i] = file.readAll();
+        }
+        QVERIFY(m_contents[0] != m_contents[1]);
+    }
+
+    void emptyFileRoundTrip()
+    {
+        QTemporaryDir dir;
+        BackupStore store(dir.filePath(QStringLiteral("empty.json")), policy());
+        QVERIFY(store.add(QByteArray()));
+        QVERIFY(store.add(m_contents[0]));
+        QByteArray content("x");
+        QString error;
+        QVERIFY2(store.load(store.versions().first().id, content, &error), qPrintable(error));
+        QVERIFY(content.isEmpty());
+    }
+
+    void deltaRoundTrip()
+    {
+        QTemporaryDir dir;
+        BackupStore store(dir.filePath(QStringLiteral("delta.json")), policy());
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(store.add(m_contents[i % 2]));
+        }
+        const QList<BackupStore::Version> versions = store.versions();
+        QCOMPARE(versions.size(), 4);
+        QVERIFY(!versions.last().full);
+        QByteArray content;
+        QVERIFY(store.load(versions.last().id, content));
+        QCOMPARE(content, m_contents[1]);
+    }
+
+    void importLegacyBackups()
+    {
+        QTemporaryDir dir;
+        const QString configFile = dir.filePath(QStringLiteral("legacy.json"));
+        BackupStore store(configFile, policy());
+        QVERIFY(store.add(m_contents[1])); // 新版本库里已有的版本晚于旧备份
+        const QDateTime base = QDateTime::currentDateTime().addDays(-1);
+        for (int i = 0; i < 3; ++i) {
+            QFile legacy(dir.filePath(QString("legacy.backup_%1.json")
+                                          .arg(base.addSecs(i).toString(QStringLiteral("yyyyMMdd_HHmmss")))));
+            QVERIFY(legacy.open(QIODevice::WriteOnly));
+            legacy.write(i == 2 ? QByteArray() : m_contents[i]);
+        }
+        QString error;
+        QCOMPARE(store.importLegacyBackups(&error), 3);
+        QVERIFY(QDir(dir.path()).entryList(QStringList() << QStringLiteral("*.backup_*.json")).isEmpty());
+
+        const QList<BackupStore::Version> versions = store.versions();
+        QCOMPARE(versions.size(), 4);
+        const QByteArray expected[] = {m_contents[0], m_contents[1], QByteArray(), m_contents[1]};
+        for (int i = 0; i < versions.size(); ++i) {
+            QByteArray content;
+            QVERIFY2(store.load(versions.at(i).id, content, &error), qPrintable(error));
+            QCOMPARE(content, expected[i]);
+        }
+        QCOMPARE(store.importLegacyBackups(), 0);
+    }
+
+    // 旧做法：每次保存前把整个文件复制一份
+    void fullCopy()
+    {
+        const QString copy = m_dir.filePath(QStringLiteral("backup.backup_copy.json"));
+        QBENCHMARK {
+            QFile::remove(copy);
+            QVERIFY(QFile::copy(m_configFile, copy));
+        }
+        qDebug() << "file KB:" << QFileInfo(m_configFile).size() / 1024;
+    }
+
+    // 差量版本库：与最新版本的完整内容（head）按行比较、压缩后写入并更新 head，包含保留策略的清理
+    void deltaBackup()
+    {
+        QTemporaryDir dir;
+        BackupStore store(dir.filePath(QStringLiteral("store.json")), policy());
+        QVERIFY(store.add(m_contents[0]));
+        int turn = 0;
+        QBENCHMARK {
+            QVERIFY(store.add(m_contents[++turn % 2]));
+        }
+        qint64 stored = 0;
+        for (const BackupStore::Version& version : store.versions()) {
+            stored += version.storedBytes;
+        }
+        qDebug() << "versions:" << store.versions().size() << "stored KB:" << stored / 1024
+                 << "head KB:" << QFileInfo(store.directory() + QStringLiteral("/head")).size() / 1024;
+    }
+
+private:
+    static constexpr int kDevices = 2000;
+    BenchFixture::Model m_model;
+    ConfigSerializer m_serializer;
+    QTemporaryDir m_dir;
+    QString m_configFile;
+    QByteArray m_contents[2];
+
+    static BackupStore::Policy policy()
+    {
+        BackupStore::Policy policy;
+        policy.maxCount = 20;
+        policy.maxAgeDays = 30;
+        return policy;
+    }
+
+    bool save()
+    {
+        AtomicFileWriter writer(m_configFile);
+        return writer.open()
+            && m_serializer.serialize(writer, m_model.root, m_model.types, m_model.devices)
+            && writer.commit();
+    }
+};
+
+QTEST_MAIN(BackupBenchmark)
+#include "bench_backup.moc"
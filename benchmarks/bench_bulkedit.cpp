@@ -0,0 +1,114 @@
+﻿#include "BenchFixture.h"
+#include "BulkEdit.h"
+#include "WorkStateTemplate.h"
+#include <QtTest>
+
+// 批量修改：2000 台超短波设备全部工作状态上的表达式修改（含写入前的规则与约束试算）；
+// 另检查约束违反时整体放弃、选项规则联动与枚举可选项检查
+class BulkEditBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        m_model.replicate(QStringLiteral("uhf"), kDevices);
+        m_devices = m_model.devices.value(QStringLiteral("uhf"));
+        QCOMPARE(m_devices.size(), kDevices);
+        QVERIFY(m_devices.last()->getWorkStateCount() >= 2);
+    }
+
+    // 定频状态要求起始频率 = 终止频率，跳频状态要求起始频率 < 终止频率，两者都不满足时不能写入
+    void rejectsConstraintViolation()
+    {
+        DeviceInstance* device = m_devices.last();
+        const quint64 revision = device->getRevision();
+        const BulkEdit::Outcome outcome = BulkEdit::apply(
+            request(QStringLiteral("end_frequency"), QStringLiteral("start_frequency - 1"), true, device),
+            stateParameter(QStringLiteral("end_frequency")));
+        QVERIFY(!outcome.ok);
+        QVERIFY(!outcome.errors.isEmpty());
+        QCOMPARE(device->getRevision(), revision);
+    }
+
+    // 第一个状态为定频（起始 = 终止），改为扩频后信号类型不在新选项中，联动改为第一项
+    void cascadesOptionRules()
+    {
+        DeviceInstance* device = m_devices.last();
+        QCOMPARE(device->getWorkStateValues(0).value("uhf_mode").toString(), QString(u8"定频"));
+        BulkEdit::Request req = request(QStringLiteral("uhf_mode"), QString(u8"扩频"), false, device);
+        req.lastState = 0;
+        const BulkEdit::Outcome outcome = BulkEdit::apply(req, stateParameter(QStringLiteral("uhf_mode")));
+        QVERIFY2(outcome.ok, qPrintable(outcome.errors.join("\n")));
+        QCOMPARE(outcome.changed, 1);
+        QCOMPARE(outcome.cascaded, 1);
+        QCOMPARE(device->getWorkStateValues(0).value("signal_type").toString(), QString(u8"24-数传DQPSK+FM"));
+    }
+
+    // 跳频信号类型不在定频状态的可选项中
+    void rejectsEnumOutsideOptions()
+    {
+        DeviceInstance* device = m_devices.last();
+        QCOMPARE(device->getWorkStateValues(1).value("uhf_mode").toString(), QString(u8"定频"));
+        BulkEdit::Request req = request(QStringLiteral("signal_type"), QString(u8"5-话音FH"), false, device);
+        req.firstState = 1;
+        req.lastState = 1;
+        const BulkEdit::Outcome outcome = BulkEdit::apply(req, stateParameter(QStringLiteral("signal_type")));
+        QVERIFY(!outcome.ok);
+    }
+
+    void expressionAllStates()
+    {
+        const BulkEdit::Request req = request(QStringLiteral("power"), QStringLiteral("x * 1.01"), true);
+        const ParameterItem* param = stateParameter(QStringLiteral("power"));
+        BulkEdit::Outcome outcome;
+        QBENCHMARK {
+            outcome = BulkEdit::apply(req, param);
+        }
+        QVERIFY2(outcome.ok, qPrintable(outcome.errors.join("\n")));
+        qDebug() << "cells:" << outcome.cells << "changed:" << outcome.changed << "ms:" << outcome.elapsedMs;
+    }
+
+    // 跳频间隔被约束读取，每个变化的单元格都要试算约束
+    void constrainedExpressionAllStates()
+    {
+        const BulkEdit::Request up = request(QStringLiteral("hop_interval"), QStringLiteral("x + 1"), true);
+        const BulkEdit::Request down = request(QStringLiteral("hop_interval"), QStringLiteral("x - 1"), true);
+        const ParameterItem* param = stateParameter(QStringLiteral("hop_interval"));
+        BulkEdit::Outcome outcome;
+        QBENCHMARK {
+            outcome = BulkEdit::apply(up, param);
+            QVERIFY2(outcome.ok, qPrintable(outcome.errors.join("\n")));
+            outcome = BulkEdit::apply(down, param);
+            QVERIFY2(outcome.ok, qPrintable(outcome.errors.join("\n")));
+        }
+        qDebug() << "cells:" << outcome.cells << "changed:" << outcome.changed << "ms:" << outcome.elapsedMs;
+    }
+
+private:
+    static constexpr int kDevices = 2000;
+    BenchFixture::Model m_model;
+    QList<DeviceInstance*> m_devices;
+
+    BulkEdit::Request request(const QString& paramId, const QString& text, bool expression,
+                              DeviceInstance* device = nullptr) const
+    {
+        BulkEdit::Request req;
+        req.typeId = QStringLiteral("uhf");
+        req.paramId = paramId;
+        req.stateParameter = true;
+        req.devices = device ? QList<DeviceInstance*>() << device : m_devices;
+        req.expression = expression;
+        req.text = text;
+        return req;
+    }
+
+    const ParameterItem* stateParameter(const QString& paramId) const
+    {
+        return m_model.type(QStringLiteral("uhf"))->getWorkStateTemplate()->getParameter(paramId);
+    }
+};
+
+QTEST_MAIN(BulkEditBenchmark)
+#include "bench_bulkedit.moc"
@@ -0,0 +1,116 @@
+﻿#include "BenchFixture.h"
+#include "ParameterFormModel.h"
+#include "ParameterItem.h"
+#include "PerfLog.h"
+#include "WorkStateTemplate.h"
+#include "WorkStateTabWidget.h"
+#include <QFormLayout>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QWidget>
+#include <QtTest>
+#include <functional>
+
+// 一台雷达设备全部工作状态页的构建：以前每个参数一个 ParameterItem 副本、常驻编辑器、标签与行容器，
+// 现在每页一个 ParameterFormView，编辑器只在编辑单元格时创建。输出两种做法的控件数与常驻内存增量
+class FormBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        m_device = m_model.devices.value(QStringLiteral("radar")).value(0);
+        QVERIFY(m_device);
+        m_device->setWorkStateCount(kStates);
+        QVERIFY(m_device->getEquipmentType()->getWorkStateTemplate());
+    }
+
+    // 打开表单只读取设备，不产生编辑日志记录或自动保存
+    void openingFormKeepsDevice()
+    {
+        const quint64 revision = m_device->getRevision();
+        ParameterFormModel basic(m_device, -1);
+        for (int s = 0; s < kStates; ++s) {
+            ParameterFormModel state(m_device, s);
+        }
+        QCOMPARE(m_device->getRevision(), revision);
+    }
+
+    void buildPerParameterWidgets()
+    {
+        report("per-parameter widgets", [this](QWidget* page) { buildLegacyPages(page); });
+        QBENCHMARK {
+            QWidget page;
+            buildLegacyPages(&page);
+        }
+    }
+
+    void buildFormViews()
+    {
+        report("form views", [this](QWidget* page) { buildFormPages(page); });
+        QBENCHMARK {
+            QWidget page;
+            buildFormPages(&page);
+        }
+    }
+
+private:
+    static constexpr int kStates = 16;
+    BenchFixture::Model m_model;
+    DeviceInstance* m_device = nullptr;
+
+    void buildFormPages(QWidget* page)
+    {
+        QVBoxLayout* layout = new QVBoxLayout(page);
+        for (int s = 0; s < kStates; ++s) {
+            layout->addWidget(new WorkStateTabWidget(m_device, s, QString(), page));
+        }
+    }
+
+    // 与改为表格模型之前的工作状态页相同的结构
+    void buildLegacyPages(QWidget* page)
+    {
+        QVBoxLayout* layout = new QVBoxLayout(page);
+        const QList<ParameterItem*>& params = m_device->getEquipmentType()->getWorkStateTemplate()->getParameters();
+        for (int s = 0; s < kStates; ++s) {
+            QGroupBox* group = new QGroupBox(QString(u8"工作状态 %1 参数").arg(s + 1), page);
+            QFormLayout* formLayout = new QFormLayout(group);
+            const QVariantMap values = m_device->getWorkStateValues(s);
+            for (const ParameterItem* templateParam : params) {
+                ParameterItem* param = new ParameterItem(templateParam->getId(), templateParam->getLabel(),
+                                                         templateParam->getType());
+                param->setParent(group);
+                param->setUnit(templateParam->getUnit());
+                param->setDefaultValue(templateParam->getDefaultValue());
+                param->setRange(templateParam->getMinValue(), templateParam->getMaxValue());
+                param->setOptions(templateParam->getOptions());
+                QWidget* editor = param->createEditor(group);
+                param->setValue(values.value(param->getId(), param->getDefaultValue()));
+                QWidget* row = new QWidget(group);
+                QHBoxLayout* rowLayout = new QHBoxLayout(row);
+                rowLayout->setContentsMargins(0, 0, 0, 0);
+                rowLayout->addWidget(new QLabel(param->getLabel(), row));
+                rowLayout->addWidget(editor, 1);
+                formLayout->addRow(row);
+            }
+            layout->addWidget(group);
+        }
+    }
+
+    void report(const char* name, const std::function<void(QWidget*)>& build)
+    {
+        const qint64 before = PerfLog::residentMemoryKB();
+        QWidget page;
+        build(&page);
+        qDebug() << name << "states:" << kStates
+                 << "widgets:" << page.findChildren<QWidget*>().size()
+                 << "resident KB delta:" << PerfLog::residentMemoryKB() - before;
+    }
+};
+
+QTEST_MAIN(FormBenchmark)
+#include "bench_forms.moc"
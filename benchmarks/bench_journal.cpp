@@ -0,0 +1,74 @@
+﻿#include "BenchFixture.h"
+#include "EditJournal.h"
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// 编辑日志的写入速率：每次编辑都追加记录，每批合并写入后同步到磁盘
+class JournalBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        QVERIFY(m_dir.isValid());
+        m_configFile = m_dir.filePath(QStringLiteral("journal.json"));
+        QVERIFY(QFile::copy(BenchFixture::sampleConfigPath(), m_configFile));
+        QCOMPARE(m_journal.open(m_configFile, m_model.devices), 0);
+        for (const QList<DeviceInstance*>& devices : m_model.devices) {
+            for (DeviceInstance* device : devices) {
+                device->setJournal(&m_journal);
+            }
+        }
+        m_device = m_model.devices.value(QStringLiteral("uhf")).first();
+        QVERIFY(m_device);
+    }
+
+    void cleanupTestCase()
+    {
+        m_journal.close();
+    }
+
+    // 只记录、不写盘：编辑路径上的开销
+    void recordEdit()
+    {
+        QBENCHMARK {
+            m_device->setWorkStateValue(0, QStringLiteral("power"), ++m_value);
+        }
+        m_journal.flush();
+    }
+
+    // 单条编辑立即写入并同步：最坏情况下每批只有一条记录
+    void recordAndSyncEach()
+    {
+        QBENCHMARK {
+            m_device->setWorkStateValue(0, QStringLiteral("power"), ++m_value);
+            m_journal.flush();
+        }
+    }
+
+    // 200 ms 合并窗口内的典型批量：100 次编辑后一次写入并同步
+    void recordAndSyncBatch100()
+    {
+        QBENCHMARK {
+            for (int i = 0; i < 100; ++i) {
+                m_device->setWorkStateValue(i % m_device->getWorkStateCount(), QStringLiteral("power"), ++m_value);
+            }
+            m_journal.flush();
+        }
+        QVERIFY(m_journal.hasUnsaved());
+    }
+
+private:
+    BenchFixture::Model m_model;
+    EditJournal m_journal;
+    QTemporaryDir m_dir;
+    QString m_configFile;
+    DeviceInstance* m_device = nullptr;
+    int m_value = 0;
+};
+
+QTEST_MAIN(JournalBenchmark)
+#include "bench_journal.moc"
@@ -0,0 +1,207 @@
+﻿#include "BenchFixture.h"
+#include "ParameterRuleSet.h"
+#include "RuleExpression.h"
+#include "ValidationEngine.h"
+#include "ValidationRule.h"
+#include "WorkStateTemplate.h"
+#include <QtTest>
+
+// 规则引擎：超短波模板规则的编译、条件表达式求值、可见性位图、选项查找与单状态约束检查的用时；
+// 另检查不加引号的列表项、算术运算与引用未知参数的规则
+class RulesBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        EquipmentType* type = m_model.type(QStringLiteral("uhf"));
+        QVERIFY(type && type->getWorkStateTemplate());
+        m_tmpl = type->getWorkStateTemplate();
+        m_device = m_model.devices.value(QStringLiteral("uhf")).value(0);
+        QVERIFY(m_device);
+        for (int s = 0; s < m_device->getWorkStateCount(); ++s) {
+            m_states.append(m_device->getWorkStateValues(s));
+        }
+        for (const QJsonValue& value : m_model.root.value("equipment_config").toObject().value("equipment_types").toArray()) {
+            if (value.toObject().value("type_id").toString() == QLatin1String("uhf")) {
+                m_templateJson = value.toObject().value("work_state_template").toObject();
+            }
+        }
+        QVERIFY(m_templateJson.contains("validation_rules"));
+        for (const ParameterItem* param : m_tmpl->getParameters() + type->getBasicParameters()) {
+            m_knownIds.insert(param->getId());
+        }
+        for (const ValidationRule& rule : m_tmpl->getCompiledValidationRules()) {
+            for (const ValidationConstraint& c : rule.constraints) {
+                if (c.condition.isValid()) {
+                    m_conditions.append(&c.condition);
+                }
+            }
+        }
+        QVERIFY(!m_conditions.isEmpty());
+        qDebug() << "states:" << m_states.size() << "conditions:" << m_conditions.size();
+    }
+
+    // 不加引号的列表项读到 , 或 ] 为止，以数字开头或含 - 与空格的枚举取值整体作为一项
+    void unquotedListItems()
+    {
+        RuleExpression expression;
+        QString error;
+        QVERIFY2(expression.compile(QString(u8"mode in [2-余弦函数, 0x02-常规, 跳 频] && count > 1"), &error),
+                 qPrintable(error));
+        QVariantMap values;
+        values.insert("mode", QString(u8"0x02-常规"));
+        values.insert("count", 2);
+        QVERIFY(expression.evaluate(values));
+        values.insert("mode", QString(u8"2-余弦函数"));
+        QVERIFY(expression.evaluate(values));
+        values.insert("mode", QString(u8"跳 频"));
+        QVERIFY(expression.evaluate(values));
+        values.insert("mode", QStringLiteral("2"));
+        QVERIFY(!expression.evaluate(values));
+        QCOMPARE(expression.variables(), QStringList() << "mode" << "count");
+    }
+
+    void arithmetic()
+    {
+        RuleExpression expression;
+        QString error;
+        QVERIFY2(expression.compile(QStringLiteral("-(x + 2) * 3 - -1 / 2"), &error), qPrintable(error));
+        QVariantMap values;
+        values.insert("x", 1);
+        double result = 0.0;
+        QVERIFY(expression.evaluateNumber(values, &result));
+        QCOMPARE(result, -8.5);
+        values.insert("x", QStringLiteral("abc"));
+        QVERIFY(!expression.evaluateNumber(values, &result));
+
+        QVERIFY2(expression.compile(QStringLiteral("end_frequency - start_frequency >= frequency_count * hop_interval"), &error),
+                 qPrintable(error));
+        QVERIFY(expression.evaluate(m_states.value(2)));
+    }
+
+    // 布尔取值与字面量 true / false 一样，可按数值或按字符串比较
+    void boolValues()
+    {
+        RuleExpression expression;
+        QString error;
+        QVERIFY2(expression.compile(QStringLiteral("flag == 'true' && flag == 1 && flag in [true]"), &error),
+                 qPrintable(error));
+        QVariantMap values;
+        values.insert("flag", true);
+        QVERIFY(expression.evaluate(values));
+        values.insert("flag", false);
+        QVERIFY(!expression.evaluate(values));
+    }
+
+    // 拼错的参数ID或漏写引号的取值在加载时报告并忽略，不会恒不成立地生效
+    void unknownVariablesAreIgnored()
+    {
+        QJsonObject json = m_templateJson;
+        QJsonArray visibility = json.value("visibility_rules").toArray();
+        QJsonObject badCase;
+        badCase.insert("when", QString(u8"uhf_mode == 跳频"));
+        badCase.insert("show", QJsonArray() << QStringLiteral("power"));
+        QJsonObject badRule;
+        badRule.insert("cases", QJsonArray() << badCase);
+        visibility.append(badRule);
+        json.insert("visibility_rules", visibility);
+        ParameterRuleSet rules;
+        rules.load(json, m_tmpl->getParameters());
+        QCOMPARE(rules.expressionCount(), m_tmpl->getRules().expressionCount());
+
+        QJsonObject constraint;
+        constraint.insert("expect", QStringLiteral("powr < 100"));
+        QJsonObject rule;
+        rule.insert("id", QStringLiteral("typo"));
+        rule.insert("constraints", QJsonArray() << constraint);
+        QVERIFY(ValidationRule::compile(QJsonArray() << rule, m_knownIds).isEmpty());
+    }
+
+    void compile()
+    {
+        const QJsonArray validation = m_templateJson.value("validation_rules").toArray();
+        QBENCHMARK {
+            ParameterRuleSet rules;
+            rules.load(m_templateJson, m_tmpl->getParameters());
+            ValidationRule::compile(validation, m_knownIds);
+        }
+    }
+
+    void evaluateConditions()
+    {
+        int matched = 0;
+        QBENCHMARK {
+            matched = 0;
+            for (const QVariantMap& values : m_states) {
+                for (const RuleExpression* condition : m_conditions) {
+                    matched += condition->evaluate(values, m_device->getBasicValues()) ? 1 : 0;
+                }
+            }
+        }
+        QVERIFY(matched > 0);
+    }
+
+    void hiddenMask()
+    {
+        const ParameterRuleSet& rules = m_tmpl->getRules();
+        int hidden = 0;
+        QBENCHMARK {
+            hidden = 0;
+            for (const QVariantMap& values : m_states) {
+                hidden += rules.hiddenMask(values).count(true);
+            }
+        }
+        QVERIFY(hidden > 0);
+    }
+
+    void optionsFor()
+    {
+        const ParameterRuleSet& rules = m_tmpl->getRules();
+        int slot = -1;
+        for (int i = 0; i < m_tmpl->getParameters().size(); ++i) {
+            if (m_tmpl->getParameters().at(i)->getId() == QLatin1String("signal_type")) {
+                slot = i;
+            }
+        }
+        QVERIFY(slot >= 0);
+        int options = 0;
+        QBENCHMARK {
+            options = 0;
+            for (const QVariantMap& values : m_states) {
+                options += rules.optionsFor(slot, values).size();
+            }
+        }
+        QVERIFY(options > 0);
+    }
+
+    void checkStateSlots()
+    {
+        QSet<int> slotIndexes;
+        for (int i = 0; i < m_tmpl->getValidationDependencies().constraintSlots.size(); ++i) {
+            slotIndexes.insert(i);
+        }
+        int failed = 0;
+        QBENCHMARK {
+            failed = 0;
+            for (int s = 0; s < m_states.size(); ++s) {
+                failed += ValidationEngine::checkStateSlots(m_device, s, m_states.at(s), slotIndexes).size();
+            }
+        }
+        qDebug() << "constraints:" << slotIndexes.size() << "failed:" << failed;
+    }
+
+private:
+    BenchFixture::Model m_model;
+    WorkStateTemplate* m_tmpl = nullptr;
+    DeviceInstance* m_device = nullptr;
+    QList<QVariantMap> m_states;
+    QJsonObject m_templateJson;
+    QSet<QString> m_knownIds;
+    QVector<const RuleExpression*> m_conditions;
+};
+
+QTEST_MAIN(RulesBenchmark)
+#include "bench_rules.moc"
@@ -0,0 +1,63 @@
+﻿#include "BenchFixture.h"
+#include "AtomicFileWriter.h"
+#include "ConfigSerializer.h"
+#include <QFileInfo>
+#include <QTemporaryDir>
+#include <QtTest>
+
+// 2000 台设备（超短波，每台 15 个工作状态）的保存：全量生成与只改一个字段后的增量保存
+class SaveBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        m_model.replicate(QStringLiteral("uhf"), kDevices);
+        QCOMPARE(m_model.devices.value(QStringLiteral("uhf")).size(), kDevices);
+        QVERIFY(m_dir.isValid());
+        m_path = m_dir.filePath(QStringLiteral("bench_save.json"));
+    }
+
+    void saveFull()
+    {
+        QBENCHMARK {
+            m_serializer.clear();
+            QVERIFY(save());
+        }
+        QCOMPARE(m_serializer.lastStats().devicesSerialized, m_model.deviceCount());
+    }
+
+    void saveOneFieldChanged()
+    {
+        QVERIFY(save()); // 预热片段缓存
+        DeviceInstance* device = m_model.devices.value(QStringLiteral("uhf")).at(kDevices / 2);
+        int power = 0;
+        QBENCHMARK {
+            device->setWorkStateValue(0, QStringLiteral("power"), ++power);
+            QVERIFY(save());
+        }
+        QCOMPARE(m_serializer.lastStats().devicesSerialized, 1);
+        qDebug() << "devices:" << m_model.deviceCount()
+                 << "file KB:" << QFileInfo(m_path).size() / 1024;
+    }
+
+private:
+    static constexpr int kDevices = 2000;
+    BenchFixture::Model m_model;
+    ConfigSerializer m_serializer;
+    QTemporaryDir m_dir;
+    QString m_path;
+
+    bool save()
+    {
+        AtomicFileWriter writer(m_path);
+        return writer.open()
+            && m_serializer.serialize(writer, m_model.root, m_model.types, m_model.devices)
+            && writer.commit();
+    }
+};
+
+QTEST_MAIN(SaveBenchmark)
+#include "bench_save.moc"
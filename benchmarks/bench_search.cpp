@@ -0,0 +1,83 @@
+﻿#include "BenchFixture.h"
+#include "SearchIndex.h"
+#include <QCoreApplication>
+#include <QSignalSpy>
+#include <QtTest>
+
+// 全局搜索：把超短波设备复制到约 10 万个取值单元格，测索引重建与各类查询的用时
+class SearchBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        const DeviceInstance* proto = m_model.devices.value(QStringLiteral("uhf")).value(0);
+        QVERIFY(proto);
+        int cellsPerDevice = proto->getBasicValues().size();
+        for (int s = 0; s < proto->getWorkStateCount(); ++s) {
+            cellsPerDevice += proto->getWorkStateValues(s).size();
+        }
+        QVERIFY(cellsPerDevice > 0);
+        m_model.replicate(QStringLiteral("uhf"), kCells / cellsPerDevice + 1);
+        m_index.rebuild(m_model.types, m_model.devices);
+        QVERIFY(m_index.cellCount() >= kCells);
+        for (const QList<DeviceInstance*>& devices : m_model.devices) {
+            for (DeviceInstance* device : devices) {
+                device->setSearchIndex(&m_index);
+            }
+        }
+        qDebug() << "cells:" << m_index.cellCount() << "devices:" << m_model.deviceCount();
+    }
+
+    void rebuild()
+    {
+        QBENCHMARK {
+            m_index.rebuild(m_model.types, m_model.devices);
+        }
+    }
+
+    void query_data()
+    {
+        QTest::addColumn<QString>("text");
+        QTest::newRow("value prefix") << QStringLiteral("跳频");
+        QTest::newRow("parameter") << QStringLiteral("power");
+        QTest::newRow("device") << QStringLiteral("uhf_1999");
+        QTest::newRow("comparison") << QStringLiteral("power > 30");
+        QTest::newRow("combined") << QStringLiteral("uhf_mode 定频 power >= 0");
+    }
+
+    void query()
+    {
+        QFETCH(QString, text);
+        SearchIndex::Result result;
+        QBENCHMARK {
+            result = m_index.query(text, 500);
+        }
+        qDebug() << text << "matches:" << result.total << "us:" << result.elapsedUs;
+    }
+
+    // 连续修改只在回到事件循环后通知一次
+    void changesAreBatched()
+    {
+        QSignalSpy spy(&m_index, SIGNAL(changed()));
+        DeviceInstance* device = m_model.devices.value(QStringLiteral("uhf")).value(1);
+        for (int i = 0; i < 1000; ++i) {
+            device->setWorkStateValue(0, QStringLiteral("power"), kUnique - 999 + i);
+        }
+        QCOMPARE(spy.count(), 0);
+        QCoreApplication::processEvents();
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(m_index.query(QString("power = %1").arg(kUnique), 10).total, 1);
+    }
+
+private:
+    static constexpr int kCells = 100000;
+    static constexpr int kUnique = 987654; // 示例配置中不存在的功率值
+    BenchFixture::Model m_model;
+    SearchIndex m_index;
+};
+
+QTEST_MAIN(SearchBenchmark)
+#include "bench_search.moc"
@@ -0,0 +1,149 @@
+﻿#include "BenchFixture.h"
+#include "AtomicFileWriter.h"
+#include "ConfigSerializer.h"
+#include "JsonWriter.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QtTest>
+
+namespace {
+// 改为直接写出之前的设备序列化方式（经 QJsonObject），作为输出一致性的基准
+QJsonObject legacyDeviceToJson(const DeviceInstance* device)
+{
+    QJsonObject deviceObj;
+    deviceObj["device_id"] = device->getDeviceId();
+    deviceObj["device_name"] = device->getDeviceName();
+
+    QJsonObject basicValuesObj;
+    const auto& basicValues = device->getAllBasicValues();
+    for (auto it = basicValues.begin(); it != basicValues.end(); ++it) {
+        basicValuesObj[it.key()] = JsonWriter::fromVariant(it.value());
+    }
+    deviceObj["basic_values"] = basicValuesObj;
+
+    QJsonArray workStatesArray;
+    for (int i = 0; i < device->getWorkStateCount(); ++i) {
+        QJsonObject stateObj;
+        stateObj["state_index"] = i;
+        QJsonObject stateValuesObj;
+        const QVariantMap stateValues = device->getWorkStateValues(i);
+        for (auto it = stateValues.begin(); it != stateValues.end(); ++it) {
+            stateValuesObj[it.key()] = JsonWriter::fromVariant(it.value());
+        }
+        stateObj["values"] = stateValuesObj;
+        workStatesArray.append(stateObj);
+    }
+    deviceObj["work_states"] = workStatesArray;
+    return deviceObj;
+}
+
+QJsonObject legacyDocument(const BenchFixture::Model& model)
+{
+    QJsonObject configObj = model.root.value("equipment_config").toObject();
+    QHash<QString, QJsonObject> existing;
+    for (const auto& v : configObj.value("equipment_types").toArray()) {
+        existing.insert(v.toObject().value("type_id").toString(), v.toObject());
+    }
+    QJsonArray types;
+    for (const EquipmentType* type : model.types) {
+        const QList<DeviceInstance*> devices = model.devices.value(type->getTypeId());
+        QJsonObject typeObj = ConfigSerializer::typeToJson(type, existing.value(type->getTypeId()), devices.size());
+        QJsonArray deviceArray;
+        for (const DeviceInstance* device : devices) {
+            deviceArray.append(legacyDeviceToJson(device));
+        }
+        typeObj["device_instances"] = deviceArray;
+        types.append(typeObj);
+    }
+    configObj["equipment_types"] = types;
+    QJsonObject root = model.root;
+    root["equipment_config"] = configObj;
+    return root;
+}
+}
+
+// 流式写出设备片段与旧的 QJsonObject 写法：解析后的内容必须一致，并比较两者的生成用时
+class SerializerBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        // 覆盖模板之外的键、特殊字符与小数的最短往返格式
+        DeviceInstance* device = m_model.devices.value(QStringLiteral("uhf")).first();
+        device->setBasicValue(QStringLiteral("legacy_key"), QStringLiteral("引号\"与\\反斜杠\n换行"));
+        device->setWorkStateValue(0, QStringLiteral("power"), 0.1);
+        device->setWorkStateValue(1, QStringLiteral("zz_undeclared"), 42);
+        m_model.replicate(QStringLiteral("uhf"), kDevices);
+        QVERIFY(m_dir.isValid());
+    }
+
+    void deviceOutputMatchesLegacy()
+    {
+        int checked = 0;
+        for (const QList<DeviceInstance*>& devices : m_model.devices) {
+            for (const DeviceInstance* device : devices) {
+                QByteArray bytes;
+                ConfigSerializer::writeDevice(bytes, device, 0);
+                QJsonParseError parseError;
+                const QJsonDocument doc = QJsonDocument::fromJson(bytes, &parseError);
+                QVERIFY2(parseError.error == QJsonParseError::NoError, qPrintable(parseError.errorString()));
+                QCOMPARE(doc.object(), legacyDeviceToJson(device));
+                ++checked;
+            }
+        }
+        QVERIFY(checked >= kDevices);
+    }
+
+    void documentMatchesLegacy()
+    {
+        const QString path = m_dir.filePath(QStringLiteral("serializer.json"));
+        ConfigSerializer serializer;
+        AtomicFileWriter writer(path);
+        QVERIFY(writer.open());
+        QVERIFY(serializer.serialize(writer, m_model.root, m_model.types, m_model.devices));
+        QVERIFY(writer.commit());
+
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+        QVERIFY(doc.isObject());
+        QCOMPARE(doc.object(), legacyDocument(m_model));
+    }
+
+    void writeDevicesStreaming()
+    {
+        const QList<DeviceInstance*> devices = m_model.devices.value(QStringLiteral("uhf"));
+        QBENCHMARK {
+            QByteArray out;
+            for (const DeviceInstance* device : devices) {
+                ConfigSerializer::writeDevice(out, device, 5);
+            }
+        }
+    }
+
+    void writeDevicesLegacy()
+    {
+        const QList<DeviceInstance*> devices = m_model.devices.value(QStringLiteral("uhf"));
+        QBENCHMARK {
+            QJsonArray array;
+            for (const DeviceInstance* device : devices) {
+                array.append(legacyDeviceToJson(device));
+            }
+            const QByteArray out = QJsonDocument(array).toJson();
+            QVERIFY(!out.isEmpty());
+        }
+    }
+
+private:
+    static constexpr int kDevices = 2000;
+    BenchFixture::Model m_model;
+    QTemporaryDir m_dir;
+};
+
+QTEST_MAIN(SerializerBenchmark)
+#include "bench_serializer.moc"
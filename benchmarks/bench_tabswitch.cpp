@@ -0,0 +1,83 @@
+﻿#include "BenchFixture.h"
+#include "DeviceTabWidget.h"
+#include "ParameterEditorPool.h"
+#include "ParameterFormModel.h"
+#include <QApplication>
+#include <QtTest>
+
+// 工作状态模板补足到 200 个参数的雷达设备：在两个状态页之间切换，直到排队事件（含重绘）处理完。
+// 第二项在每次切换后打开一个取值编辑器，覆盖编辑器回收池的复用路径
+class TabSwitchBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        QVERIFY(m_model.widenWorkStateTemplate(QStringLiteral("radar"), kParams));
+        m_device = m_model.devices.value(QStringLiteral("radar")).value(0);
+        QVERIFY(m_device);
+        const QString enableId = m_device->getEquipmentType()->getEnableParameterId();
+        if (!enableId.isEmpty()) {
+            m_device->setBasicValue(enableId, 1);
+        }
+        if (m_device->getWorkStateCount() < 2) {
+            m_device->setWorkStateCount(2);
+        }
+
+        m_tabs = new DeviceTabWidget(m_device);
+        m_tabs->resize(1200, 800);
+        m_tabs->show();
+        QVERIFY(QTest::qWaitForWindowExposed(m_tabs));
+        QVERIFY(m_tabs->count() >= 3); // 基本参数 + 至少两个状态页
+        ParameterFormView* view = viewAt(1);
+        QVERIFY(view);
+        QCOMPARE(view->formModel()->rowCount(), kParams);
+    }
+
+    void cleanupTestCase()
+    {
+        delete m_tabs;
+    }
+
+    void switchStateTabs()
+    {
+        int turn = 0;
+        QBENCHMARK {
+            m_tabs->setCurrentIndex(1 + (++turn % 2));
+            QApplication::processEvents();
+        }
+    }
+
+    void switchAndEdit()
+    {
+        const ParameterEditorPool::Stats before = ParameterEditorPool::stats();
+        int turn = 0;
+        QBENCHMARK {
+            const int index = 1 + (++turn % 2);
+            m_tabs->setCurrentIndex(index);
+            ParameterFormView* view = viewAt(index);
+            view->edit(view->model()->index(turn % kParams, ParameterFormModel::ValueColumn));
+            QApplication::processEvents();
+        }
+        const ParameterEditorPool::Stats after = ParameterEditorPool::stats();
+        qDebug() << "editors created:" << after.created - before.created
+                 << "reused:" << after.reused - before.reused;
+    }
+
+private:
+    static constexpr int kParams = 200;
+    BenchFixture::Model m_model;
+    DeviceInstance* m_device = nullptr;
+    DeviceTabWidget* m_tabs = nullptr;
+
+    ParameterFormView* viewAt(int index) const
+    {
+        QWidget* page = m_tabs->widget(index);
+        return page ? page->findChild<ParameterFormView*>() : nullptr;
+    }
+};
+
+QTEST_MAIN(TabSwitchBenchmark)
+#include "bench_tabswitch.moc"
@@ -0,0 +1,73 @@
+﻿#include "BenchFixture.h"
+#include "AppTheme.h"
+#include "DeviceTabWidget.h"
+#include <QApplication>
+#include <QFont>
+#include <QStyle>
+#include <QStyleFactory>
+#include <QtTest>
+
+// 各界面主题下构建一台雷达设备的全部页签（基本参数、16 个工作状态页、全部状态表格）并显示到
+// 排队事件处理完为止：对比 AppStyle + 调色板、旧的全局样式表与平台原生样式
+class ThemeBenchmark : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase()
+    {
+        QString error;
+        QVERIFY2(m_model.load(&error), qPrintable(error));
+        m_device = m_model.devices.value(QStringLiteral("radar")).value(0);
+        QVERIFY(m_device);
+        const QString enableId = m_device->getEquipmentType()->getEnableParameterId();
+        if (!enableId.isEmpty()) {
+            m_device->setBasicValue(enableId, 1);
+        }
+        m_device->setWorkStateCount(kStates);
+    }
+
+    void buildDeviceTabs_data()
+    {
+        QTest::addColumn<int>("mode");
+        // 调色板主题按类设置的字体无法撤销，放在最后
+        QTest::newRow("native") << static_cast<int>(AppTheme::NativeTheme);
+        QTest::newRow("stylesheet") << static_cast<int>(AppTheme::StyleSheetTheme);
+        QTest::newRow("palette") << static_cast<int>(AppTheme::PaletteTheme);
+    }
+
+    void buildDeviceTabs()
+    {
+        QFETCH(int, mode);
+        useTheme(static_cast<AppTheme::Mode>(mode));
+        QBENCHMARK {
+            DeviceTabWidget tabs(m_device);
+            tabs.resize(1200, 800);
+            tabs.show();
+            QApplication::processEvents();
+        }
+    }
+
+    void cleanupTestCase()
+    {
+        useTheme(AppTheme::NativeTheme);
+    }
+
+private:
+    static constexpr int kStates = 16;
+    BenchFixture::Model m_model;
+    DeviceInstance* m_device = nullptr;
+
+    // 先恢复为无样式表的 Fusion 默认外观，再应用要测的主题
+    static void useTheme(AppTheme::Mode mode)
+    {
+        QApplication* app = qobject_cast<QApplication*>(QCoreApplication::instance());
+        app->setStyleSheet(QString());
+        app->setStyle(QStyleFactory::create(QStringLiteral("Fusion")));
+        app->setPalette(app->style()->standardPalette());
+        app->setFont(QFont());
+        AppTheme::apply(*app, mode);
+    }
+};
+
+QTEST_MAIN(ThemeBenchmark)
+#include "bench_themes.moc"
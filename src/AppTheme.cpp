@@ -0,0 +1,379 @@
+﻿#include "AppTheme.h"
+#include "StyleHelper.h"
+#include <QApplication>
+#include <QDebug>
+#include <QFont>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPushButton>
+#include <QStyleFactory>
+#include <QStyleOption>
+#include <QTabBar>
+
+namespace {
+const QColor kInvalidBorder(0xdc, 0x26, 0x26);
+const QColor kInvalidBase(0xfe, 0xf2, 0xf2);
+const char* const kInvalidPaletteProperty = "themeInvalidPalette";
+
+bool isInvalid(const QWidget* widget)
+{
+    return widget && widget->property("invalid").toBool();
+}
+
+// 所有颜色组共用同一颜色，禁用态再单独覆盖
+void setAll(QPalette& palette, QPalette::ColorRole role, const QColor& color)
+{
+    palette.setColor(QPalette::Active, role, color);
+    palette.setColor(QPalette::Inactive, role, color);
+    palette.setColor(QPalette::Disabled, role, color);
+}
+
+QPainterPath roundedRect(const QRectF& rect, qreal radius)
+{
+    QPainterPath path;
+    path.addRoundedRect(rect, radius, radius);
+    return path;
+}
+}
+
+namespace AppTheme {
+
+Mode mode()
+{
+    static const Mode value = [] {
+        if (!qEnvironmentVariableIsEmpty("DISABLE_CUSTOM_STYLE")) {
+            return NativeTheme;
+        }
+        if (qgetenv("APP_THEME").toLower() == "stylesheet") {
+            return StyleSheetTheme;
+        }
+        return PaletteTheme;
+    }();
+    return value;
+}
+
+QString modeName()
+{
+    switch (mode()) {
+    case NativeTheme: return QStringLiteral("native");
+    case StyleSheetTheme: return QStringLiteral("stylesheet");
+    default: return QStringLiteral("palette");
+    }
+}
+
+QPalette lightPalette()
+{
+    QPalette palette;
+    setAll(palette, QPalette::Window, QColor("#f8fafc"));
+    setAll(palette, QPalette::WindowText, QColor("#0f172a"));
+    setAll(palette, QPalette::Base, QColor("#ffffff"));
+    setAll(palette, QPalette::AlternateBase, QColor("#f1f5f9"));
+    setAll(palette, QPalette::Text, QColor("#111827"));
+    setAll(palette, QPalette::Button, QColor("#e5ecf6"));
+    setAll(palette, QPalette::ButtonText, QColor("#0f172a"));
+    setAll(palette, QPalette::BrightText, QColor("#ffffff"));
+    setAll(palette, QPalette::Light, QColor("#ffffff"));
+    setAll(palette, QPalette::Midlight, QColor("#f1f5fd"));
+    setAll(palette, QPalette::Mid, QColor("#d0d7e2"));   // 分组框、页签边框
+    setAll(palette, QPalette::Dark, QColor("#c3cfe2"));  // 输入框边框
+    setAll(palette, QPalette::Shadow, QColor("#94a3b8"));
+    setAll(palette, QPalette::Highlight, QColor("#2563eb"));
+    setAll(palette, QPalette::HighlightedText, QColor("#ffffff"));
+    setAll(palette, QPalette::Link, QColor("#2563eb"));
+    setAll(palette, QPalette::ToolTipBase, QColor("#0f172a"));
+    setAll(palette, QPalette::ToolTipText, QColor("#f8fafc"));
+    palette.setColor(QPalette::Disabled, QPalette::Highlight, QColor("#a5b4fc"));
+    palette.setColor(QPalette::Disabled, QPalette::HighlightedText, QColor("#f1f5f9"));
+    palette.setColor(QPalette::Disabled, QPalette::Text, QColor("#94a3b8"));
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, QColor("#94a3b8"));
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, QColor("#94a3b8"));
+    return palette;
+}
+
+QPalette darkPalette()
+{
+    QPalette palette;
+    setAll(palette, QPalette::Window, QColor("#0b1220"));
+    setAll(palette, QPalette::WindowText, QColor("#f8fafc"));
+    setAll(palette, QPalette::Base, QColor("#0f172a"));
+    setAll(palette, QPalette::AlternateBase, QColor("#111827"));
+    setAll(palette, QPalette::Text, QColor("#e2e8f0"));
+    setAll(palette, QPalette::Button, QColor("#0f172a"));
+    setAll(palette, QPalette::ButtonText, QColor("#e2e8f0"));
+    setAll(palette, QPalette::BrightText, QColor("#f8fafc"));
+    setAll(palette, QPalette::Light, QColor("#1e293b"));
+    setAll(palette, QPalette::Midlight, QColor("#1e293b"));
+    setAll(palette, QPalette::Mid, QColor("#1f2937"));
+    setAll(palette, QPalette::Dark, QColor("#1f2937"));
+    setAll(palette, QPalette::Shadow, QColor("#020617"));
+    setAll(palette, QPalette::Highlight, QColor("#2563eb"));
+    setAll(palette, QPalette::HighlightedText, QColor("#f8fafc"));
+    setAll(palette, QPalette::Link, QColor("#60a5fa"));
+    setAll(palette, QPalette::ToolTipBase, QColor("#1e293b"));
+    setAll(palette, QPalette::ToolTipText, QColor("#f8fafc"));
+    palette.setColor(QPalette::Disabled, QPalette::Highlight, QColor("#334155"));
+    palette.setColor(QPalette::Disabled, QPalette::HighlightedText, QColor("#94a3b8"));
+    palette.setColor(QPalette::Disabled, QPalette::Text, QColor("#64748b"));
+    palette.setColor(QPalette::Disabled, QPalette::WindowText, QColor("#64748b"));
+    palette.setColor(QPalette::Disabled, QPalette::ButtonText, QColor("#64748b"));
+    return palette;
+}
+
+void apply(QApplication& app)
+{
+    apply(app, mode());
+    qDebug() << QString(u8"界面主题: %1").arg(modeName());
+}
+
+void apply(QApplication& app, Mode mode)
+{
+    switch (mode) {
+    case NativeTheme:
+        break;
+    case StyleSheetTheme:
+        app.setStyleSheet(StyleHelper::lightAppStyle());
+        break;
+    case PaletteTheme: {
+        app.setStyle(new AppStyle);
+        app.setPalette(lightPalette());
+        app.setPalette(darkPalette(), "QMenu"); // 与旧样式表一致，菜单保持深色
+
+        // 字体按类设置，不逐个控件写入
+        QFont::insertSubstitutions(QStringLiteral("Inter"),
+                                   QStringList() << QStringLiteral("Microsoft YaHei") << QStringLiteral("sans-serif"));
+        QFont font(QStringLiteral("Inter"));
+        font.setPixelSize(12);
+        app.setFont(font);
+        QFont labelFont(font);
+        labelFont.setWeight(QFont::DemiBold);
+        app.setFont(labelFont, "QLabel");
+        QFont titleFont(font);
+        titleFont.setBold(true);
+        app.setFont(titleFont, "QGroupBox");
+        break;
+    }
+    }
+}
+
+void applyDarkPanel(QWidget* panel)
+{
+    if (mode() == StyleSheetTheme) {
+        panel->setStyleSheet(StyleHelper::darkPanelStyle());
+        return;
+    }
+    panel->setPalette(darkPalette());
+    panel->setAutoFillBackground(true);
+}
+
+} // namespace AppTheme
+
+AppStyle::AppStyle()
+    : QProxyStyle(QStyleFactory::create(QStringLiteral("Fusion")))
+{
+}
+
+void AppStyle::polish(QWidget* widget)
+{
+    QProxyStyle::polish(widget);
+    // [invalid="true"] 的浅红底：委托与 ParameterItem 切换属性后会 unpolish/polish
+    if (isInvalid(widget)) {
+        QPalette palette = widget->palette();
+        palette.setColor(QPalette::Base, kInvalidBase);
+        widget->setPalette(palette);
+        widget->setProperty(kInvalidPaletteProperty, true);
+    }
+}
+
+void AppStyle::unpolish(QWidget* widget)
+{
+    if (widget->property(kInvalidPaletteProperty).toBool()) {
+        widget->setPalette(QPalette()); // 恢复为继承的调色板
+        widget->setProperty(kInvalidPaletteProperty, QVariant());
+    }
+    QProxyStyle::unpolish(widget);
+}
+
+void AppStyle::drawInputFrame(const QStyleOption* option, QPainter* painter, const QWidget* widget) const
+{
+    QColor border = option->palette.color(QPalette::Dark);
+    if (isInvalid(widget)) {
+        border = kInvalidBorder;
+    } else if (option->state & State_HasFocus) {
+        border = option->palette.color(QPalette::Highlight);
+    }
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing, true);
+    painter->setPen(QPen(border, 1));
+    painter->setBrush(Qt::NoBrush);
+    painter->drawPath(roundedRect(QRectF(option->rect).adjusted(0.5, 0.5, -0.5, -0.5), 5));
+    painter->restore();
+}
+
+void AppStyle::drawPrimitive(PrimitiveElement element, const QStyleOption* option,
+                             QPainter* painter, const QWidget* widget) const
+{
+    switch (element) {
+    case PE_PanelButtonCommand:
+        // 下拉框的按钮部分也走这里，只接管 QPushButton
+        if (qobject_cast<const QPushButton*>(widget)) {
+            QColor fill = option->palette.color(QPalette::Highlight);
+            if (!(option->state & State_Enabled)) {
+                fill = option->palette.color(QPalette::Disabled, QPalette::Highlight);
+            } else if (option->state & (State_Sunken | State_On)) {
+                fill = fill.darker(130);
+            } else if (option->state & State_MouseOver) {
+                fill = fill.darker(112);
+            }
+            painter->save();
+            painter->setRenderHint(QPainter::Antialiasing, true);
+            painter->setPen(Qt::NoPen);
+            painter->setBrush(fill);
+            painter->drawPath(roundedRect(QRectF(option->rect), 6));
+            painter->restore();
+            return;
+        }
+        break;
+    case PE_PanelLineEdit:
+        if (const QStyleOptionFrame* frame = qstyleoption_cast<const QStyleOptionFrame*>(option)) {
+            if (frame->lineWidth > 0) {
+                painter->save();
+                painter->setRenderHint(QPainter::Antialiasing, true);
+                painter->setPen(Qt::NoPen);
+                painter->setBrush(option->palette.brush(QPalette::Base));
+                painter->drawPath(roundedRect(QRectF(option->rect), 5));
+                painter->restore();
+                drawInputFrame(option, painter, widget);
+                return;
+            }
+        }
+        break;
+    case PE_FrameGroupBox: {
+        painter->save();
+        painter->setRenderHint(QPainter::Antialiasing, true);
+        painter->setPen(QPen(option->palette.color(QPalette::Mid), 1));
+        painter->setBrush(option->palette.brush(QPalette::Base));
+        painter->drawPath(roundedRect(QRectF(option->rect).adjusted(0.5, 0.5, -0.5, -0.5), 6));
+        painter->restore();
+        return;
+    }
+    case PE_FrameTabWidget:
+        painter->save();
+        painter->setPen(option->palette.color(QPalette::Mid));
+        painter->setBrush(option->palette.brush(QPalette::Window));
+        painter->drawRect(option->rect.adjusted(0, 0, -1, -1));
+        painter->restore();
+        return;
+    default:
+        break;
+    }
+    QProxyStyle::drawPrimitive(element, option, painter, widget);
+}
+
+void AppStyle::drawControl(ControlElement element, const QStyleOption* option,
+                           QPainter* painter, const QWidget* widget) const
+{
+    switch (element) {
+    case CE_PushButtonLabel:
+        if (qobject_cast<const QPushButton*>(widget)) {
+            if (const QStyleOptionButton* button = qstyleoption_cast<const QStyleOptionButton*>(option)) {
+                QStyleOptionButton copy(*button);
+                const QPalette::ColorGroup group = (option->state & State_Enabled) ? QPalette::Active : QPalette::Disabled;
+                copy.palette.setColor(QPalette::ButtonText, option->palette.color(group, QPalette::HighlightedText));
+                QProxyStyle::drawControl(element, &copy, painter, widget);
+                return;
+            }
+        }
+        break;
+    case CE_TabBarTabShape:
+        if (const QStyleOptionTab* tab = qstyleoption_cast<const QStyleOptionTab*>(option)) {
+            if (tab->shape == QTabBar::RoundedNorth) {
+                const bool selected = tab->state & State_Selected;
+                QColor fill = option->palette.color(QPalette::Button);
+                if (selected) {
+                    fill = option->palette.color(QPalette::Base);
+                } else if (tab->state & State_MouseOver) {
+                    fill = option->palette.color(QPalette::Midlight);
+                }
+                const QRectF rect = QRectF(option->rect).adjusted(2.5, 2.5, -2.5, selected ? 1 : 0);
+                QPainterPath path;
+                path.moveTo(rect.bottomLeft());
+                path.lineTo(rect.left(), rect.top() + 6);
+                path.quadTo(rect.topLeft(), QPointF(rect.left() + 6, rect.top()));
+                path.lineTo(rect.right() - 6, rect.top());
+                path.quadTo(rect.topRight(), QPointF(rect.right(), rect.top() + 6));
+                path.lineTo(rect.bottomRight());
+                painter->save();
+                painter->setRenderHint(QPainter::Antialiasing, true);
+                painter->setPen(selected ? QPen(option->palette.color(QPalette::Mid), 1) : QPen(Qt::NoPen));
+                painter->setBrush(fill);
+                painter->drawPath(path);
+                painter->restore();
+                return;
+            }
+        }
+        break;
+    case CE_TabBarTabLabel:
+        if (const QStyleOptionTab* tab = qstyleoption_cast<const QStyleOptionTab*>(option)) {
+            if (tab->state & State_Selected) {
+                QStyleOptionTab copy(*tab);
+                copy.palette.setColor(QPalette::WindowText, option->palette.color(QPalette::Highlight));
+                QProxyStyle::drawControl(element, &copy, painter, widget);
+                return;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    QProxyStyle::drawControl(element, option, painter, widget);
+}
+
+void AppStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex* option,
+                                  QPainter* painter, const QWidget* widget) const
+{
+    QProxyStyle::drawComplexControl(control, option, painter, widget);
+    // Fusion 画完后再叠加统一的圆角边框，聚焦与 invalid 的颜色与输入框一致
+    if (control == CC_SpinBox) {
+        const QStyleOptionSpinBox* spinBox = qstyleoption_cast<const QStyleOptionSpinBox*>(option);
+        if (spinBox && spinBox->frame) {
+            drawInputFrame(option, painter, widget);
+        }
+    } else if (control == CC_ComboBox) {
+        const QStyleOptionComboBox* comboBox = qstyleoption_cast<const QStyleOptionComboBox*>(option);
+        if (comboBox && comboBox->frame) {
+            drawInputFrame(option, painter, widget);
+        }
+    }
+}
+
+QSize AppStyle::sizeFromContents(ContentsType type, const QStyleOption* option,
+                                 const QSize& size, const QWidget* widget) const
+{
+    QSize result = QProxyStyle::sizeFromContents(type, option, size, widget);
+    switch (type) {
+    case CT_TabBarTab:
+        // 对应旧样式表 padding: 8px 16px; min-width: 130px
+        result.setWidth(qMax(result.width() + 12, 130));
+        result.setHeight(result.height() + 8);
+        break;
+    case CT_PushButton:
+        result.setHeight(qMax(result.height(), 28));
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+int AppStyle::pixelMetric(PixelMetric metric, const QStyleOption* option, const QWidget* widget) const
+{
+    switch (metric) {
+    case PM_TabBarTabOverlap:
+        return 0;
+    case PM_ButtonShiftHorizontal:
+    case PM_ButtonShiftVertical:
+        return 0;
+    default:
+        return QProxyStyle::pixelMetric(metric, option, widget);
+    }
+}
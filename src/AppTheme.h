@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <QPalette>
+#include <QProxyStyle>
+#include <QString>
+
+class QApplication;
+class QWidget;
+
+// 应用主题：默认使用 AppStyle（基于 Fusion 的 QProxyStyle）加 QPalette 绘制，
+// 不在 qApp 上设置样式表，表单控件创建时无需经过 QStyleSheetStyle 的规则匹配与 polish。
+// 环境变量：
+//   DISABLE_CUSTOM_STYLE 非空  -> 平台原生样式（与以前一致）
+//   APP_THEME=stylesheet       -> 旧版全局样式表，便于对比界面构建耗时
+namespace AppTheme {
+enum Mode {
+    NativeTheme,
+    PaletteTheme,
+    StyleSheetTheme
+};
+
+Mode mode();
+QString modeName();
+
+// 在创建任何窗口之前调用
+void apply(QApplication& app);
+// 应用指定主题，不读取环境变量（基准测试在同一进程中对比各主题）
+void apply(QApplication& app, Mode mode);
+
+// 结构/规则编辑器等深色面板；样式表主题下仍使用 StyleHelper::darkPanelStyle()
+void applyDarkPanel(QWidget* panel);
+
+QPalette lightPalette();
+QPalette darkPalette();
+} // namespace AppTheme
+
+// 与旧样式表等价的外观：蓝色圆角按钮、圆角输入框（聚焦蓝框，[invalid="true"] 红框浅红底）、
+// 圆角分组框与页签。颜色全部取自调色板，深色面板只需换调色板。
+class AppStyle : public QProxyStyle {
+    Q_OBJECT
+
+public:
+    AppStyle();
+
+    using QProxyStyle::polish;
+    using QProxyStyle::unpolish;
+    void polish(QWidget* widget) override;
+    void unpolish(QWidget* widget) override;
+
+    void drawPrimitive(PrimitiveElement element, const QStyleOption* option,
+                       QPainter* painter, const QWidget* widget = nullptr) const override;
+    void drawControl(ControlElement element, const QStyleOption* option,
+                     QPainter* painter, const QWidget* widget = nullptr) const override;
+    void drawComplexControl(ComplexControl control, const QStyleOptionComplex* option,
+                            QPainter* painter, const QWidget* widget = nullptr) const override;
+    QSize sizeFromContents(ContentsType type, const QStyleOption* option,
+                           const QSize& size, const QWidget* widget = nullptr) const override;
+    int pixelMetric(PixelMetric metric, const QStyleOption* option = nullptr,
+                    const QWidget* widget = nullptr) const override;
+
+private:
+    void drawInputFrame(const QStyleOption* option, QPainter* painter, const QWidget* widget) const;
+};
@@ -0,0 +1,130 @@
+﻿#include "AtomicFileWriter.h"
+#include <QDebug>
+
+double AtomicFileWriter::Stats::throughputMBps() const
+{
+    const double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+    return bytes / (1024.0 * 1024.0) / seconds;
+}
+
+AtomicFileWriter::AtomicFileWriter(const QString& fileName)
+    : m_fileName(fileName), m_file(fileName)
+{
+}
+
+AtomicFileWriter::~AtomicFileWriter()
+{
+    if (m_open) {
+        cancel();
+    }
+}
+
+bool AtomicFileWriter::open()
+{
+    m_timer.start();
+    m_stats = Stats();
+    m_error.clear();
+    m_buffer.clear();
+    m_buffer.reserve(kChunkSize);
+    if (!m_file.open(QIODevice::WriteOnly)) {
+        fail(QString(u8"无法创建临时文件: %1（%2）").arg(m_fileName, m_file.errorString()));
+        return false;
+    }
+    m_open = true;
+    return true;
+}
+
+bool AtomicFileWriter::write(const QByteArray& data)
+{
+    if (!m_open) {
+        return false;
+    }
+    // 大块数据直接分块写出，小片段先攒到一块再写，减少系统调用次数
+    if (m_buffer.isEmpty() && data.size() >= kChunkSize) {
+        for (int offset = 0; offset < data.size(); offset += kChunkSize) {
+            const int len = qMin(kChunkSize, data.size() - offset);
+            if (m_file.write(data.constData() + offset, len) != len) {
+                fail(QString(u8"写入失败: %1（%2）").arg(m_fileName, m_file.errorString()));
+                return false;
+            }
+            m_stats.bytes += len;
+        }
+        return true;
+    }
+    m_buffer.append(data);
+    if (m_buffer.size() >= kChunkSize) {
+        return flushBuffer();
+    }
+    return true;
+}
+
+bool AtomicFileWriter::flushBuffer()
+{
+    if (m_buffer.isEmpty()) {
+        return true;
+    }
+    if (m_file.write(m_buffer) != m_buffer.size()) {
+        fail(QString(u8"写入失败: %1（%2）").arg(m_fileName, m_file.errorString()));
+        return false;
+    }
+    m_stats.bytes += m_buffer.size();
+    m_buffer.clear();
+    return true;
+}
+
+bool AtomicFileWriter::commit()
+{
+    if (!m_open) {
+        return false;
+    }
+    if (!flushBuffer()) {
+        return false;
+    }
+    m_open = false;
+    // QSaveFile::commit 内部先刷盘再重命名覆盖目标文件
+    if (!m_file.commit()) {
+        m_error = QString(u8"保存失败，原文件未改动: %1（%2）").arg(m_fileName, m_file.errorString());
+        qWarning() << m_error;
+        return false;
+    }
+    m_stats.elapsedMs = m_timer.elapsed();
+    qDebug() << QString(u8"写入 %1：%2 KB，用时 %3 ms，%4 MB/s")
+                    .arg(m_fileName)
+                    .arg(m_stats.bytes / 1024.0, 0, 'f', 1)
+                    .arg(m_stats.elapsedMs)
+                    .arg(m_stats.throughputMBps(), 0, 'f', 1);
+    return true;
+}
+
+void AtomicFileWriter::cancel()
+{
+    m_buffer.clear();
+    if (m_open) {
+        m_file.cancelWriting();
+        m_file.commit(); // 已取消时只删除临时文件，不会覆盖目标
+        m_open = false;
+    }
+}
+
+void AtomicFileWriter::fail(const QString& message)
+{
+    m_error = message;
+    qWarning() << message;
+    cancel();
+}
+
+bool AtomicFileWriter::writeFile(const QString& fileName,
+                                 const QByteArray& data,
+                                 QString* error,
+                                 Stats* stats)
+{
+    AtomicFileWriter writer(fileName);
+    bool ok = writer.open() && writer.write(data) && writer.commit();
+    if (!ok && error) {
+        *error = writer.errorString();
+    }
+    if (stats) {
+        *stats = writer.stats();
+    }
+    return ok;
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSaveFile>
+
+// 配置文件落盘的统一出口：先写入同目录下的临时文件，分块缓冲输出，
+// commit 时刷盘（fsync / FlushFileBuffers）后原子替换目标文件。
+// 写入中途崩溃、磁盘写满或主动取消时，原文件保持不变。
+class AtomicFileWriter {
+public:
+    struct Stats {
+        qint64 bytes = 0;
+        qint64 elapsedMs = 0;
+        double throughputMBps() const; // 耗时不足 1ms 时按 1ms 计
+    };
+
+    explicit AtomicFileWriter(const QString& fileName);
+    ~AtomicFileWriter(); // 未 commit 时自动丢弃临时文件
+
+    bool open();
+    bool write(const QByteArray& data);  // 先进入缓冲区，满一块后写入临时文件
+    bool commit();                       // 刷出缓冲、刷盘并替换目标文件
+    void cancel();
+
+    QString fileName() const { return m_fileName; }
+    QString errorString() const { return m_error; }
+    Stats stats() const { return m_stats; }
+
+    // 一次性写入整块数据的便捷接口，失败时 error 给出原因
+    static bool writeFile(const QString& fileName,
+                          const QByteArray& data,
+                          QString* error = nullptr,
+                          Stats* stats = nullptr);
+
+    static constexpr int kChunkSize = 64 * 1024;
+
+private:
+    QString m_fileName;
+    QSaveFile m_file;
+    QByteArray m_buffer;
+    QElapsedTimer m_timer;
+    QString m_error;
+    Stats m_stats;
+    bool m_open = false;
+
+    bool flushBuffer();
+    void fail(const QString& message);
+};
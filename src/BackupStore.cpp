@@ -0,0 +1,502 @@
+﻿#include "BackupStore.h"
+#include "AtomicFileWriter.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+const char kDeltaMagic[] = "BKD1";
+const char kTimeFormat[] = "yyyyMMdd-HHmmss";
+
+void writeVarint(QByteArray& out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.append(static_cast<char>(value));
+}
+
+bool readVarint(const QByteArray& in, int& pos, quint64& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        const quint8 byte = static_cast<quint8>(in.at(pos++));
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 按行切分（保留换行符），返回每行的起止偏移
+QVector<QPair<int, int>> splitLines(const QByteArray& data)
+{
+    QVector<QPair<int, int>> lines;
+    int start = 0;
+    while (start < data.size()) {
+        int end = data.indexOf('\n', start);
+        end = end < 0 ? data.size() : end + 1;
+        lines.append(qMakePair(start, end));
+        start = end;
+    }
+    return lines;
+}
+}
+
+BackupStore::Policy BackupStore::Policy::fromEnvironment()
+{
+    Policy policy;
+    bool ok = false;
+    const int count = qgetenv("BACKUP_MAX_COUNT").toInt(&ok);
+    if (ok && count > 0) {
+        policy.maxCount = count;
+    }
+    const int days = qgetenv("BACKUP_MAX_AGE_DAYS").toInt(&ok);
+    if (ok && days > 0) {
+        policy.maxAgeDays = days;
+    }
+    return policy;
+}
+
+BackupStore::BackupStore(const QString& configFile, const Policy& policy)
+    : m_configFile(configFile),
+      m_directory(configFile + QStringLiteral(".backups")),
+      m_policy(policy)
+{
+}
+
+QList<BackupStore::Version> BackupStore::versions() const
+{
+    static const QRegularExpression pattern(QStringLiteral("^(\\d+)_(\\d{8}-\\d{6})\\.(full|delta)$"));
+    QList<Version> list;
+    const QFileInfoList entries = QDir(m_directory).entryInfoList(QDir::Files, QDir::Name);
+    for (const QFileInfo& entry : entries) {
+        const QRegularExpressionMatch match = pattern.match(entry.fileName());
+        if (!match.hasMatch()) {
+            continue;
+        }
+        Version version;
+        version.id = match.captured(1).toInt();
+        version.time = QDateTime::fromString(match.captured(2), QString::fromLatin1(kTimeFormat));
+        version.full = match.captured(3) == QLatin1String("full");
+        version.storedBytes = entry.size();
+        version.fileName = entry.absoluteFilePath();
+        list.append(version);
+    }
+    std::sort(list.begin(), list.end(), [](const Version& a, const Version& b) { return a.id < b.id; });
+    return list;
+}
+
+bool BackupStore::addFile(QString* error)
+{
+    QFile file(m_configFile);
+    if (!file.exists()) {
+        return true; // 首次保存，没有可备份的内容
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString(u8"无法读取配置文件: %1").arg(m_configFile);
+        return false;
+    }
+    return add(file.readAll(), error);
+}
+
+bool BackupStore::add(const QByteArray& content, QString* error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (!append(content, QDateTime::currentDateTime(), error)) {
+        return false;
+    }
+    qDebug() << QString(u8"备份完成：原文件 %1 KB，%2 ms")
+                    .arg(content.size() / 1024.0, 0, 'f', 1)
+                    .arg(timer.elapsed());
+    prune();
+    return true;
+}
+
+bool BackupStore::append(const QByteArray& content, const QDateTime& time, QString* error)
+{
+    if (!QDir().mkpath(m_directory)) {
+        if (error) *error = QString(u8"无法创建备份目录: %1").arg(m_directory);
+        return false;
+    }
+
+    const QList<Version> list = versions();
+    bool full = true;
+    QByteArray payload = content;
+    if (!list.isEmpty()) {
+        QByteArray previous;
+        if (loadHead(list.last().id, previous)) {
+            if (previous == content) {
+                qDebug() << QString(u8"配置文件与最新备份相同，跳过备份");
+                return true;
+            }
+            // 距上一个完整版本太远，或改动太多差量不划算时保存完整内容
+            int sinceFull = 0;
+            for (int i = list.size() - 1; i >= 0 && !list.at(i).full; --i) {
+                ++sinceFull;
+            }
+            if (sinceFull + 1 < m_policy.keyframeInterval) {
+                const QByteArray delta = makeDelta(previous, content);
+                if (delta.size() < content.size() / 2) {
+                    full = false;
+                    payload = delta;
+                }
+            }
+        }
+    }
+
+    const int id = list.isEmpty() ? 1 : list.last().id + 1;
+    if (!writeVersion(id, time, full, payload, error)) {
+        return false;
+    }
+    storeHead(id, content);
+    qDebug() << QString(u8"备份版本 %1（%2）").arg(id).arg(full ? u8"完整" : u8"差量");
+    return true;
+}
+
+QString BackupStore::headPath() const
+{
+    return m_directory + QStringLiteral("/head");
+}
+
+// head 文件首行是对应的版本号，与最新版本不一致（被外部改动或写入中断）时回放差量链
+bool BackupStore::loadHead(int latestId, QByteArray& content) const
+{
+    if (m_headId == latestId) {
+        content = m_head;
+        return true;
+    }
+    QFile file(headPath());
+    if (file.open(QIODevice::ReadOnly)) {
+        const QByteArray data = file.readAll();
+        const int newline = data.indexOf('\n');
+        bool ok = false;
+        if (newline > 0 && data.left(newline).toInt(&ok) == latestId && ok) {
+            content = data.mid(newline + 1);
+            m_headId = latestId;
+            m_head = content;
+            return true;
+        }
+    }
+    if (!load(latestId, content)) {
+        return false;
+    }
+    m_headId = latestId;
+    m_head = content;
+    return true;
+}
+
+void BackupStore::storeHead(int id, const QByteArray& content)
+{
+    m_headId = id;
+    m_head = content;
+    QString error;
+    if (!AtomicFileWriter::writeFile(headPath(), QByteArray::number(id) + '\n' + content, &error)) {
+        // 缺少 head 只影响下次备份的速度
+        qWarning() << QString(u8"无法写入最新备份内容: %1").arg(error);
+        QFile::remove(headPath());
+    }
+}
+
+bool BackupStore::writeVersion(int id, const QDateTime& time, bool full, const QByteArray& payload, QString* error)
+{
+    const QString name = QString("%1/%2_%3.%4")
+                             .arg(m_directory)
+                             .arg(id, 6, 10, QLatin1Char('0'))
+                             .arg(time.toString(QString::fromLatin1(kTimeFormat)))
+                             .arg(full ? "full" : "delta");
+    return AtomicFileWriter::writeFile(name, qCompress(payload), error);
+}
+
+bool BackupStore::readPayload(const Version& version, QByteArray& payload, QString* error) const
+{
+    QFile file(version.fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString(u8"无法读取备份: %1").arg(version.fileName);
+        return false;
+    }
+    const QByteArray stored = file.readAll();
+    // 空内容经 qCompress 后只剩 4 字节的零长度头，qUncompress 会把它当作损坏数据
+    if (stored == QByteArray(4, '\0')) {
+        payload.clear();
+        return true;
+    }
+    payload = qUncompress(stored);
+    if (payload.isEmpty()) {
+        if (error) *error = QString(u8"备份已损坏: %1").arg(version.fileName);
+        return false;
+    }
+    return true;
+}
+
+bool BackupStore::load(int id, QByteArray& content, QString* error) const
+{
+    const QList<Version> list = versions();
+    int target = -1;
+    for (int i = 0; i < list.size(); ++i) {
+        if (list.at(i).id == id) {
+            target = i;
+            break;
+        }
+    }
+    if (target < 0) {
+        if (error) *error = QString(u8"备份版本 %1 不存在").arg(id);
+        return false;
+    }
+
+    // 从最近的完整版本开始依次回放差量
+    int start = target;
+    while (start >= 0 && !list.at(start).full) {
+        --start;
+    }
+    if (start < 0) {
+        if (error) *error = QString(u8"备份版本 %1 缺少完整基准").arg(id);
+        return false;
+    }
+    if (!readPayload(list.at(start), content, error)) {
+        return false;
+    }
+    for (int i = start + 1; i <= target; ++i) {
+        QByteArray delta;
+        QByteArray next;
+        if (!readPayload(list.at(i), delta, error)) {
+            return false;
+        }
+        if (!applyDelta(content, delta, next)) {
+            if (error) *error = QString(u8"备份差量无法应用: %1").arg(list.at(i).fileName);
+            return false;
+        }
+        content.swap(next);
+    }
+    return true;
+}
+
+bool BackupStore::restore(int id, QString* error)
+{
+    QByteArray content;
+    if (!load(id, content, error)) {
+        return false;
+    }
+    // 恢复前先保存当前内容，恢复操作本身也可以撤回
+    if (!addFile(error)) {
+        return false;
+    }
+    if (!AtomicFileWriter::writeFile(m_configFile, content, error)) {
+        return false;
+    }
+    qDebug() << QString(u8"已从备份版本 %1 恢复: %2").arg(id).arg(m_configFile);
+    return true;
+}
+
+void BackupStore::prune()
+{
+    const QList<Version> list = versions();
+    if (list.isEmpty()) {
+        return;
+    }
+    const QDateTime cutoff = QDateTime::currentDateTime().addDays(-m_policy.maxAgeDays);
+    int firstKept = qMax(0, list.size() - m_policy.maxCount);
+    while (firstKept < list.size() - 1 && list.at(firstKept).time.isValid() && list.at(firstKept).time < cutoff) {
+        ++firstKept;
+    }
+    if (firstKept == 0) {
+        return;
+    }
+
+    // 最早保留的版本依赖将被删除的版本时，先改写为完整内容
+    const Version& oldest = list.at(firstKept);
+    if (!oldest.full) {
+        QByteArray content;
+        QString error;
+        if (!load(oldest.id, content, &error) || !writeVersion(oldest.id, oldest.time, true, content, &error)) {
+            qWarning() << QString(u8"备份清理中止: %1").arg(error);
+            return;
+        }
+        QFile::remove(oldest.fileName);
+    }
+    for (int i = 0; i < firstKept; ++i) {
+        QFile::remove(list.at(i).fileName);
+    }
+    qDebug() << QString(u8"备份清理：删除 %1 个旧版本").arg(firstKept);
+}
+
+int BackupStore::importLegacyBackups(QString* error)
+{
+    const QFileInfo config(m_configFile);
+    const QString prefix = config.completeBaseName() + QStringLiteral(".backup_");
+    static const QRegularExpression pattern(QStringLiteral("^(\\d{8}_\\d{6})\\.json$"));
+    QList<QPair<QDateTime, QString>> legacy;
+    const QFileInfoList entries =
+        QDir(config.path()).entryInfoList(QStringList() << prefix + QStringLiteral("*.json"), QDir::Files, QDir::Name);
+    for (const QFileInfo& entry : entries) {
+        const QRegularExpressionMatch match = pattern.match(entry.fileName().mid(prefix.size()));
+        if (match.hasMatch()) {
+            legacy.append(qMakePair(QDateTime::fromString(match.captured(1), QStringLiteral("yyyyMMdd_HHmmss")),
+                                    entry.absoluteFilePath()));
+        }
+    }
+    if (legacy.isEmpty()) {
+        return 0;
+    }
+
+    // 旧备份都早于版本库中已有的版本：在临时目录里按时间顺序重建整个版本库，成功后再替换，
+    // 中途失败时原版本库与旧备份文件都不受影响
+    QList<QPair<QDateTime, QByteArray>> contents;
+    for (const Version& version : versions()) {
+        QByteArray content;
+        if (!load(version.id, content, error)) {
+            return -1;
+        }
+        contents.append(qMakePair(version.time, content));
+    }
+    for (const QPair<QDateTime, QString>& item : legacy) {
+        QFile file(item.second);
+        if (!file.open(QIODevice::ReadOnly)) {
+            if (error) *error = QString(u8"无法读取旧备份: %1").arg(item.second);
+            return -1;
+        }
+        contents.append(qMakePair(item.first, file.readAll()));
+    }
+    std::stable_sort(contents.begin(), contents.end(),
+                     [](const QPair<QDateTime, QByteArray>& a, const QPair<QDateTime, QByteArray>& b) {
+                         return a.first < b.first;
+                     });
+
+    BackupStore staging(m_configFile, m_policy);
+    staging.m_directory = m_directory + QStringLiteral(".import");
+    QDir(staging.m_directory).removeRecursively();
+    for (const QPair<QDateTime, QByteArray>& item : contents) {
+        if (!staging.append(item.second, item.first, error)) {
+            QDir(staging.m_directory).removeRecursively();
+            return -1;
+        }
+    }
+    if (QDir(m_directory).exists() && !QDir(m_directory).removeRecursively()) {
+        if (error) *error = QString(u8"无法替换备份目录: %1").arg(m_directory);
+        QDir(staging.m_directory).removeRecursively();
+        return -1;
+    }
+    if (!QDir().rename(staging.m_directory, m_directory)) {
+        if (error) *error = QString(u8"无法替换备份目录: %1").arg(m_directory);
+        return -1;
+    }
+    // 重建后版本号对应的内容已变，内存中的缓存作废（head 文件随临时目录一起替换）
+    m_headId = 0;
+    m_head.clear();
+    for (const QPair<QDateTime, QString>& item : legacy) {
+        QFile::remove(item.second);
+    }
+    qDebug() << QString(u8"已导入 %1 个旧备份文件: %2").arg(legacy.size()).arg(m_directory);
+    prune();
+    return legacy.size();
+}
+
+QByteArray BackupStore::makeDelta(const QByteArray& base, const QByteArray& target)
+{
+    const QVector<QPair<int, int>> baseLines = splitLines(base);
+    QHash<QByteArray, int> firstLine; // 行内容 -> 基准中首次出现的行号
+    firstLine.reserve(baseLines.size());
+    for (int i = 0; i < baseLines.size(); ++i) {
+        const QByteArray line = QByteArray::fromRawData(base.constData() + baseLines.at(i).first,
+                                                        baseLines.at(i).second - baseLines.at(i).first);
+        if (!firstLine.contains(line)) {
+            firstLine.insert(line, i);
+        }
+    }
+
+    QByteArray out(kDeltaMagic);
+    QByteArray literal;
+    int copyStart = -1;
+    int copyEnd = -1;
+    int nextBaseLine = -1;
+    auto flushCopy = [&]() {
+        if (copyStart >= 0) {
+            out.append('C');
+            writeVarint(out, static_cast<quint64>(copyStart));
+            writeVarint(out, static_cast<quint64>(copyEnd - copyStart));
+            copyStart = -1;
+        }
+    };
+    auto flushLiteral = [&]() {
+        if (!literal.isEmpty()) {
+            out.append('I');
+            writeVarint(out, static_cast<quint64>(literal.size()));
+            out.append(literal);
+            literal.clear();
+        }
+    };
+
+    for (const QPair<int, int>& range : splitLines(target)) {
+        const QByteArray line = QByteArray::fromRawData(target.constData() + range.first, range.second - range.first);
+        int match = -1;
+        // 优先延续上一段连续复制，重复出现的行（如 "}," ）才不会跳到别处
+        if (nextBaseLine >= 0 && nextBaseLine < baseLines.size() &&
+            line == QByteArray::fromRawData(base.constData() + baseLines.at(nextBaseLine).first,
+                                            baseLines.at(nextBaseLine).second - baseLines.at(nextBaseLine).first)) {
+            match = nextBaseLine;
+        } else {
+            match = firstLine.value(line, -1);
+        }
+
+        if (match < 0) {
+            flushCopy();
+            literal.append(line);
+            nextBaseLine = -1;
+            continue;
+        }
+        flushLiteral();
+        const int start = baseLines.at(match).first;
+        const int end = baseLines.at(match).second;
+        if (copyStart >= 0 && start == copyEnd) {
+            copyEnd = end;
+        } else {
+            flushCopy();
+            copyStart = start;
+            copyEnd = end;
+        }
+        nextBaseLine = match + 1;
+    }
+    flushCopy();
+    flushLiteral();
+    return out;
+}
+
+bool BackupStore::applyDelta(const QByteArray& base, const QByteArray& delta, QByteArray& out)
+{
+    if (!delta.startsWith(kDeltaMagic)) {
+        return false;
+    }
+    out.clear();
+    out.reserve(base.size());
+    int pos = static_cast<int>(sizeof(kDeltaMagic) - 1);
+    while (pos < delta.size()) {
+        const char op = delta.at(pos++);
+        quint64 a = 0;
+        quint64 b = 0;
+        if (op == 'C') {
+            if (!readVarint(delta, pos, a) || !readVarint(delta, pos, b) ||
+                a + b > static_cast<quint64>(base.size())) {
+                return false;
+            }
+            out.append(base.constData() + a, static_cast<int>(b));
+        } else if (op == 'I') {
+            if (!readVarint(delta, pos, a) || a > static_cast<quint64>(delta.size() - pos)) {
+                return false;
+            }
+            out.append(delta.constData() + pos, static_cast<int>(a));
+            pos += static_cast<int>(a);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+// 结构编辑保存前的历史版本存储：<配置文件>.backups/ 目录下每个版本一个压缩文件。
+// 相邻版本通常只差几行，因此多数版本只保存相对上一版本的按行差量（copy / insert），
+// 每隔若干版本或差量过大时保存一份完整内容，限制恢复时需要回放的差量链长度。
+// 按数量与天数保留，删除旧版本时把最早保留的差量版本改写为完整内容，保证任意保留版本都能恢复。
+// 最新版本的完整内容另存一份未压缩的 head 文件（并缓存在内存中），新增版本时直接与它比较，
+// 不必回放整条差量链。
+class BackupStore {
+public:
+    struct Policy {
+        int maxCount = 20;        // 最多保留的版本数，BACKUP_MAX_COUNT 可覆盖
+        int maxAgeDays = 30;      // 超过天数的版本删除（最新版本总是保留），BACKUP_MAX_AGE_DAYS 可覆盖
+        int keyframeInterval = 10; // 每隔多少个版本保存一次完整内容
+        static Policy fromEnvironment();
+    };
+
+    struct Version {
+        int id = 0;
+        QDateTime time;
+        bool full = false;
+        qint64 storedBytes = 0; // 压缩后占用的字节数
+        QString fileName;
+    };
+
+    explicit BackupStore(const QString& configFile, const Policy& policy = Policy::fromEnvironment());
+
+    QString directory() const { return m_directory; }
+    QList<Version> versions() const; // 从旧到新
+
+    // 把配置文件当前内容存为新版本（与最新版本相同时跳过），随后按保留策略清理
+    bool addFile(QString* error = nullptr);
+    bool add(const QByteArray& content, QString* error = nullptr);
+    bool load(int id, QByteArray& content, QString* error = nullptr) const;
+    // 先备份当前内容，再把指定版本原子写回配置文件
+    bool restore(int id, QString* error = nullptr);
+    void prune();
+    // 把旧版本遗留在配置文件旁的 <文件名>.backup_<时间>.json 按时间顺序并入版本库并删除原文件，
+    // 返回导入的个数，失败返回 -1（原文件保留）
+    int importLegacyBackups(QString* error = nullptr);
+
+    // 按行差量：基准中能找到的连续行记为 copy(偏移, 长度)，其余作为 insert 原样保存
+    static QByteArray makeDelta(const QByteArray& base, const QByteArray& target);
+    static bool applyDelta(const QByteArray& base, const QByteArray& delta, QByteArray& out);
+
+private:
+    QString m_configFile;
+    QString m_directory;
+    Policy m_policy;
+    mutable int m_headId = 0;   // m_head 对应的版本号，0 表示未缓存
+    mutable QByteArray m_head;  // 最新版本的完整内容
+
+    QString headPath() const;
+    bool loadHead(int latestId, QByteArray& content) const;
+    void storeHead(int id, const QByteArray& content);
+    bool append(const QByteArray& content, const QDateTime& time, QString* error);
+    bool writeVersion(int id, const QDateTime& time, bool full, const QByteArray& payload, QString* error);
+    bool readPayload(const Version& version, QByteArray& payload, QString* error) const;
+};
@@ -0,0 +1,213 @@
+﻿#include "BatchValidator.h"
+#include "ConfigLoader.h"
+#include "ShardedStorage.h"
+#include "ValidationEngine.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include <QCommandLineParser>
+#include <QCommandLineOption>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+// QtConcurrent 在 Qt5.5 下要求函数对象声明 result_type
+struct ValidateFileFunctor {
+    typedef BatchValidator::FileResult result_type;
+    int maxIssues;
+    explicit ValidateFileFunctor(int limit) : maxIssues(limit) {}
+    result_type operator()(const QString& file) const
+    {
+        return BatchValidator::validateFile(file, maxIssues);
+    }
+};
+
+void writeLine(FILE* out, const QJsonObject& obj)
+{
+    const QByteArray line = QJsonDocument(obj).toJson(QJsonDocument::Compact);
+    fwrite(line.constData(), 1, static_cast<size_t>(line.size()), out);
+    fputc('\n', out);
+}
+
+void writeText(FILE* out, const QString& text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    fprintf(out, "%s\n", utf8.constData());
+}
+}
+
+bool BatchValidator::isRequested(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--validate") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BatchValidator::FileResult BatchValidator::validateFile(const QString& file, int maxIssues)
+{
+    FileResult result;
+    result.file = file;
+    result.report = ValidationReport(maxIssues);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QJsonObject rootObj;
+    if (!ConfigLoader::readRoot(file, rootObj, &result.error)) {
+        result.elapsedMs = timer.elapsed();
+        return result;
+    }
+    QJsonObject configObj;
+    if (!ShardedStorage::loadShards(file, rootObj, configObj, &result.error)) {
+        result.elapsedMs = timer.elapsed();
+        return result;
+    }
+    result.loaded = true;
+
+    QList<EquipmentType*> types;
+    QMap<QString, QList<DeviceInstance*>> devices;
+    ConfigLoader::buildModel(configObj, types, devices);
+
+    ValidationEngine engine(types, devices);
+    engine.run(result.report);
+
+    ConfigLoader::clear(types, devices);
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+QJsonObject BatchValidator::toJson(const FileResult& result)
+{
+    QJsonObject obj;
+    obj.insert("file", result.file);
+    obj.insert("elapsed_ms", static_cast<double>(result.elapsedMs));
+    if (!result.loaded) {
+        obj.insert("status", QStringLiteral("error"));
+        obj.insert("error", result.error);
+        return obj;
+    }
+
+    const ValidationReport& report = result.report;
+    obj.insert("status", report.isEmpty() ? QStringLiteral("passed") : QStringLiteral("failed"));
+    obj.insert("issue_count", report.totalCount());
+    obj.insert("truncated", report.isTruncated());
+
+    QJsonArray issues;
+    for (const ValidationIssue& issue : report.issues()) {
+        QJsonObject item;
+        item.insert("code", issue.codeName());
+        item.insert("type_id", issue.typeId);
+        item.insert("device_id", issue.deviceId);
+        item.insert("state_index", issue.stateIndex);
+        item.insert("param_id", issue.paramId);
+        if (!issue.ruleId.isEmpty()) {
+            item.insert("rule_id", issue.ruleId);
+        }
+        item.insert("message", issue.message());
+        issues.append(item);
+    }
+    obj.insert("issues", issues);
+    return obj;
+}
+
+int BatchValidator::run(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(u8"装备参数配置工具 - 批量校验模式");
+    QCommandLineOption helpOption = parser.addHelpOption();
+    QCommandLineOption validateOption("validate", u8"只校验给定的配置文件，不启动界面");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  u8"并行校验的线程数，默认等于CPU核数", "n");
+    QCommandLineOption maxIssuesOption("max-issues",
+                                       u8"每个文件最多输出的问题条数（<=0 不限制），默认500或VALIDATION_MAX_ISSUES",
+                                       "n");
+    parser.addOption(validateOption);
+    parser.addOption(jobsOption);
+    parser.addOption(maxIssuesOption);
+    parser.addPositionalArgument("files", u8"待校验的配置文件", "<file.json...>");
+
+    if (!parser.parse(arguments)) {
+        writeText(stderr, parser.errorText());
+        return LoadFailed;
+    }
+    if (parser.isSet(helpOption)) {
+        writeText(stdout, parser.helpText());
+        return AllPassed;
+    }
+
+    const QStringList files = parser.positionalArguments();
+    if (files.isEmpty()) {
+        writeText(stderr, u8"未指定待校验的配置文件");
+        return LoadFailed;
+    }
+
+    int maxIssues = 500;
+    bool ok = false;
+    const int envMax = qgetenv("VALIDATION_MAX_ISSUES").toInt(&ok);
+    if (ok) {
+        maxIssues = envMax;
+    }
+    if (parser.isSet(maxIssuesOption)) {
+        maxIssues = parser.value(maxIssuesOption).toInt(&ok);
+        if (!ok) {
+            writeText(stderr, QString(u8"无效的 --max-issues 取值: %1").arg(parser.value(maxIssuesOption)));
+            return LoadFailed;
+        }
+    }
+    if (parser.isSet(jobsOption)) {
+        const int jobs = parser.value(jobsOption).toInt(&ok);
+        if (!ok || jobs <= 0) {
+            writeText(stderr, QString(u8"无效的 --jobs 取值: %1").arg(parser.value(jobsOption)));
+            return LoadFailed;
+        }
+        QThreadPool::globalInstance()->setMaxThreadCount(jobs);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 单个文件直接在当前线程处理；多个文件交给线程池，结果仍按输入顺序输出
+    QVector<FileResult> results;
+    if (files.size() == 1) {
+        results.append(validateFile(files.first(), maxIssues));
+    } else {
+        results = QtConcurrent::blockingMapped<QVector<FileResult>>(files, ValidateFileFunctor(maxIssues));
+    }
+
+    int passed = 0;
+    int failed = 0;
+    int errors = 0;
+    for (const FileResult& result : results) {
+        writeLine(stdout, toJson(result));
+        if (!result.loaded) {
+            ++errors;
+        } else if (result.report.isEmpty()) {
+            ++passed;
+        } else {
+            ++failed;
+        }
+    }
+
+    QJsonObject summary;
+    summary.insert("files", results.size());
+    summary.insert("passed", passed);
+    summary.insert("failed", failed);
+    summary.insert("errors", errors);
+    summary.insert("elapsed_ms", static_cast<double>(timer.elapsed()));
+    QJsonObject summaryLine;
+    summaryLine.insert("summary", summary);
+    writeLine(stdout, summaryLine);
+    fflush(stdout);
+
+    if (errors > 0) {
+        return LoadFailed;
+    }
+    return failed > 0 ? IssuesFound : AllPassed;
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "ValidationReport.h"
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+
+// 命令行批量校验：EquipmentConfig --validate a.json b.json ...
+// 只经过数据模型加载与校验，不创建任何界面对象；给定多个文件时在线程池中并行处理。
+// 标准输出按输入顺序每个文件一行 JSON（JSON Lines），最后一行为汇总；日志统一走标准错误。
+class BatchValidator {
+public:
+    enum ExitCode {
+        AllPassed = 0,   // 全部通过
+        IssuesFound = 1, // 至少一个文件存在校验问题
+        LoadFailed = 2   // 存在无法读取/解析的文件，或命令行参数错误
+    };
+
+    struct FileResult {
+        QString file;
+        bool loaded = false;
+        QString error;
+        ValidationReport report;
+        qint64 elapsedMs = 0;
+    };
+
+    // 在创建 QApplication 之前判断是否进入批量校验模式
+    static bool isRequested(int argc, char* argv[]);
+    static int run(const QStringList& arguments);
+
+    static FileResult validateFile(const QString& file, int maxIssues);
+    static QJsonObject toJson(const FileResult& result);
+};
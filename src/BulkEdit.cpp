@@ -0,0 +1,222 @@
+﻿#include "BulkEdit.h"
+#include "DeviceInstance.h"
+#include "EquipmentType.h"
+#include "ParameterItem.h"
+#include "RuleExpression.h"
+#include "ValidationEngine.h"
+#include "WorkStateTemplate.h"
+#include <QElapsedTimer>
+#include <QSet>
+#include <QDebug>
+#include <cmath>
+
+namespace {
+struct PendingCell {
+    DeviceInstance* device;
+    int stateIndex; // -1 为基本参数
+    QVariantMap changes; // 参数ID -> 新值，含选项规则联动修改的目标参数
+};
+
+QString cellName(const DeviceInstance* device, int stateIndex)
+{
+    return stateIndex < 0 ? device->getDeviceName()
+                          : QString(u8"%1 工作状态 %2").arg(device->getDeviceName()).arg(stateIndex + 1);
+}
+
+int slotOf(const QList<ParameterItem*>& params, const QString& parameterId)
+{
+    for (int i = 0; i < params.size(); ++i) {
+        if (params.at(i)->getId() == parameterId) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 与 ParameterFormModel::applyRules 相同：控制参数变化后，目标枚举的取值不在新选项中时改为第一项，
+// 被改动的目标若本身也是控制参数则继续联动；每个参数最多改动一次
+void cascadeOptions(const ParameterRuleSet& rules, const QList<ParameterItem*>& params,
+                    const QString& controllerId, QVariantMap& values, QVariantMap& changes)
+{
+    QStringList queue(controllerId);
+    while (!queue.isEmpty()) {
+        const QString id = queue.takeFirst();
+        if (!rules.isOptionController(id)) {
+            continue;
+        }
+        for (int target : rules.optionTargets(id)) {
+            const ParameterItem* targetParam = params.at(target);
+            const QString targetId = targetParam->getId();
+            if (changes.contains(targetId)) {
+                continue;
+            }
+            const QStringList opts = rules.optionsFor(target, values);
+            if (!opts.isEmpty() && !opts.contains(values.value(targetId).toString())) {
+                const QVariant first = targetParam->coerce(opts.first());
+                values.insert(targetId, first);
+                changes.insert(targetId, first);
+                queue.append(targetId);
+            }
+        }
+    }
+}
+}
+
+BulkEdit::Outcome BulkEdit::apply(const Request& request, const ParameterItem* param)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Outcome outcome;
+    if (!param) {
+        outcome.errors << QString(u8"参数不存在: %1").arg(request.paramId);
+        return outcome;
+    }
+
+    // 规则与约束按设备类型编译，所选设备属于同一类型
+    EquipmentType* equipType = request.devices.isEmpty() ? nullptr : request.devices.first()->getEquipmentType();
+    WorkStateTemplate* tmpl = equipType ? equipType->getWorkStateTemplate() : nullptr;
+    const ParameterRuleSet* rules = nullptr;
+    QList<ParameterItem*> params;
+    if (request.stateParameter && tmpl) {
+        rules = &tmpl->getRules();
+        params = tmpl->getParameters();
+    } else if (!request.stateParameter && equipType) {
+        rules = &equipType->getBasicRules();
+        params = equipType->getBasicParameters();
+    }
+    const int slot = slotOf(params, request.paramId);
+    const bool isEnum = param->getType() == "enum";
+    // 工作状态数量改变状态个数本身，不做单状态约束试算
+    const bool checkConstraints = tmpl && (request.stateParameter || request.paramId != "work_state_count");
+
+    const QString type = param->getType();
+    const bool numeric = type == "int" || type == "Byte" || type == "double";
+    RuleExpression expression;
+    QVariantMap xValue; // 表达式中的 x：当前单元格的取值
+    QVariant fixedValue;
+    if (request.expression) {
+        if (!numeric) {
+            outcome.errors << QString(u8"%1 不是数值参数，不能使用表达式").arg(param->getLabel());
+            return outcome;
+        }
+        QString error;
+        if (!expression.compile(request.text, &error)) {
+            outcome.errors << error;
+            return outcome;
+        }
+        for (const QString& id : expression.variables()) {
+            if (id != QLatin1String("x") && slotOf(params, id) < 0) {
+                outcome.errors << QString(u8"表达式引用了未知参数: %1").arg(id);
+                return outcome;
+            }
+        }
+    } else {
+        fixedValue = param->coerce(request.text.trimmed());
+    }
+
+    // 第一遍：计算新值并在副本上试算，不修改模型
+    QVector<PendingCell> pending;
+    auto report = [&](DeviceInstance* device, int stateIndex, const QString& message) {
+        if (outcome.errors.size() < kMaxErrors) {
+            outcome.errors << QString(u8"%1：%2").arg(cellName(device, stateIndex), message);
+        }
+    };
+    auto addCell = [&](DeviceInstance* device, int stateIndex, const QVariantMap& current) {
+        ++outcome.cells;
+        const QVariant before = current.value(request.paramId);
+        QVariant value = fixedValue;
+        if (request.expression) {
+            xValue.insert(QStringLiteral("x"), before);
+            double result = 0.0;
+            if (!expression.evaluateNumber(current, &result, xValue)) {
+                report(device, stateIndex, QString(u8"当前值 %1 无法计算").arg(before.toString()));
+                return;
+            }
+            value = type == "double" ? QVariant(result) : QVariant(static_cast<int>(std::lround(result)));
+        }
+        // 与 ParameterFormModel::validateRow 相同：枚举按控制参数当前取值对应的可选项检查
+        const QStringList opts = isEnum && rules && slot >= 0 ? rules->optionsFor(slot, current) : QStringList();
+        if (opts.isEmpty() ? !param->validate(value) : !opts.contains(value.toString())) {
+            report(device, stateIndex, QString(u8"%1 不是 %2 当前的合法取值").arg(value.toString(), param->getLabel()));
+            return;
+        }
+        if (value == before) {
+            return;
+        }
+
+        QVariantMap trial = current;
+        trial.insert(request.paramId, value);
+        PendingCell cell;
+        cell.device = device;
+        cell.stateIndex = stateIndex;
+        cell.changes.insert(request.paramId, value);
+        if (rules) {
+            cascadeOptions(*rules, params, request.paramId, trial, cell.changes);
+        }
+
+        // 与编辑页的即时校验相同：只检查读取了变化参数的单状态约束；基本参数影响该设备的全部工作状态
+        if (checkConstraints) {
+            const ValidationDependencyIndex& deps = tmpl->getValidationDependencies();
+            QSet<int> affectedSlots;
+            for (auto it = cell.changes.constBegin(); it != cell.changes.constEnd(); ++it) {
+                for (int slotIndex : deps.byParameter.value(it.key())) {
+                    affectedSlots.insert(slotIndex);
+                }
+            }
+            if (!affectedSlots.isEmpty()) {
+                const int first = stateIndex >= 0 ? stateIndex : 0;
+                const int last = stateIndex >= 0 ? stateIndex : device->getWorkStateCount() - 1;
+                for (int s = first; s <= last; ++s) {
+                    const QHash<int, ValidationIssue> failed = stateIndex >= 0
+                        ? ValidationEngine::checkStateSlots(device, s, trial, affectedSlots)
+                        : ValidationEngine::checkStateSlots(device, s, device->getWorkStateValues(s), trial, affectedSlots);
+                    if (!failed.isEmpty()) {
+                        report(device, s, failed.constBegin().value().message());
+                        return;
+                    }
+                }
+            }
+        }
+        outcome.cascaded += cell.changes.size() - 1;
+        pending.append(cell);
+    };
+
+    for (DeviceInstance* device : request.devices) {
+        if (!request.stateParameter) {
+            addCell(device, -1, device->getBasicValues());
+            continue;
+        }
+        const int last = request.lastState < 0 ? device->getWorkStateCount() - 1
+                                               : qMin(request.lastState, device->getWorkStateCount() - 1);
+        for (int s = qMax(0, request.firstState); s <= last; ++s) {
+            addCell(device, s, device->getWorkStateValues(s));
+        }
+    }
+    if (!outcome.errors.isEmpty()) {
+        outcome.elapsedMs = timer.elapsed();
+        return outcome;
+    }
+
+    // 第二遍：全部通过，一次写入
+    for (const PendingCell& cell : pending) {
+        for (auto it = cell.changes.constBegin(); it != cell.changes.constEnd(); ++it) {
+            if (cell.stateIndex >= 0) {
+                cell.device->setWorkStateValue(cell.stateIndex, it.key(), it.value());
+            } else if (it.key() == "work_state_count") {
+                cell.device->setWorkStateCount(it.value().toInt());
+            } else {
+                cell.device->setBasicValue(it.key(), it.value());
+            }
+        }
+        if (outcome.changedDevices.isEmpty() || outcome.changedDevices.last() != cell.device) {
+            outcome.changedDevices.append(cell.device);
+        }
+    }
+    outcome.changed = pending.size();
+    outcome.ok = true;
+    outcome.elapsedMs = timer.elapsed();
+    qDebug() << QString(u8"批量修改 %1：%2 个单元格，%3 个变化（联动 %4 项），%5 台设备，用时 %6 ms")
+                    .arg(request.paramId).arg(outcome.cells).arg(outcome.changed).arg(outcome.cascaded)
+                    .arg(outcome.changedDevices.size()).arg(outcome.elapsedMs);
+    return outcome;
+}
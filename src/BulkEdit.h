@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class DeviceInstance;
+class ParameterItem;
+
+// 批量修改：对选定设备（及工作状态范围）中的同一参数写入固定值，或按表达式由当前值计算新值。
+// 作为一个事务执行：先计算全部新值，并按编辑页相同的流程试算（单字段校验、当前可选项、
+// 选项规则联动、读取了变化参数的单状态约束），任何一处不通过则整体放弃、模型不变；
+// 全部通过后一次性写入设备实例，调用方随后对受影响的设备页统一刷新一次。
+class BulkEdit {
+public:
+    struct Request {
+        QString typeId;
+        QString paramId;
+        bool stateParameter = false; // false 为基本参数
+        QList<DeviceInstance*> devices;
+        int firstState = 0;
+        int lastState = -1; // <0 表示到每台设备的最后一个工作状态
+        bool expression = false;
+        QString text; // 固定值或表达式（规则表达式的算术子集，x 为当前值，也可引用同一状态的其他参数）
+    };
+
+    struct Outcome {
+        bool ok = false;
+        int cells = 0;   // 参与计算的单元格数
+        int changed = 0; // 取值实际变化的单元格数
+        int cascaded = 0; // 选项规则联动改为第一项的其他参数个数
+        QStringList errors; // 最多 kMaxErrors 条
+        QList<DeviceInstance*> changedDevices;
+        qint64 elapsedMs = 0;
+    };
+
+    static constexpr int kMaxErrors = 20;
+
+    static Outcome apply(const Request& request, const ParameterItem* param);
+};
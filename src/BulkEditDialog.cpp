@@ -0,0 +1,228 @@
+﻿#include "BulkEditDialog.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include "ParameterItem.h"
+#include "WorkStateTemplate.h"
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QFormLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPushButton>
+#include <QRadioButton>
+#include <QSpinBox>
+#include <QVBoxLayout>
+
+BulkEditDialog::BulkEditDialog(const QList<EquipmentType*>& types,
+                               const QMap<QString, QList<DeviceInstance*>>& devices,
+                               QWidget* parent)
+    : QDialog(parent), m_types(types), m_devices(devices)
+{
+    setWindowTitle(u8"批量修改参数");
+    setMinimumWidth(480);
+
+    m_typeCombo = new QComboBox;
+    for (const EquipmentType* type : m_types) {
+        m_typeCombo->addItem(type->getTypeName(), type->getTypeId());
+    }
+    m_paramCombo = new QComboBox;
+
+    m_deviceList = new QListWidget;
+    m_deviceList->setMinimumHeight(140);
+    QPushButton* selectAllButton = new QPushButton(u8"全选");
+    QPushButton* selectNoneButton = new QPushButton(u8"全不选");
+    auto checkAll = [this](Qt::CheckState state) {
+        for (int i = 0; i < m_deviceList->count(); ++i) {
+            m_deviceList->item(i)->setCheckState(state);
+        }
+    };
+    connect(selectAllButton, &QPushButton::clicked, this, [checkAll]() { checkAll(Qt::Checked); });
+    connect(selectNoneButton, &QPushButton::clicked, this, [checkAll]() { checkAll(Qt::Unchecked); });
+    QHBoxLayout* selectLayout = new QHBoxLayout;
+    selectLayout->addWidget(selectAllButton);
+    selectLayout->addWidget(selectNoneButton);
+    selectLayout->addStretch();
+
+    m_firstStateSpin = new QSpinBox;
+    m_lastStateSpin = new QSpinBox;
+    QHBoxLayout* stateLayout = new QHBoxLayout;
+    stateLayout->addWidget(m_firstStateSpin);
+    stateLayout->addWidget(new QLabel(u8"至"));
+    stateLayout->addWidget(m_lastStateSpin);
+    stateLayout->addStretch();
+
+    m_valueRadio = new QRadioButton(u8"设为固定值");
+    m_expressionRadio = new QRadioButton(u8"按表达式计算（x 为当前值，如 x*1.1 或 x+5）");
+    m_valueRadio->setChecked(true);
+    m_valueEdit = new QLineEdit;
+    m_hintLabel = new QLabel;
+    m_hintLabel->setWordWrap(true);
+    m_errorLabel = new QLabel;
+    m_errorLabel->setWordWrap(true);
+    m_errorLabel->setStyleSheet("color: #c62828;");
+
+    QFormLayout* form = new QFormLayout;
+    form->addRow(u8"设备类型", m_typeCombo);
+    form->addRow(u8"参数", m_paramCombo);
+    form->addRow(u8"设备", m_deviceList);
+    form->addRow(QString(), selectLayout);
+    form->addRow(u8"工作状态", stateLayout);
+    form->addRow(QString(), m_valueRadio);
+    form->addRow(QString(), m_expressionRadio);
+    form->addRow(u8"值 / 表达式", m_valueEdit);
+    form->addRow(QString(), m_hintLabel);
+
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    buttons->button(QDialogButtonBox::Ok)->setText(u8"应用");
+    connect(buttons, &QDialogButtonBox::accepted, this, &BulkEditDialog::onAccept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &BulkEditDialog::reject);
+
+    QVBoxLayout* layout = new QVBoxLayout(this);
+    layout->addLayout(form);
+    layout->addWidget(m_errorLabel);
+    layout->addWidget(buttons);
+
+    connect(m_typeCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &BulkEditDialog::onTypeChanged);
+    connect(m_paramCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &BulkEditDialog::onParameterChanged);
+    connect(m_firstStateSpin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+        if (m_lastStateSpin->value() < value) {
+            m_lastStateSpin->setValue(value);
+        }
+    });
+    onTypeChanged();
+}
+
+const EquipmentType* BulkEditDialog::currentType() const
+{
+    const int index = m_typeCombo->currentIndex();
+    return index >= 0 && index < m_types.size() ? m_types.at(index) : nullptr;
+}
+
+bool BulkEditDialog::isStateParameter() const
+{
+    return m_paramCombo->currentData().toString().startsWith("s:");
+}
+
+const ParameterItem* BulkEditDialog::currentParameter() const
+{
+    const EquipmentType* type = currentType();
+    const QString key = m_paramCombo->currentData().toString();
+    if (!type || key.size() < 2) {
+        return nullptr;
+    }
+    const QString id = key.mid(2);
+    if (isStateParameter()) {
+        return type->getWorkStateTemplate() ? type->getWorkStateTemplate()->getParameter(id) : nullptr;
+    }
+    return type->getBasicParameter(id);
+}
+
+void BulkEditDialog::onTypeChanged()
+{
+    const EquipmentType* type = currentType();
+    m_paramCombo->blockSignals(true);
+    m_paramCombo->clear();
+    m_deviceList->clear();
+    int maxStates = 0;
+    if (type) {
+        for (const ParameterItem* param : type->getBasicParameters()) {
+            m_paramCombo->addItem(QString(u8"基本参数 / %1 (%2)").arg(param->getLabel(), param->getId()),
+                                  QStringLiteral("b:") + param->getId());
+        }
+        if (const WorkStateTemplate* tmpl = type->getWorkStateTemplate()) {
+            for (const ParameterItem* param : tmpl->getParameters()) {
+                m_paramCombo->addItem(QString(u8"工作状态 / %1 (%2)").arg(param->getLabel(), param->getId()),
+                                      QStringLiteral("s:") + param->getId());
+            }
+        }
+        for (const DeviceInstance* device : m_devices.value(type->getTypeId())) {
+            QListWidgetItem* item = new QListWidgetItem(device->getDeviceName(), m_deviceList);
+            item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+            item->setCheckState(Qt::Checked);
+            maxStates = qMax(maxStates, device->getWorkStateCount());
+        }
+    }
+    m_paramCombo->blockSignals(false);
+
+    m_firstStateSpin->setRange(1, qMax(1, maxStates));
+    m_lastStateSpin->setRange(1, qMax(1, maxStates));
+    m_firstStateSpin->setValue(1);
+    m_lastStateSpin->setValue(qMax(1, maxStates));
+    onParameterChanged();
+}
+
+void BulkEditDialog::onParameterChanged()
+{
+    const ParameterItem* param = currentParameter();
+    const bool stateParam = isStateParameter();
+    m_firstStateSpin->setEnabled(stateParam);
+    m_lastStateSpin->setEnabled(stateParam);
+    if (!param) {
+        m_hintLabel->clear();
+        return;
+    }
+    const QString type = param->getType();
+    const bool numeric = type == "int" || type == "Byte" || type == "double";
+    m_expressionRadio->setEnabled(numeric);
+    if (!numeric) {
+        m_valueRadio->setChecked(true);
+    }
+    if (type == "enum") {
+        m_hintLabel->setText(QString(u8"可选值：%1").arg(param->getOptions().join(u8"、")));
+    } else if (numeric) {
+        m_hintLabel->setText(QString(u8"类型 %1，范围 %2 ~ %3").arg(type).arg(param->getMinValue()).arg(param->getMaxValue()));
+    } else {
+        m_hintLabel->setText(QString(u8"类型 %1").arg(type));
+    }
+    m_errorLabel->clear();
+}
+
+BulkEdit::Request BulkEditDialog::request() const
+{
+    BulkEdit::Request request;
+    const EquipmentType* type = currentType();
+    if (!type) {
+        return request;
+    }
+    request.typeId = type->getTypeId();
+    request.paramId = m_paramCombo->currentData().toString().mid(2);
+    request.stateParameter = isStateParameter();
+    const QList<DeviceInstance*> typeDevices = m_devices.value(type->getTypeId());
+    for (int i = 0; i < m_deviceList->count() && i < typeDevices.size(); ++i) {
+        if (m_deviceList->item(i)->checkState() == Qt::Checked) {
+            request.devices.append(typeDevices.at(i));
+        }
+    }
+    request.firstState = m_firstStateSpin->value() - 1;
+    request.lastState = m_lastStateSpin->value() - 1;
+    request.expression = m_expressionRadio->isChecked();
+    request.text = m_valueEdit->text();
+    return request;
+}
+
+void BulkEditDialog::setError(const QString& message)
+{
+    m_errorLabel->setText(message);
+}
+
+void BulkEditDialog::onAccept()
+{
+    const BulkEdit::Request current = request();
+    if (current.paramId.isEmpty()) {
+        setError(u8"请选择参数");
+        return;
+    }
+    if (current.devices.isEmpty()) {
+        setError(u8"请至少选择一台设备");
+        return;
+    }
+    if (current.text.trimmed().isEmpty()) {
+        setError(current.expression ? QString(u8"请填写表达式") : QString(u8"请填写取值"));
+        return;
+    }
+    accept();
+}
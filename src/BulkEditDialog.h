@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "BulkEdit.h"
+#include <QDialog>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+class EquipmentType;
+class DeviceInstance;
+class ParameterItem;
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QListWidget;
+class QRadioButton;
+class QSpinBox;
+
+// 批量修改对话框：选择设备类型、参数、设备与工作状态范围，填写固定值或表达式（x 为当前值）。
+// 只负责收集 BulkEdit::Request，执行与失败提示由调用方完成。
+class BulkEditDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    BulkEditDialog(const QList<EquipmentType*>& types,
+                   const QMap<QString, QList<DeviceInstance*>>& devices,
+                   QWidget* parent = nullptr);
+
+    BulkEdit::Request request() const;
+    void setError(const QString& message);
+
+private slots:
+    void onTypeChanged();
+    void onParameterChanged();
+    void onAccept();
+
+private:
+    QList<EquipmentType*> m_types;
+    QMap<QString, QList<DeviceInstance*>> m_devices;
+    QComboBox* m_typeCombo;
+    QComboBox* m_paramCombo;
+    QListWidget* m_deviceList;
+    QSpinBox* m_firstStateSpin;
+    QSpinBox* m_lastStateSpin;
+    QRadioButton* m_valueRadio;
+    QRadioButton* m_expressionRadio;
+    QLineEdit* m_valueEdit;
+    QLabel* m_hintLabel;
+    QLabel* m_errorLabel;
+
+    const EquipmentType* currentType() const;
+    const ParameterItem* currentParameter() const;
+    bool isStateParameter() const;
+};
@@ -2,27 +2,27 @@
 #include "ParameterEditDialog.h"
 #include "TypeEditDialog.h"
 #include "RuleEditorDialog.h"
-#include "StyleHelper.h"
+#include "AppTheme.h"
+#include "AtomicFileWriter.h"
+#include "BackupStore.h"
 #include <QHBoxLayout>
 #include <QVBoxLayout>
 #include <QGroupBox>
 #include <QMessageBox>
-#include <QFile>
 #include <QJsonDocument>
 #include <QLabel>
 #include <QDialogButtonBox>
-#include <QFileInfo>
 #include <QMenu>
 #include <QTextEdit>
 #include <QFormLayout>
-#include <QDateTime>
+#include <QDebug>
 
 ConfigEditorDialog::ConfigEditorDialog(const QJsonObject& rootObj, const QString& filePath, QWidget* parent)
     : QDialog(parent), m_rootObj(rootObj), m_filePath(filePath)
 {
     setWindowTitle(u8"结构编辑模式");
     setMinimumSize(1000, 650);
-    setStyleSheet(StyleHelper::darkPanelStyle());
+    AppTheme::applyDarkPanel(this);
 
     // 拉取 equipment_types
     QJsonObject ecObj = m_rootObj.value("equipment_config").toObject();
@@ -159,9 +159,13 @@ ConfigEditorDialog::ConfigEditorDialog(const QJsonObject& rootObj, const QString
     // 底部操作按钮：显式放置，避免样式导致的不可见问题
     m_saveButton = new QPushButton(u8"保存结构并重载");
     QPushButton* closeBtn = new QPushButton(u8"关闭");
+    QPushButton* historyBtn = new QPushButton(u8"历史版本...");
+    historyBtn->setEnabled(!m_filePath.isEmpty());
     connect(m_saveButton, &QPushButton::clicked, this, &ConfigEditorDialog::onSave);
     connect(closeBtn, &QPushButton::clicked, this, &ConfigEditorDialog::reject);
+    connect(historyBtn, &QPushButton::clicked, this, &ConfigEditorDialog::onRestoreBackup);
     QHBoxLayout* actionLayout = new QHBoxLayout;
+    actionLayout->addWidget(historyBtn);
     actionLayout->addStretch();
     actionLayout->addWidget(m_saveButton);
     actionLayout->addWidget(closeBtn);
@@ -500,36 +504,95 @@ void ConfigEditorDialog::onRemoveWorkParam()
 void ConfigEditorDialog::backupFile()
 {
     if (m_filePath.isEmpty()) return;
-    QFileInfo fi(m_filePath);
-    QString timestamp = QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss");
-    QString backup = fi.path() + "/" + fi.completeBaseName() + ".backup_" + timestamp + ".json";
-    QFile::remove(backup);
-    QFile::copy(m_filePath, backup);
+    // 历史版本以压缩差量保存在 <配置文件>.backups/，按数量与天数自动清理
+    BackupStore store(m_filePath);
+    QString error;
+    if (store.importLegacyBackups(&error) < 0) {
+        qWarning() << QString(u8"旧备份导入失败: %1").arg(error);
+    }
+    if (!store.addFile(&error)) {
+        qWarning() << QString(u8"备份失败: %1").arg(error);
+    }
+}
+
+void ConfigEditorDialog::onRestoreBackup()
+{
+    BackupStore store(m_filePath);
+    QString importError;
+    if (store.importLegacyBackups(&importError) < 0) {
+        qWarning() << QString(u8"旧备份导入失败: %1").arg(importError);
+    }
+    const QList<BackupStore::Version> versions = store.versions();
+    if (versions.isEmpty()) {
+        QMessageBox::information(this, u8"历史版本", u8"当前配置文件还没有历史版本。");
+        return;
+    }
+
+    QDialog dlg(this);
+    dlg.setWindowTitle(u8"历史版本");
+    dlg.setMinimumSize(420, 320);
+    QListWidget* list = new QListWidget(&dlg);
+    for (int i = versions.size() - 1; i >= 0; --i) {
+        const BackupStore::Version& version = versions.at(i);
+        QListWidgetItem* item = new QListWidgetItem(QString(u8"#%1  %2  （%3，%4 KB）")
+                                                        .arg(version.id)
+                                                        .arg(version.time.toString("yyyy-MM-dd HH:mm:ss"))
+                                                        .arg(version.full ? u8"完整" : u8"差量")
+                                                        .arg(version.storedBytes / 1024.0, 0, 'f', 1));
+        item->setData(Qt::UserRole, version.id);
+        list->addItem(item);
+    }
+    list->setCurrentRow(0);
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Cancel, &dlg);
+    QPushButton* restoreBtn = buttons->addButton(u8"恢复到此版本", QDialogButtonBox::AcceptRole);
+    connect(buttons, &QDialogButtonBox::accepted, &dlg, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dlg, &QDialog::reject);
+    connect(list, &QListWidget::itemDoubleClicked, restoreBtn, &QPushButton::click);
+    QVBoxLayout* layout = new QVBoxLayout(&dlg);
+    layout->addWidget(new QLabel(u8"恢复前会先备份当前文件，恢复后重新加载配置。"));
+    layout->addWidget(list, 1);
+    layout->addWidget(buttons);
+    if (dlg.exec() != QDialog::Accepted || !list->currentItem()) {
+        return;
+    }
+
+    if (m_changed &&
+        QMessageBox::question(this, u8"历史版本", u8"恢复将放弃结构编辑器中尚未保存的修改，是否继续？") != QMessageBox::Yes) {
+        return;
+    }
+    QString error;
+    if (!store.restore(list->currentItem()->data(Qt::UserRole).toInt(), &error)) {
+        QMessageBox::warning(this, u8"恢复失败", error);
+        return;
+    }
+    // 文件已被替换，由上层重新加载
+    m_changed = true;
+    accept();
 }
 
-void ConfigEditorDialog::writeFile()
+bool ConfigEditorDialog::writeFile()
 {
     QJsonObject ecObj = m_rootObj.value("equipment_config").toObject();
     ecObj["equipment_types"] = m_types;
     m_rootObj["equipment_config"] = ecObj;
 
     if (!m_filePath.isEmpty()) {
-        QFile f(m_filePath);
-        if (!f.open(QIODevice::WriteOnly)) {
-            QMessageBox::warning(this, u8"保存失败", u8"无法写入文件");
-            return;
+        QString error;
+        if (!AtomicFileWriter::writeFile(m_filePath, QJsonDocument(m_rootObj).toJson(), &error)) {
+            QMessageBox::warning(this, u8"保存失败", error);
+            return false;
         }
-        QJsonDocument doc(m_rootObj);
-        f.write(doc.toJson());
-        f.close();
     }
+    return true;
 }
 
 void ConfigEditorDialog::onSave()
 {
     if (m_changed) {
         backupFile();
-        writeFile();
+        if (!writeFile()) {
+            return; // 写入失败时原文件未改动，留在编辑器中便于重试
+        }
     }
     // 保持 m_changed 为 true 以便上层重新加载最新文件
     accept();
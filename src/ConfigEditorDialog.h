@@ -1,4 +1,4 @@
-#pragma once
+﻿#pragma once
 
 #include <QDialog>
 #include <QJsonObject>
@@ -36,6 +36,7 @@ private slots:
     void onStateTitlesChanged();
     void onApplyRules();
     void onOpenRuleEditor();
+    void onRestoreBackup();
 
 private:
     QJsonObject m_rootObj;
@@ -58,7 +59,7 @@ private:
     void updateDetail();
     void updateParamLists(const QJsonObject& typeObj);
     void backupFile();
-    void writeFile();
+    bool writeFile();
     static QString paramDisplay(const QJsonObject& obj);
     void applyStateMetaChanges();
     void updateRulesEditor(const QJsonObject& typeObj);
@@ -0,0 +1,238 @@
+﻿#include "ConfigLoader.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include "ParameterItem.h"
+#include "WorkStateTemplate.h"
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QDebug>
+
+bool ConfigLoader::readRoot(const QString& jsonFile, QJsonObject& rootObj, QString* error,
+                            PerfLog::Timer* timer)
+{
+    QFile file(jsonFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = QString(u8"无法打开配置文件: %1").arg(jsonFile);
+        return false;
+    }
+
+    QByteArray jsonData = file.readAll();
+    if (timer) timer->mark(u8"读取文件");
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &parseError);
+    if (timer) timer->mark(u8"解析");
+
+    if (parseError.error != QJsonParseError::NoError) {
+        if (error) *error = QString(u8"JSON解析错误: %1").arg(parseError.errorString());
+        return false;
+    }
+
+    rootObj = doc.object();
+    if (!rootObj.contains("equipment_config")) {
+        if (error) *error = QString(u8"配置文件格式错误：缺少equipment_config节点");
+        return false;
+    }
+    return true;
+}
+
+void ConfigLoader::buildModel(const QJsonObject& configObj,
+                              QList<EquipmentType*>& types,
+                              QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    if (configObj.contains("equipment_types")) {
+        QJsonArray equipmentTypes = configObj["equipment_types"].toArray();
+
+        for (const auto& typeValue : equipmentTypes) {
+            QJsonObject typeObj = typeValue.toObject();
+            EquipmentType* equipType = EquipmentType::fromJson(typeObj);
+
+            if (equipType) {
+                types.append(equipType);
+
+                // 创建设备实例 - 优先从device_instances创建
+                QList<DeviceInstance*> typeDevices;
+
+                if (typeObj.contains("device_instances")) {
+                    // 从配置文件中的device_instances创建
+                    QJsonArray devicesArray = typeObj["device_instances"].toArray();
+
+                    for (int i = 0; i < devicesArray.size(); ++i) {
+                        QJsonObject deviceObj = devicesArray[i].toObject();
+                        QString deviceId = deviceObj["device_id"].toString();
+                        QString deviceName = deviceObj["device_name"].toString();
+
+                        // 如果ID或名称为空，使用默认生成的
+                        if (deviceId.isEmpty()) {
+                            deviceId = QString("%1_%2").arg(equipType->getTypeId()).arg(i);
+                        }
+                        if (deviceName.isEmpty()) {
+                            deviceName = QString("%1 %2").arg(equipType->getTypeName()).arg(i + 1);
+                        }
+
+                        DeviceInstance* device = new DeviceInstance(deviceId, deviceName, equipType);
+                        typeDevices.append(device);
+                    }
+
+                    qDebug() << QString(u8"从device_instances创建了 %1 个 %2 设备").arg(typeDevices.size()).arg(equipType->getTypeName());
+                } else {
+                    // 回退到使用device_count创建
+                    for (int i = 0; i < equipType->getDeviceCount(); ++i) {
+                        QString deviceId = QString("%1_%2").arg(equipType->getTypeId()).arg(i);
+                        QString deviceName = QString("%1 %2").arg(equipType->getTypeName()).arg(i + 1);
+                        DeviceInstance* device = new DeviceInstance(deviceId, deviceName, equipType);
+                        typeDevices.append(device);
+                    }
+                    qDebug() << QString(u8"从device_count创建了 %1 个 %2 设备").arg(typeDevices.size()).arg(equipType->getTypeName());
+                }
+
+                devices[equipType->getTypeId()] = typeDevices;
+            }
+        }
+    }
+
+    // 加载设备实例的实际参数值（如果存在）
+    loadDeviceValues(configObj, devices);
+
+    // 启用参数只保存在设备取值中的旧配置，取值加载后才能确定
+    for (EquipmentType* equipType : types) {
+        equipType->resolveLegacyEnableParameter(devices.value(equipType->getTypeId()));
+    }
+}
+
+void ConfigLoader::loadDeviceValues(const QJsonObject& configObj,
+                                    QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    if (!configObj.contains("equipment_types")) {
+        return;
+    }
+
+    QJsonArray equipmentTypes = configObj["equipment_types"].toArray();
+
+    for (const auto& typeValue : equipmentTypes) {
+        QJsonObject typeObj = typeValue.toObject();
+        QString typeId = typeObj["type_id"].toString();
+
+        if (!devices.contains(typeId)) {
+            continue;
+        }
+
+        // 加载设备实例的实际参数值
+        if (typeObj.contains("device_instances")) {
+            QJsonArray devicesArray = typeObj["device_instances"].toArray();
+            QList<DeviceInstance*>& typeDevices = devices[typeId];
+
+            // 为每个JSON中的设备实例找到对应的DeviceInstance对象
+            for (int i = 0; i < devicesArray.size(); ++i) {
+                QJsonObject deviceObj = devicesArray[i].toObject();
+                QString jsonDeviceId = deviceObj["device_id"].toString();
+
+                // 通过设备ID找到对应的DeviceInstance
+                DeviceInstance* device = nullptr;
+                for (DeviceInstance* dev : typeDevices) {
+                    if (dev->getDeviceId() == jsonDeviceId) {
+                        device = dev;
+                        break;
+                    }
+                }
+
+                // 如果没找到，尝试通过索引匹配（向后兼容）
+                if (!device && i < typeDevices.size()) {
+                    device = typeDevices[i];
+                    qDebug() << QString(u8"警告：设备ID %1 不匹配，使用索引 %2 进行匹配").arg(jsonDeviceId).arg(i);
+                }
+
+                if (!device) {
+                    qDebug() << QString(u8"警告：无法找到设备ID %1 对应的设备实例").arg(jsonDeviceId);
+                    continue;
+                }
+
+                // 加载基本参数值，按参数声明的类型转换一次（兼容旧文件中以字符串保存的数值）
+                const EquipmentType* equipType = device->getEquipmentType();
+                if (deviceObj.contains("basic_values")) {
+                    QJsonObject basicValuesObj = deviceObj["basic_values"].toObject();
+                    for (auto it = basicValuesObj.begin(); it != basicValuesObj.end(); ++it) {
+                        const ParameterItem* param = equipType ? equipType->getBasicParameter(it.key()) : nullptr;
+                        const QVariant value = it.value().toVariant();
+                        device->setBasicValue(it.key(), param ? param->coerce(value) : value);
+                    }
+                }
+                const WorkStateTemplate* tmpl = equipType ? equipType->getWorkStateTemplate() : nullptr;
+
+                // 加载工作状态值
+                if (deviceObj.contains("work_states")) {
+                    QJsonArray workStatesArray = deviceObj["work_states"].toArray();
+
+                    // 首先根据实际保存的状态数量更新设备的工作状态个数
+                    int actualStateCount = workStatesArray.size();
+                    if (actualStateCount > 0) {
+                        device->setWorkStateCount(actualStateCount);
+                    }
+
+                    for (int j = 0; j < workStatesArray.size(); ++j) {
+                        QJsonObject stateObj = workStatesArray[j].toObject();
+                        int stateIndex = stateObj["state_index"].toInt();
+
+                        if (stateObj.contains("values")) {
+                            QJsonObject stateValuesObj = stateObj["values"].toObject();
+                            QVariantMap stateValues;
+
+                            for (auto it = stateValuesObj.begin(); it != stateValuesObj.end(); ++it) {
+                                const ParameterItem* param = tmpl ? tmpl->getParameter(it.key()) : nullptr;
+                                const QVariant value = it.value().toVariant();
+                                stateValues[it.key()] = param ? param->coerce(value) : value;
+                            }
+                            // 文件中缺少的模板参数按默认值补齐（基本参数在创建设备时已有默认值），
+                            // 保存与校验看到完整的取值，打开表单也不必再改动设备
+                            if (tmpl) {
+                                for (const ParameterItem* param : tmpl->getParameters()) {
+                                    if (!stateValues.contains(param->getId())) {
+                                        stateValues.insert(param->getId(), param->getDefaultValue());
+                                    }
+                                }
+                            }
+
+                            device->setWorkStateValues(stateIndex, stateValues);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+QJsonObject ConfigLoader::withoutDeviceValues(const QJsonObject& rootObj)
+{
+    QJsonObject configObj = rootObj.value("equipment_config").toObject();
+    QJsonArray typesArray = configObj.value("equipment_types").toArray();
+    bool stripped = false;
+    for (int i = 0; i < typesArray.size(); ++i) {
+        QJsonObject typeObj = typesArray.at(i).toObject();
+        if (typeObj.contains("device_instances")) {
+            typeObj.remove("device_instances");
+            typesArray[i] = typeObj;
+            stripped = true;
+        }
+    }
+    if (!stripped) {
+        return rootObj;
+    }
+    configObj.insert("equipment_types", typesArray);
+    QJsonObject result = rootObj;
+    result.insert("equipment_config", configObj);
+    return result;
+}
+
+void ConfigLoader::clear(QList<EquipmentType*>& types,
+                         QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    for (auto& deviceList : devices) {
+        qDeleteAll(deviceList);
+        deviceList.clear();
+    }
+    devices.clear();
+
+    qDeleteAll(types);
+    types.clear();
+}
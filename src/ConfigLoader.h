@@ -0,0 +1,37 @@
+﻿#pragma once
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QJsonObject>
+#include "PerfLog.h"
+
+class EquipmentType;
+class DeviceInstance;
+
+// 配置文件 -> 数据模型的加载逻辑，不依赖任何界面对象，
+// 界面加载与命令行批量校验共用同一套实现。
+class ConfigLoader {
+public:
+    // 读取并解析配置文件，要求包含 equipment_config 节点；失败时写入 error。
+    // 给定 timer 时分别记录读取与解析两个阶段
+    static bool readRoot(const QString& jsonFile, QJsonObject& rootObj, QString* error = nullptr,
+                         PerfLog::Timer* timer = nullptr);
+
+    // 根据 equipment_config 创建设备类型与设备实例，并加载已保存的参数值。
+    // 对象所有权交给调用方，可用 clear() 统一释放
+    static void buildModel(const QJsonObject& configObj,
+                           QList<EquipmentType*>& types,
+                           QMap<QString, QList<DeviceInstance*>>& devices);
+
+    // 把 device_instances 中保存的基本参数与工作状态值写入已创建的设备实例
+    static void loadDeviceValues(const QJsonObject& configObj,
+                                 QMap<QString, QList<DeviceInstance*>>& devices);
+
+    // 去掉各类型的 device_instances，只留下模型以外需要原样保留的内容；
+    // 设备取值保存时由模型重新生成，缓存的根对象不必再持有一份
+    static QJsonObject withoutDeviceValues(const QJsonObject& rootObj);
+
+    static void clear(QList<EquipmentType*>& types,
+                      QMap<QString, QList<DeviceInstance*>>& devices);
+};
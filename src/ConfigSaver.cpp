@@ -0,0 +1,247 @@
+﻿#include "ConfigSaver.h"
+#include "ShardedStorage.h"
+#include "EquipmentType.h"
+#include "ValidationEngine.h"
+#include <QtConcurrent/QtConcurrentRun>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QDebug>
+
+ConfigSaver::ConfigSaver(QObject* parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFutureWatcher<Result>::finished, this, &ConfigSaver::onJobFinished);
+}
+
+ConfigSaver::~ConfigSaver()
+{
+    m_pending.clear();
+    m_future.waitForFinished();
+}
+
+quint64 ConfigSaver::LatestGenerations::value(const QString& path) const
+{
+    QMutexLocker locker(&mutex);
+    return byPath.value(path);
+}
+
+void ConfigSaver::LatestGenerations::set(const QString& path, quint64 generation)
+{
+    QMutexLocker locker(&mutex);
+    byPath.insert(path, generation);
+}
+
+ConfigSaver::Snapshot ConfigSaver::takeSnapshot(const QString& path,
+                                                const QJsonObject& root,
+                                                bool rootReread,
+                                                const QList<EquipmentType*>& types,
+                                                const QMap<QString, QList<DeviceInstance*>>& devices,
+                                                int maxIssues)
+{
+    Snapshot snapshot;
+    snapshot.path = path;
+    snapshot.root = root;
+    snapshot.rootReread = rootReread;
+    snapshot.types = types;
+    snapshot.maxIssues = maxIssues;
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        QList<DeviceInstance>& copies = snapshot.devices[it.key()];
+        copies.reserve(it.value().size());
+        for (const DeviceInstance* device : it.value()) {
+            copies.append(*device);
+        }
+    }
+    return snapshot;
+}
+
+quint64 ConfigSaver::submit(Snapshot snapshot)
+{
+    snapshot.generation = ++m_nextGeneration;
+    const QString absolute = QFileInfo(snapshot.path).absoluteFilePath();
+    m_latest.set(absolute, snapshot.generation);
+
+    if (m_runningGeneration == 0) {
+        start(snapshot);
+    } else {
+        // 执行中的任务结束后再启动；只替换排队中写入同一文件的旧快照
+        auto it = m_pending.find(absolute);
+        if (it != m_pending.end()) {
+            qDebug() << QString(u8"保存请求 #%1 被 #%2 取代").arg(it->generation).arg(snapshot.generation);
+            emitSuperseded(*it, snapshot.generation);
+            *it = snapshot;
+        } else {
+            m_pending.insert(absolute, snapshot);
+        }
+    }
+    return snapshot.generation;
+}
+
+void ConfigSaver::emitSuperseded(const Snapshot& snapshot, quint64 supersededBy)
+{
+    Result result;
+    result.generation = snapshot.generation;
+    result.path = snapshot.path;
+    result.superseded = true;
+    result.supersededBy = supersededBy;
+    // 提交方在 submit 返回后才登记本次请求，结果回到事件循环后再回报
+    QTimer::singleShot(0, this, [this, result]() {
+        emit finished(result);
+    });
+}
+
+void ConfigSaver::start(Snapshot snapshot)
+{
+    m_runningGeneration = snapshot.generation;
+    m_runningPath = QFileInfo(snapshot.path).absoluteFilePath();
+    m_future = QtConcurrent::run(&ConfigSaver::execute, snapshot, &m_serializer,
+                                 static_cast<const LatestGenerations*>(&m_latest));
+    m_watcher.setFuture(m_future);
+}
+
+void ConfigSaver::onJobFinished()
+{
+    // waitForFinished() 可能已经提前处理了这次结果
+    if (m_runningGeneration == 0 || !m_future.isFinished()) {
+        return;
+    }
+    const Result result = m_future.result();
+    m_runningGeneration = 0;
+    m_runningPath.clear();
+
+    if (!m_pending.isEmpty()) {
+        // 按提交顺序执行排队中的快照
+        auto next = m_pending.begin();
+        for (auto it = m_pending.begin(); it != m_pending.end(); ++it) {
+            if (it->generation < next->generation) {
+                next = it;
+            }
+        }
+        const Snapshot snapshot = next.value();
+        m_pending.erase(next);
+        start(snapshot);
+    }
+    emit finished(result);
+}
+
+void ConfigSaver::waitForFinished()
+{
+    while (m_runningGeneration != 0) {
+        m_future.waitForFinished();
+        onJobFinished();
+    }
+}
+
+bool ConfigSaver::isSaving(const QString& path) const
+{
+    const QString absolute = QFileInfo(path).absoluteFilePath();
+    if (m_runningGeneration != 0 && m_runningPath == absolute) {
+        return true;
+    }
+    return m_pending.contains(absolute);
+}
+
+void ConfigSaver::clearCache()
+{
+    waitForFinished();
+    m_serializer.clear();
+}
+
+void ConfigSaver::markLoaded(const QString& path,
+                             const QJsonObject& root,
+                             const QList<EquipmentType*>& types,
+                             const QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    waitForFinished();
+    ShardedStorage::markLoaded(m_serializer, path, root, types, devices);
+}
+
+ConfigSaver::Result ConfigSaver::execute(Snapshot snapshot,
+                                         ConfigSerializer* serializer,
+                                         const LatestGenerations* latest)
+{
+    Result result;
+    result.generation = snapshot.generation;
+    result.path = snapshot.path;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 指向快照副本；先取非常量引用使列表脱离共享，规范化后的取值回写到副本，
+    // 改动同时记录在结果中，保存成功后由界面线程同步回模型
+    QMap<QString, QList<DeviceInstance*>> devices;
+    for (auto it = snapshot.devices.begin(); it != snapshot.devices.end(); ++it) {
+        QList<DeviceInstance*>& pointers = devices[it.key()];
+        QList<DeviceInstance>& copies = it.value();
+        for (int i = 0; i < copies.size(); ++i) {
+            pointers.append(&copies[i]);
+        }
+    }
+
+    result.report = ValidationReport(snapshot.maxIssues);
+    ValidationEngine engine(snapshot.types, devices);
+    engine.setNormalizationLog(&result.normalized);
+    const bool valid = engine.run(result.report);
+    const qint64 validateMs = timer.elapsed();
+    result.validateMs = validateMs;
+    if (!valid) {
+        result.validationFailed = true;
+        result.error = u8"保存失败：存在非法或超出范围的输入，请检查高亮字段。";
+        return result;
+    }
+
+    // 只有写入同一文件的更新请求才能取代本次保存
+    const quint64 latestForPath = latest->value(QFileInfo(snapshot.path).absoluteFilePath());
+    if (snapshot.generation < latestForPath) {
+        result.superseded = true;
+        result.supersededBy = latestForPath;
+        return result;
+    }
+
+    if (snapshot.rootReread) {
+        serializer->invalidateTypes(); // 类型片段中合并了原文件的字段，需要重新生成
+    }
+
+    if (ShardedStorage::isSplit(snapshot.root)) {
+        // 分片布局：只重写取值变化的分片，最后替换 schema 文件
+        ShardedStorage::SaveStats shardStats;
+        if (!ShardedStorage::save(*serializer, snapshot.path, snapshot.root, snapshot.types, devices,
+                                  &shardStats, &result.error)) {
+            return result;
+        }
+        result.serializeStats = shardStats.serialize;
+        result.writeStats = shardStats.write;
+        qDebug() << QString(u8"分片保存: 重写 %1/%2 个取值分片，schema %3")
+                        .arg(shardStats.shardsWritten)
+                        .arg(shardStats.shardCount)
+                        .arg(shardStats.schemaWritten ? u8"已重写" : u8"未变化");
+    } else {
+        // 序列化结果直接流入临时文件，刷盘后原子替换；任一步失败时原文件保持不变
+        AtomicFileWriter writer(snapshot.path);
+        const bool written = writer.open()
+            && serializer->serialize(writer, snapshot.root, snapshot.types, devices)
+            && writer.commit();
+        result.serializeStats = serializer->lastStats();
+        result.writeStats = writer.stats();
+        if (!written) {
+            result.error = writer.errorString();
+            return result;
+        }
+    }
+
+    result.ok = true;
+    result.root = snapshot.root;
+    qDebug() << QString(u8"后台保存 #%1 完成: %2（校验 %3 ms；生成并写出 %4 ms，重新生成 %5/%6 台设备、%7/%8 个类型；共 %9 KB，含刷盘 %10 ms）")
+                    .arg(snapshot.generation)
+                    .arg(snapshot.path)
+                    .arg(validateMs)
+                    .arg(result.serializeStats.elapsedMs)
+                    .arg(result.serializeStats.devicesSerialized)
+                    .arg(result.serializeStats.deviceCount)
+                    .arg(result.serializeStats.typesSerialized)
+                    .arg(result.serializeStats.typeCount)
+                    .arg(result.writeStats.bytes / 1024)
+                    .arg(result.writeStats.elapsedMs);
+    return result;
+}
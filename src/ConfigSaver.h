@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include "ConfigSerializer.h"
+#include "AtomicFileWriter.h"
+#include "ValidationReport.h"
+#include "ValidationEngine.h"
+#include "DeviceInstance.h"
+#include <QObject>
+#include <QFuture>
+#include <QFutureWatcher>
+#include <QJsonObject>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+class EquipmentType;
+
+// 后台保存：界面线程只复制一份模型快照（设备取值为隐式共享，复制开销很小），
+// 校验、序列化与原子写盘在线程池中完成，期间用户可以继续编辑。
+// 同一时刻只有一个保存任务在执行；执行期间再次提交时每个目标文件只保留最新的一份快照，
+// 旧快照在写盘前发现同一文件已有更新的请求则直接放弃。写入其他文件的请求（导出、另存为）互不取代。
+// 每个请求都通过 finished 信号在界面线程中回报一次结果，被取代的请求同样回报。
+class ConfigSaver : public QObject {
+    Q_OBJECT
+
+public:
+    struct Snapshot {
+        quint64 generation = 0;
+        QString path;
+        QJsonObject root;          // 需要保留的其他根节点
+        bool rootReread = false;   // root 重新读自磁盘，类型片段需要重新生成
+        QList<EquipmentType*> types; // 设备类型加载后不再修改，只读共享
+        QMap<QString, QList<DeviceInstance>> devices; // typeId -> 设备副本
+        int maxIssues = 500;
+    };
+
+    struct Result {
+        quint64 generation = 0;
+        QString path;
+        bool ok = false;
+        bool superseded = false;       // 已被同一文件更新的保存请求取代，未写盘
+        quint64 supersededBy = 0;      // 取代它的请求序号
+        bool validationFailed = false;
+        QString error;
+        ValidationReport report;
+        qint64 validateMs = 0;         // 后台校验用时
+        QVector<ValidationEngine::Normalization> normalized; // 写入文件的规范化改动，成功后同步回模型
+        QJsonObject root;              // 写出时使用的根对象，分片布局下含更新后的分片列表
+        ConfigSerializer::Stats serializeStats;
+        AtomicFileWriter::Stats writeStats;
+    };
+
+    explicit ConfigSaver(QObject* parent = nullptr);
+    ~ConfigSaver(); // 等待执行中的任务结束，丢弃尚未开始的快照
+
+    static Snapshot takeSnapshot(const QString& path,
+                                 const QJsonObject& root,
+                                 bool rootReread,
+                                 const QList<EquipmentType*>& types,
+                                 const QMap<QString, QList<DeviceInstance*>>& devices,
+                                 int maxIssues);
+
+    // 提交保存，返回本次请求的序号
+    quint64 submit(Snapshot snapshot);
+
+    // 阻塞等待执行中与排队中的保存全部完成（重新加载、打开结构编辑器、退出前调用）
+    void waitForFinished();
+
+    bool isBusy() const { return m_runningGeneration != 0 || !m_pending.isEmpty(); }
+    // 执行中或排队中的保存是否写入 path（绝对路径比较）
+    bool isSaving(const QString& path) const;
+
+    // 序列化缓存只在没有任务执行时才可以访问
+    void clearCache();
+    // 加载分片布局的文件后记录各分片与 schema 的签名，第一次保存不必重写未变化的文件
+    void markLoaded(const QString& path,
+                    const QJsonObject& root,
+                    const QList<EquipmentType*>& types,
+                    const QMap<QString, QList<DeviceInstance*>>& devices);
+
+signals:
+    void finished(const ConfigSaver::Result& result);
+
+private slots:
+    void onJobFinished();
+
+private:
+    ConfigSerializer m_serializer; // 只在工作线程中使用，任务之间串行
+    QFutureWatcher<Result> m_watcher;
+    QFuture<Result> m_future;
+    quint64 m_runningGeneration = 0;
+    QString m_runningPath;
+    QHash<QString, Snapshot> m_pending; // 绝对路径 -> 排队中的最新快照
+    quint64 m_nextGeneration = 0;
+
+    // 每个目标文件最新提交的请求序号；界面线程写入，工作线程在写盘前读取
+    struct LatestGenerations {
+        mutable QMutex mutex;
+        QHash<QString, quint64> byPath;
+        quint64 value(const QString& path) const;
+        void set(const QString& path, quint64 generation);
+    };
+    LatestGenerations m_latest;
+
+    void start(Snapshot snapshot);
+    void emitSuperseded(const Snapshot& snapshot, quint64 supersededBy);
+    static Result execute(Snapshot snapshot,
+                          ConfigSerializer* serializer,
+                          const LatestGenerations* latest);
+};
@@ -0,0 +1,574 @@
+﻿#include "ConfigSerializer.h"
+#include "JsonWriter.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include "AtomicFileWriter.h"
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QSet>
+#include <QStringList>
+
+namespace {
+// 缩进层级：根对象 -> equipment_config -> equipment_types[] -> 类型对象 -> device_instances[] -> 设备对象
+const int kConfigLevel = 1;
+const int kTypesLevel = 2;
+const int kTypeLevel = 3;
+const int kDevicesLevel = 4;
+const int kDeviceLevel = 5;
+
+// 对象的键按 QJsonObject 的顺序排列，必要时补上由序列化器自己生成的键
+QStringList keysWith(const QJsonObject& obj, const QString& extraKey)
+{
+    QStringList keys = obj.keys();
+    if (!keys.contains(extraKey)) {
+        keys << extraKey;
+        keys.sort();
+    }
+    return keys;
+}
+
+QString deviceKey(const DeviceInstance* device)
+{
+    const EquipmentType* type = device->getEquipmentType();
+    return (type ? type->getTypeId() : QString()) + QChar(0x1f) + device->getDeviceId();
+}
+}
+
+QJsonObject ConfigSerializer::typeToJson(const EquipmentType* equipType, const QJsonObject& existing, int deviceCount)
+{
+    QJsonObject typeObj = existing;
+    typeObj["type_id"] = equipType->getTypeId();
+    typeObj["type_name"] = equipType->getTypeName();
+    
+    // 使用实际的设备实例数量，而不是模板的device_count
+    typeObj["device_count"] = deviceCount;
+    
+    // 序列化基本参数
+    QJsonArray basicParamsArray;
+    const auto& basicParams = equipType->getBasicParameters();
+    for (ParameterItem* param : basicParams) {
+        QJsonObject paramObj;
+        paramObj["id"] = param->getId();
+        paramObj["label"] = param->getLabel();
+        paramObj["type"] = param->getType();
+        paramObj["unit"] = param->getUnit();
+        paramObj["default"] = JsonWriter::fromVariant(param->getDefaultValue());
+        
+        if (param->getType() == "int" || param->getType() == "double") {
+            QJsonArray rangeArray;
+            rangeArray.append(param->getMinValue());
+            rangeArray.append(param->getMaxValue());
+            paramObj["range"] = rangeArray;
+        } else if (param->getType() == "enum") {
+            QJsonArray optionsArray;
+            for (const QString& option : param->getOptions()) {
+                optionsArray.append(option);
+            }
+            paramObj["options"] = optionsArray;
+        }
+        
+        basicParamsArray.append(paramObj);
+    }
+    typeObj["basic_parameters"] = basicParamsArray;
+    
+    // 只写出显式声明的启用参数，旧配置按规则推断的结果不回写
+    if (equipType->isEnableParameterDeclared()) {
+        typeObj["enable_parameter"] = equipType->getEnableParameterId();
+    }
+    
+    // 基本参数的联动规则
+    const QJsonArray basicVisRules = equipType->getBasicRules().visibilityRulesJson();
+    if (!basicVisRules.isEmpty()) {
+        typeObj["visibility_rules"] = basicVisRules;
+    } else {
+        typeObj.remove("visibility_rules");
+    }
+    const QJsonArray basicOptRules = equipType->getBasicRules().optionRulesJson();
+    if (!basicOptRules.isEmpty()) {
+        typeObj["option_rules"] = basicOptRules;
+    } else {
+        typeObj.remove("option_rules");
+    }
+    
+    // 序列化工作状态模板
+    WorkStateTemplate* wsTemplate = equipType->getWorkStateTemplate();
+    if (wsTemplate) {
+        QJsonObject templateObj = typeObj.value("work_state_template").toObject();
+        templateObj["template_id"] = wsTemplate->getTemplateId();
+        templateObj["template_name"] = wsTemplate->getTemplateName();
+        
+        QJsonArray wsParamsArray;
+        const auto& wsParams = wsTemplate->getParameters();
+        for (ParameterItem* param : wsParams) {
+            QJsonObject paramObj;
+            paramObj["id"] = param->getId();
+            paramObj["label"] = param->getLabel();
+            paramObj["type"] = param->getType();
+            paramObj["unit"] = param->getUnit();
+            paramObj["default"] = JsonWriter::fromVariant(param->getDefaultValue());
+            
+            if (param->getType() == "int" || param->getType() == "double") {
+                QJsonArray rangeArray;
+                rangeArray.append(param->getMinValue());
+                rangeArray.append(param->getMaxValue());
+                paramObj["range"] = rangeArray;
+            } else if (param->getType() == "enum") {
+                QJsonArray optionsArray;
+                for (const QString& option : param->getOptions()) {
+                    optionsArray.append(option);
+                }
+                paramObj["options"] = optionsArray;
+            }
+            
+            wsParamsArray.append(paramObj);
+        }
+        templateObj["parameters"] = wsParamsArray;
+        
+        // 保存自定义工作状态标签及可选的数量覆盖
+        if (!wsTemplate->getStateTabTitles().isEmpty()) {
+            QJsonArray titlesArr;
+            for (const QString& t : wsTemplate->getStateTabTitles()) {
+                titlesArr.append(t);
+            }
+            templateObj["state_tab_titles"] = titlesArr;
+        } else {
+            templateObj.remove("state_tab_titles");
+        }
+        if (wsTemplate->getStateTabCountOverride() > 0) {
+            templateObj["state_tab_count"] = wsTemplate->getStateTabCountOverride();
+        } else {
+            templateObj.remove("state_tab_count");
+        }
+
+        // 规则（可见性 / 选项 / 校验说明）
+        QJsonArray visRules = wsTemplate->getVisibilityRulesJson();
+        if (!visRules.isEmpty()) {
+            templateObj["visibility_rules"] = visRules;
+        } else {
+            templateObj.remove("visibility_rules");
+        }
+
+        QJsonArray optRules = wsTemplate->getOptionRulesJson();
+        if (!optRules.isEmpty()) {
+            templateObj["option_rules"] = optRules;
+        } else {
+            templateObj.remove("option_rules");
+        }
+
+        QJsonArray validationRules = wsTemplate->getValidationRulesJson();
+        if (validationRules.isEmpty()) {
+            validationRules = templateObj.value("validation_rules").toArray();
+        }
+        if (!validationRules.isEmpty()) {
+            templateObj["validation_rules"] = validationRules;
+        } else {
+            templateObj.remove("validation_rules");
+        }
+        typeObj["work_state_template"] = templateObj;
+    } else {
+        typeObj.remove("work_state_template");
+    }
+    return typeObj;
+}
+
+namespace {
+// 按参数声明顺序写出取值，模板中没有声明的键（旧版本遗留等）按字母顺序排在最后
+void writeValues(QByteArray& out, const QVariantMap& values, const QList<ParameterItem*>& params, int level)
+{
+    if (values.isEmpty()) {
+        out.append("{}", 2);
+        return;
+    }
+    out.append("{\n", 2);
+    bool first = true;
+    auto writeEntry = [&](const QString& key, const QVariant& value) {
+        if (!first) {
+            out.append(",\n", 2);
+        }
+        first = false;
+        JsonWriter::writeKey(out, key, level + 1);
+        JsonWriter::writeVariant(out, value);
+    };
+    int written = 0;
+    for (const ParameterItem* param : params) {
+        auto it = values.constFind(param->getId());
+        if (it != values.constEnd()) {
+            writeEntry(it.key(), it.value());
+            ++written;
+        }
+    }
+    if (written < values.size()) {
+        QSet<QString> declared;
+        declared.reserve(params.size());
+        for (const ParameterItem* param : params) {
+            declared.insert(param->getId());
+        }
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            if (!declared.contains(it.key())) {
+                writeEntry(it.key(), it.value());
+            }
+        }
+    }
+    out.append('\n');
+    JsonWriter::writeIndent(out, level);
+    out.append('}');
+}
+}
+
+void ConfigSerializer::writeDevice(QByteArray& out, const DeviceInstance* device, int level)
+{
+    static const QList<ParameterItem*> kNoParams;
+    const EquipmentType* equipType = device->getEquipmentType();
+    const WorkStateTemplate* tmpl = equipType ? equipType->getWorkStateTemplate() : nullptr;
+    const QList<ParameterItem*>& basicParams = equipType ? equipType->getBasicParameters() : kNoParams;
+    const QList<ParameterItem*>& stateParams = tmpl ? tmpl->getParameters() : kNoParams;
+
+    out.append("{\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("device_id"), level + 1);
+    JsonWriter::writeString(out, device->getDeviceId());
+    out.append(",\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("device_name"), level + 1);
+    JsonWriter::writeString(out, device->getDeviceName());
+    out.append(",\n", 2);
+
+    // 基本参数值
+    JsonWriter::writeKey(out, QStringLiteral("basic_values"), level + 1);
+    writeValues(out, device->getAllBasicValues(), basicParams, level + 1);
+    out.append(",\n", 2);
+
+    // 工作状态值
+    JsonWriter::writeKey(out, QStringLiteral("work_states"), level + 1);
+    const int stateCount = device->getWorkStateCount();
+    if (stateCount == 0) {
+        out.append("[]", 2);
+    } else {
+        out.append("[\n", 2);
+        for (int i = 0; i < stateCount; ++i) {
+            if (i > 0) {
+                out.append(",\n", 2);
+            }
+            JsonWriter::writeIndent(out, level + 2);
+            out.append("{\n", 2);
+            JsonWriter::writeKey(out, QStringLiteral("state_index"), level + 3);
+            out.append(QByteArray::number(i));
+            out.append(",\n", 2);
+            JsonWriter::writeKey(out, QStringLiteral("values"), level + 3);
+            writeValues(out, device->getWorkStateValues(i), stateParams, level + 3);
+            out.append('\n');
+            JsonWriter::writeIndent(out, level + 2);
+            out.append('}');
+        }
+        out.append('\n');
+        JsonWriter::writeIndent(out, level + 1);
+        out.append(']');
+    }
+    out.append('\n');
+    JsonWriter::writeIndent(out, level);
+    out.append('}');
+}
+
+void ConfigSerializer::clear()
+{
+    m_typeCache.clear();
+    m_deviceCache.clear();
+    m_shardSignatures.clear();
+}
+
+quint64 ConfigSerializer::shardSignature(const QList<DeviceInstance*>& devices, int deviceOffset)
+{
+    // FNV-1a 累加设备标识与修订号，设备增删、换序或取值变化都会改变签名
+    quint64 hash = 14695981039346656037ULL;
+    auto mix = [&hash](quint64 value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+    mix(static_cast<quint64>(deviceOffset));
+    mix(static_cast<quint64>(devices.size()));
+    for (const DeviceInstance* device : devices) {
+        mix(qHash(deviceKey(device)));
+        mix(device->getRevision());
+    }
+    return hash;
+}
+
+bool ConfigSerializer::isShardCurrent(const QString& file, quint64 signature) const
+{
+    auto it = m_shardSignatures.constFind(file);
+    return it != m_shardSignatures.constEnd() && it.value() == signature;
+}
+
+void ConfigSerializer::retainDevices(const QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    QHash<QString, DeviceFragment> kept;
+    for (const QList<DeviceInstance*>& typeDevices : devices) {
+        for (const DeviceInstance* device : typeDevices) {
+            const QString key = deviceKey(device);
+            auto it = m_deviceCache.constFind(key);
+            if (it != m_deviceCache.constEnd()) {
+                kept.insert(key, it.value());
+            }
+        }
+    }
+    m_deviceCache.swap(kept);
+}
+
+void ConfigSerializer::drain(QByteArray& out)
+{
+    if (out.isEmpty()) {
+        return;
+    }
+    if (!m_writeFailed && !m_writer->write(out)) {
+        m_writeFailed = true;
+    }
+    out.clear();
+}
+
+void ConfigSerializer::writeFragment(QByteArray& out, const QByteArray& fragment)
+{
+    // 缓存片段不复制进暂存区，先写出前面攒下的结构文本以保持顺序
+    drain(out);
+    if (!m_writeFailed && !m_writer->write(fragment)) {
+        m_writeFailed = true;
+    }
+}
+
+bool ConfigSerializer::serialize(AtomicFileWriter& writer,
+                                 const QJsonObject& root,
+                                 const QList<EquipmentType*>& types,
+                                 const QMap<QString, QList<DeviceInstance*>>& devices,
+                                 bool withDevices)
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_stats = Stats();
+    m_stats.typeCount = types.size();
+    m_writer = &writer;
+    m_writeFailed = false;
+
+    QByteArray out;
+    out.reserve(4096); // 只暂存缓存片段之间的结构文本
+    QHash<QString, DeviceFragment> usedDevices;
+
+    const QString configKey = QStringLiteral("equipment_config");
+    const QStringList rootKeys = keysWith(root, configKey);
+    out.append("{\n", 2);
+    for (int i = 0; i < rootKeys.size(); ++i) {
+        if (i > 0) {
+            out.append(",\n", 2);
+        }
+        const QString& key = rootKeys.at(i);
+        JsonWriter::writeKey(out, key, kConfigLevel);
+        if (key == configKey) {
+            writeConfig(out, root.value(key).toObject(), types, devices, withDevices, usedDevices);
+        } else {
+            JsonWriter::writeValue(out, root.value(key), kConfigLevel);
+        }
+    }
+    out.append("\n}\n", 3);
+    drain(out);
+    m_writer = nullptr;
+
+    // 只保留本次用到的设备片段，已删除设备的缓存随之释放；写入中断或只写结构时保留原缓存
+    if (!m_writeFailed && withDevices) {
+        m_deviceCache.swap(usedDevices);
+    }
+    m_stats.elapsedMs = timer.elapsed();
+    return !m_writeFailed;
+}
+
+bool ConfigSerializer::serializeShard(AtomicFileWriter& writer,
+                                      const QString& typeId,
+                                      const QList<DeviceInstance*>& devices,
+                                      int deviceOffset)
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_stats = Stats();
+    m_writer = &writer;
+    m_writeFailed = false;
+
+    // 与单文件相同的嵌套层级，设备片段的缩进因此可以直接复用
+    QByteArray out;
+    out.reserve(4096);
+    out.append("{\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("equipment_config"), kConfigLevel);
+    out.append("{\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("equipment_types"), kTypesLevel);
+    out.append("[\n", 2);
+    JsonWriter::writeIndent(out, kTypeLevel);
+    out.append("{\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("device_instances"), kDevicesLevel);
+    writeDevices(out, devices, m_deviceCache);
+    out.append(",\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("device_offset"), kDevicesLevel);
+    out.append(QByteArray::number(deviceOffset));
+    out.append(",\n", 2);
+    JsonWriter::writeKey(out, QStringLiteral("type_id"), kDevicesLevel);
+    JsonWriter::writeString(out, typeId);
+    out.append('\n');
+    JsonWriter::writeIndent(out, kTypeLevel);
+    out.append("}\n", 2);
+    JsonWriter::writeIndent(out, kTypesLevel);
+    out.append("]\n", 2);
+    JsonWriter::writeIndent(out, kConfigLevel);
+    out.append("}\n}\n", 4);
+    drain(out);
+    m_writer = nullptr;
+
+    m_stats.elapsedMs = timer.elapsed();
+    return !m_writeFailed;
+}
+
+void ConfigSerializer::writeConfig(QByteArray& out,
+                                   const QJsonObject& configObj,
+                                   const QList<EquipmentType*>& types,
+                                   const QMap<QString, QList<DeviceInstance*>>& devices,
+                                   bool withDevices,
+                                   QHash<QString, DeviceFragment>& usedDevices)
+{
+    // 原有类型对象只在需要重新生成类型片段时才展开
+    QHash<QString, QJsonObject> existingTypeMap;
+    bool existingLoaded = false;
+    auto existingType = [&](const QString& typeId) {
+        if (!existingLoaded) {
+            existingLoaded = true;
+            const QJsonArray existingTypesArray = configObj.value("equipment_types").toArray();
+            for (const auto& v : existingTypesArray) {
+                QJsonObject obj = v.toObject();
+                QString tid = obj.value("type_id").toString();
+                if (!tid.isEmpty()) {
+                    existingTypeMap.insert(tid, obj);
+                }
+            }
+        }
+        return existingTypeMap.value(typeId);
+    };
+
+    const QString typesKey = QStringLiteral("equipment_types");
+    const QStringList keys = keysWith(configObj, typesKey);
+    out.append("{\n", 2);
+    for (int i = 0; i < keys.size(); ++i) {
+        if (i > 0) {
+            out.append(",\n", 2);
+        }
+        const QString& key = keys.at(i);
+        JsonWriter::writeKey(out, key, kTypesLevel);
+        if (key != typesKey) {
+            JsonWriter::writeValue(out, configObj.value(key), kTypesLevel);
+            continue;
+        }
+
+        if (types.isEmpty()) {
+            out.append("[]", 2);
+            continue;
+        }
+        out.append("[\n", 2);
+        for (int t = 0; t < types.size(); ++t) {
+            const EquipmentType* equipType = types.at(t);
+            if (t > 0) {
+                out.append(",\n", 2);
+            }
+            JsonWriter::writeIndent(out, kTypeLevel);
+
+            const bool hasDevices = withDevices && devices.contains(equipType->getTypeId());
+            const QList<DeviceInstance*> typeDevices = devices.value(equipType->getTypeId());
+            auto cached = m_typeCache.constFind(equipType);
+            if (cached == m_typeCache.constEnd() ||
+                cached->deviceCount != typeDevices.size() ||
+                cached->hasDevices != hasDevices) {
+                cached = m_typeCache.insert(equipType, buildTypeFragment(equipType,
+                                                                         existingType(equipType->getTypeId()),
+                                                                         hasDevices,
+                                                                         typeDevices.size()));
+                ++m_stats.typesSerialized;
+            }
+            writeFragment(out, cached->head);
+            if (hasDevices) {
+                writeDevices(out, typeDevices, usedDevices);
+            }
+            writeFragment(out, cached->tail);
+            if (m_writeFailed) {
+                return;
+            }
+        }
+        out.append('\n');
+        JsonWriter::writeIndent(out, kTypesLevel);
+        out.append(']');
+    }
+    out.append('\n');
+    JsonWriter::writeIndent(out, kConfigLevel);
+    out.append('}');
+}
+
+void ConfigSerializer::writeDevices(QByteArray& out,
+                                    const QList<DeviceInstance*>& typeDevices,
+                                    QHash<QString, DeviceFragment>& usedDevices)
+{
+    if (typeDevices.isEmpty()) {
+        out.append("[]", 2);
+        return;
+    }
+    out.append("[\n", 2);
+    for (int i = 0; i < typeDevices.size(); ++i) {
+        const DeviceInstance* device = typeDevices.at(i);
+        ++m_stats.deviceCount;
+        if (i > 0) {
+            out.append(",\n", 2);
+        }
+        JsonWriter::writeIndent(out, kDeviceLevel);
+
+        const QString key = deviceKey(device);
+        DeviceFragment fragment = m_deviceCache.value(key);
+        if (fragment.bytes.isEmpty() || fragment.revision != device->getRevision()) {
+            fragment.revision = device->getRevision();
+            fragment.bytes.clear();
+            writeDevice(fragment.bytes, device, kDeviceLevel);
+            ++m_stats.devicesSerialized;
+        }
+        writeFragment(out, fragment.bytes);
+        usedDevices.insert(key, fragment);
+    }
+    out.append('\n');
+    JsonWriter::writeIndent(out, kDevicesLevel);
+    out.append(']');
+}
+
+ConfigSerializer::TypeFragment ConfigSerializer::buildTypeFragment(const EquipmentType* equipType,
+                                                                   const QJsonObject& existing,
+                                                                   bool hasDevices,
+                                                                   int deviceCount)
+{
+    TypeFragment fragment;
+    fragment.deviceCount = deviceCount;
+    fragment.hasDevices = hasDevices;
+
+    const QString devicesKey = QStringLiteral("device_instances");
+    QJsonObject typeObj = typeToJson(equipType, existing, deviceCount);
+    if (!hasDevices) {
+        typeObj.remove(devicesKey); // 设备取值只来自模型，不沿用原文件中的内容
+    }
+    QStringList keys = typeObj.keys();
+    if (hasDevices) {
+        // 设备数组由调用方从设备片段拼接，这里只在其位置断开
+        keys = keysWith(typeObj, devicesKey);
+    }
+
+    QByteArray* cur = &fragment.head;
+    cur->append("{\n", 2);
+    for (int i = 0; i < keys.size(); ++i) {
+        if (i > 0) {
+            cur->append(",\n", 2);
+        }
+        const QString& key = keys.at(i);
+        JsonWriter::writeKey(*cur, key, kDevicesLevel);
+        if (hasDevices && key == devicesKey) {
+            cur = &fragment.tail;
+            continue;
+        }
+        JsonWriter::writeValue(*cur, typeObj.value(key), kDevicesLevel);
+    }
+    cur->append('\n');
+    JsonWriter::writeIndent(*cur, kTypeLevel);
+    cur->append('}');
+    return fragment;
+}
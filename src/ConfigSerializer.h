@@ -0,0 +1,100 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QJsonObject>
+
+class EquipmentType;
+class DeviceInstance;
+class AtomicFileWriter;
+
+// 数据模型 -> 配置文件字节，边生成边写入输出文件，不在内存中拼出完整文档。
+// 设备类型结构（basic_parameters / work_state_template 等）与每台设备的取值分别缓存为
+// 已缩进的文本片段；再次保存时只重新生成修订号变化的设备，其余片段直接写出。
+// 设备片段直接遍历 DeviceInstance 生成，不经过 QJsonObject，键按参数声明顺序输出。
+// 设备片段按“类型ID + 设备ID”索引，因此对模型快照（设备副本）同样命中。
+// 非线程安全：同一时刻只能在一个线程中使用。
+class ConfigSerializer {
+public:
+    struct Stats {
+        int typeCount = 0;
+        int typesSerialized = 0;   // 重新生成的类型结构片段数
+        int deviceCount = 0;
+        int devicesSerialized = 0; // 重新生成的设备片段数
+        qint64 elapsedMs = 0;
+    };
+
+    // root 提供需要保留的其他根节点及类型对象中的未知字段；
+    // 写入失败时返回 false，原因见 writer.errorString()，调用方不再 commit。
+    // withDevices 为 false 时只写结构（分片布局的 schema 文件），device_count 仍按设备数写出
+    bool serialize(AtomicFileWriter& writer,
+                   const QJsonObject& root,
+                   const QList<EquipmentType*>& types,
+                   const QMap<QString, QList<DeviceInstance*>>& devices,
+                   bool withDevices = true);
+
+    // 分片布局的一个取值分片：与单文件相同的嵌套结构，只含一个类型的 type_id、
+    // device_offset（分片中第一台设备的序号）与 device_instances，复用同一份设备片段缓存
+    bool serializeShard(AtomicFileWriter& writer,
+                        const QString& typeId,
+                        const QList<DeviceInstance*>& devices,
+                        int deviceOffset);
+    // 分片内容签名（设备标识 + 修订号），与上次写出时相同则无需重写
+    static quint64 shardSignature(const QList<DeviceInstance*>& devices, int deviceOffset);
+    bool isShardCurrent(const QString& file, quint64 signature) const;
+    void markShardWritten(const QString& file, quint64 signature) { m_shardSignatures.insert(file, signature); }
+    // 分片保存不按单次调用清理设备缓存，整轮结束后只保留仍存在的设备
+    void retainDevices(const QMap<QString, QList<DeviceInstance*>>& devices);
+
+    // 根对象或类型结构变化（重新加载、外部修改）后丢弃类型片段与分片签名；clear() 丢弃全部缓存
+    void invalidateTypes() { m_typeCache.clear(); m_shardSignatures.clear(); }
+    void clear();
+
+    const Stats& lastStats() const { return m_stats; }
+
+    // 类型对象的 JSON 表示（合并 existing 中的未知字段），供非缓存场景复用
+    static QJsonObject typeToJson(const EquipmentType* type, const QJsonObject& existing, int deviceCount);
+    // 设备对象：device_id、device_name、basic_values、work_states，取值按参数声明顺序，
+    // 模板之外的键排在最后；level 为对象所在的缩进层级
+    static void writeDevice(QByteArray& out, const DeviceInstance* device, int level);
+
+private:
+    struct TypeFragment {
+        int deviceCount = -1;
+        bool hasDevices = false;
+        QByteArray head; // 到 "device_instances": 为止（不含设备数组）
+        QByteArray tail; // 设备数组之后直到类型对象结束
+    };
+    struct DeviceFragment {
+        quint64 revision = 0;
+        QByteArray bytes;
+    };
+
+    QHash<const EquipmentType*, TypeFragment> m_typeCache;
+    QHash<QString, DeviceFragment> m_deviceCache;
+    QHash<QString, quint64> m_shardSignatures; // 分片文件 -> 上次写出的内容签名
+    Stats m_stats;
+    AtomicFileWriter* m_writer = nullptr; // 仅在 serialize() 期间有效
+    bool m_writeFailed = false;
+
+    // 小段结构文本先攒在 out 中，写出缓存片段前或结束时交给输出文件（由其按块缓冲）
+    void drain(QByteArray& out);
+    void writeFragment(QByteArray& out, const QByteArray& fragment);
+
+    void writeConfig(QByteArray& out,
+                     const QJsonObject& configObj,
+                     const QList<EquipmentType*>& types,
+                     const QMap<QString, QList<DeviceInstance*>>& devices,
+                     bool withDevices,
+                     QHash<QString, DeviceFragment>& usedDevices);
+    void writeDevices(QByteArray& out,
+                      const QList<DeviceInstance*>& typeDevices,
+                      QHash<QString, DeviceFragment>& usedDevices);
+    static TypeFragment buildTypeFragment(const EquipmentType* equipType,
+                                          const QJsonObject& existing,
+                                          bool hasDevices,
+                                          int deviceCount);
+};
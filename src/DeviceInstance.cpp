@@ -1,9 +1,18 @@
 ﻿#include "DeviceInstance.h"
+#include "EditJournal.h"
+#include "SearchIndex.h"
 #include <QDebug>
+#include <atomic>
+
+namespace {
+// 全局递增，保证不同设备实例（包括释放后在同一地址重建的实例）不会得到相同修订号
+std::atomic<quint64> s_revisionCounter(0);
+}
 
 DeviceInstance::DeviceInstance(const QString& deviceId, const QString& deviceName, EquipmentType* equipmentType)
     : m_deviceId(deviceId), m_deviceName(deviceName), m_equipmentType(equipmentType)
 {
+    touch();
     // 初始化基本参数的默认值
     if (m_equipmentType) {
         for (const ParameterItem* param : m_equipmentType->getBasicParameters()) {
@@ -21,9 +30,70 @@ QVariant DeviceInstance::getBasicValue(const QString& parameterId) const
     return m_basicValues.value(parameterId);
 }
 
+void DeviceInstance::touch()
+{
+    m_revision = ++s_revisionCounter;
+}
+
+namespace {
+// 逐键比较新旧取值，回调变化（含新增）的键；旧值中被删除的键以无效值回调
+template <typename Fn>
+void forEachChange(const QVariantMap& before, const QVariantMap& after, Fn fn)
+{
+    for (auto it = after.constBegin(); it != after.constEnd(); ++it) {
+        auto old = before.constFind(it.key());
+        if (old == before.constEnd() || old.value() != it.value()) {
+            fn(it.key(), it.value());
+        }
+    }
+    for (auto it = before.constBegin(); it != before.constEnd(); ++it) {
+        if (!after.contains(it.key())) {
+            fn(it.key(), QVariant());
+        }
+    }
+}
+}
+
+void DeviceInstance::setBasicValues(const QVariantMap& values)
+{
+    if (m_basicValues != values) {
+        if (m_observers.journal || m_observers.index) {
+            forEachChange(m_basicValues, values, [this](const QString& id, const QVariant& value) {
+                if (m_observers.journal) {
+                    m_observers.journal->recordBasic(this, id, value);
+                }
+                if (m_observers.index) {
+                    m_observers.index->basicValueChanged(this, id, value);
+                }
+            });
+        }
+        m_basicValues = values;
+        m_enabledCache = -1;
+        touch();
+    }
+}
+
 void DeviceInstance::setBasicValue(const QString& parameterId, const QVariant& value)
 {
-    m_basicValues[parameterId] = value;
+    // 界面定时回写大多是相同的值，只有真正变化时才标记为已修改
+    auto it = m_basicValues.find(parameterId);
+    if (it == m_basicValues.end()) {
+        m_basicValues.insert(parameterId, value);
+    } else if (it.value() != value) {
+        it.value() = value;
+    } else {
+        return;
+    }
+    if (m_equipmentType && parameterId == m_equipmentType->getEnableParameterId()) {
+        m_enabledCache = -1;
+    }
+    touch();
+    if (m_observers.journal) {
+        m_observers.journal->recordBasic(this, parameterId, value);
+    }
+    if (m_observers.index) {
+        m_observers.index->basicValueChanged(this, parameterId, value);
+    }
 }
 
 int DeviceInstance::getWorkStateCount() const
@@ -45,6 +115,7 @@ void DeviceInstance::setWorkStateCount(int count)
     qDebug() << QString(u8"当前工作状态列表大小为%1，需要增加到%2").arg(m_workStateValues.size()).arg(count);
     
     // 调整工作状态值列表大小
+    const int oldCount = m_workStateValues.size();
     while (m_workStateValues.size() < count) {
         // 添加新的工作状态，使用默认值
         QVariantMap defaultStateValues;
@@ -55,10 +126,15 @@ void DeviceInstance::setWorkStateCount(int count)
             }
         }
         m_workStateValues.append(defaultStateValues);
+        touch();
     }
     
     while (m_workStateValues.size() > count) {
         m_workStateValues.removeLast();
+        touch();
+    }
+    if (m_observers.index && m_workStateValues.size() != oldCount) {
+        m_observers.index->stateCountChanged(this);
     }
 }
 
@@ -79,49 +155,65 @@ QVariantMap DeviceInstance::getWorkStateValues(int stateIndex) const
 
 void DeviceInstance::setWorkStateValues(int stateIndex, const QVariantMap& values)
 {
-    if (stateIndex >= 0 && stateIndex < m_workStateValues.size()) {
+    if (stateIndex >= 0 && stateIndex < m_workStateValues.size() && m_workStateValues.at(stateIndex) != values) {
+        if (m_observers.journal || m_observers.index) {
+            forEachChange(m_workStateValues.at(stateIndex), values,
+                          [this, stateIndex](const QString& id, const QVariant& value) {
+                if (m_observers.journal) {
+                    m_observers.journal->recordState(this, stateIndex, id, value);
+                }
+                if (m_observers.index) {
+                    m_observers.index->stateValueChanged(this, stateIndex, id, value);
+                }
+            });
+        }
         m_workStateValues[stateIndex] = values;
+        touch();
+    }
+}
+
+void DeviceInstance::setWorkStateValue(int stateIndex, const QString& parameterId, const QVariant& value)
+{
+    if (stateIndex < 0 || stateIndex >= m_workStateValues.size()) {
+        return;
+    }
+    QVariantMap& values = m_workStateValues[stateIndex];
+    auto it = values.find(parameterId);
+    if (it == values.end()) {
+        values.insert(parameterId, value);
+    } else if (it.value() != value) {
+        it.value() = value;
+    } else {
+        return;
+    }
+    touch();
+    if (m_observers.journal) {
+        m_observers.journal->recordState(this, stateIndex, parameterId, value);
+    }
+    if (m_observers.index) {
+        m_observers.index->stateValueChanged(this, stateIndex, parameterId, value);
     }
 }
 
 bool DeviceInstance::isEnabled() const
 {
-    // 检查设备是否启用，根据不同设备类型的启用参数
-    if (m_equipmentType) {
-        QString typeId = m_equipmentType->getTypeId();
-        QString typeName = m_equipmentType->getTypeName();
-        
-        // 根据设备类型检查对应的"参数出现"字段
-        QStringList possibleEnabledParams;
-        
-        if (typeId.contains("radar") || typeName.contains("雷达")) {
-            possibleEnabledParams << "radar_enabled" << "雷达参数出现";
-        } else if (typeId.contains("comm") || typeName.contains("通信")) {
-            possibleEnabledParams << "comm_enabled" << "通信参数出现";
-        }
-        
-        // 添加通用的启用参数
-        possibleEnabledParams << "enabled" << "参数出现";
-        
-        // 检查任何一个启用参数
-        for (const QString& paramId : possibleEnabledParams) {
-            QVariant enabledValue = getBasicValue(paramId);
-            if (enabledValue.isValid()) {
-                // 如果参数值为数字类型，检查是否不为0
-                bool ok;
-                int intValue = enabledValue.toInt(&ok);
-                if (ok) {
-                    return intValue != 0;
-                }
-                
-                // 如果参数值为字符串类型，检查是否不为空且不为"0"
-                QString stringValue = enabledValue.toString().trimmed();
-                if (!stringValue.isEmpty() && stringValue != "0" && stringValue.toLower() != "false") {
-                    return true;
-                }
-            }
+    if (m_enabledCache >= 0) {
+        return m_enabledCache != 0;
+    }
+    bool enabled = true; // 未声明启用参数或没有取值时默认启用
+    const QString enableId = m_equipmentType ? m_equipmentType->getEnableParameterId() : QString();
+    const QVariant value = enableId.isEmpty() ? QVariant() : getBasicValue(enableId);
+    if (value.isValid()) {
+        // 数值按是否为 0 判断，字符串为空、"0" 或 "false" 时视为停用
+        bool ok = false;
+        const int intValue = value.toInt(&ok);
+        if (ok) {
+            enabled = intValue != 0;
+        } else {
+            const QString text = value.toString().trimmed();
+            enabled = !text.isEmpty() && text != "0" && text.toLower() != "false";
         }
     }
-    
-    return true; // 默认启用
+    m_enabledCache = enabled ? 1 : 0;
+    return enabled;
 } 
\ No newline at end of file
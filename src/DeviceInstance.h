@@ -5,6 +5,9 @@
 #include <QVariantMap>
 #include <QList>
 
+class EditJournal;
+class SearchIndex;
+
 class DeviceInstance {
 public:
     DeviceInstance(const QString& deviceId, const QString& deviceName, EquipmentType* equipmentType);
@@ -16,7 +19,7 @@ public:
     // 基本参数值管理
     QVariantMap getBasicValues() const { return m_basicValues; }
     QVariantMap getAllBasicValues() const { return m_basicValues; }
-    void setBasicValues(const QVariantMap& values) { m_basicValues = values; }
+    void setBasicValues(const QVariantMap& values);
     QVariant getBasicValue(const QString& parameterId) const;
     void setBasicValue(const QString& parameterId, const QVariant& value);
     
@@ -25,14 +28,37 @@ public:
     void setWorkStateCount(int count);
     QVariantMap getWorkStateValues(int stateIndex) const;
     void setWorkStateValues(int stateIndex, const QVariantMap& values);
+    void setWorkStateValue(int stateIndex, const QString& parameterId, const QVariant& value);
     
-    // 设备启用状态
+    // 设备启用状态：取类型声明的 enable_parameter，结果缓存到该参数再次被修改
     bool isEnabled() const;
     
+    // 修订号：取值实际发生变化时递增（全局唯一），序列化缓存据此判断是否需要重新生成
+    quint64 getRevision() const { return m_revision; }
+    
+    // 编辑日志：只挂在界面编辑的实例上，取值变化时逐项记录；复制（保存快照）时不随之复制
+    void setJournal(EditJournal* journal) { m_observers.journal = journal; }
+    // 全局搜索索引：与编辑日志一样只挂在界面编辑的实例上，取值或状态数量变化时增量更新
+    void setSearchIndex(SearchIndex* index) { m_observers.index = index; }
+    
 private:
+    // 取值变化的观察者（编辑日志、搜索索引）：属于界面中的这份模型，复制实例时不随之复制
+    struct ChangeObservers {
+        EditJournal* journal = nullptr;
+        SearchIndex* index = nullptr;
+        ChangeObservers() = default;
+        ChangeObservers(const ChangeObservers&) {}
+        ChangeObservers& operator=(const ChangeObservers&) { return *this; }
+    };
+    
     QString m_deviceId;
     QString m_deviceName;
     EquipmentType* m_equipmentType;
     QVariantMap m_basicValues;
     QList<QVariantMap> m_workStateValues;
+    quint64 m_revision = 0;
+    ChangeObservers m_observers;
+    mutable int m_enabledCache = -1; // -1 未计算，0/1 为缓存的启用状态
+    
+    void touch();
 }; 
\ No newline at end of file
@@ -1,20 +1,22 @@
 ﻿#include "DeviceTabWidget.h"
 #include "WorkStateTabWidget.h"
+#include "ParameterFormModel.h"
+#include "WorkStateGrid.h"
+#include "ParameterEditorPool.h"
+#include "ParameterItem.h"
 #include "EquipmentConfigWidget.h"
+#include "AtomicFileWriter.h"
+#include "JsonWriter.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
-#include <QFormLayout>
 #include <QGroupBox>
 #include <QLabel>
-#include <QScrollArea>
 #include <QPushButton>
 #include <QTimer>
 #include <QDebug>
 #include <QFileDialog>
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QFile>
 #include <QMessageBox>
 #include <QTabBar>
 
@@ -34,93 +36,65 @@ DeviceTabWidget::DeviceTabWidget(DeviceInstance* device, QWidget* parent)
     createWorkStateTabs();
     m_lastStateCount = m_device->getWorkStateCount();
     
-    // 启动定时器监听工作状态个数变化
-    QTimer* updateTimer = new QTimer(this);
-    connect(updateTimer, &QTimer::timeout, this, &DeviceTabWidget::onWorkStateCountChanged);
-    updateTimer->start(2000); // 每2秒检查一次
+    // 调试日志（ENABLE_DEBUG_LOG）开启时记录页签切换到界面处理完排队事件（含重绘）的耗时，
+    // 以及这次切换中编辑器新建与复用的次数；平时不挂这段计时
+    static const bool logSwitches = !qEnvironmentVariableIsEmpty("ENABLE_DEBUG_LOG");
+    if (logSwitches) {
+        connect(this, &QTabWidget::currentChanged, this, [this](int index) {
+            if (index < 0) {
+                return;
+            }
+            m_switchTimer.start();
+            m_switchPoolBefore = ParameterEditorPool::stats();
+            QTimer::singleShot(0, this, [this, index]() {
+                const ParameterEditorPool::Stats pool = ParameterEditorPool::stats();
+                qDebug() << QString(u8"切换到页签 %1 用时 %2 ms（编辑器新建 %3 个，复用 %4 次）")
+                             .arg(tabText(index)).arg(m_switchTimer.elapsed())
+                             .arg(pool.created - m_switchPoolBefore.created)
+                             .arg(pool.reused - m_switchPoolBefore.reused);
+            });
+        });
+    }
     
-    // 启动定时器监听设备启用状态变化
-    // 初始更新可见性
+    // 初始更新可见性；之后由基本参数的修改通知驱动，不再定时轮询
     updateVisibility();
 }
 
 void DeviceTabWidget::createBasicParametersTab()
 {
-    m_basicParamsWidget = new QWidget;
-    QScrollArea* scrollArea = new QScrollArea;
-    scrollArea->setWidgetResizable(true);
-    scrollArea->setWidget(m_basicParamsWidget);
+    // 基本参数的即时校验同样防抖，停止输入后统一检查
+    m_basicValidationTimer = new QTimer(this);
+    m_basicValidationTimer->setSingleShot(true);
+    m_basicValidationTimer->setInterval(300);
+    connect(m_basicValidationTimer, &QTimer::timeout, this, &DeviceTabWidget::runBasicValidation);
     
+    m_basicParamsWidget = new QWidget;
     QVBoxLayout* mainLayout = new QVBoxLayout(m_basicParamsWidget);
     
-    // 创建基本参数组
+    // 创建基本参数组：编辑器只在编辑某个单元格时由委托创建
     QGroupBox* basicGroup = new QGroupBox(u8"基本参数");
-    QFormLayout* formLayout = new QFormLayout(basicGroup);
-    
-    EquipmentType* equipType = m_device->getEquipmentType();
-    if (equipType) {
-        const auto& basicParamTemplates = equipType->getBasicParameters();
-        
-        // 为每个基本参数创建独立的实例
-        for (ParameterItem* templateParam : basicParamTemplates) {
-            // 创建独立的ParameterItem实例
-            ParameterItem* param = new ParameterItem(templateParam->getId(), 
-                                                     templateParam->getLabel(), 
-                                                     templateParam->getType());
-            param->setParent(this);
-            param->setUnit(templateParam->getUnit());
-            param->setDefaultValue(templateParam->getDefaultValue());
-            
-            // 复制约束条件
-            if (templateParam->getType() == "int" || templateParam->getType() == "double") {
-                param->setRange(templateParam->getMinValue(), templateParam->getMaxValue());
-            } else if (templateParam->getType() == "enum") {
-                param->setOptions(templateParam->getOptions());
-            }
-            
-            QWidget* editor = param->createEditor(basicGroup);
-            
-            // 设置当前值
-            QVariant currentValue = m_device->getBasicValue(param->getId());
-            if (currentValue.isValid()) {
-                param->setValue(currentValue);
-            } else {
-                param->setValue(param->getDefaultValue());
-                m_device->setBasicValue(param->getId(), param->getDefaultValue());
-            }
-            
-            QString labelText = param->getLabel();
-            if (!param->getUnit().isEmpty()) {
-                labelText += QString(" (%1)").arg(param->getUnit());
-            }
-            
-            QLabel* labelWidget = new QLabel(labelText, basicGroup);
-            QWidget* rowContainer = new QWidget(basicGroup);
-            QHBoxLayout* rowLayout = new QHBoxLayout(rowContainer);
-            rowLayout->setContentsMargins(0, 0, 0, 0);
-            rowLayout->setSpacing(8);
-            rowLayout->addWidget(labelWidget);
-            rowLayout->addWidget(editor, 1);
-            formLayout->addRow(rowContainer);
-            
-            // 存储参数实例及其行组件以便后续更新
-            m_basicParameterInstances[param->getId()] = param;
-            m_basicLabelWidgets[param->getId()] = labelWidget;
-            m_basicRowWidgets[param->getId()] = rowContainer;
-        }
-        
-        // 统一标签宽度，确保左对齐效果一致
-        int maxLabelWidth = 0;
-        for (auto it = m_basicLabelWidgets.begin(); it != m_basicLabelWidgets.end(); ++it) {
-            maxLabelWidth = qMax(maxLabelWidth, it.value()->sizeHint().width());
+    QVBoxLayout* groupLayout = new QVBoxLayout(basicGroup);
+    m_basicModel = new ParameterFormModel(m_device, -1, this);
+    m_basicView = new ParameterFormView(m_basicModel, basicGroup);
+    groupLayout->addWidget(m_basicView);
+    connect(m_basicModel, &ParameterFormModel::valueChanged, this, [this](const QString& id) {
+        m_pendingBasicIds.insert(id);
+        m_basicValidationTimer->start();
+        // 设备级联动：工作状态数量与启用状态只在基本参数修改时才可能变化
+        if (id == "work_state_count") {
+            onBasicParameterChanged();
         }
-        for (auto it = m_basicLabelWidgets.begin(); it != m_basicLabelWidgets.end(); ++it) {
-            it.value()->setMinimumWidth(maxLabelWidth);
-            it.value()->setMaximumWidth(maxLabelWidth);
+        // 启用状态只在启用参数修改时重新计算
+        const EquipmentType* equipType = m_device->getEquipmentType();
+        if (equipType && id == equipType->getEnableParameterId() && m_device->isEnabled() != m_shownEnabled) {
+            updateVisibility();
         }
+    });
+    for (const ParameterItem* param : m_basicModel->parameters()) {
+        m_pendingBasicIds.insert(param->getId());
     }
     
-    mainLayout->addWidget(basicGroup);
+    mainLayout->addWidget(basicGroup, 1);
     
     // 创建基本参数保存按钮
     QHBoxLayout* basicButtonLayout = new QHBoxLayout;
@@ -133,14 +107,10 @@ void DeviceTabWidget::createBasicParametersTab()
     basicButtonLayout->addStretch();
     
     mainLayout->addLayout(basicButtonLayout);
-    mainLayout->addStretch();
     
-    addTab(scrollArea, u8"基本参数");
+    addTab(m_basicParamsWidget, u8"基本参数");
     
-    // 启动定时器更新基本参数值
-    QTimer* basicUpdateTimer = new QTimer(this);
-    connect(basicUpdateTimer, &QTimer::timeout, this, &DeviceTabWidget::onBasicParameterChanged);
-    basicUpdateTimer->start(1000);
+    m_basicValidationTimer->start();
 }
 
 void DeviceTabWidget::createWorkStateTabs()
@@ -149,34 +119,120 @@ void DeviceTabWidget::createWorkStateTabs()
         return;
     }
     
-    WorkStateTemplate* tmpl = m_device->getEquipmentType()->getWorkStateTemplate();
-    int stateCount = m_device->getWorkStateCount();
-    // 考虑模板定义的标签数量和可选覆盖
-    int desiredCount = stateCount;
-    if (tmpl->getStateTabCountOverride() > 0) {
-        desiredCount = qMax(desiredCount, tmpl->getStateTabCountOverride());
-    }
-    desiredCount = qMax(desiredCount, tmpl->getStateTabTitles().size());
-    if (desiredCount != stateCount) {
-        m_device->setWorkStateCount(desiredCount);
-        stateCount = desiredCount;
+    const int stateCount = desiredStateCount();
+    if (stateCount != m_device->getWorkStateCount()) {
+        m_device->setWorkStateCount(stateCount);
     }
     
     for (int i = 0; i < stateCount; ++i) {
-        QString tabName = (i < tmpl->getStateTabTitles().size() && !tmpl->getStateTabTitles().at(i).isEmpty())
-                            ? tmpl->getStateTabTitles().at(i)
-                            : QString(u8"工作状态 %1").arg(i + 1);
-        WorkStateTabWidget* stateWidget = new WorkStateTabWidget(m_device, i, tabName, this);
-        stateWidget->setObjectName(QStringLiteral("work_state_%1").arg(i));
-        addTab(stateWidget, tabName);
+        createStateTab(i, stateTabTitle(i));
     }
     
     m_lastStateCount = stateCount;
     
+    // 全部状态表格：与各状态页共用设备取值，任一侧修改后刷新另一侧
+    m_gridWidget = new WorkStateGridWidget(m_device, this);
+    addTab(m_gridWidget, u8"全部状态");
+    connect(m_gridWidget->model(), &WorkStateGridModel::stateValuesChanged, this, [this](int stateIndex) {
+        if (WorkStateTabWidget* stateWidget = findStateTab(stateIndex)) {
+            stateWidget->refreshValues();
+        }
+    });
+    
     // 创建设备级保存按钮（作为最后一个tab）
     createSaveButtons();
 }
 
+WorkStateTabWidget* DeviceTabWidget::createStateTab(int stateIndex, const QString& tabName)
+{
+    WorkStateTabWidget* stateWidget = new WorkStateTabWidget(m_device, stateIndex, tabName, this);
+    stateWidget->setObjectName(QStringLiteral("work_state_%1").arg(stateIndex));
+    insertTab(stateTabInsertIndex(), stateWidget, tabName);
+    m_stateTabs.append(stateWidget);
+    connect(stateWidget, &WorkStateTabWidget::parameterChanged, this, [this, stateIndex]() {
+        if (m_gridWidget) {
+            m_gridWidget->model()->refreshState(stateIndex);
+        }
+    });
+    return stateWidget;
+}
+
+WorkStateTabWidget* DeviceTabWidget::findStateTab(int stateIndex) const
+{
+    return m_stateTabs.value(stateIndex, nullptr);
+}
+
+int DeviceTabWidget::stateTabInsertIndex() const
+{
+    const int gridIndex = m_gridWidget ? indexOf(m_gridWidget) : -1;
+    return gridIndex >= 0 ? gridIndex : count();
+}
+
+int DeviceTabWidget::desiredStateCount() const
+{
+    // 考虑模板定义的标签数量和可选覆盖
+    int stateCount = m_device->getWorkStateCount();
+    const WorkStateTemplate* tmpl = m_device->getEquipmentType() ? m_device->getEquipmentType()->getWorkStateTemplate() : nullptr;
+    if (tmpl) {
+        if (tmpl->getStateTabCountOverride() > 0) {
+            stateCount = qMax(stateCount, tmpl->getStateTabCountOverride());
+        }
+        stateCount = qMax(stateCount, tmpl->getStateTabTitles().size());
+    }
+    return stateCount;
+}
+
+QString DeviceTabWidget::stateTabTitle(int stateIndex) const
+{
+    const WorkStateTemplate* tmpl = m_device->getEquipmentType() ? m_device->getEquipmentType()->getWorkStateTemplate() : nullptr;
+    if (tmpl && stateIndex < tmpl->getStateTabTitles().size() && !tmpl->getStateTabTitles().at(stateIndex).isEmpty()) {
+        return tmpl->getStateTabTitles().at(stateIndex);
+    }
+    return QString(u8"工作状态 %1").arg(stateIndex + 1);
+}
+
+void DeviceTabWidget::reconcileStateTabs(int stateCount)
+{
+    QElapsedTimer timer;
+    timer.start();
+    const int oldCount = m_stateTabs.size();
+    
+    // 只在尾部增删：已有状态页的索引与内容不变，耗时与变化的状态数成正比
+    while (m_stateTabs.size() > stateCount) {
+        WorkStateTabWidget* stateWidget = m_stateTabs.takeLast();
+        const int index = indexOf(stateWidget);
+        if (index >= 0) {
+            removeTab(index);
+        }
+        delete stateWidget;
+    }
+    
+    // 保留下来的页签（可能因设备停用而被移出）按顺序放回基本参数页之后，并就地更新标题
+    for (int i = 0; i < m_stateTabs.size(); ++i) {
+        WorkStateTabWidget* stateWidget = m_stateTabs.at(i);
+        const int index = indexOf(stateWidget);
+        if (index < 0) {
+            insertTab(i + 1, stateWidget, stateTabTitle(i));
+            stateWidget->show();
+        } else {
+            setTabText(index, stateTabTitle(i));
+        }
+    }
+    
+    for (int i = m_stateTabs.size(); i < stateCount; ++i) {
+        createStateTab(i, stateTabTitle(i));
+    }
+    
+    if (oldCount != stateCount) {
+        if (m_gridWidget) {
+            m_gridWidget->model()->resetStates();
+        }
+        qDebug() << QString(u8"工作状态页调整 %1 -> %2，用时 %3 ms")
+                     .arg(oldCount).arg(stateCount).arg(timer.elapsed());
+    }
+    m_lastStateCount = stateCount;
+}
+
 void DeviceTabWidget::createSaveButtons()
 {
     QWidget* saveTabWidget = new QWidget;
@@ -223,12 +279,8 @@ void DeviceTabWidget::onSaveDeviceButtonClicked()
     
     if (mainConfig) {
         if (mainConfig->hasCurrentFile()) {
-            // 自动保存到当前文件
-            if (mainConfig->autoSave()) {
-                QMessageBox::information(this, u8"保存成功", 
-                                         QString(u8"设备 %1 已保存到当前配置文件")
-                                             .arg(m_device->getDeviceName()));
-            }
+            // 自动保存到当前文件，写盘在后台完成，结果显示在主窗口状态栏
+            mainConfig->autoSave();
         } else {
             // 如果没有当前文件，提供单独保存选项
             QString fileName = QFileDialog::getSaveFileName(this, 
@@ -266,12 +318,8 @@ void DeviceTabWidget::onSaveBasicButtonClicked()
     
     if (mainConfig) {
         if (mainConfig->hasCurrentFile()) {
-            // 自动保存到当前文件
-            if (mainConfig->autoSave()) {
-                QMessageBox::information(this, u8"保存成功", 
-                                         QString(u8"设备 %1 的基本参数已保存到当前配置文件")
-                                             .arg(m_device->getDeviceName()));
-            }
+            // 自动保存到当前文件，写盘在后台完成，结果显示在主窗口状态栏
+            mainConfig->autoSave();
         } else {
             // 如果没有当前文件，提供单独保存选项
             QString fileName = QFileDialog::getSaveFileName(this, 
@@ -307,7 +355,7 @@ bool DeviceTabWidget::saveDeviceToJson(const QString& fileName)
     QJsonObject basicValuesObj;
     const auto& basicValues = m_device->getAllBasicValues();
     for (auto it = basicValues.begin(); it != basicValues.end(); ++it) {
-        basicValuesObj[it.key()] = it.value().toString();
+        basicValuesObj[it.key()] = JsonWriter::fromVariant(it.value());
     }
     deviceObj["basic_parameters"] = basicValuesObj;
     
@@ -320,7 +368,7 @@ bool DeviceTabWidget::saveDeviceToJson(const QString& fileName)
         QJsonObject stateValuesObj;
         const QVariantMap& stateValues = m_device->getWorkStateValues(i);
         for (auto it = stateValues.begin(); it != stateValues.end(); ++it) {
-            stateValuesObj[it.key()] = it.value().toString();
+            stateValuesObj[it.key()] = JsonWriter::fromVariant(it.value());
         }
         stateObj["parameter_values"] = stateValuesObj;
         
@@ -331,17 +379,12 @@ bool DeviceTabWidget::saveDeviceToJson(const QString& fileName)
     rootObj["device_config"] = deviceObj;
     
     // 写入文件
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(this, u8"保存失败", 
-                             QString(u8"无法创建文件: %1").arg(fileName));
+    QString error;
+    if (!AtomicFileWriter::writeFile(fileName, JsonWriter::toJson(rootObj), &error)) {
+        QMessageBox::warning(this, u8"保存失败", error);
         return false;
     }
     
-    QJsonDocument doc(rootObj);
-    file.write(doc.toJson());
-    file.close();
-    
     qDebug() << QString(u8"设备配置保存完成: %1").arg(fileName);
     return true;
 }
@@ -360,15 +403,15 @@ bool DeviceTabWidget::saveBasicParametersToJson(const QString& fileName)
     
     // 保存基本参数值和定义
     QJsonArray parametersArray;
-    for (auto it = m_basicParameterInstances.begin(); it != m_basicParameterInstances.end(); ++it) {
-        ParameterItem* param = it.value();
+    for (int row = 0; row < m_basicModel->rowCount(); ++row) {
+        const ParameterItem* param = m_basicModel->parameterAt(row);
         QJsonObject paramObj;
         paramObj["id"] = param->getId();
         paramObj["label"] = param->getLabel();
         paramObj["type"] = param->getType();
         paramObj["unit"] = param->getUnit();
-        paramObj["current_value"] = param->getValue().toString();
-        paramObj["default_value"] = param->getDefaultValue().toString();
+        paramObj["current_value"] = JsonWriter::fromVariant(m_basicModel->value(row));
+        paramObj["default_value"] = JsonWriter::fromVariant(param->getDefaultValue());
         
         parametersArray.append(paramObj);
     }
@@ -377,17 +420,12 @@ bool DeviceTabWidget::saveBasicParametersToJson(const QString& fileName)
     rootObj["basic_parameters"] = basicObj;
     
     // 写入文件
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(this, u8"保存失败", 
-                             QString(u8"无法创建文件: %1").arg(fileName));
+    QString error;
+    if (!AtomicFileWriter::writeFile(fileName, JsonWriter::toJson(rootObj), &error)) {
+        QMessageBox::warning(this, u8"保存失败", error);
         return false;
     }
     
-    QJsonDocument doc(rootObj);
-    file.write(doc.toJson());
-    file.close();
-    
     qDebug() << QString(u8"基本参数保存完成: %1").arg(fileName);
     return true;
 }
@@ -398,60 +436,56 @@ void DeviceTabWidget::updateWorkStateTabs()
         return;
     }
     
-    WorkStateTemplate* tmpl = m_device->getEquipmentType() ? m_device->getEquipmentType()->getWorkStateTemplate() : nullptr;
-    int baseCount = m_device->getWorkStateCount();
-    int desiredCount = baseCount;
-    if (tmpl) {
-        if (tmpl->getStateTabCountOverride() > 0) {
-            desiredCount = qMax(desiredCount, tmpl->getStateTabCountOverride());
-        }
-        desiredCount = qMax(desiredCount, tmpl->getStateTabTitles().size());
+    const int newStateCount = desiredStateCount();
+    if (newStateCount != m_device->getWorkStateCount()) {
+        m_device->setWorkStateCount(newStateCount);
     }
-    if (desiredCount != baseCount) {
-        m_device->setWorkStateCount(desiredCount);
+    if (!m_device->isEnabled()) {
+        // 停用期间状态页不在界面上，重新启用时由 updateVisibility 补齐
+        m_lastStateCount = newStateCount;
+        return;
     }
-    int newStateCount = desiredCount;
-    
-    int currentWorkStateCount = 0;
-    for (int i = 1; i < count(); ++i) { // 跳过基本参数tab(0)
-        if (qobject_cast<WorkStateTabWidget*>(widget(i))) {
-            currentWorkStateCount++;
-        }
+    reconcileStateTabs(newStateCount);
+}
+
+void DeviceTabWidget::refreshFromDevice()
+{
+    if (!m_device) {
+        return;
     }
-    
-    if (newStateCount == currentWorkStateCount) {
-        // 数量一致时刷新标签文本，防止自定义标签被默认覆盖
-        for (int i = 1; i < count(); ++i) {
-            WorkStateTabWidget* w = qobject_cast<WorkStateTabWidget*>(widget(i));
-            if (!w) continue;
-            QString tabName = (tmpl && (i - 1) < tmpl->getStateTabTitles().size() && !tmpl->getStateTabTitles().at(i - 1).isEmpty())
-                                ? tmpl->getStateTabTitles().at(i - 1)
-                                : QString(u8"工作状态 %1").arg(i);
-            setTabText(i, tabName);
-        }
-        return; // 没有变化
+    m_basicModel->refresh();
+    for (const ParameterItem* param : m_basicModel->parameters()) {
+        m_pendingBasicIds.insert(param->getId());
     }
+    m_basicValidationTimer->start();
     
-    // 移除所有工作状态tab，保留基本参数tab
-    for (int i = count() - 1; i >= 1; --i) { // 从后往前删除，跳过基本参数tab(0)
-        if (qobject_cast<WorkStateTabWidget*>(widget(i))) {
-            QWidget* tabWidget = this->widget(i);
-            removeTab(i);
-            delete tabWidget;
-        }
+    if (m_lastStateCount != m_device->getWorkStateCount()) {
+        updateWorkStateTabs();
     }
-    
-    // 重新创建工作状态tab
-    for (int i = 0; i < newStateCount; ++i) {
-        QString tabName = (tmpl && i < tmpl->getStateTabTitles().size() && !tmpl->getStateTabTitles().at(i).isEmpty())
-                            ? tmpl->getStateTabTitles().at(i)
-                            : QString(u8"工作状态 %1").arg(i + 1);
-        WorkStateTabWidget* stateWidget = new WorkStateTabWidget(m_device, i, tabName, this);
-        addTab(stateWidget, tabName);
+    for (WorkStateTabWidget* stateWidget : m_stateTabs) {
+        stateWidget->refreshValues();
+    }
+    if (m_gridWidget) {
+        m_gridWidget->model()->resetStates();
+    }
+    updateVisibility();
+}
+
+bool DeviceTabWidget::focusParameter(int stateIndex, const QString& parameterId)
+{
+    if (stateIndex < 0) {
+        setCurrentIndex(0);
+        m_basicView->focusParameter(parameterId);
+        return true;
     }
     
-    qDebug() << "Updated work state tabs. New count:" << newStateCount;
-    m_lastStateCount = newStateCount;
+    WorkStateTabWidget* stateWidget = findStateTab(stateIndex);
+    if (stateWidget && indexOf(stateWidget) >= 0) {
+        setCurrentIndex(indexOf(stateWidget));
+        stateWidget->focusParameter(parameterId);
+        return true;
+    }
+    return false;
 }
 
 void DeviceTabWidget::onBasicParameterChanged()
@@ -460,17 +494,8 @@ void DeviceTabWidget::onBasicParameterChanged()
         return;
     }
     
-    // 保存旧的工作状态数量
-    int oldStateCount = m_device->getWorkStateCount();
-    
-    // 更新设备实例中的基本参数值（使用独立的参数实例）
-    for (auto it = m_basicParameterInstances.begin(); it != m_basicParameterInstances.end(); ++it) {
-        ParameterItem* param = it.value();
-        QVariant newValue = param->getValue();
-        m_device->setBasicValue(param->getId(), newValue);
-    }
-    
-    // 检查工作状态数量是否发生变化
+    // 基本参数在编辑提交时已写回设备实例，这里只检查工作状态数量是否发生变化
+    int oldStateCount = m_lastStateCount;
     int newStateCount = m_device->getWorkStateCount();
     if (oldStateCount != newStateCount) {
         qDebug() << QString(u8"检测到工作状态数量变化：%1 -> %2，调用setWorkStateCount进行初始化")
@@ -485,14 +510,27 @@ void DeviceTabWidget::onBasicParameterChanged()
     m_lastStateCount = newStateCount;
 }
 
-void DeviceTabWidget::onWorkStateCountChanged()
+void DeviceTabWidget::runBasicValidation()
 {
-    int currentStateCount = m_device ? m_device->getWorkStateCount() : 0;
+    if (!m_device || m_pendingBasicIds.isEmpty()) {
+        return;
+    }
     
-    if (m_lastStateCount != currentStateCount) {
-        m_lastStateCount = currentStateCount;
-        updateWorkStateTabs();
+    WorkStateTemplate* tmpl = m_device->getEquipmentType() ? m_device->getEquipmentType()->getWorkStateTemplate() : nullptr;
+    for (const QString& pid : m_pendingBasicIds) {
+        const int row = m_basicModel->rowOf(pid);
+        if (row >= 0) {
+            bool valid = m_basicModel->validateRow(row);
+            m_basicModel->setInvalid(pid, !valid, valid ? QString() : QString(u8"%1 输入非法或超出范围").arg(m_basicModel->parameterAt(row)->getLabel()));
+        }
+        // 只有被状态约束引用的基本参数才需要通知各工作状态页
+        if (tmpl && tmpl->getValidationDependencies().byParameter.contains(pid)) {
+            for (WorkStateTabWidget* w : m_stateTabs) {
+                w->scheduleValidation(pid);
+            }
+        }
     }
+    m_pendingBasicIds.clear();
 }
 
 void DeviceTabWidget::updateVisibility()
@@ -502,42 +540,22 @@ void DeviceTabWidget::updateVisibility()
     }
     
     bool deviceEnabled = m_device->isEnabled();
-    WorkStateTemplate* tmpl = m_device->getEquipmentType() ? m_device->getEquipmentType()->getWorkStateTemplate() : nullptr;
-    
-    // 收集所有工作状态标签页
-    QList<QWidget*> workStateTabs;
-    QList<int> workStateIndices;
-    
-    for (int i = 1; i < count(); ++i) { // 跳过基本参数tab(0)
-        QWidget* tabWidget = widget(i);
-        if (tabWidget && qobject_cast<WorkStateTabWidget*>(tabWidget)) {
-            workStateTabs.append(tabWidget);
-            workStateIndices.append(i);
-        }
-    }
+    m_shownEnabled = deviceEnabled;
     
     if (!deviceEnabled) {
-        // 设备未启用：隐藏所有工作状态标签页
-        for (int i = workStateIndices.size() - 1; i >= 0; --i) { // 从后往前删除，避免索引变化
-            int index = workStateIndices[i];
-            QWidget* tabWidget = widget(index);
-            removeTab(index);
-            tabWidget->hide();
-        }
-        
-        // 隐藏基本参数中的工作状态数量参数
-        for (auto it = m_basicParameterInstances.begin(); it != m_basicParameterInstances.end(); ++it) {
-            ParameterItem* param = it.value();
-            if (param->getId() == "work_state_count" || param->getId().contains("工作状态")) {
-                param->setVisible(false);
-                if (m_basicLabelWidgets.contains(param->getId())) {
-                    m_basicLabelWidgets[param->getId()]->setVisible(false);
-                }
-                if (m_basicRowWidgets.contains(param->getId())) {
-                    m_basicRowWidgets[param->getId()]->setVisible(false);
-                }
+        // 设备未启用：移出所有工作状态标签页（保留对象，启用后原样放回）
+        for (WorkStateTabWidget* stateWidget : m_stateTabs) {
+            const int index = indexOf(stateWidget);
+            if (index >= 0) {
+                removeTab(index);
+                stateWidget->hide();
             }
         }
+        if (m_gridWidget && indexOf(m_gridWidget) >= 0) {
+            removeTab(indexOf(m_gridWidget));
+            m_gridWidget->hide();
+        }
+        // 停用时需要隐藏的基本参数（如工作状态数量）由类型的 visibility_rules 声明
         
         // 隐藏保存设备按钮
         if (m_saveDeviceButton) {
@@ -550,60 +568,13 @@ void DeviceTabWidget::updateVisibility()
             m_saveBasicButton->setEnabled(false);
         }
     } else {
-        // 设备启用：确保工作状态标签页正确显示
-        int expectedStateCount = m_device->getWorkStateCount();
-        if (tmpl) {
-            if (tmpl->getStateTabCountOverride() > 0) {
-                expectedStateCount = qMax(expectedStateCount, tmpl->getStateTabCountOverride());
-            }
-            expectedStateCount = qMax(expectedStateCount, tmpl->getStateTabTitles().size());
-        }
+        // 设备启用：放回已有的工作状态标签页，数量不符时只增删尾部
+        reconcileStateTabs(desiredStateCount());
         
-        // 如果没有工作状态标签页或数量不对，重新创建
-        if (workStateTabs.size() != expectedStateCount) {
-            // 清理现有的工作状态标签页
-            for (int i = workStateIndices.size() - 1; i >= 0; --i) {
-                int index = workStateIndices[i];
-                QWidget* tabWidget = widget(index);
-                removeTab(index);
-                delete tabWidget; // 删除widget防止内存泄漏
-            }
-            
-            // 重新创建正确数量的工作状态tabs
-            for (int i = 0; i < expectedStateCount; ++i) {
-                QString tabName = (tmpl && i < tmpl->getStateTabTitles().size() && !tmpl->getStateTabTitles().at(i).isEmpty())
-                                    ? tmpl->getStateTabTitles().at(i)
-                                    : QString(u8"工作状态 %1").arg(i + 1);
-                WorkStateTabWidget* stateWidget = new WorkStateTabWidget(m_device, i, tabName, this);
-                addTab(stateWidget, tabName);
-            }
-        } else {
-            // 显示现有的工作状态标签页
-            for (int i = 0; i < workStateTabs.size(); ++i) {
-                QWidget* tabWidget = workStateTabs[i];
-                QString tabName = (tmpl && i < tmpl->getStateTabTitles().size() && !tmpl->getStateTabTitles().at(i).isEmpty())
-                                    ? tmpl->getStateTabTitles().at(i)
-                                    : QString(u8"工作状态 %1").arg(i + 1);
-                int idxTab = indexOf(tabWidget);
-                if (idxTab < 0) { // 如果标签页不在tab widget中
-                    addTab(tabWidget, tabName);
-                } else {
-                    setTabText(idxTab, tabName);
-                }
-                tabWidget->show();
-            }
-        }
-        
-        // 显示所有参数
-        for (auto it = m_basicParameterInstances.begin(); it != m_basicParameterInstances.end(); ++it) {
-            ParameterItem* param = it.value();
-            param->setVisible(true);
-            if (m_basicLabelWidgets.contains(param->getId())) {
-                m_basicLabelWidgets[param->getId()]->setVisible(true);
-            }
-            if (m_basicRowWidgets.contains(param->getId())) {
-                m_basicRowWidgets[param->getId()]->setVisible(true);
-            }
+        if (m_gridWidget && indexOf(m_gridWidget) < 0) {
+            m_gridWidget->model()->resetStates();
+            addTab(m_gridWidget, u8"全部状态");
+            m_gridWidget->show();
         }
         
         // 显示保存设备按钮
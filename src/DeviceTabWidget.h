@@ -1,14 +1,22 @@
 ﻿#pragma once
 
 #include "DeviceInstance.h"
+#include "ParameterEditorPool.h"
 #include <QTabWidget>
 #include <QWidget>
 #include <QPushButton>
+#include <QList>
 #include <QMap>
+#include <QSet>
 #include <QLabel>
+#include <QElapsedTimer>
 
 class EquipmentConfigWidget;
-class ParameterItem;
+class ParameterFormModel;
+class ParameterFormView;
+class WorkStateTabWidget;
+class WorkStateGridWidget;
+class QTimer;
 
 class DeviceTabWidget : public QTabWidget {
     Q_OBJECT
@@ -16,31 +24,51 @@ class DeviceTabWidget : public QTabWidget {
 public:
     explicit DeviceTabWidget(DeviceInstance* device, QWidget* parent = nullptr);
     
+    DeviceInstance* getDevice() const { return m_device; }
+    
     // 更新界面可见性
     void updateVisibility();
+    
+    // 设备取值在界面之外被修改（批量修改等）后统一刷新一次：表单、状态页数量、表格与可见性
+    void refreshFromDevice();
+    
+    // 切换到指定状态页（-1 为基本参数页）并聚焦参数编辑器
+    bool focusParameter(int stateIndex, const QString& parameterId);
 
 signals:
     void deviceSaveRequested(DeviceInstance* device);
 
 private slots:
     void onBasicParameterChanged();
-    void onWorkStateCountChanged();
     void onSaveDeviceButtonClicked();
     void onSaveBasicButtonClicked();
+    void runBasicValidation();
 
 private:
     DeviceInstance* m_device;
     QWidget* m_basicParamsWidget;
     QPushButton* m_saveDeviceButton;
     QPushButton* m_saveBasicButton;
-    QMap<QString, ParameterItem*> m_basicParameterInstances;
-    QMap<QString, QLabel*> m_basicLabelWidgets;
-    QMap<QString, QWidget*> m_basicRowWidgets;
+    ParameterFormModel* m_basicModel = nullptr; // 基本参数直接读写设备实例
+    ParameterFormView* m_basicView = nullptr;
+    QList<WorkStateTabWidget*> m_stateTabs; // 按状态序号排列，设备停用时仍保留
+    WorkStateGridWidget* m_gridWidget = nullptr; // “全部状态”表格页，固定在最后
     int m_lastStateCount = -1;
+    bool m_shownEnabled = true; // 界面当前按启用/停用哪种状态显示
+    QElapsedTimer m_switchTimer;
+    ParameterEditorPool::Stats m_switchPoolBefore; // 本次切换开始时的回收池计数
+    QTimer* m_basicValidationTimer = nullptr;
+    QSet<QString> m_pendingBasicIds; // 等待即时校验的基本参数
 
     void createBasicParametersTab();
     void createWorkStateTabs();
     void updateWorkStateTabs();
+    WorkStateTabWidget* createStateTab(int stateIndex, const QString& tabName);
+    WorkStateTabWidget* findStateTab(int stateIndex) const;
+    int stateTabInsertIndex() const; // 新状态页插入在表格页之前
+    int desiredStateCount() const;
+    QString stateTabTitle(int stateIndex) const;
+    void reconcileStateTabs(int stateCount);
     void createSaveButtons();
     bool saveDeviceToJson(const QString& fileName);
     bool saveBasicParametersToJson(const QString& fileName);
@@ -0,0 +1,332 @@
+﻿#include "EditJournal.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include "JsonWriter.h"
+#include "AtomicFileWriter.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QDebug>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+// 缓冲中的记录最长等待这么久写入日志，连续快速编辑合并为一次追加
+const int kFlushDelayMs = 200;
+
+// QFile::flush 只把数据交给操作系统，断电或系统崩溃时仍可能丢失；每批记录追加后同步到磁盘
+bool syncToDisk(QFile& file)
+{
+#ifdef Q_OS_WIN
+    return ::_commit(file.handle()) == 0; // 即 FlushFileBuffers
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+void writeField(QByteArray& out, const char* key, const QString& value)
+{
+    out.append(",\"").append(key).append("\":");
+    JsonWriter::writeString(out, value);
+}
+
+// 回放时按 类型ID + 设备ID 查找设备；分隔符不会出现在ID中
+QString deviceKey(const QString& typeId, const QString& deviceId)
+{
+    return typeId + QChar(0x1f) + deviceId;
+}
+}
+
+EditJournal::EditJournal(QObject* parent)
+    : QObject(parent)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(kFlushDelayMs);
+    connect(&m_flushTimer, &QTimer::timeout, this, &EditJournal::flush);
+}
+
+EditJournal::~EditJournal()
+{
+    close();
+}
+
+QString EditJournal::journalPath(const QString& configFile)
+{
+    return configFile + QStringLiteral(".journal");
+}
+
+QByteArray EditJournal::header(const QString& configFile)
+{
+    const QFileInfo fi(configFile);
+    return QByteArray("{\"journal\":1,\"size\":") + QByteArray::number(fi.size())
+         + ",\"modified\":" + QByteArray::number(fi.lastModified().toMSecsSinceEpoch()) + "}\n";
+}
+
+int EditJournal::open(const QString& configFile,
+                      QMap<QString, QList<DeviceInstance*>>& devices,
+                      QString* warning)
+{
+    close();
+    m_configFile = configFile;
+    m_headerWritten = false;
+
+    QFile file(journalPath(configFile));
+    if (!file.exists()) {
+        return 0;
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (warning) *warning = QString(u8"无法读取编辑日志: %1").arg(file.fileName());
+        return -1;
+    }
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    file.close();
+
+    // 首行是基准配置文件的大小与修改时间，不一致说明配置文件已被其他途径改写
+    const QJsonObject head = QJsonDocument::fromJson(lines.value(0)).object();
+    const QFileInfo fi(configFile);
+    if (head.value("journal").toInt() != 1 ||
+        static_cast<qint64>(head.value("size").toDouble()) != fi.size() ||
+        static_cast<qint64>(head.value("modified").toDouble()) != fi.lastModified().toMSecsSinceEpoch()) {
+        const QString stale = journalPath(configFile) + QStringLiteral(".stale");
+        QFile::remove(stale);
+        QFile::rename(file.fileName(), stale);
+        if (warning) {
+            *warning = QString(u8"编辑日志与配置文件不匹配（配置文件已被修改），未回放，已另存为 %1").arg(stale);
+        }
+        return -1;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    // 每行记录都要定位设备，先建一次索引，回放不随设备数线性增长
+    QHash<QString, DeviceInstance*> devicesByKey;
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        for (DeviceInstance* device : it.value()) {
+            const QString key = deviceKey(it.key(), device->getDeviceId());
+            if (!devicesByKey.contains(key)) { // 设备ID重复时与原先一样取第一个
+                devicesByKey.insert(key, device);
+            }
+        }
+    }
+    int applied = 0;
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray& line = lines.at(i);
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        QString error;
+        if (!applyLine(line, devicesByKey, &error)) {
+            // 异常退出时最后一行可能只写了一半
+            qWarning() << QString(u8"编辑日志第 %1 行无法回放: %2").arg(i + 1).arg(error);
+            continue;
+        }
+        m_records.append(Record{++m_sequence, line + '\n'});
+        ++applied;
+    }
+    m_headerWritten = true;
+    qDebug() << QString(u8"回放编辑日志 %1：%2 条记录，%3 ms").arg(file.fileName()).arg(applied).arg(timer.elapsed());
+    return applied;
+}
+
+bool EditJournal::applyLine(const QByteArray& line,
+                            const QHash<QString, DeviceInstance*>& devicesByKey,
+                            QString* error)
+{
+    QJsonParseError parseError;
+    const QJsonObject obj = QJsonDocument::fromJson(line, &parseError).object();
+    if (parseError.error != QJsonParseError::NoError) {
+        *error = parseError.errorString();
+        return false;
+    }
+
+    const QString deviceId = obj.value("device").toString();
+    DeviceInstance* device = devicesByKey.value(deviceKey(obj.value("type").toString(), deviceId));
+    if (!device) {
+        *error = QString(u8"找不到设备 %1").arg(deviceId);
+        return false;
+    }
+
+    const EquipmentType* equipType = device->getEquipmentType();
+    const QString op = obj.value("op").toString();
+    const QString id = obj.value("id").toString();
+    const QJsonValue value = obj.value("value");
+    if (op == "basic") {
+        if (value.isNull()) {
+            QVariantMap values = device->getBasicValues();
+            values.remove(id);
+            device->setBasicValues(values);
+        } else if (id == "work_state_count") {
+            device->setWorkStateCount(value.toInt());
+        } else {
+            const ParameterItem* param = equipType ? equipType->getBasicParameter(id) : nullptr;
+            device->setBasicValue(id, param ? param->coerce(value.toVariant()) : value.toVariant());
+        }
+        return true;
+    }
+    if (op == "state") {
+        const int stateIndex = obj.value("state").toInt(-1);
+        if (stateIndex < 0 || stateIndex >= device->getWorkStateCount()) {
+            *error = QString(u8"工作状态 %1 超出范围").arg(stateIndex);
+            return false;
+        }
+        const WorkStateTemplate* tmpl = equipType ? equipType->getWorkStateTemplate() : nullptr;
+        const ParameterItem* param = tmpl ? tmpl->getParameter(id) : nullptr;
+        QVariantMap values = device->getWorkStateValues(stateIndex);
+        if (value.isNull()) {
+            values.remove(id);
+        } else {
+            values[id] = param ? param->coerce(value.toVariant()) : value.toVariant();
+        }
+        device->setWorkStateValues(stateIndex, values);
+        return true;
+    }
+    *error = QString(u8"未知操作 %1").arg(op);
+    return false;
+}
+
+void EditJournal::close()
+{
+    flush();
+    m_flushTimer.stop();
+    m_file.close();
+    m_records.clear();
+    m_pending.clear();
+    m_configFile.clear();
+    m_headerWritten = false;
+}
+
+void EditJournal::recordBasic(const DeviceInstance* device, const QString& id, const QVariant& value)
+{
+    const EquipmentType* equipType = device->getEquipmentType();
+    QByteArray line("{\"op\":\"basic\"");
+    writeField(line, "type", equipType ? equipType->getTypeId() : QString());
+    writeField(line, "device", device->getDeviceId());
+    writeField(line, "id", id);
+    line.append(",\"value\":");
+    if (value.isValid()) {
+        JsonWriter::writeVariant(line, value);
+    } else {
+        line.append("null", 4);
+    }
+    line.append("}\n", 2);
+    append(line);
+}
+
+void EditJournal::recordState(const DeviceInstance* device, int stateIndex, const QString& id, const QVariant& value)
+{
+    const EquipmentType* equipType = device->getEquipmentType();
+    QByteArray line("{\"op\":\"state\"");
+    writeField(line, "type", equipType ? equipType->getTypeId() : QString());
+    writeField(line, "device", device->getDeviceId());
+    line.append(",\"state\":").append(QByteArray::number(stateIndex));
+    writeField(line, "id", id);
+    line.append(",\"value\":");
+    if (value.isValid()) {
+        JsonWriter::writeVariant(line, value);
+    } else {
+        line.append("null", 4);
+    }
+    line.append("}\n", 2);
+    append(line);
+}
+
+void EditJournal::append(QByteArray line)
+{
+    if (!isOpen()) {
+        return;
+    }
+    m_pending.append(line);
+    m_records.append(Record{++m_sequence, line});
+    if (!m_flushTimer.isActive()) {
+        m_flushTimer.start();
+    }
+    emit recorded();
+}
+
+bool EditJournal::openForAppend()
+{
+    if (m_file.isOpen()) {
+        return true;
+    }
+    m_file.setFileName(journalPath(m_configFile));
+    // 首次写入时才创建日志文件，只浏览不编辑时不在配置目录中留下文件
+    const QIODevice::OpenMode mode = m_headerWritten ? QIODevice::Append : (QIODevice::WriteOnly | QIODevice::Truncate);
+    if (!m_file.open(mode)) {
+        qWarning() << QString(u8"无法写入编辑日志: %1（%2）").arg(m_file.fileName(), m_file.errorString());
+        return false;
+    }
+    if (!m_headerWritten) {
+        m_file.write(header(m_configFile));
+        m_headerWritten = true;
+    }
+    return true;
+}
+
+void EditJournal::flush()
+{
+    m_flushTimer.stop();
+    if (m_pending.isEmpty() || !isOpen()) {
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    if (!openForAppend()) {
+        return; // 保留在缓冲中，下次再试
+    }
+    const int count = m_pending.count('\n');
+    if (m_file.write(m_pending) != m_pending.size() || !m_file.flush() || !syncToDisk(m_file)) {
+        qWarning() << QString(u8"编辑日志写入失败: %1（%2）").arg(m_file.fileName(), m_file.errorString());
+        m_file.close();
+        return;
+    }
+    qDebug() << QString(u8"编辑日志追加 %1 条记录（%2 字节），含刷盘 %3 ms")
+                    .arg(count)
+                    .arg(m_pending.size())
+                    .arg(timer.elapsed());
+    m_pending.clear();
+}
+
+void EditJournal::compact(const QString& configFile, quint64 upTo)
+{
+    if (!isOpen()) {
+        return;
+    }
+    flush();
+    m_file.close();
+
+    int dropped = 0;
+    while (dropped < m_records.size() && m_records.at(dropped).sequence <= upTo) {
+        ++dropped;
+    }
+    m_records.remove(0, dropped);
+
+    // 另存为其他文件：原文件未包含这些修改，其日志随之作废
+    const bool retarget = QFileInfo(configFile).absoluteFilePath() != QFileInfo(m_configFile).absoluteFilePath();
+    if (retarget) {
+        QFile::remove(journalPath(m_configFile));
+        m_configFile = configFile;
+    }
+
+    if (m_records.isEmpty()) {
+        QFile::remove(journalPath(m_configFile));
+        m_headerWritten = false;
+        return;
+    }
+
+    // 保存期间产生的记录仍未落入配置文件，以保存后的配置文件为基准重写日志
+    QByteArray bytes = header(m_configFile);
+    for (const Record& record : m_records) {
+        bytes.append(record.line);
+    }
+    QString error;
+    if (!AtomicFileWriter::writeFile(journalPath(m_configFile), bytes, &error)) {
+        qWarning() << QString(u8"编辑日志压缩失败: %1").arg(error);
+    }
+    m_headerWritten = true;
+}
@@ -0,0 +1,76 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QTimer>
+#include <QVariant>
+#include <QVector>
+
+class EquipmentType;
+class DeviceInstance;
+
+// 预写式编辑日志：配置文件旁的 <配置文件>.journal，每次模型取值变化追加一行 JSON
+// （设备、工作状态、参数ID、新值），代价远低于整份重写配置文件。
+// 记录先进入内存缓冲，短时间合并后追加写入；保存成功后把已落入配置文件的记录压缩掉。
+// 打开配置文件时若存在日志（上次异常退出或尚未保存），按顺序回放到模型中。
+// 日志首行记录基准配置文件的大小与修改时间，配置文件被其他途径改写后日志不再回放。
+class EditJournal : public QObject {
+    Q_OBJECT
+
+public:
+    explicit EditJournal(QObject* parent = nullptr);
+    ~EditJournal(); // 写出缓冲中的记录
+
+    static QString journalPath(const QString& configFile);
+
+    // 回放 configFile 对应的日志并开始记录：返回回放的记录数；
+    // 日志与配置文件不匹配时改名为 .stale 保留，返回 -1 并在 warning 中给出说明
+    int open(const QString& configFile,
+             QMap<QString, QList<DeviceInstance*>>& devices,
+             QString* warning = nullptr);
+    void close(); // 写出缓冲并停止记录，日志文件保留
+
+    // 由 DeviceInstance 在取值实际变化时调用；value 无效表示删除该键
+    void recordBasic(const DeviceInstance* device, const QString& id, const QVariant& value);
+    void recordState(const DeviceInstance* device, int stateIndex, const QString& id, const QVariant& value);
+
+    bool isOpen() const { return !m_configFile.isEmpty(); }
+    bool hasUnsaved() const { return !m_records.isEmpty(); }
+    quint64 lastSequence() const { return m_sequence; }
+
+    // configFile 保存成功且已包含序号 <= upTo 的记录：丢弃这些记录，
+    // 其余记录以新的配置文件为基准重写日志；另存为其他文件时日志随之迁移
+    void compact(const QString& configFile, quint64 upTo);
+
+public slots:
+    void flush();
+
+signals:
+    void recorded(); // 新增记录，供空闲自动保存计时
+
+private:
+    struct Record {
+        quint64 sequence = 0;
+        QByteArray line;
+    };
+
+    QString m_configFile;
+    QFile m_file;
+    QVector<Record> m_records; // 尚未压缩进配置文件的记录
+    QByteArray m_pending;      // 尚未写入日志文件的记录
+    QTimer m_flushTimer;
+    quint64 m_sequence = 0;
+    bool m_headerWritten = false;
+
+    void append(QByteArray line);
+    bool openForAppend();
+    static QByteArray header(const QString& configFile);
+    static bool applyLine(const QByteArray& line,
+                          const QHash<QString, DeviceInstance*>& devicesByKey,
+                          QString* error);
+};
@@ -13,7 +13,14 @@
 #include <QScopedValueRollback>
 #include <QTabBar>
 #include <QHash>
+#include <QSet>
+#include <QElapsedTimer>
 #include "ConfigEditorDialog.h"
+#include "ValidationEngine.h"
+#include "ConfigLoader.h"
+#include "ShardedStorage.h"
+#include "AtomicFileWriter.h"
+#include "AppTheme.h"
 
 EquipmentConfigWidget::EquipmentConfigWidget(QWidget* parent)
     : QTabWidget(parent)
@@ -27,29 +34,53 @@ EquipmentConfigWidget::EquipmentConfigWidget(QWidget* parent)
         tabBar()->setElideMode(Qt::ElideNone);
     }
     
-    // 启动定时器定期更新所有设备的可见性
-    QTimer* visibilityTimer = new QTimer(this);
-    connect(visibilityTimer, &QTimer::timeout, this, &EquipmentConfigWidget::updateAllVisibility);
-    visibilityTimer->start(2000); // 每2秒检查一次
+    bool capOk = false;
+    int cap = qgetenv("VALIDATION_MAX_ISSUES").toInt(&capOk);
+    if (capOk) {
+        m_maxValidationIssues = cap;
+    }
+    
+    m_saver = new ConfigSaver(this);
+    connect(m_saver, &ConfigSaver::finished, this, &EquipmentConfigWidget::onSaveFinished);
+    
+    // 编辑先追加到日志，停顿一段时间后再在后台整体保存
+    m_journal = new EditJournal(this);
+    m_searchIndex = new SearchIndex(this);
+    int idleMs = 5000;
+    bool idleOk = false;
+    const int envIdle = qgetenv("JOURNAL_AUTOSAVE_IDLE_MS").toInt(&idleOk);
+    if (idleOk) {
+        idleMs = envIdle;
+    }
+    m_autosaveTimer = new QTimer(this);
+    m_autosaveTimer->setSingleShot(true);
+    m_autosaveTimer->setInterval(qMax(idleMs, 0));
+    connect(m_autosaveTimer, &QTimer::timeout, this, &EquipmentConfigWidget::onAutosaveTimeout);
+    if (idleMs > 0) {
+        connect(m_journal, &EditJournal::recorded, m_autosaveTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    }
 }
 
 EquipmentConfigWidget::~EquipmentConfigWidget()
 {
+    // 退出时仍等待未完成的保存写盘并压缩编辑日志，但不再向外回报结果
+    blockSignals(true);
     clearAll();
 }
 
 void EquipmentConfigWidget::clearAll()
 {
-    // 清理设备实例
-    for (auto& deviceList : m_deviceInstances) {
-        qDeleteAll(deviceList);
-        deviceList.clear();
-    }
-    m_deviceInstances.clear();
-    
-    // 清理设备类型
-    qDeleteAll(m_equipmentTypes);
-    m_equipmentTypes.clear();
+    // 后台保存仍在读取设备类型，先等待其结束；序列化缓存随模型一并丢弃。
+    // 编辑日志写出后保留在磁盘上，下次打开同一文件时回放
+    m_saver->clearCache();
+    m_autosaveTimer->stop();
+    m_journal->close();
+    m_searchIndex->clear(); // 先于设备实例释放
+    m_journalMarks.clear();
+    m_saveKinds.clear();
+    m_saveTimers.clear();
+    m_adoptPathSaves.clear();
+    ConfigLoader::clear(m_equipmentTypes, m_deviceInstances);
     
     // 清理所有tab
     while (count() > 0) {
@@ -61,27 +92,28 @@ void EquipmentConfigWidget::clearAll()
 
 bool EquipmentConfigWidget::loadFromJson(const QString& jsonFile)
 {
-    QFile file(jsonFile);
-    if (!file.open(QIODevice::ReadOnly)) {
-        emit validationError(QString(u8"无法打开配置文件: %1").arg(jsonFile));
-        return false;
-    }
-    
-    QByteArray jsonData = file.readAll();
-    QJsonParseError parseError;
-    QJsonDocument doc = QJsonDocument::fromJson(jsonData, &parseError);
-    
-    if (parseError.error != QJsonParseError::NoError) {
-        emit validationError(QString(u8"JSON解析错误: %1").arg(parseError.errorString()));
+    // 各阶段用时写入性能记录；样式与布局在回到事件循环后才发生，最后一段在那时补记。
+    // 界面构建用时与样式表有关，记录中一并注明当前主题
+    PerfLog::Timer timer(u8"加载", QString(u8"%1（主题 %2）").arg(QFileInfo(jsonFile).fileName(), AppTheme::modeName()));
+    QJsonObject rootObj;
+    QString error;
+    if (!ConfigLoader::readRoot(jsonFile, rootObj, &error, &timer)) {
+        emit timingRecorded(timer.finish(false));
+        emit validationError(error);
         return false;
     }
-    
-    QJsonObject rootObj = doc.object();
-    m_lastRootObject = rootObj;
-    if (!rootObj.contains("equipment_config")) {
-        emit validationError(QString(u8"配置文件格式错误：缺少equipment_config节点"));
+    // 分片布局下设备取值在各分片文件中，合并后与单文件布局一致；缓存的根对象仍是 schema 本身
+    QJsonObject configObj;
+    if (!ShardedStorage::loadShards(jsonFile, rootObj, configObj, &error)) {
+        emit timingRecorded(timer.finish(false));
+        emit validationError(error);
         return false;
     }
+    timer.mark(u8"读取分片");
+    // 只缓存模型以外的内容，设备取值在模型中已有一份
+    m_lastRootObject = ConfigLoader::withoutDeviceValues(rootObj);
+    rootObj = QJsonObject();
+    stampRootFile(jsonFile);
 
     // 加载阶段屏蔽界面刷新与可见性检查，减少构建时的卡顿
     QScopedValueRollback<bool> loadingGuard(m_isLoading, true);
@@ -93,68 +125,43 @@ bool EquipmentConfigWidget::loadFromJson(const QString& jsonFile)
     
     // 清理现有数据
     clearAll();
-    
-    QJsonObject configObj = rootObj["equipment_config"].toObject();
-    if (configObj.contains("equipment_types")) {
-        QJsonArray equipmentTypes = configObj["equipment_types"].toArray();
-        
-        for (const auto& typeValue : equipmentTypes) {
-            QJsonObject typeObj = typeValue.toObject();
-            EquipmentType* equipType = EquipmentType::fromJson(typeObj);
-            
-            if (equipType) {
-                m_equipmentTypes.append(equipType);
-                
-                // 创建设备实例 - 优先从device_instances创建
-                QList<DeviceInstance*> devices;
-                
-                if (typeObj.contains("device_instances")) {
-                    // 从配置文件中的device_instances创建
-                    QJsonArray devicesArray = typeObj["device_instances"].toArray();
-                    
-                    for (int i = 0; i < devicesArray.size(); ++i) {
-                        QJsonObject deviceObj = devicesArray[i].toObject();
-                        QString deviceId = deviceObj["device_id"].toString();
-                        QString deviceName = deviceObj["device_name"].toString();
-                        
-                        // 如果ID或名称为空，使用默认生成的
-                        if (deviceId.isEmpty()) {
-                            deviceId = QString("%1_%2").arg(equipType->getTypeId()).arg(i);
-                        }
-                        if (deviceName.isEmpty()) {
-                            deviceName = QString("%1 %2").arg(equipType->getTypeName()).arg(i + 1);
-                        }
-                        
-                        DeviceInstance* device = new DeviceInstance(deviceId, deviceName, equipType);
-                        devices.append(device);
-                    }
-                    
-                    // 更新设备类型的device_count以匹配实际实例数量
-                    // 注意：这里需要修改EquipmentType类以支持设置device_count
-                    qDebug() << QString(u8"从device_instances创建了 %1 个 %2 设备").arg(devices.size()).arg(equipType->getTypeName());
-                } else {
-                    // 回退到使用device_count创建
-                    for (int i = 0; i < equipType->getDeviceCount(); ++i) {
-                        QString deviceId = QString("%1_%2").arg(equipType->getTypeId()).arg(i);
-                        QString deviceName = QString("%1 %2").arg(equipType->getTypeName()).arg(i + 1);
-                        DeviceInstance* device = new DeviceInstance(deviceId, deviceName, equipType);
-                        devices.append(device);
-                    }
-                    qDebug() << QString(u8"从device_count创建了 %1 个 %2 设备").arg(devices.size()).arg(equipType->getTypeName());
-                }
-                
-                m_deviceInstances[equipType->getTypeId()] = devices;
-            }
+    timer.mark(u8"释放旧配置");
+    
+    // 创建设备类型、设备实例并加载已保存的参数值
+    ConfigLoader::buildModel(configObj, m_equipmentTypes, m_deviceInstances);
+    // 此时模型与磁盘上的分片一致；之后回放的编辑会改变修订号，对应分片在下次保存时重写
+    m_saver->markLoaded(jsonFile, m_lastRootObject, m_equipmentTypes, m_deviceInstances);
+    timer.mark(u8"构建模型");
+    
+    // 回放上次未压缩进配置文件的编辑（异常退出或未保存），之后的编辑继续记入日志
+    QString journalWarning;
+    const int recovered = m_journal->open(jsonFile, m_deviceInstances, &journalWarning);
+    for (const QList<DeviceInstance*>& typeDevices : m_deviceInstances) {
+        for (DeviceInstance* device : typeDevices) {
+            device->setJournal(m_journal);
         }
     }
+    timer.mark(u8"回放编辑日志");
     
-    // 加载设备实例的实际参数值（如果存在）
-    loadDeviceInstanceValues(configObj);
+    // 搜索索引在回放之后建立，此后的取值变化由设备实例增量通知
+    m_searchIndex->rebuild(m_equipmentTypes, m_deviceInstances);
+    for (const QList<DeviceInstance*>& typeDevices : m_deviceInstances) {
+        for (DeviceInstance* device : typeDevices) {
+            device->setSearchIndex(m_searchIndex);
+        }
+    }
+    timer.mark(u8"搜索索引");
     
-    // 创建界面
+    // 创建界面；参数表单按模型/委托实现，控件数量只与页签数有关，与参数个数无关
     createEquipmentTypeTabs();
+    timer.mark(u8"创建页签");
     setUpdatesEnabled(true);
     updateAllVisibility(); // 构建完成后统一刷新可见性
+    timer.mark(u8"首次可见性");
+    QTimer::singleShot(0, this, [this, timer]() mutable {
+        timer.mark(u8"样式与布局");
+        emit timingRecorded(timer.finish());
+    });
     
     // 设置当前文件路径
     m_currentFilePath = jsonFile;
@@ -163,6 +170,14 @@ bool EquipmentConfigWidget::loadFromJson(const QString& jsonFile)
     qDebug() << QString(u8"配置加载完成。设备类型数量: %1").arg(m_equipmentTypes.size());
     
     emit configChanged();
+    if (recovered > 0) {
+        if (m_autosaveTimer->interval() > 0) {
+            m_autosaveTimer->start();
+        }
+        emit editsRecovered(jsonFile, recovered);
+    } else if (!journalWarning.isEmpty()) {
+        emit validationError(journalWarning);
+    }
     return true;
 }
 
@@ -180,105 +195,15 @@ bool EquipmentConfigWidget::createNewConfig(const QString& jsonFile)
     ecObj.insert("equipment_types", QJsonArray());
     rootObj.insert("equipment_config", ecObj);
 
-    QFile file(jsonFile);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-        emit validationError(QString(u8"无法创建空白配置文件: %1").arg(jsonFile));
+    QString error;
+    if (!AtomicFileWriter::writeFile(jsonFile, QJsonDocument(rootObj).toJson(), &error)) {
+        emit validationError(QString(u8"无法创建空白配置文件: %1").arg(error));
         return false;
     }
-    QJsonDocument doc(rootObj);
-    file.write(doc.toJson());
-    file.close();
 
     return loadFromJson(jsonFile);
 }
 
-void EquipmentConfigWidget::loadDeviceInstanceValues(const QJsonObject& configObj)
-{
-    if (!configObj.contains("equipment_types")) {
-        return;
-    }
-    
-    QJsonArray equipmentTypes = configObj["equipment_types"].toArray();
-    
-    for (const auto& typeValue : equipmentTypes) {
-        QJsonObject typeObj = typeValue.toObject();
-        QString typeId = typeObj["type_id"].toString();
-        
-        if (!m_deviceInstances.contains(typeId)) {
-            continue;
-        }
-        
-        // 加载设备实例的实际参数值
-        if (typeObj.contains("device_instances")) {
-            QJsonArray devicesArray = typeObj["device_instances"].toArray();
-            QList<DeviceInstance*>& devices = m_deviceInstances[typeId];
-            
-            // 为每个JSON中的设备实例找到对应的DeviceInstance对象
-            for (int i = 0; i < devicesArray.size(); ++i) {
-                QJsonObject deviceObj = devicesArray[i].toObject();
-                QString jsonDeviceId = deviceObj["device_id"].toString();
-                
-                // 通过设备ID找到对应的DeviceInstance
-                DeviceInstance* device = nullptr;
-                for (DeviceInstance* dev : devices) {
-                    if (dev->getDeviceId() == jsonDeviceId) {
-                        device = dev;
-                        break;
-                    }
-                }
-                
-                // 如果没找到，尝试通过索引匹配（向后兼容）
-                if (!device && i < devices.size()) {
-                    device = devices[i];
-                    qDebug() << QString(u8"警告：设备ID %1 不匹配，使用索引 %2 进行匹配").arg(jsonDeviceId).arg(i);
-                }
-                
-                if (!device) {
-                    qDebug() << QString(u8"警告：无法找到设备ID %1 对应的设备实例").arg(jsonDeviceId);
-                    continue;
-                }
-                
-                // 加载基本参数值
-                if (deviceObj.contains("basic_values")) {
-                    QJsonObject basicValuesObj = deviceObj["basic_values"].toObject();
-                    for (auto it = basicValuesObj.begin(); it != basicValuesObj.end(); ++it) {
-                        QString paramId = it.key();
-                        QVariant value = it.value().toVariant();
-                        device->setBasicValue(paramId, value);
-                    }
-                }
-                
-                // 加载工作状态值
-                if (deviceObj.contains("work_states")) {
-                    QJsonArray workStatesArray = deviceObj["work_states"].toArray();
-                    
-                    // 首先根据实际保存的状态数量更新设备的工作状态个数
-                    int actualStateCount = workStatesArray.size();
-                    if (actualStateCount > 0) {
-                        device->setWorkStateCount(actualStateCount);
-                    }
-                    
-                    for (int j = 0; j < workStatesArray.size(); ++j) {
-                        QJsonObject stateObj = workStatesArray[j].toObject();
-                        int stateIndex = stateObj["state_index"].toInt();
-                        
-                        if (stateObj.contains("values")) {
-                            QJsonObject stateValuesObj = stateObj["values"].toObject();
-                            QVariantMap stateValues;
-                            
-                            for (auto it = stateValuesObj.begin(); it != stateValuesObj.end(); ++it) {
-                                stateValues[it.key()] = it.value().toVariant();
-                            }
-                            
-                            device->setWorkStateValues(stateIndex, stateValues);
-                        }
-                    }
-                }
-            }
-        }
-    }
-}
-
 bool EquipmentConfigWidget::autoSave()
 {
     if (!hasCurrentFile()) {
@@ -302,228 +227,199 @@ bool EquipmentConfigWidget::saveCurrentValues()
 
 bool EquipmentConfigWidget::saveToJson(const QString& jsonFile)
 {
-    if (!validateAll()) {
-        emit validationError(u8"保存失败：存在非法或超出范围的输入，请检查高亮字段。");
-        return false;
+    return submitSave(jsonFile, ExplicitSave) != 0;
+}
+
+bool EquipmentConfigWidget::saveAs(const QString& jsonFile)
+{
+    const quint64 generation = submitSave(jsonFile, ExplicitSave);
+    if (generation != 0) {
+        m_adoptPathSaves.insert(generation);
     }
-    
-    // 先尝试读取原有文件内容
+    return generation != 0;
+}
+
+bool EquipmentConfigWidget::exportSingleFile(const QString& jsonFile)
+{
+    return submitSave(jsonFile, ExportSave, ToSingleFile) != 0;
+}
+
+bool EquipmentConfigWidget::saveAsSplit(const QString& jsonFile)
+{
+    const quint64 generation = submitSave(jsonFile, ExplicitSave, ToSplit);
+    if (generation != 0) {
+        m_adoptPathSaves.insert(generation);
+    }
+    return generation != 0;
+}
+
+void EquipmentConfigWidget::onAutosaveTimeout()
+{
+    if (!hasCurrentFile() || !m_journal->hasUnsaved()) {
+        return;
+    }
+    if (m_saver->isBusy()) {
+        m_autosaveTimer->start(); // 上一次保存尚未结束，稍后再试
+        return;
+    }
+    submitSave(m_currentFilePath, QuietSave);
+}
+
+quint64 EquipmentConfigWidget::submitSave(const QString& jsonFile, SaveKind kind, LayoutChange layout)
+{
+    if (jsonFile.isEmpty()) {
+        emit validationError(u8"未指定保存的文件。");
+        return 0;
+    }
+    // 保留目标文件中 equipment_config 以外的内容：优先使用加载时缓存的根对象，
+    // 仅在目标文件被外部修改或另存到其他文件时才重新读取。
+    // 正在后台写入同一文件时，磁盘状态与缓存的差异来自自己的写入，缓存仍然有效
     QJsonObject rootObj;
-    
-    QFile existingFile(jsonFile);
-    if (existingFile.exists() && existingFile.open(QIODevice::ReadOnly)) {
-        QByteArray existingJsonData = existingFile.readAll();
-        existingFile.close();
-        
-        QJsonParseError parseError;
-        QJsonDocument existingDoc = QJsonDocument::fromJson(existingJsonData, &parseError);
-        
-        if (parseError.error == QJsonParseError::NoError) {
-            rootObj = existingDoc.object();
-            qDebug() << QString(u8"读取到原有JSON文件内容，保留其他对象");
-        } else {
-            qDebug() << QString(u8"原有JSON文件解析失败，创建新的根对象: %1").arg(parseError.errorString());
-            rootObj = QJsonObject(); // 创建新的根对象
-        }
+    bool rootReread = false;
+    if (isRootCacheValid(jsonFile) || (!m_lastRootObject.isEmpty() && m_saver->isSaving(jsonFile))) {
+        rootObj = m_lastRootObject;
     } else {
-        qDebug() << QString(u8"原有JSON文件不存在或无法读取，创建新的根对象");
-        rootObj = QJsonObject(); // 创建新的根对象
+        rootObj = readRootForSave(jsonFile);
+        rootReread = true;
     }
-    
-    QJsonObject configObj = rootObj.value("equipment_config").toObject();
-    QJsonArray existingTypesArray = configObj.value("equipment_types").toArray();
-    QHash<QString, QJsonObject> existingTypeMap;
-    for (const auto& v : existingTypesArray) {
-        QJsonObject obj = v.toObject();
-        QString tid = obj.value("type_id").toString();
-        if (!tid.isEmpty()) {
-            existingTypeMap.insert(tid, obj);
-        }
+    if (layout != KeepLayout) {
+        // 布局切换只改 storage 节点；目标布局沿用到之后对该文件的保存
+        rootObj = ShardedStorage::withLayout(rootObj, layout == ToSplit);
     }
-
-    QJsonArray equipmentTypesArray;
     
-    // 序列化所有设备类型
-    for (EquipmentType* equipType : m_equipmentTypes) {
-        QJsonObject typeObj = existingTypeMap.value(equipType->getTypeId());
-        typeObj["type_id"] = equipType->getTypeId();
-        typeObj["type_name"] = equipType->getTypeName();
-        
-        // 使用实际的设备实例数量，而不是模板的device_count
-        int actualDeviceCount = 0;
-        if (m_deviceInstances.contains(equipType->getTypeId())) {
-            actualDeviceCount = m_deviceInstances[equipType->getTypeId()].size();
-        }
-        typeObj["device_count"] = actualDeviceCount;
-        
-        // 序列化基本参数
-        QJsonArray basicParamsArray;
-        const auto& basicParams = equipType->getBasicParameters();
-        for (ParameterItem* param : basicParams) {
-            QJsonObject paramObj;
-            paramObj["id"] = param->getId();
-            paramObj["label"] = param->getLabel();
-            paramObj["type"] = param->getType();
-            paramObj["unit"] = param->getUnit();
-            paramObj["default"] = param->getDefaultValue().toString();
-            
-            if (param->getType() == "int" || param->getType() == "double") {
-                QJsonArray rangeArray;
-                rangeArray.append(param->getMinValue());
-                rangeArray.append(param->getMaxValue());
-                paramObj["range"] = rangeArray;
-            } else if (param->getType() == "enum") {
-                QJsonArray optionsArray;
-                for (const QString& option : param->getOptions()) {
-                    optionsArray.append(option);
-                }
-                paramObj["options"] = optionsArray;
-            }
-            
-            basicParamsArray.append(paramObj);
-        }
-        typeObj["basic_parameters"] = basicParamsArray;
-        
-        // 序列化工作状态模板
-        WorkStateTemplate* wsTemplate = equipType->getWorkStateTemplate();
-        if (wsTemplate) {
-            QJsonObject templateObj = typeObj.value("work_state_template").toObject();
-            templateObj["template_id"] = wsTemplate->getTemplateId();
-            templateObj["template_name"] = wsTemplate->getTemplateName();
-            
-            QJsonArray wsParamsArray;
-            const auto& wsParams = wsTemplate->getParameters();
-            for (ParameterItem* param : wsParams) {
-                QJsonObject paramObj;
-                paramObj["id"] = param->getId();
-                paramObj["label"] = param->getLabel();
-                paramObj["type"] = param->getType();
-                paramObj["unit"] = param->getUnit();
-                paramObj["default"] = param->getDefaultValue().toString();
-                
-                if (param->getType() == "int" || param->getType() == "double") {
-                    QJsonArray rangeArray;
-                    rangeArray.append(param->getMinValue());
-                    rangeArray.append(param->getMaxValue());
-                    paramObj["range"] = rangeArray;
-                } else if (param->getType() == "enum") {
-                    QJsonArray optionsArray;
-                    for (const QString& option : param->getOptions()) {
-                        optionsArray.append(option);
-                    }
-                    paramObj["options"] = optionsArray;
-                }
-                
-                wsParamsArray.append(paramObj);
-            }
-            templateObj["parameters"] = wsParamsArray;
-            
-            // 保存自定义工作状态标签及可选的数量覆盖
-            if (!wsTemplate->getStateTabTitles().isEmpty()) {
-                QJsonArray titlesArr;
-                for (const QString& t : wsTemplate->getStateTabTitles()) {
-                    titlesArr.append(t);
-                }
-                templateObj["state_tab_titles"] = titlesArr;
-            } else {
-                templateObj.remove("state_tab_titles");
-            }
-            if (wsTemplate->getStateTabCountOverride() > 0) {
-                templateObj["state_tab_count"] = wsTemplate->getStateTabCountOverride();
-            } else {
-                templateObj.remove("state_tab_count");
-            }
-
-            // 规则（可见性 / 选项 / 校验说明）
-            QJsonArray visRules = wsTemplate->getVisibilityRulesJson();
-            if (!visRules.isEmpty()) {
-                templateObj["visibility_rules"] = visRules;
-            } else {
-                templateObj.remove("visibility_rules");
-            }
+    // 界面线程只复制快照；校验、序列化与写盘在后台完成，较新的保存会取代尚未写盘的旧请求
+    PerfLog::Timer timer(kind == QuietSave ? u8"自动保存" : kind == ExportSave ? u8"导出" : u8"保存",
+                         QFileInfo(jsonFile).fileName());
+    // 自动保存在每次停顿后都会发生，只记录用时，不遍历对象树
+    timer.setCountObjects(kind != QuietSave);
+    ConfigSaver::Snapshot snapshot = ConfigSaver::takeSnapshot(jsonFile, rootObj, rootReread,
+                                                               m_equipmentTypes, m_deviceInstances,
+                                                               m_maxValidationIssues);
+    const quint64 generation = m_saver->submit(snapshot);
+    timer.mark(u8"界面快照");
+    // 快照包含到此为止的全部编辑，保存成功后这些日志记录即可压缩掉；导出的副本不参与压缩
+    m_saveKinds.insert(generation, kind);
+    if (kind != ExportSave) {
+        m_journal->flush();
+        m_journalMarks.insert(generation, m_journal->lastSequence());
+    }
+    qDebug() << QString(u8"已提交%1请求 #%2: %3（快照 %4 ms）")
+                    .arg(kind == QuietSave ? u8"自动保存" : kind == ExportSave ? u8"导出" : u8"保存")
+                    .arg(generation)
+                    .arg(jsonFile)
+                    .arg(timer.elapsed());
+    m_saveTimers.insert(generation, timer);
+    return generation;
+}
 
-            QJsonArray optRules = wsTemplate->getOptionRulesJson();
-            if (!optRules.isEmpty()) {
-                templateObj["option_rules"] = optRules;
-            } else {
-                templateObj.remove("option_rules");
-            }
+void EquipmentConfigWidget::waitForPendingSave()
+{
+    m_saver->waitForFinished();
+}
 
-            QJsonArray validationRules = wsTemplate->getValidationRulesJson();
-            if (validationRules.isEmpty()) {
-                validationRules = templateObj.value("validation_rules").toArray();
-            }
-            if (!validationRules.isEmpty()) {
-                templateObj["validation_rules"] = validationRules;
-            } else {
-                templateObj.remove("validation_rules");
-            }
-            typeObj["work_state_template"] = templateObj;
-        } else {
-            typeObj.remove("work_state_template");
+void EquipmentConfigWidget::onSaveFinished(const ConfigSaver::Result& result)
+{
+    const quint64 journalMark = m_journalMarks.take(result.generation);
+    const SaveKind kind = m_saveKinds.take(result.generation);
+    const bool adoptPath = m_adoptPathSaves.remove(result.generation);
+    PerfLog::Timer timer = m_saveTimers.take(result.generation);
+    if (result.superseded) {
+        // 取代它的请求写入同一文件且包含全部修改：另存为的换路径与显式保存的提示随之转交
+        if (adoptPath) {
+            m_adoptPathSaves.insert(result.supersededBy);
         }
-        
-        // 序列化设备实例的实际参数值
-        if (m_deviceInstances.contains(equipType->getTypeId())) {
-            QJsonArray devicesArray;
-            const QList<DeviceInstance*>& devices = m_deviceInstances[equipType->getTypeId()];
-            
-            for (DeviceInstance* device : devices) {
-                QJsonObject deviceObj;
-                deviceObj["device_id"] = device->getDeviceId();
-                deviceObj["device_name"] = device->getDeviceName();
-                
-                // 保存基本参数值
-                QJsonObject basicValuesObj;
-                const auto& basicValues = device->getAllBasicValues();
-                for (auto it = basicValues.begin(); it != basicValues.end(); ++it) {
-                    basicValuesObj[it.key()] = it.value().toString();
-                }
-                deviceObj["basic_values"] = basicValuesObj;
-                
-                // 保存工作状态值
-                QJsonArray workStatesArray;
-                for (int i = 0; i < device->getWorkStateCount(); ++i) {
-                    QJsonObject stateObj;
-                    stateObj["state_index"] = i;
-                    
-                    QJsonObject stateValuesObj;
-                    const QVariantMap& stateValues = device->getWorkStateValues(i);
-                    for (auto it = stateValues.begin(); it != stateValues.end(); ++it) {
-                        stateValuesObj[it.key()] = it.value().toString();
-                    }
-                    stateObj["values"] = stateValuesObj;
-                    
-                    workStatesArray.append(stateObj);
-                }
-                deviceObj["work_states"] = workStatesArray;
-                
-                devicesArray.append(deviceObj);
+        if (kind == ExplicitSave && m_saveKinds.value(result.supersededBy) == QuietSave) {
+            m_saveKinds.insert(result.supersededBy, ExplicitSave);
+            auto next = m_saveTimers.find(result.supersededBy);
+            if (next != m_saveTimers.end()) {
+                next->setCountObjects(true);
             }
-            typeObj["device_instances"] = devicesArray;
         }
-        
-        equipmentTypesArray.append(typeObj);
+        qDebug() << QString(u8"保存请求 #%1 已被 #%2 取代，未写入").arg(result.generation).arg(result.supersededBy);
+        if (kind != QuietSave) {
+            emit timingRecorded(timer.finish(false));
+            emit saveSuperseded(result.path);
+        }
+        return;
     }
+    // 后台阶段的用时随结果带回；合计为提交到回报的时间，包含排队等待
+    timer.addPhase(u8"后台校验", result.validateMs);
+    if (!result.validationFailed) {
+        timer.addPhase(u8"序列化", result.serializeStats.elapsedMs);
+        timer.addPhase(u8"写盘", qMax<qint64>(0, result.writeStats.elapsedMs - result.serializeStats.elapsedMs));
+    }
+    emit timingRecorded(timer.finish(result.ok));
     
-    configObj["equipment_types"] = equipmentTypesArray;
-    // 只更新equipment_config部分，保留rootObj中的其他对象
-    rootObj["equipment_config"] = configObj;
+    m_lastReport = result.report;
+    emit validationReportChanged(m_lastReport);
+    if (!result.ok && kind == QuietSave) {
+        // 自动保存失败不打断编辑，修改仍保留在编辑日志中
+        qDebug() << QString(u8"自动保存未完成: %1").arg(result.error);
+        return;
+    }
+    if (!result.ok) {
+        if (result.validationFailed) {
+            // 消息框只展示摘要，完整列表在校验结果面板中按需格式化
+            emit validationError(result.report.summary());
+        }
+        emit validationError(result.error);
+        emit saveFinished(result.path, false);
+        return;
+    }
+    // 文件中写入的是规范化后的取值，同步回模型，界面与文件保持一致
+    applyNormalization(result.normalized);
+    if (kind == ExportSave) {
+        emit saveFinished(result.path, true);
+        return;
+    }
+    if (adoptPath && result.path != m_currentFilePath) {
+        m_currentFilePath = result.path;
+        emit filePathChanged(m_currentFilePath);
+    }
     
-    // 写入文件
-    QFile file(jsonFile);
-    if (!file.open(QIODevice::WriteOnly)) {
-        emit validationError(QString(u8"无法创建配置文件: %1").arg(jsonFile));
+    // 缓存的根对象只用于保留非设备内容，不随每次保存重建
+    m_lastRootObject = result.root;
+    stampRootFile(result.path);
+    m_journal->compact(result.path, journalMark);
+    emit saveFinished(result.path, true);
+}
+
+void EquipmentConfigWidget::stampRootFile(const QString& jsonFile)
+{
+    QFileInfo fi(jsonFile);
+    m_rootStamp.path = fi.absoluteFilePath();
+    m_rootStamp.modified = fi.lastModified();
+    m_rootStamp.size = fi.size();
+}
+
+bool EquipmentConfigWidget::isRootCacheValid(const QString& jsonFile) const
+{
+    if (m_lastRootObject.isEmpty()) {
         return false;
     }
+    QFileInfo fi(jsonFile);
+    return fi.exists()
+        && fi.absoluteFilePath() == m_rootStamp.path
+        && fi.size() == m_rootStamp.size
+        && fi.lastModified() == m_rootStamp.modified;
+}
+
+QJsonObject EquipmentConfigWidget::readRootForSave(const QString& jsonFile) const
+{
+    QFile existingFile(jsonFile);
+    if (!existingFile.exists() || !existingFile.open(QIODevice::ReadOnly)) {
+        qDebug() << QString(u8"原有JSON文件不存在或无法读取，创建新的根对象");
+        return QJsonObject();
+    }
     
-    QJsonDocument doc(rootObj);
-    file.write(doc.toJson());
-    file.close();
-    
-    qDebug() << QString(u8"配置保存完成: %1").arg(jsonFile);
-    m_lastRootObject = rootObj;
-    return true;
+    QJsonParseError parseError;
+    QJsonDocument existingDoc = QJsonDocument::fromJson(existingFile.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        qDebug() << QString(u8"原有JSON文件解析失败，创建新的根对象: %1").arg(parseError.errorString());
+        return QJsonObject();
+    }
+    qDebug() << QString(u8"目标文件已被外部修改或不是当前文件，重新读取以保留其他对象");
+    return ConfigLoader::withoutDeviceValues(existingDoc.object());
 }
 
 void EquipmentConfigWidget::createEquipmentTypeTabs()
@@ -606,291 +502,145 @@ void EquipmentConfigWidget::updateAllVisibility()
 
 bool EquipmentConfigWidget::validateAll()
 {
-    QStringList errors;
-    auto parseFrequencies = [](const QString& text, QList<double>& out) -> bool {
-        QString trimmed = text.trimmed();
-        if (trimmed.isEmpty()) {
-            return true;
-        }
-        if (!trimmed.startsWith('[') || !trimmed.endsWith(']')) {
-            return false;
-        }
-        trimmed = trimmed.mid(1, trimmed.size() - 2).trimmed();
-        if (trimmed.isEmpty()) {
-            return true;
-        }
-        const QStringList parts = trimmed.split(',',  QString::SkipEmptyParts);
-        for (const QString& p : parts) {
-            bool ok = false;
-            double v = p.trimmed().toDouble(&ok);
-            if (!ok) {
-                return false;
-            }
-            out.append(v);
-        }
-        return true;
-    };
+    // 参数规范化与 validation_rules（per_state / per_device / global）统一由校验引擎执行
+    PerfLog::Timer timer(u8"校验");
+    m_lastReport = ValidationReport(m_maxValidationIssues);
+    ValidationEngine engine(m_equipmentTypes, m_deviceInstances);
+    bool ok = engine.run(m_lastReport);
+    timer.mark(u8"校验引擎");
+    emit validationReportChanged(m_lastReport);
+    timer.mark(u8"刷新结果面板");
+    timer.setSubject(QString(u8"%1 条问题").arg(m_lastReport.totalCount()));
+    emit timingRecorded(timer.finish());
+    if (!ok) {
+        // 消息框只展示摘要，完整列表在校验结果面板中按需格式化
+        emit validationError(m_lastReport.summary());
+        return false;
+    }
+    
+    return true;
+}
 
-    auto normalizeValue = [](ParameterItem* param, const QVariant& value) {
-        QVariant normalized = value;
-        const QString type = param->getType();
+bool EquipmentConfigWidget::focusIssue(const ValidationIssue& issue)
+{
+    return focusParameter(issue.typeId, issue.deviceId, issue.stateIndex, issue.paramId);
+}
+
+bool EquipmentConfigWidget::focusParameter(const QString& typeId, const QString& deviceId,
+                                           int stateIndex, const QString& paramId)
+{
+    auto matches = [&typeId, &deviceId](DeviceTabWidget* deviceTab) {
+        DeviceInstance* device = deviceTab ? deviceTab->getDevice() : nullptr;
+        return device && device->getDeviceId() == deviceId &&
+               device->getEquipmentType() && device->getEquipmentType()->getTypeId() == typeId;
+    };
+    
+    for (int i = 0; i < count(); ++i) {
+        QWidget* tabWidget = widget(i);
         
-        if (!normalized.isValid() || (type == "string" && normalized.toString().isEmpty())) {
-            if (type == "string" && param->isArrayLike()) {
-                normalized = QStringLiteral("[]");
-            } else {
-                normalized = param->getDefaultValue();
+        DeviceTabWidget* deviceTabWidget = qobject_cast<DeviceTabWidget*>(tabWidget);
+        if (deviceTabWidget) {
+            if (matches(deviceTabWidget)) {
+                setCurrentIndex(i);
+                return deviceTabWidget->focusParameter(stateIndex, paramId);
             }
+            continue;
         }
         
-        if (type == "int" || type == "Byte") {
-            bool ok = false;
-            int v = normalized.toInt(&ok);
-            if (!ok) {
-                v = param->getDefaultValue().toInt();
-            }
-            int minVal = static_cast<int>(param->getMinValue());
-            int maxVal = static_cast<int>(param->getMaxValue());
-            if (v < minVal) v = minVal;
-            if (v > maxVal) v = maxVal;
-            normalized = v;
-        } else if (type == "double") {
-            bool ok = false;
-            double v = normalized.toDouble(&ok);
-            if (!ok) {
-                v = param->getDefaultValue().toDouble();
-            }
-            double minVal = param->getMinValue();
-            double maxVal = param->getMaxValue();
-            if (v < minVal) v = minVal;
-            if (v > maxVal) v = maxVal;
-            normalized = v;
-        } else if (type == "enum") {
-            QString v = normalized.toString();
-            if (!param->getOptions().contains(v)) {
-                QString def = param->getDefaultValue().toString();
-                if (param->getOptions().contains(def)) {
-                    v = def;
-                } else if (!param->getOptions().isEmpty()) {
-                    v = param->getOptions().first();
+        QTabWidget* typeTabWidget = qobject_cast<QTabWidget*>(tabWidget);
+        if (typeTabWidget) {
+            for (int j = 0; j < typeTabWidget->count(); ++j) {
+                DeviceTabWidget* nestedDeviceTab = qobject_cast<DeviceTabWidget*>(typeTabWidget->widget(j));
+                if (matches(nestedDeviceTab)) {
+                    setCurrentIndex(i);
+                    typeTabWidget->setCurrentIndex(j);
+                    return nestedDeviceTab->focusParameter(stateIndex, paramId);
                 }
             }
-            normalized = v;
-        } else if (type == "string") {
-            QString v = normalized.toString();
-            if (!ParameterItem::stringAllowedPattern().match(v).hasMatch()) {
-                v = param->getDefaultValue().toString();
-            }
-            normalized = v;
         }
-        
-        return normalized;
-    };
+    }
+    return false;
+}
+
+BulkEdit::Outcome EquipmentConfigWidget::applyBulkEdit(const BulkEdit::Request& request)
+{
+    const ParameterItem* param = nullptr;
+    for (const EquipmentType* type : m_equipmentTypes) {
+        if (type->getTypeId() != request.typeId) {
+            continue;
+        }
+        if (request.stateParameter) {
+            param = type->getWorkStateTemplate() ? type->getWorkStateTemplate()->getParameter(request.paramId) : nullptr;
+        } else {
+            param = type->getBasicParameter(request.paramId);
+        }
+        break;
+    }
     
-    for (EquipmentType* equipType : m_equipmentTypes) {
-        const auto& basicParams = equipType->getBasicParameters();
-        WorkStateTemplate* wsTemplate = equipType->getWorkStateTemplate();
-        const QList<DeviceInstance*>& devices = m_deviceInstances.value(equipType->getTypeId());
-        for (DeviceInstance* device : devices) {
-            // 基本参数校验
-            for (ParameterItem* param : basicParams) {
-                QVariant val = normalizeValue(param, device->getBasicValue(param->getId()));
-                device->setBasicValue(param->getId(), val); // 回写自动填充或校正的值
-                if (!param->validate(val)) {
-                    errors << QString(u8"设备[%1] 基本参数[%2] 输入非法或超出范围").arg(device->getDeviceName(), param->getLabel());
-                }
-            }
-            
-            // 工作状态参数校验
-            if (wsTemplate) {
-                for (int stateIdx = 0; stateIdx < device->getWorkStateCount(); ++stateIdx) {
-                    QVariantMap stateValues = device->getWorkStateValues(stateIdx);
-                    for (ParameterItem* param : wsTemplate->getParameters()) {
-                        QVariant val = normalizeValue(param, stateValues.value(param->getId(), param->getDefaultValue()));
-                        stateValues[param->getId()] = val; // 回写自动填充或校正的值
-                        if (!param->validate(val)) {
-                            errors << QString(u8"设备[%1] 工作状态%2 参数[%3] 输入非法或超出范围")
-                                       .arg(device->getDeviceName())
-                                       .arg(stateIdx + 1)
-                                       .arg(param->getLabel());
-                        }
-                    }
-                    device->setWorkStateValues(stateIdx, stateValues);
-                }
-            }
+    const BulkEdit::Outcome outcome = BulkEdit::apply(request, param);
+    if (!outcome.ok || outcome.changedDevices.isEmpty()) {
+        return outcome;
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    QSet<const DeviceInstance*> changed;
+    for (const DeviceInstance* device : outcome.changedDevices) {
+        changed.insert(device);
+    }
+    refreshDeviceTabs(changed);
+    qDebug() << QString(u8"批量修改后刷新 %1 个设备页，用时 %2 ms").arg(changed.size()).arg(timer.elapsed());
+    
+    emit configChanged();
+    return outcome;
+}
 
-            // 通用规则引擎：按 validation_rules 执行业务校验（当前用于 UHF）
-            if (wsTemplate) {
-                QJsonObject wsObj = equipType->getWorkStateTemplate()->getTemplateId().isEmpty()
-                    ? QJsonObject()
-                    : QJsonObject(); //占位
-                // 从原始配置对象中获取 validation_rules（存放在 work_state_template 节点）
-                // 由于这里没有直接保存模板的 JSON，改用 equipType->getWorkStateTemplate() 获取不到规则，故直接从 m_lastRootObject 中查找
-            }
+void EquipmentConfigWidget::refreshDeviceTabs(const QSet<const DeviceInstance*>& devices)
+{
+    // 只刷新受影响的设备页，刷新期间暂停绘制，结束后统一重绘一次
+    setUpdatesEnabled(false);
+    for (DeviceTabWidget* deviceTab : findChildren<DeviceTabWidget*>()) {
+        if (devices.contains(deviceTab->getDevice())) {
+            deviceTab->refreshFromDevice();
         }
     }
+    setUpdatesEnabled(true);
+}
 
-    // 从 m_lastRootObject 中提取 validation_rules 并执行
-    if (!m_lastRootObject.isEmpty()) {
-        QJsonArray types = m_lastRootObject.value("equipment_config").toObject().value("equipment_types").toArray();
-        QMap<QString, QJsonObject> rulesByType;
-        for (const auto& tv : types) {
-            QJsonObject to = tv.toObject();
-            QString tid = to.value("type_id").toString();
-            QJsonObject ws = to.value("work_state_template").toObject();
-            if (ws.contains("validation_rules")) {
-                rulesByType.insert(tid, ws);
-            }
+void EquipmentConfigWidget::applyNormalization(const QVector<ValidationEngine::Normalization>& changes)
+{
+    if (changes.isEmpty()) {
+        return;
+    }
+    QHash<QString, DeviceInstance*> byKey;
+    for (auto it = m_deviceInstances.constBegin(); it != m_deviceInstances.constEnd(); ++it) {
+        for (DeviceInstance* device : it.value()) {
+            byKey.insert(it.key() + QChar(0x1f) + device->getDeviceId(), device);
         }
+    }
 
-        auto getParamVal = [](const QVariantMap& vals, const QString& key) -> QString {
-            QVariant v = vals.value(key);
-            if (!v.isValid()) return QString();
-            return v.toString();
-        };
-
-        auto matchWhen = [&](const QVariantMap& vals, const QJsonObject& when) -> bool {
-            for (auto it = when.begin(); it != when.end(); ++it) {
-                QString key = it.key();
-                QJsonArray arr = it.value().toArray();
-                QString cur = getParamVal(vals, key);
-                bool hit = false;
-                for (const auto& v : arr) {
-                    if (cur == v.toString()) {
-                        hit = true;
-                        break;
-                    }
-                }
-                if (!hit) return false;
-            }
-            return true;
-        };
-
-        auto getNumber = [](const QVariantMap& vals, const QString& key) -> double {
-            bool ok = false;
-            double d = vals.value(key).toDouble(&ok);
-            return ok ? d : 0.0;
-        };
-
-        auto applyValidationRules = [&](const QString& typeId,
-                                        DeviceInstance* device,
-                                        int stateIdx,
-                                        const QVariantMap& vals,
-                                        const QJsonArray& rules) {
-            for (const auto& rv : rules) {
-                QJsonObject ro = rv.toObject();
-                QString scope = ro.value("scope").toString();
-                if (scope != "per_state") continue;
-                QString rid = ro.value("id").toString();
-                QString desc = ro.value("description").toString();
-                QJsonArray constraints = ro.value("constraints").toArray();
-                for (const auto& cv : constraints) {
-                    QJsonObject co = cv.toObject();
-                    if (co.contains("when")) {
-                        if (!matchWhen(vals, co.value("when").toObject())) {
-                            continue;
-                        }
-                    }
-                    const QString prefix = QString(u8"设备[%1] 工作状态%2 规则[%3]")
-                                               .arg(device->getDeviceName())
-                                               .arg(stateIdx + 1)
-                                               .arg(rid.isEmpty() ? QStringLiteral("未知") : rid);
-                    const double eps = 1e-6;
-                    if (co.contains("equal")) {
-                        QJsonArray arr = co.value("equal").toArray();
-                        if (arr.size() == 2) {
-                            double a = getNumber(vals, arr.at(0).toString());
-                            double b = getNumber(vals, arr.at(1).toString());
-                            if (qAbs(a - b) > eps) {
-                                errors << QString(u8"%1：%2 与 %3 应相等").arg(prefix, arr.at(0).toString(), arr.at(1).toString());
-                            }
-                        }
-                    }
-                    if (co.contains("less")) {
-                        QJsonArray arr = co.value("less").toArray();
-                        if (arr.size() == 2) {
-                            double a = getNumber(vals, arr.at(0).toString());
-                            double b = getNumber(vals, arr.at(1).toString());
-                            if (!(a < b)) {
-                                errors << QString(u8"%1：%2 应小于 %3").arg(prefix, arr.at(0).toString(), arr.at(1).toString());
-                            }
-                        }
-                    }
-                    if (co.contains("min")) {
-                        QJsonObject mo = co.value("min").toObject();
-                        for (auto it = mo.begin(); it != mo.end(); ++it) {
-                            double v = getNumber(vals, it.key());
-                            if (v + eps < it.value().toDouble()) {
-                                errors << QString(u8"%1：%2 应≥%3").arg(prefix, it.key()).arg(it.value().toDouble());
-                            }
-                        }
-                    }
-                    if (co.contains("min_end_by_interval")) {
-                        QJsonObject mo = co.value("min_end_by_interval").toObject();
-                        QString startK = mo.value("start").toString();
-                        QString endK = mo.value("end").toString();
-                        QString countK = mo.value("count").toString();
-                        QString intK = mo.value("interval").toString();
-                        double start = getNumber(vals, startK);
-                        double end = getNumber(vals, endK);
-                        int count = vals.value(countK).toInt();
-                        double interval = getNumber(vals, intK);
-                        double minEnd = start + static_cast<double>(count) * interval;
-                        if (end + eps < minEnd) {
-                            errors << QString(u8"%1：%2 应≥%3（当前 %4，期望≥%5）")
-                                      .arg(prefix, endK)
-                                      .arg(minEnd, 0, 'g', 12)
-                                      .arg(end, 0, 'g', 12)
-                                      .arg(minEnd, 0, 'g', 12);
-                        }
-                    }
-                    if (co.contains("list_between")) {
-                        QJsonObject lo = co.value("list_between").toObject();
-                        QString listK = lo.value("list").toString();
-                        QString minK = lo.value("min_from").toString();
-                        QString maxK = lo.value("max_from").toString();
-                        QList<double> listVals;
-                        if (!parseFrequencies(vals.value(listK).toString(), listVals)) {
-                            errors << QString(u8"%1：%2 频率数组格式错误，应为形如[1,2,3]").arg(prefix, listK);
-                        } else {
-                            double minV = getNumber(vals, minK);
-                            double maxV = getNumber(vals, maxK);
-                            for (double f : listVals) {
-                                if (!(f > minV && f < maxV)) {
-                                    errors << QString(u8"%1：%2 中的频率%3 应在 (%4, %5) 内")
-                                              .arg(prefix, listK)
-                                              .arg(f, 0, 'g', 12)
-                                              .arg(minV, 0, 'g', 12)
-                                              .arg(maxV, 0, 'g', 12);
-                                    break;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        };
-
-        for (EquipmentType* equipType : m_equipmentTypes) {
-            const auto& devices = m_deviceInstances.value(equipType->getTypeId());
-            QJsonObject wsObj = rulesByType.value(equipType->getTypeId());
-            QJsonArray vRules = wsObj.value("validation_rules").toArray();
-            if (vRules.isEmpty()) continue;
-            for (DeviceInstance* device : devices) {
-                for (int stateIdx = 0; stateIdx < device->getWorkStateCount(); ++stateIdx) {
-                    QVariantMap stateValues = device->getWorkStateValues(stateIdx);
-                    applyValidationRules(equipType->getTypeId(), device, stateIdx, stateValues, vRules);
-                }
+    // 快照之后用户又修改过的取值以用户的修改为准；这些改动已经写入文件，不再记入编辑日志
+    QSet<const DeviceInstance*> changed;
+    for (const ValidationEngine::Normalization& change : changes) {
+        DeviceInstance* device = byKey.value(change.typeId + QChar(0x1f) + change.deviceId);
+        if (!device) {
+            continue;
+        }
+        device->setJournal(nullptr);
+        if (change.stateIndex < 0) {
+            if (device->getBasicValue(change.paramId) == change.before) {
+                device->setBasicValue(change.paramId, change.after);
+                changed.insert(device);
             }
+        } else if (change.stateIndex < device->getWorkStateCount()
+                   && device->getWorkStateValues(change.stateIndex).value(change.paramId) == change.before) {
+            device->setWorkStateValue(change.stateIndex, change.paramId, change.after);
+            changed.insert(device);
         }
+        device->setJournal(m_journal);
     }
-    
-    if (!errors.isEmpty()) {
-        emit validationError(errors.join("\n"));
-        return false;
-    }
-    
-    return true;
+    refreshDeviceTabs(changed);
+    qDebug() << QString(u8"保存时规范化了 %1 个取值，已同步到 %2 台设备").arg(changes.size()).arg(changed.size());
 }
 
 void EquipmentConfigWidget::onConfigurationChanged()
@@ -905,7 +655,20 @@ bool EquipmentConfigWidget::openStructureEditor()
         emit validationError(u8"当前没有加载可编辑的配置。");
         return false;
     }
-    ConfigEditorDialog dlg(m_lastRootObject, m_currentFilePath, this);
+    // 结构编辑器会改写配置文件，先把日志中未保存的修改落盘，避免日志基准失效
+    if (m_journal->hasUnsaved() && hasCurrentFile()) {
+        submitSave(m_currentFilePath, ExplicitSave);
+    }
+    // 缓存的根对象不含设备取值，结构编辑器以磁盘上的完整内容为准
+    waitForPendingSave();
+    QJsonObject rootObj = m_lastRootObject;
+    if (!m_currentFilePath.isEmpty()) {
+        QJsonObject saved;
+        if (ConfigLoader::readRoot(m_currentFilePath, saved)) {
+            rootObj = saved;
+        }
+    }
+    ConfigEditorDialog dlg(rootObj, m_currentFilePath, this);
     if (dlg.exec() == QDialog::Accepted && dlg.changed()) {
         // 重新加载文件以同步模型
         if (!m_currentFilePath.isEmpty()) {
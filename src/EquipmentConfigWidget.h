@@ -2,11 +2,21 @@
 
 #include "EquipmentType.h"
 #include "DeviceInstance.h"
+#include "ValidationReport.h"
+#include "ConfigSaver.h"
+#include "EditJournal.h"
+#include "SearchIndex.h"
+#include "BulkEdit.h"
+#include "PerfLog.h"
 #include <QTabWidget>
 #include <QList>
 #include <QMap>
 #include <QString>
 #include <QJsonObject>
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
 
 class EquipmentConfigWidget : public QTabWidget {
     Q_OBJECT
@@ -16,11 +26,26 @@ public:
     ~EquipmentConfigWidget();
 
     bool loadFromJson(const QString& jsonFile);
+    // 保存均在后台执行：返回 false 表示请求未能提交（原因经 validationError 给出），
+    // 提交后的实际结果由 saveFinished 回报
     bool saveToJson(const QString& jsonFile);
+    bool saveAs(const QString& jsonFile); // 另存为：保存成功后才切换当前文件
+    void waitForPendingSave();
     bool autoSave(); // 自动保存到当前文件
+    bool exportSingleFile(const QString& jsonFile); // 导出为单文件布局，不改变当前文件与编辑日志
+    bool saveAsSplit(const QString& jsonFile); // 以分片布局另存（schema + 取值分片），成功后切换当前文件
     bool saveCurrentValues(); // 保存当前所有参数值（不改变文件结构）
     void updateAllVisibility();
     bool validateAll();
+    const ValidationReport& lastValidationReport() const { return m_lastReport; }
+    void setMaxValidationIssues(int maxIssues) { m_maxValidationIssues = maxIssues; }
+    bool focusIssue(const ValidationIssue& issue); // 跳转到问题所在的参数编辑器
+    bool focusParameter(const QString& typeId, const QString& deviceId, int stateIndex, const QString& paramId);
+    SearchIndex* searchIndex() const { return m_searchIndex; }
+    const QList<EquipmentType*>& equipmentTypes() const { return m_equipmentTypes; }
+    const QMap<QString, QList<DeviceInstance*>>& deviceInstances() const { return m_deviceInstances; }
+    // 批量修改：整体校验通过后一次写入，受影响的设备页在同一次界面更新中刷新
+    BulkEdit::Outcome applyBulkEdit(const BulkEdit::Request& request);
     bool openStructureEditor(); // 打开结构编辑模式
     bool createNewConfig(const QString& jsonFile); // 创建空白配置并加载
 
@@ -32,23 +57,55 @@ public:
 signals:
     void configChanged();
     void validationError(const QString& message);
+    void validationReportChanged(const ValidationReport& report);
     void filePathChanged(const QString& filePath);
+    void saveFinished(const QString& filePath, bool ok);
+    void saveSuperseded(const QString& filePath); // 保存请求被同一文件之后的保存取代，结果随那次保存回报
+    void editsRecovered(const QString& filePath, int count); // 打开文件时从编辑日志回放了未保存的修改
+    void timingRecorded(const PerfLog::Entry& entry); // 加载、校验、保存结束后的分阶段用时
 
 private slots:
     void onConfigurationChanged();
+    void onSaveFinished(const ConfigSaver::Result& result);
+    void onAutosaveTimeout();
 
 private:
     QList<EquipmentType*> m_equipmentTypes;
     QMap<QString, QList<DeviceInstance*>> m_deviceInstances; // typeId -> devices
     QString m_currentFilePath; // 当前打开的文件路径
-    QJsonObject m_lastRootObject; // 缓存当前配置的原始 JSON
+    QJsonObject m_lastRootObject; // 缓存当前配置中模型以外的内容（不含设备取值），保存时据此保留其他节点
+    // 缓存对应的文件状态：保存前只比较修改时间与大小，未被外部修改时无需重读重解析
+    struct FileStamp {
+        QString path;
+        QDateTime modified;
+        qint64 size = -1;
+    };
+    FileStamp m_rootStamp;
+    ConfigSaver* m_saver = nullptr; // 后台保存，内部复用未变化设备的序列化片段
+    EditJournal* m_journal = nullptr; // 预写式编辑日志，保存成功后压缩
+    SearchIndex* m_searchIndex = nullptr; // 全局搜索索引，随取值变化增量更新
+    QTimer* m_autosaveTimer = nullptr; // 编辑停顿后把日志压缩进配置文件，可由 JOURNAL_AUTOSAVE_IDLE_MS 调整（<=0 关闭）
+    enum SaveKind {
+        ExplicitSave, // 用户触发的保存
+        QuietSave,    // 空闲自动保存，失败时不弹出提示
+        ExportSave    // 导出副本，不压缩编辑日志、不更新缓存的根对象
+    };
+    enum LayoutChange { KeepLayout, ToSingleFile, ToSplit };
+    QHash<quint64, quint64> m_journalMarks; // 保存请求 -> 提交时的日志序号
+    QHash<quint64, SaveKind> m_saveKinds; // 保存请求 -> 类型
+    QHash<quint64, PerfLog::Timer> m_saveTimers; // 保存请求 -> 计时（提交到回报）
+    QSet<quint64> m_adoptPathSaves; // 成功后把目标文件设为当前文件的保存请求（另存为）
     bool m_isLoading = false; // 标记是否处于加载阶段，避免重复刷新
+    ValidationReport m_lastReport; // 最近一次校验的结构化结果
+    int m_maxValidationIssues = 500; // 单次校验最多保留的问题条数，可由 VALIDATION_MAX_ISSUES 覆盖
 
     void createEquipmentTypeTabs();
     void createDeviceTabs(const QString& typeId, QTabWidget* parentTab);
     void clearAll();
-    
-    // 参数值的保存和加载
-    void loadDeviceInstanceValues(const QJsonObject& configObj);
-    void saveDeviceInstanceValues(QJsonObject& configObj) const;
+    quint64 submitSave(const QString& jsonFile, SaveKind kind, LayoutChange layout = KeepLayout); // 0 表示未提交
+    void applyNormalization(const QVector<ValidationEngine::Normalization>& changes);
+    void refreshDeviceTabs(const QSet<const DeviceInstance*>& devices);
+    void stampRootFile(const QString& jsonFile);
+    bool isRootCacheValid(const QString& jsonFile) const;
+    QJsonObject readRootForSave(const QString& jsonFile) const;
 }; 
@@ -1,4 +1,5 @@
 ﻿#include "EquipmentType.h"
+#include "DeviceInstance.h"
 #include <QJsonArray>
 #include <QDebug>
 
@@ -38,6 +39,50 @@ ParameterItem* EquipmentType::getBasicParameter(const QString& id) const
     return nullptr;
 }
 
+QStringList EquipmentType::legacyEnableCandidates() const
+{
+    // 旧配置没有 enable_parameter：按类型 ID/名称推断候选参数
+    QStringList candidates;
+    if (m_typeId.contains("radar") || m_typeName.contains("雷达")) {
+        candidates << "radar_enabled" << "雷达参数出现";
+    } else if (m_typeId.contains("comm") || m_typeName.contains("通信")) {
+        candidates << "comm_enabled" << "通信参数出现";
+    }
+    candidates << "enabled" << "参数出现";
+    return candidates;
+}
+
+void EquipmentType::resolveLegacyEnableParameter()
+{
+    // 先取第一个已声明为基本参数的候选
+    for (const QString& id : legacyEnableCandidates()) {
+        if (getBasicParameter(id)) {
+            m_enableParameterId = id;
+            qDebug() << QString(u8"设备类型 %1 未声明 enable_parameter，按旧规则使用 %2").arg(m_typeId, id);
+            return;
+        }
+    }
+}
+
+void EquipmentType::resolveLegacyEnableParameter(const QList<DeviceInstance*>& devices)
+{
+    if (m_enableParameterDeclared || !m_enableParameterId.isEmpty()) {
+        return;
+    }
+    // 更早的配置只在设备取值中保存启用参数，取第一个出现在任一设备基本参数取值中的候选
+    for (const QString& id : legacyEnableCandidates()) {
+        for (const DeviceInstance* device : devices) {
+            if (device->getBasicValues().contains(id)) {
+                m_enableParameterId = id;
+                qWarning() << QString(u8"设备类型 %1 未声明 enable_parameter，按设备取值中的 %2 判断启用状态；"
+                                      u8"该参数不是基本参数，界面中无法修改，请在配置中声明")
+                                  .arg(m_typeId, id);
+                return;
+            }
+        }
+    }
+}
+
 EquipmentType* EquipmentType::fromJson(const QJsonObject& json)
 {
     QString typeId = json["type_id"].toString();
@@ -60,11 +105,26 @@ EquipmentType* EquipmentType::fromJson(const QJsonObject& json)
             }
         }
     }
+    // 基本参数的联动规则与工作状态模板同一格式，写在类型对象上
+    equipmentType->m_basicRules.load(json, equipmentType->m_basicParameters);
+    
+    if (json.contains("enable_parameter")) {
+        equipmentType->m_enableParameterId = json["enable_parameter"].toString();
+        equipmentType->m_enableParameterDeclared = true;
+        // 仍按设备取值判断启用状态，但该参数不会出现在基本参数页中
+        if (!equipmentType->m_enableParameterId.isEmpty()
+            && !equipmentType->getBasicParameter(equipmentType->m_enableParameterId)) {
+            qWarning() << QString(u8"设备类型 %1 声明的 enable_parameter %2 不是基本参数，界面中无法修改")
+                              .arg(typeId, equipmentType->m_enableParameterId);
+        }
+    } else {
+        equipmentType->resolveLegacyEnableParameter();
+    }
     
     // 加载工作状态模板
     if (json.contains("work_state_template")) {
         QJsonObject templateObj = json["work_state_template"].toObject();
-        WorkStateTemplate* tmpl = WorkStateTemplate::fromJson(templateObj);
+        WorkStateTemplate* tmpl = WorkStateTemplate::fromJson(templateObj, equipmentType->m_basicParameters);
         if (tmpl) {
             equipmentType->setWorkStateTemplate(tmpl);
         }
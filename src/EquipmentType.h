@@ -2,10 +2,13 @@
 
 #include "ParameterItem.h"
 #include "WorkStateTemplate.h"
+#include "ParameterRuleSet.h"
 #include <QString>
 #include <QList>
 #include <QJsonObject>
 
+class DeviceInstance;
+
 class EquipmentType {
 public:
     EquipmentType(const QString& typeId, const QString& typeName);
@@ -16,6 +19,11 @@ public:
     int getDeviceCount() const { return m_deviceCount; }
     const QList<ParameterItem*>& getBasicParameters() const { return m_basicParameters; }
     WorkStateTemplate* getWorkStateTemplate() const { return m_workStateTemplate; }
+    // 基本参数的可见性与选项规则（类型对象上的 visibility_rules / option_rules）
+    const ParameterRuleSet& getBasicRules() const { return m_basicRules; }
+    // 决定设备是否启用的基本参数（enable_parameter），加载时确定一次；为空表示设备始终启用
+    QString getEnableParameterId() const { return m_enableParameterId; }
+    bool isEnableParameterDeclared() const { return m_enableParameterDeclared; }
     
     void setDeviceCount(int count) { m_deviceCount = count; }
     void addBasicParameter(ParameterItem* parameter);
@@ -26,11 +34,20 @@ public:
     
     // 从JSON加载
     static EquipmentType* fromJson(const QJsonObject& json);
+    // 设备取值加载后调用：未声明 enable_parameter、候选参数也不是基本参数的旧配置，
+    // 按设备基本参数取值中出现的候选键确定启用参数
+    void resolveLegacyEnableParameter(const QList<DeviceInstance*>& devices);
 
 private:
     QString m_typeId;
     QString m_typeName;
     int m_deviceCount = 1;
     QList<ParameterItem*> m_basicParameters;
+    ParameterRuleSet m_basicRules;
+    QString m_enableParameterId;
+    bool m_enableParameterDeclared = false;
+
+    QStringList legacyEnableCandidates() const;
+    void resolveLegacyEnableParameter();
     WorkStateTemplate* m_workStateTemplate = nullptr;
 }; 
\ No newline at end of file
@@ -0,0 +1,180 @@
+﻿#include "JsonWriter.h"
+#include <cmath>
+
+void JsonWriter::writeIndent(QByteArray& out, int level)
+{
+    out.append(QByteArray(level * 4, ' '));
+}
+
+void JsonWriter::writeKey(QByteArray& out, const QString& key, int level)
+{
+    writeIndent(out, level);
+    writeString(out, key);
+    out.append(": ", 2);
+}
+
+void JsonWriter::writeString(QByteArray& out, const QString& text)
+{
+    static const char hex[] = "0123456789abcdef";
+    const QByteArray utf8 = text.toUtf8();
+    out.append('"');
+    for (char ch : utf8) {
+        const unsigned char c = static_cast<unsigned char>(ch);
+        switch (c) {
+        case '"':  out.append("\\\"", 2); break;
+        case '\\': out.append("\\\\", 2); break;
+        case '\b': out.append("\\b", 2); break;
+        case '\f': out.append("\\f", 2); break;
+        case '\n': out.append("\\n", 2); break;
+        case '\r': out.append("\\r", 2); break;
+        case '\t': out.append("\\t", 2); break;
+        default:
+            if (c < 0x20) {
+                out.append("\\u00", 4);
+                out.append(hex[c >> 4]);
+                out.append(hex[c & 0xf]);
+            } else {
+                out.append(ch);
+            }
+            break;
+        }
+    }
+    out.append('"');
+}
+
+void JsonWriter::writeNumber(QByteArray& out, double value)
+{
+    if (!std::isfinite(value)) {
+        out.append("null", 4); // JSON 不支持 NaN/Inf，与 QJsonDocument 行为一致
+        return;
+    }
+    // 整数值按整数输出，避免出现 3.0000000000000000 之类的写法
+    if (value == std::floor(value) && std::fabs(value) < 9007199254740992.0) {
+        out.append(QByteArray::number(static_cast<qint64>(value)));
+        return;
+    }
+    // 最短往返表示：15 位有效数字必定可还原，多数取值到此为止（0.1 写作 0.1 而不是 0.10000000000000001）
+    for (int precision = 15; precision < 17; ++precision) {
+        const QByteArray text = QByteArray::number(value, 'g', precision);
+        if (text.toDouble() == value) {
+            out.append(text);
+            return;
+        }
+    }
+    out.append(QByteArray::number(value, 'g', 17));
+}
+
+void JsonWriter::writeVariant(QByteArray& out, const QVariant& value)
+{
+    switch (value.type()) {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+        writeNumber(out, value.toDouble());
+        break;
+    case QVariant::Bool:
+        out.append(value.toBool() ? "true" : "false");
+        break;
+    default:
+        if (value.userType() == QMetaType::Float) {
+            writeNumber(out, value.toDouble());
+        } else {
+            writeString(out, value.toString());
+        }
+        break;
+    }
+}
+
+QJsonValue JsonWriter::fromVariant(const QVariant& value)
+{
+    switch (value.type()) {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+        return QJsonValue(value.toDouble());
+    case QVariant::Bool:
+        return QJsonValue(value.toBool());
+    default:
+        if (value.userType() == QMetaType::Float) {
+            return QJsonValue(value.toDouble());
+        }
+        return QJsonValue(value.toString());
+    }
+}
+
+void JsonWriter::writeObject(QByteArray& out, const QJsonObject& obj, int level)
+{
+    if (obj.isEmpty()) {
+        out.append("{}", 2);
+        return;
+    }
+    out.append("{\n", 2);
+    bool first = true;
+    for (auto it = obj.constBegin(); it != obj.constEnd(); ++it) {
+        if (!first) {
+            out.append(",\n", 2);
+        }
+        first = false;
+        writeKey(out, it.key(), level + 1);
+        writeValue(out, it.value(), level + 1);
+    }
+    out.append('\n');
+    writeIndent(out, level);
+    out.append('}');
+}
+
+void JsonWriter::writeArray(QByteArray& out, const QJsonArray& arr, int level)
+{
+    if (arr.isEmpty()) {
+        out.append("[]", 2);
+        return;
+    }
+    out.append("[\n", 2);
+    for (int i = 0; i < arr.size(); ++i) {
+        if (i > 0) {
+            out.append(",\n", 2);
+        }
+        writeIndent(out, level + 1);
+        writeValue(out, arr.at(i), level + 1);
+    }
+    out.append('\n');
+    writeIndent(out, level);
+    out.append(']');
+}
+
+void JsonWriter::writeValue(QByteArray& out, const QJsonValue& value, int level)
+{
+    switch (value.type()) {
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+        out.append("null", 4);
+        break;
+    case QJsonValue::Bool:
+        out.append(value.toBool() ? "true" : "false");
+        break;
+    case QJsonValue::Double:
+        writeNumber(out, value.toDouble());
+        break;
+    case QJsonValue::String:
+        writeString(out, value.toString());
+        break;
+    case QJsonValue::Array:
+        writeArray(out, value.toArray(), level);
+        break;
+    case QJsonValue::Object:
+        writeObject(out, value.toObject(), level);
+        break;
+    }
+}
+
+QByteArray JsonWriter::toJson(const QJsonObject& root)
+{
+    QByteArray out;
+    writeObject(out, root, 0);
+    out.append('\n');
+    return out;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QVariant>
+
+// 缩进格式的 JSON 文本输出（4 空格缩进、键按 QJsonObject 顺序）。
+// 与 QJsonDocument::toJson 不同，可以从任意缩进层级开始写，
+// 便于把缓存的片段直接拼接进完整文档。
+class JsonWriter {
+public:
+    static void writeValue(QByteArray& out, const QJsonValue& value, int level);
+    static void writeObject(QByteArray& out, const QJsonObject& obj, int level);
+    static void writeArray(QByteArray& out, const QJsonArray& arr, int level);
+    static void writeString(QByteArray& out, const QString& text);
+    static void writeNumber(QByteArray& out, double value);
+    static void writeIndent(QByteArray& out, int level);
+    static void writeKey(QByteArray& out, const QString& key, int level); // 缩进 + "key": 
+
+    // 参数取值 -> JSON：数值写为数字，布尔写为 true/false，其余按字符串
+    static QJsonValue fromVariant(const QVariant& value);
+    static void writeVariant(QByteArray& out, const QVariant& value); // 同上，直接写出文本
+
+    // 完整文档（根对象 + 结尾换行）
+    static QByteArray toJson(const QJsonObject& root);
+};
@@ -0,0 +1,93 @@
+﻿#include "ParameterEditorPool.h"
+
+namespace {
+QList<QPointer<QWidget>> g_pool[ParameterEditorPool::KindCount];
+int g_created = 0;
+int g_reused = 0;
+}
+
+ParameterEditorPool::Kind ParameterEditorPool::kindOf(const QString& type)
+{
+    if (type == "int" || type == "Byte") {
+        return IntEditor;
+    }
+    if (type == "double") {
+        return DoubleEditor;
+    }
+    if (type == "string") {
+        return StringEditor;
+    }
+    if (type == "enum") {
+        return EnumEditor;
+    }
+    return KindCount;
+}
+
+int ParameterEditorPool::capacity()
+{
+    static const int value = [] {
+        bool ok = false;
+        const int size = qgetenv("EDITOR_POOL_SIZE").toInt(&ok);
+        return ok && size >= 0 ? size : 16;
+    }();
+    return value;
+}
+
+QList<QPointer<QWidget>>& ParameterEditorPool::entries(Kind kind)
+{
+    return g_pool[kind];
+}
+
+QWidget* ParameterEditorPool::acquire(Kind kind, QWidget* parent)
+{
+    if (kind >= KindCount) {
+        return nullptr;
+    }
+    QList<QPointer<QWidget>>& pool = entries(kind);
+    while (!pool.isEmpty()) {
+        QWidget* editor = pool.takeLast().data();
+        if (!editor) {
+            continue; // 原视图已销毁
+        }
+        if (editor->parentWidget() != parent) {
+            editor->setParent(parent);
+        }
+        ++g_reused;
+        return editor;
+    }
+    return nullptr;
+}
+
+void ParameterEditorPool::noteCreated()
+{
+    ++g_created;
+}
+
+void ParameterEditorPool::release(Kind kind, QWidget* editor)
+{
+    if (!editor) {
+        return;
+    }
+    if (kind >= KindCount || entries(kind).size() >= capacity()) {
+        editor->deleteLater();
+        return;
+    }
+    editor->hide();
+    editor->clearFocus();
+    entries(kind).append(editor);
+}
+
+ParameterEditorPool::Stats ParameterEditorPool::stats()
+{
+    Stats result;
+    result.created = g_created;
+    result.reused = g_reused;
+    for (int kind = 0; kind < KindCount; ++kind) {
+        for (const QPointer<QWidget>& editor : g_pool[kind]) {
+            if (editor) {
+                ++result.pooled;
+            }
+        }
+    }
+    return result;
+}
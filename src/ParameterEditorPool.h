@@ -0,0 +1,43 @@
+﻿#pragma once
+
+#include <QList>
+#include <QPointer>
+#include <QString>
+#include <QWidget>
+
+// 参数编辑器回收池（仅界面线程使用）：ParameterDelegate 关闭编辑器时不销毁，
+// 按类型（int/double/string/enum）暂存，下次编辑任意视图的同类单元格时取出、
+// 换到新的父控件并重新设置范围与可选项，省去控件构造与样式表 polish。
+// 暂存的编辑器仍挂在原视图下，原视图销毁时随之释放，池中只保留 QPointer。
+class ParameterEditorPool {
+public:
+    enum Kind {
+        IntEditor,
+        DoubleEditor,
+        StringEditor,
+        EnumEditor,
+        KindCount
+    };
+
+    struct Stats {
+        int created = 0;
+        int reused = 0;
+        int pooled = 0; // 当前暂存数量
+    };
+
+    // 参数类型对应的编辑器种类；不支持的类型返回 KindCount
+    static Kind kindOf(const QString& type);
+
+    // 取出一个同类编辑器并挂到 parent 下；池为空时返回 nullptr，由调用方新建后 noteCreated()
+    static QWidget* acquire(Kind kind, QWidget* parent);
+    static void noteCreated();
+
+    // 回收编辑器；超过每类上限（EDITOR_POOL_SIZE，默认 16）时直接销毁
+    static void release(Kind kind, QWidget* editor);
+
+    static Stats stats();
+
+private:
+    static int capacity();
+    static QList<QPointer<QWidget>>& entries(Kind kind);
+};
@@ -0,0 +1,472 @@
+﻿#include "ParameterFormModel.h"
+#include "DeviceInstance.h"
+#include "EquipmentType.h"
+#include "ParameterItem.h"
+#include "WorkStateTemplate.h"
+#include "ParameterEditorPool.h"
+#include "ParameterRuleSet.h"
+#include <QColor>
+#include <QComboBox>
+#include <QDoubleSpinBox>
+#include <QHeaderView>
+#include <QLineEdit>
+#include <QRegularExpressionValidator>
+#include <QSpinBox>
+#include <QStyle>
+
+ParameterFormModel::ParameterFormModel(DeviceInstance* device, int stateIndex, QObject* parent)
+    : QAbstractTableModel(parent), m_device(device), m_stateIndex(stateIndex)
+{
+    EquipmentType* equipType = m_device ? m_device->getEquipmentType() : nullptr;
+    if (equipType) {
+        if (m_stateIndex < 0) {
+            m_params = equipType->getBasicParameters();
+            m_rules = &equipType->getBasicRules();
+        } else if (equipType->getWorkStateTemplate()) {
+            m_params = equipType->getWorkStateTemplate()->getParameters();
+            m_rules = &equipType->getWorkStateTemplate()->getRules();
+        }
+    }
+    for (int row = 0; row < m_params.size(); ++row) {
+        m_rows.insert(m_params.at(row)->getId(), row);
+    }
+    m_ruleHidden.resize(m_params.size());
+    m_forcedHidden.resize(m_params.size());
+
+    // 缺少的取值在加载与创建设备时已按默认值补齐；打开表单只计算可见性，不修改设备
+    if (m_rules) {
+        updateRuleHidden();
+    }
+}
+
+const ParameterItem* ParameterFormModel::parameterAt(int row) const
+{
+    return row >= 0 && row < m_params.size() ? m_params.at(row) : nullptr;
+}
+
+QVariant ParameterFormModel::value(int row) const
+{
+    const ParameterItem* param = parameterAt(row);
+    if (!param || !m_device) {
+        return QVariant();
+    }
+    const QVariant stored = m_stateIndex < 0
+        ? m_device->getBasicValue(param->getId())
+        : m_device->getWorkStateValues(m_stateIndex).value(param->getId());
+    return stored.isValid() ? stored : param->getDefaultValue();
+}
+
+QVariantMap ParameterFormModel::values() const
+{
+    if (!m_device) {
+        return QVariantMap();
+    }
+    return m_stateIndex < 0 ? m_device->getBasicValues() : m_device->getWorkStateValues(m_stateIndex);
+}
+
+bool ParameterFormModel::setValue(const QString& parameterId, const QVariant& newValue)
+{
+    const int row = rowOf(parameterId);
+    const ParameterItem* param = parameterAt(row);
+    if (!param || !m_device) {
+        return false;
+    }
+    const QVariant coerced = param->coerce(newValue);
+    if (value(row) == coerced) {
+        return true;
+    }
+    if (m_stateIndex < 0) {
+        m_device->setBasicValue(parameterId, coerced);
+    } else {
+        m_device->setWorkStateValue(m_stateIndex, parameterId, coerced);
+    }
+    const QModelIndex cell = index(row, ValueColumn);
+    emit dataChanged(cell, cell);
+    emit valueChanged(parameterId, coerced);
+    applyRules(parameterId);
+    return true;
+}
+
+QStringList ParameterFormModel::options(int row) const
+{
+    // 与表格视图共用编译后的选项规则；没有规则匹配时使用参数声明的选项
+    if (m_rules) {
+        const QStringList opts = m_rules->optionsFor(row, values());
+        if (!opts.isEmpty()) {
+            return opts;
+        }
+    }
+    const ParameterItem* param = parameterAt(row);
+    return param ? param->getOptions() : QStringList();
+}
+
+bool ParameterFormModel::validateRow(int row) const
+{
+    const ParameterItem* param = parameterAt(row);
+    if (!param) {
+        return true;
+    }
+    if (param->getType() == "enum") {
+        return options(row).contains(value(row).toString());
+    }
+    return param->validate(value(row));
+}
+
+void ParameterFormModel::setInvalid(const QString& parameterId, bool invalid, const QString& message)
+{
+    const int row = rowOf(parameterId);
+    if (row < 0) {
+        return;
+    }
+    if (invalid) {
+        if (m_invalidMessages.contains(row) && m_invalidMessages.value(row) == message) {
+            return;
+        }
+        m_invalidMessages.insert(row, message);
+    } else if (!m_invalidMessages.remove(row)) {
+        return;
+    }
+    emit dataChanged(index(row, LabelColumn), index(row, ValueColumn));
+}
+
+bool ParameterFormModel::isRowHidden(int row) const
+{
+    return row >= 0 && row < m_params.size() && (m_ruleHidden.testBit(row) || m_forcedHidden.testBit(row));
+}
+
+void ParameterFormModel::setRowForcedHidden(const QString& parameterId, bool hidden)
+{
+    const int row = rowOf(parameterId);
+    if (row < 0 || m_forcedHidden.testBit(row) == hidden) {
+        return;
+    }
+    const bool before = isRowHidden(row);
+    m_forcedHidden.setBit(row, hidden);
+    if (isRowHidden(row) != before) {
+        emit rowsHiddenChanged(QVector<int>() << row);
+    }
+}
+
+void ParameterFormModel::updateRuleHidden()
+{
+    const QBitArray hidden = m_rules->hiddenMask(values());
+    // 只有规则结果变化、且未被外部强制隐藏的行需要切换
+    const QBitArray changed = (m_ruleHidden ^ hidden) & ~m_forcedHidden;
+    m_ruleHidden = hidden;
+    QVector<int> rows;
+    for (int row = 0; row < changed.size(); ++row) {
+        if (changed.testBit(row)) {
+            rows.append(row);
+        }
+    }
+    if (!rows.isEmpty()) {
+        emit rowsHiddenChanged(rows);
+    }
+}
+
+void ParameterFormModel::refresh()
+{
+    if (m_params.isEmpty()) {
+        return;
+    }
+    emit dataChanged(index(0, ValueColumn), index(m_params.size() - 1, ValueColumn));
+    applyRules(QString());
+}
+
+void ParameterFormModel::applyRules(const QString& controllerId)
+{
+    // controllerId 为空时应用全部规则（取值在模型之外被修改后刷新）
+    if (!m_rules) {
+        return;
+    }
+    if (controllerId.isEmpty() || m_rules->isVisibilityController(controllerId)) {
+        updateRuleHidden();
+    }
+    if (!controllerId.isEmpty() && !m_rules->isOptionController(controllerId)) {
+        return;
+    }
+
+    // 控制参数变化后，目标枚举的取值不在新选项中时改为第一项
+    QVector<int> targets;
+    if (controllerId.isEmpty()) {
+        for (const auto& rule : m_rules->optionRules()) {
+            for (int target : m_rules->optionTargets(rule.controllerId)) {
+                if (!targets.contains(target)) {
+                    targets.append(target);
+                }
+            }
+        }
+    } else {
+        targets = m_rules->optionTargets(controllerId);
+    }
+    for (int targetRow : targets) {
+        const QStringList opts = m_rules->optionsFor(targetRow, values());
+        if (!opts.isEmpty() && !opts.contains(value(targetRow).toString())) {
+            setValue(m_params.at(targetRow)->getId(), opts.first());
+        }
+    }
+}
+
+int ParameterFormModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_params.size();
+}
+
+int ParameterFormModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant ParameterFormModel::data(const QModelIndex& index, int role) const
+{
+    const ParameterItem* param = parameterAt(index.row());
+    if (!param) {
+        return QVariant();
+    }
+    const int row = index.row();
+    auto invalid = m_invalidMessages.constFind(row);
+    const bool isInvalid = invalid != m_invalidMessages.constEnd();
+
+    if (index.column() == LabelColumn) {
+        switch (role) {
+        case Qt::DisplayRole:
+            return param->getUnit().isEmpty() ? param->getLabel()
+                                              : QString("%1 (%2)").arg(param->getLabel(), param->getUnit());
+        case Qt::ToolTipRole:
+            return param->getId();
+        case Qt::ForegroundRole:
+            return isInvalid ? QVariant(QColor("#dc2626")) : QVariant();
+        default:
+            return QVariant();
+        }
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return ParameterDelegate::displayText(param->getType(), value(row));
+    case Qt::EditRole:
+        return value(row);
+    case Qt::ToolTipRole:
+        return isInvalid ? QVariant(invalid.value()) : QVariant();
+    case Qt::BackgroundRole:
+        return isInvalid ? QVariant(QColor("#fef2f2")) : QVariant();
+    case ParameterDelegate::TypeRole:
+        return param->getType();
+    case ParameterDelegate::MinimumRole:
+        return param->getMinValue();
+    case ParameterDelegate::MaximumRole:
+        return param->getMaxValue();
+    case ParameterDelegate::OptionsRole:
+        return options(row);
+    case ParameterDelegate::InvalidRole:
+        return isInvalid;
+    default:
+        return QVariant();
+    }
+}
+
+bool ParameterFormModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    const ParameterItem* param = parameterAt(index.row());
+    if (!param || index.column() != ValueColumn || role != Qt::EditRole) {
+        return false;
+    }
+    return setValue(param->getId(), value);
+}
+
+Qt::ItemFlags ParameterFormModel::flags(const QModelIndex& index) const
+{
+    const ParameterItem* param = parameterAt(index.row());
+    if (!param) {
+        return Qt::NoItemFlags;
+    }
+    Qt::ItemFlags result = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    const QString type = param->getType();
+    if (index.column() == ValueColumn &&
+        (type == "int" || type == "Byte" || type == "double" || type == "string" || type == "enum")) {
+        result |= Qt::ItemIsEditable;
+    }
+    return result;
+}
+
+ParameterDelegate::ParameterDelegate(QObject* parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+QString ParameterDelegate::displayText(const QString& type, const QVariant& value)
+{
+    if (type == "double") {
+        bool ok = false;
+        const double d = value.toDouble(&ok);
+        if (ok) {
+            return QString::number(d, 'f', 2); // 与编辑器的小数位数一致
+        }
+    }
+    return value.toString();
+}
+
+QWidget* ParameterDelegate::createEditor(QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index) const
+{
+    const QString type = index.data(TypeRole).toString();
+    const ParameterEditorPool::Kind kind = ParameterEditorPool::kindOf(type);
+    if (kind == ParameterEditorPool::KindCount) {
+        return QStyledItemDelegate::createEditor(parent, option, index);
+    }
+
+    // 优先复用回收的同类编辑器，只重新设置范围与可选项
+    QWidget* editor = ParameterEditorPool::acquire(kind, parent);
+    if (!editor) {
+        switch (kind) {
+        case ParameterEditorPool::IntEditor:
+            editor = new QSpinBox(parent);
+            break;
+        case ParameterEditorPool::DoubleEditor: {
+            QDoubleSpinBox* doubleSpinBox = new QDoubleSpinBox(parent);
+            doubleSpinBox->setDecimals(2);
+            editor = doubleSpinBox;
+            break;
+        }
+        case ParameterEditorPool::StringEditor: {
+            QLineEdit* lineEdit = new QLineEdit(parent);
+            lineEdit->setValidator(new QRegularExpressionValidator(ParameterItem::stringAllowedPattern(), lineEdit));
+            editor = lineEdit;
+            break;
+        }
+        default:
+            editor = new QComboBox(parent);
+            break;
+        }
+        editor->setAutoFillBackground(true);
+        editor->setProperty("poolKind", static_cast<int>(kind));
+        ParameterEditorPool::noteCreated();
+    }
+
+    if (QSpinBox* spinBox = qobject_cast<QSpinBox*>(editor)) {
+        spinBox->setRange(static_cast<int>(index.data(MinimumRole).toDouble()),
+                          static_cast<int>(index.data(MaximumRole).toDouble()));
+    } else if (QDoubleSpinBox* doubleSpinBox = qobject_cast<QDoubleSpinBox*>(editor)) {
+        doubleSpinBox->setRange(index.data(MinimumRole).toDouble(), index.data(MaximumRole).toDouble());
+    } else if (QComboBox* comboBox = qobject_cast<QComboBox*>(editor)) {
+        const QStringList options = index.data(OptionsRole).toStringList();
+        if (comboBox->property("poolOptions").toStringList() != options) {
+            comboBox->clear();
+            comboBox->addItems(options);
+            comboBox->setProperty("poolOptions", options);
+        }
+        // 选择即提交，联动规则无需等到编辑器关闭；回收时在 destroyEditor 中断开
+        connect(comboBox, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated), this, [this, comboBox]() {
+            emit const_cast<ParameterDelegate*>(this)->commitData(comboBox);
+        });
+    }
+    return editor;
+}
+
+void ParameterDelegate::destroyEditor(QWidget* editor, const QModelIndex& index) const
+{
+    // 只回收本委托按类型创建的编辑器，其余交给默认实现销毁
+    const QVariant kind = editor->property("poolKind");
+    if (!kind.isValid()) {
+        QStyledItemDelegate::destroyEditor(editor, index);
+        return;
+    }
+    editor->disconnect(this);
+    ParameterEditorPool::release(static_cast<ParameterEditorPool::Kind>(kind.toInt()), editor);
+}
+
+void ParameterDelegate::setEditorData(QWidget* editor, const QModelIndex& index) const
+{
+    const QVariant value = index.data(Qt::EditRole);
+    if (QSpinBox* spinBox = qobject_cast<QSpinBox*>(editor)) {
+        spinBox->setValue(value.toInt());
+    } else if (QDoubleSpinBox* doubleSpinBox = qobject_cast<QDoubleSpinBox*>(editor)) {
+        doubleSpinBox->setValue(value.toDouble());
+    } else if (QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor)) {
+        lineEdit->setText(value.toString());
+    } else if (QComboBox* comboBox = qobject_cast<QComboBox*>(editor)) {
+        const int idx = comboBox->findText(value.toString());
+        if (idx >= 0) {
+            comboBox->setCurrentIndex(idx);
+        }
+    } else {
+        QStyledItemDelegate::setEditorData(editor, index);
+        return;
+    }
+
+    // invalid 属性变化后重新 polish，由 AppStyle（样式表主题下为 [invalid="true"] 规则）切换高亮
+    const bool invalid = index.data(InvalidRole).toBool();
+    editor->setToolTip(invalid ? index.data(Qt::ToolTipRole).toString() : QString());
+    if (editor->property("invalid").toBool() != invalid) {
+        editor->setProperty("invalid", invalid);
+        editor->style()->unpolish(editor);
+        editor->style()->polish(editor);
+    }
+}
+
+void ParameterDelegate::setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const
+{
+    if (QSpinBox* spinBox = qobject_cast<QSpinBox*>(editor)) {
+        spinBox->interpretText();
+        model->setData(index, spinBox->value());
+    } else if (QDoubleSpinBox* doubleSpinBox = qobject_cast<QDoubleSpinBox*>(editor)) {
+        doubleSpinBox->interpretText();
+        model->setData(index, doubleSpinBox->value());
+    } else if (QLineEdit* lineEdit = qobject_cast<QLineEdit*>(editor)) {
+        model->setData(index, lineEdit->text());
+    } else if (QComboBox* comboBox = qobject_cast<QComboBox*>(editor)) {
+        if (comboBox->currentIndex() >= 0) {
+            model->setData(index, comboBox->currentText());
+        }
+    } else {
+        QStyledItemDelegate::setModelData(editor, model, index);
+    }
+}
+
+ParameterFormView::ParameterFormView(ParameterFormModel* model, QWidget* parent)
+    : QTableView(parent), m_model(model)
+{
+    setModel(m_model);
+    setItemDelegateForColumn(ParameterFormModel::ValueColumn, new ParameterDelegate(this));
+    setEditTriggers(QAbstractItemView::AllEditTriggers);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setShowGrid(false);
+    setWordWrap(false);
+    setAlternatingRowColors(true);
+    horizontalHeader()->hide();
+    horizontalHeader()->setSectionResizeMode(ParameterFormModel::LabelColumn, QHeaderView::ResizeToContents);
+    horizontalHeader()->setStretchLastSection(true);
+    verticalHeader()->hide();
+    verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        if (m_model->isRowHidden(row)) {
+            setRowHidden(row, true);
+        }
+    }
+    connect(m_model, &ParameterFormModel::rowsHiddenChanged, this, [this](const QVector<int>& rows) {
+        // 多行同时切换时暂停绘制，表头与视口只重新布局一次
+        const bool batch = rows.size() > 1 && updatesEnabled();
+        if (batch) {
+            setUpdatesEnabled(false);
+        }
+        for (int row : rows) {
+            setRowHidden(row, m_model->isRowHidden(row));
+        }
+        if (batch) {
+            setUpdatesEnabled(true);
+        }
+    });
+}
+
+void ParameterFormView::focusParameter(const QString& parameterId)
+{
+    const int row = m_model->rowOf(parameterId);
+    if (row < 0) {
+        return;
+    }
+    const QModelIndex cell = m_model->index(row, ParameterFormModel::ValueColumn);
+    setCurrentIndex(cell);
+    scrollTo(cell);
+    setFocus();
+    edit(cell);
+}
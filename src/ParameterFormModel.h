@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <QAbstractTableModel>
+#include <QBitArray>
+#include <QStyledItemDelegate>
+#include <QTableView>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+
+class DeviceInstance;
+class ParameterItem;
+class ParameterRuleSet;
+
+// 参数表单模型：行对应模板中的参数（按声明顺序），列为名称与取值。
+// 取值直接读写 DeviceInstance（stateIndex < 0 为基本参数），不再为每个参数复制 ParameterItem 和常驻编辑器；
+// 可见性规则与选项联动（工作状态模板或设备类型基本参数的规则）在模型内计算，视图只同步行的隐藏状态。
+class ParameterFormModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { LabelColumn = 0, ValueColumn, ColumnCount };
+
+    ParameterFormModel(DeviceInstance* device, int stateIndex, QObject* parent = nullptr);
+
+    DeviceInstance* device() const { return m_device; }
+    int stateIndex() const { return m_stateIndex; }
+    const QList<ParameterItem*>& parameters() const { return m_params; }
+    const ParameterItem* parameterAt(int row) const;
+    int rowOf(const QString& parameterId) const { return m_rows.value(parameterId, -1); }
+
+    QVariant value(int row) const;
+    QVariantMap values() const; // 当前作用域在设备中的全部取值
+    bool setValue(const QString& parameterId, const QVariant& value);
+    QStringList options(int row) const; // 选项联动生效时返回联动后的可选项
+
+    // 单字段校验（类型、范围、当前可选项）
+    bool validateRow(int row) const;
+    void setInvalid(const QString& parameterId, bool invalid, const QString& message = QString());
+
+    // 行隐藏 = 可见性规则隐藏 或 外部强制隐藏
+    bool isRowHidden(int row) const;
+    void setRowForcedHidden(const QString& parameterId, bool hidden);
+
+    // 设备取值在模型之外被修改（表格视图、批量编辑等）后刷新显示并重新应用联动规则
+    void refresh();
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+
+signals:
+    void valueChanged(const QString& parameterId, const QVariant& value);
+    // 一次规则应用中隐藏状态实际变化的行，视图在同一次布局更新中切换
+    void rowsHiddenChanged(const QVector<int>& rows);
+
+private:
+    DeviceInstance* m_device;
+    int m_stateIndex;
+    const ParameterRuleSet* m_rules = nullptr; // 当前作用域的联动规则
+    QList<ParameterItem*> m_params;
+    QHash<QString, int> m_rows;
+    QBitArray m_ruleHidden;   // 可见性规则隐藏的行（模板编译的位图）
+    QBitArray m_forcedHidden;
+    QHash<int, QString> m_invalidMessages;
+
+    void applyRules(const QString& controllerId);
+    void updateRuleHidden();
+};
+
+// 取值列的委托：只为正在编辑的单元格创建编辑器，类型、范围与可选项从模型的角色中读取，
+// 表单与表格视图共用；关闭的编辑器交给 ParameterEditorPool 回收，跨页签复用
+class ParameterDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    enum Role {
+        TypeRole = Qt::UserRole + 1,
+        MinimumRole,
+        MaximumRole,
+        OptionsRole,
+        InvalidRole
+    };
+
+    explicit ParameterDelegate(QObject* parent = nullptr);
+
+    QWidget* createEditor(QWidget* parent, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
+    void destroyEditor(QWidget* editor, const QModelIndex& index) const override;
+    void setEditorData(QWidget* editor, const QModelIndex& index) const override;
+    void setModelData(QWidget* editor, QAbstractItemModel* model, const QModelIndex& index) const override;
+
+    static QString displayText(const QString& type, const QVariant& value);
+};
+
+// 表单式的参数列表视图：两列（名称、取值），单击即编辑，行隐藏跟随模型
+class ParameterFormView : public QTableView {
+    Q_OBJECT
+
+public:
+    explicit ParameterFormView(ParameterFormModel* model, QWidget* parent = nullptr);
+
+    ParameterFormModel* formModel() const { return m_model; }
+    void focusParameter(const QString& parameterId);
+
+private:
+    ParameterFormModel* m_model;
+};
@@ -6,6 +6,8 @@
 #include <QJsonArray>
 #include <QDebug>
 #include <QRegularExpressionValidator>
+#include <QStyle>
+#include <cmath>
 
 ParameterItem::ParameterItem(const QString& id, const QString& label, const QString& type)
     : m_id(id), m_label(label), m_type(type)
@@ -40,6 +42,27 @@ bool ParameterItem::validate(const QVariant& value) const
     return true;
 }
 
+QVariant ParameterItem::coerceValue(const QString& type, const QVariant& value)
+{
+    if (!value.isValid() || value.isNull()) {
+        return value;
+    }
+    if (type == "int" || type == "Byte") {
+        bool ok = false;
+        const double d = value.toDouble(&ok);
+        if (ok && std::isfinite(d) && d == std::floor(d) && std::fabs(d) <= 2147483647.0) {
+            return static_cast<int>(d);
+        }
+        return value;
+    }
+    if (type == "double") {
+        bool ok = false;
+        const double d = value.toDouble(&ok);
+        return ok ? QVariant(d) : value;
+    }
+    return value.toString();
+}
+
 QWidget* ParameterItem::createEditor(QWidget* parent)
 {
     if (m_editor) {
@@ -55,6 +78,7 @@ QWidget* ParameterItem::createEditor(QWidget* parent)
                          static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
                          [this](int value) {
             m_currentValue = value;
+            emit valueChanged(m_id, m_currentValue);
         });
         
         m_editor = spinBox;
@@ -69,6 +93,7 @@ QWidget* ParameterItem::createEditor(QWidget* parent)
                          static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged),
                          [this](double value) {
             m_currentValue = value;
+            emit valueChanged(m_id, m_currentValue);
         });
         
         m_editor = doubleSpinBox;
@@ -80,6 +105,7 @@ QWidget* ParameterItem::createEditor(QWidget* parent)
         
         QObject::connect(lineEdit, &QLineEdit::textChanged, [this](const QString& text) {
             m_currentValue = text;
+            emit valueChanged(m_id, m_currentValue);
         });
         
         m_editor = lineEdit;
@@ -99,6 +125,7 @@ QWidget* ParameterItem::createEditor(QWidget* parent)
                          [this, comboBox](int index) {
             if (index >= 0) {
                 m_currentValue = comboBox->itemText(index);
+                emit valueChanged(m_id, m_currentValue);
             }
         });
         
@@ -164,6 +191,22 @@ bool ParameterItem::isVisible() const
     return true; // 默认可见
 }
 
+void ParameterItem::setInvalid(bool invalid, const QString& message)
+{
+    if (!m_editor) {
+        return;
+    }
+    m_editor->setToolTip(invalid ? message : QString());
+    if (m_editor->property("invalid").toBool() == invalid) {
+        return;
+    }
+    m_editor->setProperty("invalid", invalid);
+    // 动态属性参与样式表匹配，需要重新 polish 才能刷新外观
+    m_editor->style()->unpolish(m_editor);
+    m_editor->style()->polish(m_editor);
+    m_editor->update();
+}
+
 ParameterItem* ParameterItem::fromJson(const QJsonObject& json)
 {
     QString id = json["id"].toString();
@@ -177,15 +220,8 @@ ParameterItem* ParameterItem::fromJson(const QJsonObject& json)
     }
     
     if (json.contains("default")) {
-        QVariant defaultValue;
-        if (type == "int") {
-            defaultValue = json["default"].toInt();
-        } else if (type == "double") {
-            defaultValue = json["default"].toDouble();
-        } else {
-            defaultValue = json["default"].toString();
-        }
-        item->setDefaultValue(defaultValue);
+        // 兼容以字符串保存的数值默认值
+        item->setDefaultValue(coerceValue(type, json["default"].toVariant()));
     }
     
     // 兼容 range 或 min/max 的数值范围定义
@@ -37,8 +37,14 @@ public:
     // 验证
     bool validate(const QVariant& value) const;
     
+    // 按声明类型转换取值：int/Byte -> int，double -> double，其余 -> 字符串。
+    // 加载时调用一次，之后的校验与保存不再反复解析字符串；无法转换的取值原样保留，交给校验处理
+    QVariant coerce(const QVariant& value) const { return coerceValue(m_type, value); }
+    static QVariant coerceValue(const QString& type, const QVariant& value);
+    
     // 创建编辑器
     QWidget* createEditor(QWidget* parent);
+    QWidget* getEditor() const { return m_editor; }
     
     // 获取和设置值
     QVariant getValue() const;
@@ -48,10 +54,17 @@ public:
     void setVisible(bool visible);
     bool isVisible() const;
     
+    // 即时校验结果：在编辑器上设置动态属性 invalid（供样式表高亮）并显示原因提示
+    void setInvalid(bool invalid, const QString& message = QString());
+    
     // 从JSON加载
     static ParameterItem* fromJson(const QJsonObject& json);
     static QRegularExpression stringAllowedPattern();
 
+signals:
+    // 用户编辑或 setValue 引起编辑器取值变化时发出
+    void valueChanged(const QString& id, const QVariant& value);
+
 private:
     QString m_id;
     QString m_label;
@@ -0,0 +1,299 @@
+﻿#include "ParameterRuleSet.h"
+#include "ParameterItem.h"
+#include <QHash>
+#include <QDebug>
+
+void ParameterRuleSet::load(const QJsonObject& json, const QList<ParameterItem*>& params)
+{
+    m_visibilityRules.clear();
+    m_optionRules.clear();
+
+    // 可见性规则：controller -> cases(value -> showIds)
+    if (json.contains("visibility_rules")) {
+        QJsonArray rules = json["visibility_rules"].toArray();
+        for (const auto& ruleVal : rules) {
+            QJsonObject ruleObj = ruleVal.toObject();
+            VisibilityRule rule;
+            rule.controllerId = ruleObj["controller"].toString();
+            
+            if (ruleObj.contains("cases")) {
+                QJsonArray cases = ruleObj["cases"].toArray();
+                for (const auto& caseVal : cases) {
+                    QJsonObject caseObj = caseVal.toObject();
+                    VisibilityCase c;
+                    c.value = caseObj["value"].toString();
+                    c.when = caseObj["when"].toString().trimmed();
+                    if (caseObj.contains("show")) {
+                        QJsonArray showArray = caseObj["show"].toArray();
+                        for (const auto& sid : showArray) {
+                            c.showIds << sid.toString();
+                            rule.affectedIds.insert(sid.toString());
+                        }
+                    }
+                    rule.cases.append(c);
+                }
+            }
+            
+            bool hasCondition = false;
+            for (const VisibilityCase& c : rule.cases) {
+                hasCondition = hasCondition || !c.when.isEmpty();
+            }
+            if ((!rule.controllerId.isEmpty() || hasCondition) && !rule.cases.isEmpty()) {
+                m_visibilityRules.append(rule);
+            }
+        }
+    }
+    
+    // 选项规则：controller -> target -> options
+    if (json.contains("option_rules")) {
+        QJsonArray rules = json["option_rules"].toArray();
+        for (const auto& ruleVal : rules) {
+            QJsonObject ruleObj = ruleVal.toObject();
+            OptionRule rule;
+            rule.controllerId = ruleObj["controller"].toString();
+            rule.targetId = ruleObj["target"].toString();
+            if (ruleObj.contains("options_by_value")) {
+                QJsonObject mapObj = ruleObj["options_by_value"].toObject();
+                for (auto it = mapObj.begin(); it != mapObj.end(); ++it) {
+                    QStringList opts;
+                    QJsonArray arr = it.value().toArray();
+                    for (const auto& o : arr) {
+                        opts << o.toString();
+                    }
+                    rule.optionsByValue[it.key()] = opts;
+                }
+            }
+            if (!rule.controllerId.isEmpty() && !rule.targetId.isEmpty() && !rule.optionsByValue.isEmpty()) {
+                m_optionRules.append(rule);
+            }
+        }
+    }
+
+    compile(params);
+}
+
+void ParameterRuleSet::compile(const QList<ParameterItem*>& params)
+{
+    m_compiledVisibility.clear();
+    m_visibilityControllers.clear();
+    m_optionControllers.clear();
+    m_optionsBySlot.clear();
+    m_optionTargets.clear();
+    m_defaults.clear();
+    m_expressionCount = 0;
+    m_slotCount = params.size();
+    QHash<QString, int> slotOf;
+    for (int i = 0; i < m_slotCount; ++i) {
+        slotOf.insert(params.at(i)->getId(), i);
+        m_defaults.insert(params.at(i)->getId(), params.at(i)->getDefaultValue());
+    }
+
+    for (const VisibilityRule& rule : m_visibilityRules) {
+        const int controllerSlot = slotOf.value(rule.controllerId, -1);
+        if (!rule.controllerId.isEmpty() && controllerSlot < 0) {
+            qWarning() << QString(u8"可见性规则的控制参数 %1 不存在，忽略该规则").arg(rule.controllerId);
+            continue; // 控制参数不在参数列表中的规则不生效
+        }
+        CompiledVisibility compiled;
+        compiled.controllerId = rule.controllerId;
+        if (controllerSlot >= 0) {
+            compiled.controllerDefault = params.at(controllerSlot)->getDefaultValue();
+        }
+
+        QBitArray affected(m_slotCount);
+        for (const QString& pid : rule.affectedIds) {
+            const int slot = slotOf.value(pid, -1);
+            if (slot >= 0) {
+                affected.setBit(slot);
+            }
+        }
+        compiled.keepMask = ~affected;
+
+        // show 为空的分支不隐藏任何参数
+        auto hiddenFor = [&](const VisibilityCase& c) {
+            QBitArray hidden(m_slotCount);
+            if (!c.showIds.isEmpty()) {
+                hidden = affected;
+                for (const QString& pid : c.showIds) {
+                    const int slot = slotOf.value(pid, -1);
+                    if (slot >= 0) {
+                        hidden.clearBit(slot);
+                    }
+                }
+            }
+            return hidden;
+        };
+
+        bool ordered = false;
+        for (const VisibilityCase& c : rule.cases) {
+            ordered = ordered || !c.when.isEmpty();
+        }
+        if (ordered) {
+            for (const VisibilityCase& c : rule.cases) {
+                CompiledCase compiledCase;
+                if (!c.when.isEmpty()) {
+                    QString error;
+                    if (!compiledCase.condition.compile(c.when, &error)) {
+                        qDebug() << QString(u8"可见性规则分支 when 表达式无效，忽略该分支：%1").arg(error);
+                        continue;
+                    }
+                    // 拼错的参数ID或漏写引号的取值会被当作参数，求值时恒不成立，加载时报告
+                    QStringList unknown;
+                    for (const QString& pid : compiledCase.condition.variables()) {
+                        if (!slotOf.contains(pid)) {
+                            unknown << pid;
+                        }
+                    }
+                    if (!unknown.isEmpty()) {
+                        qWarning() << QString(u8"可见性规则分支 when 表达式引用了未知参数 %1，忽略该分支：%2")
+                                          .arg(unknown.join(", "), c.when);
+                        continue;
+                    }
+                    ++m_expressionCount;
+                    for (const QString& pid : compiledCase.condition.variables()) {
+                        m_visibilityControllers.insert(pid);
+                    }
+                } else if (rule.controllerId.isEmpty()) {
+                    continue; // 没有控制参数时只能按条件匹配
+                }
+                compiledCase.value = c.value;
+                compiledCase.hidden = hiddenFor(c);
+                compiled.orderedCases.append(compiledCase);
+            }
+        } else {
+            // 同一取值出现多个分支时以第一个为准
+            for (const VisibilityCase& c : rule.cases) {
+                if (!compiled.hiddenByValue.contains(c.value)) {
+                    compiled.hiddenByValue.insert(c.value, hiddenFor(c));
+                }
+            }
+        }
+        m_compiledVisibility.append(compiled);
+        if (!rule.controllerId.isEmpty()) {
+            m_visibilityControllers.insert(rule.controllerId);
+        }
+    }
+
+    m_optionsBySlot.resize(m_slotCount);
+    for (int i = 0; i < m_optionRules.size(); ++i) {
+        const OptionRule& rule = m_optionRules.at(i);
+        m_optionControllers.insert(rule.controllerId);
+        const int controllerSlot = slotOf.value(rule.controllerId, -1);
+        const int targetSlot = slotOf.value(rule.targetId, -1);
+        if (controllerSlot < 0 || targetSlot < 0) {
+            qWarning() << QString(u8"选项规则的控制参数 %1 或目标参数 %2 不存在，忽略该规则").arg(rule.controllerId, rule.targetId);
+            continue; // 控制参数或目标不在参数列表中的规则不生效
+        }
+        CompiledOption compiled;
+        compiled.rule = i;
+        compiled.controllerDefault = params.at(controllerSlot)->getDefaultValue();
+        m_optionsBySlot[targetSlot].append(compiled);
+        QVector<int>& targets = m_optionTargets[rule.controllerId];
+        if (!targets.contains(targetSlot)) {
+            targets.append(targetSlot);
+        }
+    }
+}
+
+QStringList ParameterRuleSet::optionsFor(int slot, const QVariantMap& values) const
+{
+    QStringList result;
+    if (slot < 0 || slot >= m_optionsBySlot.size()) {
+        return result;
+    }
+    for (const CompiledOption& option : m_optionsBySlot.at(slot)) {
+        const OptionRule& rule = m_optionRules.at(option.rule);
+        const QString current = values.value(rule.controllerId, option.controllerDefault).toString();
+        auto it = rule.optionsByValue.constFind(current);
+        if (it != rule.optionsByValue.constEnd() && !it.value().isEmpty()) {
+            result = it.value();
+        }
+    }
+    return result;
+}
+
+QBitArray ParameterRuleSet::hiddenMask(const QVariantMap& values) const
+{
+    QBitArray hidden(m_slotCount);
+    for (const CompiledVisibility& rule : m_compiledVisibility) {
+        hidden &= rule.keepMask;
+        const QString current = rule.controllerId.isEmpty()
+            ? QString()
+            : values.value(rule.controllerId, rule.controllerDefault).toString();
+        if (!rule.orderedCases.isEmpty()) {
+            for (const CompiledCase& c : rule.orderedCases) {
+                const bool match = c.condition.isValid()
+                    ? c.condition.evaluate(values, m_defaults)
+                    : c.value == current;
+                if (match) {
+                    hidden |= c.hidden;
+                    break;
+                }
+            }
+            continue;
+        }
+        auto it = rule.hiddenByValue.constFind(current);
+        if (it != rule.hiddenByValue.constEnd()) {
+            hidden |= it.value();
+        }
+    }
+    return hidden;
+}
+
+QJsonArray ParameterRuleSet::visibilityRulesJson() const
+{
+    QJsonArray arr;
+    for (const auto& rule : m_visibilityRules) {
+        QJsonObject obj;
+        if (!rule.controllerId.isEmpty()) {
+            obj.insert("controller", rule.controllerId);
+        }
+        QJsonArray casesArr;
+        for (const auto& c : rule.cases) {
+            QJsonObject caseObj;
+            if (!c.when.isEmpty()) {
+                caseObj.insert("when", c.when);
+            }
+            if (c.when.isEmpty() || !c.value.isEmpty()) {
+                caseObj.insert("value", c.value);
+            }
+            QJsonArray showArr;
+            for (const auto& sid : c.showIds) {
+                showArr.append(sid);
+            }
+            caseObj.insert("show", showArr);
+            casesArr.append(caseObj);
+        }
+        if (!casesArr.isEmpty()) {
+            obj.insert("cases", casesArr);
+            arr.append(obj);
+        }
+    }
+    return arr;
+}
+
+QJsonArray ParameterRuleSet::optionRulesJson() const
+{
+    QJsonArray arr;
+    for (const auto& rule : m_optionRules) {
+        if (rule.controllerId.isEmpty() || rule.targetId.isEmpty() || rule.optionsByValue.isEmpty()) {
+            continue;
+        }
+        QJsonObject obj;
+        obj.insert("controller", rule.controllerId);
+        obj.insert("target", rule.targetId);
+        QJsonObject mapObj;
+        for (auto it = rule.optionsByValue.begin(); it != rule.optionsByValue.end(); ++it) {
+            QJsonArray opts;
+            for (const auto& v : it.value()) {
+                opts.append(v);
+            }
+            mapObj.insert(it.key(), opts);
+        }
+        if (!mapObj.isEmpty()) {
+            obj.insert("options_by_value", mapObj);
+            arr.append(obj);
+        }
+    }
+    return arr;
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include "RuleExpression.h"
+#include <QBitArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVariantMap>
+#include <QVector>
+
+class ParameterItem;
+
+// 参数联动规则：visibility_rules（控制参数取值 -> 显示哪些参数）与 option_rules（控制参数取值 -> 目标枚举的可选项）。
+// 工作状态模板与设备类型的基本参数共用同一套实现；加载时按参数槽位（参数声明顺序）编译，
+// 可见性规则的每个分支展开成隐藏位图，取值变化时只需查表与按位运算。
+// 分支可以用 when 条件表达式代替 value（此时规则可以不写 controller），含 when 的规则按分支顺序取第一个成立的分支。
+class ParameterRuleSet {
+public:
+    struct VisibilityCase {
+        QString value;
+        QString when; // 条件表达式，非空时代替 value 匹配
+        QStringList showIds;
+    };
+    struct VisibilityRule {
+        QString controllerId;
+        QList<VisibilityCase> cases;
+        QSet<QString> affectedIds;
+    };
+    struct OptionRule {
+        QString controllerId;
+        QString targetId;
+        QMap<QString, QStringList> optionsByValue;
+    };
+
+    // 从 json 的 visibility_rules / option_rules 读取规则并按 params 编译；参数列表此后不应再变化
+    void load(const QJsonObject& json, const QList<ParameterItem*>& params);
+
+    bool isEmpty() const { return m_visibilityRules.isEmpty() && m_optionRules.isEmpty(); }
+    const QVector<VisibilityRule>& visibilityRules() const { return m_visibilityRules; }
+    const QVector<OptionRule>& optionRules() const { return m_optionRules; }
+
+    // 按当前取值计算被可见性规则隐藏的参数（位序与参数声明顺序一致）；
+    // 规则按声明顺序应用，后面的规则覆盖前面规则涉及的参数，没有匹配分支的规则不隐藏任何参数
+    QBitArray hiddenMask(const QVariantMap& values) const;
+    bool isVisibilityController(const QString& parameterId) const { return m_visibilityControllers.contains(parameterId); }
+    bool isOptionController(const QString& parameterId) const { return m_optionControllers.contains(parameterId); }
+    // 选项规则给出的目标参数（按槽位）可选项：按规则声明顺序，后匹配的覆盖先匹配的；
+    // 没有规则匹配时返回空列表，调用方使用参数声明的选项。表单与表格视图共用
+    QStringList optionsFor(int slot, const QVariantMap& values) const;
+    // 可选项受该控制参数影响的目标槽位
+    QVector<int> optionTargets(const QString& controllerId) const { return m_optionTargets.value(controllerId); }
+    int expressionCount() const { return m_expressionCount; } // 编译成功的 when 表达式个数
+
+    QJsonArray visibilityRulesJson() const;
+    QJsonArray optionRulesJson() const;
+
+private:
+    QVector<VisibilityRule> m_visibilityRules;
+    QVector<OptionRule> m_optionRules;
+    struct CompiledCase {
+        RuleExpression condition; // 未编译时按 value 匹配
+        QString value;
+        QBitArray hidden;
+    };
+    struct CompiledVisibility {
+        QString controllerId;
+        QVariant controllerDefault;
+        QBitArray keepMask;                      // 规则未涉及的参数
+        QHash<QString, QBitArray> hiddenByValue; // 控制取值 -> 隐藏的参数
+        QVector<CompiledCase> orderedCases;      // 含 when 分支的规则按顺序匹配，不用 hiddenByValue
+    };
+    QVector<CompiledVisibility> m_compiledVisibility;
+    struct CompiledOption {
+        int rule = -1; // m_optionRules 中的序号
+        QVariant controllerDefault;
+    };
+    QVector<QVector<CompiledOption>> m_optionsBySlot; // 目标槽位 -> 作用于它的选项规则
+    QHash<QString, QVector<int>> m_optionTargets;     // 控制参数 -> 目标槽位
+    QSet<QString> m_visibilityControllers;
+    QSet<QString> m_optionControllers;
+    QVariantMap m_defaults; // when 表达式引用的参数没有取值时使用默认值
+    int m_slotCount = 0;
+    int m_expressionCount = 0;
+
+    void compile(const QList<ParameterItem*>& params);
+};
@@ -0,0 +1,185 @@
+﻿#include "PerfLog.h"
+#include <QApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QWidget>
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+QList<PerfLog::Entry> g_entries;
+
+int countObjects(const QObject* object)
+{
+    int count = 1;
+    for (const QObject* child : object->children()) {
+        count += countObjects(child);
+    }
+    return count;
+}
+}
+
+PerfLog::Timer::Timer(const QString& operation, const QString& subject)
+{
+    m_entry.operation = operation;
+    m_entry.subject = subject;
+    m_total.start();
+    m_phase.start();
+}
+
+void PerfLog::Timer::mark(const QString& phase)
+{
+    Phase item;
+    item.name = phase;
+    item.ms = m_phase.restart();
+    m_entry.phases.append(item);
+}
+
+void PerfLog::Timer::addPhase(const QString& phase, qint64 ms)
+{
+    Phase item;
+    item.name = phase;
+    item.ms = ms;
+    m_entry.phases.append(item);
+}
+
+PerfLog::Entry PerfLog::Timer::finish(bool ok)
+{
+    m_entry.totalMs = m_total.elapsed();
+    m_entry.ok = ok;
+    m_entry.finishedAt = QDateTime::currentDateTime();
+    if (!m_countObjects) {
+        PerfLog::record(m_entry);
+        return m_entry;
+    }
+    if (qobject_cast<QApplication*>(QCoreApplication::instance())) {
+        m_entry.widgetCount = QApplication::allWidgets().size();
+        // 没有父对象的 QObject 无法枚举，这里统计应用对象与全部顶层窗口下的对象树
+        int objects = countObjects(QCoreApplication::instance());
+        for (const QWidget* widget : QApplication::topLevelWidgets()) {
+            if (!widget->parent()) {
+                objects += countObjects(widget);
+            }
+        }
+        m_entry.objectCount = objects;
+    }
+    m_entry.residentKB = residentMemoryKB();
+    PerfLog::record(m_entry);
+    return m_entry;
+}
+
+QString PerfLog::Entry::summary() const
+{
+    QStringList parts;
+    for (const Phase& phase : phases) {
+        parts << QString("%1 %2").arg(phase.name).arg(phase.ms);
+    }
+    QString text = QString(u8"%1%2 %3 ms").arg(operation, ok ? QString() : QString(u8"（未完成）")).arg(totalMs);
+    if (!parts.isEmpty()) {
+        text += QString(u8"（%1）").arg(parts.join(u8"，"));
+    }
+    if (hasCounts()) {
+        text += QString(u8"，控件 %1 / 对象 %2").arg(widgetCount).arg(objectCount);
+    }
+    return text;
+}
+
+QString PerfLog::Entry::details() const
+{
+    QStringList lines;
+    lines << QString(u8"%1 %2 %3").arg(finishedAt.toString("yyyy-MM-dd HH:mm:ss.zzz"), operation, subject);
+    for (const Phase& phase : phases) {
+        lines << QString(u8"  %1: %2 ms").arg(phase.name).arg(phase.ms);
+    }
+    lines << QString(u8"  合计: %1 ms%2").arg(totalMs).arg(ok ? QString() : QString(u8"（未完成）"));
+    if (hasCounts()) {
+        lines << QString(u8"  控件 %1 个，对象 %2 个，常驻内存 %3 KB").arg(widgetCount).arg(objectCount).arg(residentKB);
+    }
+    return lines.join('\n');
+}
+
+void PerfLog::record(const Entry& entry)
+{
+    g_entries.append(entry);
+    while (g_entries.size() > kMaxEntries) {
+        g_entries.removeFirst();
+    }
+    const QString line = QString("%1\t%2\t%3").arg(entry.finishedAt.toString(Qt::ISODate), entry.summary(), entry.subject);
+    qDebug() << line;
+    appendToFile(line);
+}
+
+QList<PerfLog::Entry> PerfLog::recent()
+{
+    return g_entries;
+}
+
+QString PerfLog::filePath()
+{
+    static const QString path = [] {
+        const QString env = QString::fromLocal8Bit(qgetenv("PERF_LOG_FILE"));
+        if (!env.isEmpty()) {
+            return env;
+        }
+        const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+        return dir.isEmpty() ? QString() : QDir(dir).filePath(QStringLiteral("perf.log"));
+    }();
+    return path;
+}
+
+void PerfLog::appendToFile(const QString& line)
+{
+    static const qint64 maxBytes = [] {
+        bool ok = false;
+        const qint64 kb = qgetenv("PERF_LOG_MAX_KB").toLongLong(&ok);
+        return (ok && kb > 0 ? kb : 512) * 1024;
+    }();
+    const QString path = filePath();
+    if (path.isEmpty()) {
+        return;
+    }
+    // 文件在首次写入时打开并保持打开，之后每条记录只是一次追加，不再重复打开与查询文件信息
+    static QFile file(path);
+    if (file.isOpen() && file.size() > maxBytes) {
+        file.close();
+        const QString rotated = path + QStringLiteral(".1");
+        QFile::remove(rotated);
+        QFile::rename(path, rotated);
+    }
+    if (!file.isOpen()) {
+        const QFileInfo info(path);
+        if (info.exists() && info.size() > maxBytes) {
+            const QString rotated = path + QStringLiteral(".1");
+            QFile::remove(rotated);
+            QFile::rename(path, rotated);
+        } else if (!info.exists()) {
+            QDir().mkpath(info.absolutePath());
+        }
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+            return;
+        }
+    }
+    // 每条记录写完即交给操作系统，进程异常退出时已写入的记录不会丢失
+    file.write(line.toUtf8());
+    file.write("\n");
+    file.flush();
+}
+
+qint64 PerfLog::residentMemoryKB()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields.at(1).toLongLong() * (sysconf(_SC_PAGESIZE) / 1024);
+        }
+    }
+#endif
+    return -1;
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+// 分阶段计时与滚动记录（仅界面线程使用）：加载、校验、保存等操作按阶段记录用时，
+// 结束时附上当前控件数、QObject 数与常驻内存，写入内存中的最近记录（最多 kMaxEntries 条）
+// 和滚动日志文件。计时只在阶段边界读取单调时钟；对象计数要遍历整个对象树，
+// 只用于加载、校验与显式保存等用户触发的操作，空闲自动保存等频繁操作只记录用时。
+// 日志文件默认为应用数据目录下的 perf.log，可由 PERF_LOG_FILE 指定，首次写入后保持打开；
+// 超过 PERF_LOG_MAX_KB（默认 512）时轮换为 perf.log.1。
+class PerfLog {
+public:
+    struct Phase {
+        QString name;
+        qint64 ms = 0;
+    };
+
+    struct Entry {
+        QString operation;  // 加载 / 校验 / 保存 ...
+        QString subject;    // 文件名或补充说明
+        QDateTime finishedAt;
+        QList<Phase> phases;
+        qint64 totalMs = 0;
+        bool ok = true;
+        int widgetCount = -1; // -1 表示本次未统计
+        int objectCount = -1;
+        qint64 residentKB = -1; // 仅 Linux 可读取
+        bool hasCounts() const { return widgetCount >= 0; }
+
+        QString summary() const; // 单行摘要，用于状态栏与日志
+        QString details() const; // 逐阶段明细
+    };
+
+    // 一次操作的计时器：mark() 结束当前阶段并开始下一阶段；
+    // 在其他线程测得的阶段用 addPhase() 补入，不影响总用时
+    class Timer {
+    public:
+        explicit Timer(const QString& operation = QString(), const QString& subject = QString());
+
+        void mark(const QString& phase);
+        void addPhase(const QString& phase, qint64 ms);
+        void setSubject(const QString& subject) { m_entry.subject = subject; }
+        // 关闭后 finish() 不统计对象数与常驻内存，用于频繁发生的后台操作
+        void setCountObjects(bool count) { m_countObjects = count; }
+        qint64 elapsed() const { return m_total.elapsed(); }
+
+        // 统计对象数量（若开启）并写入滚动记录，返回完整记录
+        Entry finish(bool ok = true);
+
+    private:
+        Entry m_entry;
+        bool m_countObjects = true;
+        QElapsedTimer m_total;
+        QElapsedTimer m_phase;
+    };
+
+    static constexpr int kMaxEntries = 100;
+
+    static void record(const Entry& entry);
+    static QList<Entry> recent(); // 由旧到新
+    static QString filePath();
+
+    static qint64 residentMemoryKB();
+
+private:
+    static void appendToFile(const QString& line);
+};
@@ -13,7 +13,8 @@
 #include <QComboBox>
 #include <QMessageBox>
 #include <QSharedPointer>
-#include "StyleHelper.h"
+#include "AppTheme.h"
+#include "RuleExpression.h"
 
 RuleEditorDialog::RuleEditorDialog(const QJsonObject& rulesObj,
                                    const QStringList& availableParamIds,
@@ -30,7 +31,7 @@ RuleEditorDialog::RuleEditorDialog(const QJsonObject& rulesObj,
 {
     setWindowTitle(u8"规则编辑");
     setMinimumSize(780, 540);
-    setStyleSheet(StyleHelper::darkPanelStyle());
+    AppTheme::applyDarkPanel(this);
 
     // 防止 Tab 文本被压缩，超出时使用滚动按钮
     m_tabWidget = new QTabWidget(this);
@@ -219,6 +220,10 @@ QString RuleEditorDialog::summarizeValidationRule(const QJsonObject& obj)
 QString RuleEditorDialog::summarizeVisibilityCase(const QJsonObject& obj)
 {
     QString value = obj.value("value").toString();
+    const QString when = obj.value("when").toString();
+    if (!when.isEmpty()) {
+        value = QString(u8"当 %1").arg(when);
+    }
     QStringList ids;
     QJsonArray arr = obj.value("show").toArray();
     for (const auto& v : arr) ids << v.toString();
@@ -280,6 +285,10 @@ bool RuleEditorDialog::editVisibilityRuleObject(QJsonObject& obj, QWidget* paren
         valueCombo->setCurrentText(caseObj.value("value").toString());
         cl->addWidget(new QLabel(u8"控制值："));
         cl->addWidget(valueCombo);
+        QLineEdit* whenEdit = new QLineEdit(caseObj.value("when").toString());
+        whenEdit->setPlaceholderText(u8"例如：uhf_mode in [跳频, 扩频] && frequency_count > 64");
+        cl->addWidget(new QLabel(u8"条件表达式（可选，填写后代替控制值）："));
+        cl->addWidget(whenEdit);
         QListWidget* showList = new QListWidget;
         showList->setSelectionMode(QAbstractItemView::NoSelection);
         showList->setSortingEnabled(true);
@@ -305,7 +314,26 @@ bool RuleEditorDialog::editVisibilityRuleObject(QJsonObject& obj, QWidget* paren
         QObject::connect(buttons, &QDialogButtonBox::rejected, &cd, &QDialog::reject);
         if (cd.exec() != QDialog::Accepted) return false;
         const QString val = valueCombo->currentText().trimmed();
-        if (val.isEmpty()) {
+        const QString when = whenEdit->text().trimmed();
+        if (!when.isEmpty()) {
+            RuleExpression expression;
+            QString error;
+            if (!expression.compile(when, &error)) {
+                QMessageBox::warning(parent, u8"无效输入", error);
+                return false;
+            }
+            QStringList unknown;
+            for (const QString& pid : expression.variables()) {
+                if (!m_paramIds.contains(pid)) {
+                    unknown << pid;
+                }
+            }
+            if (!unknown.isEmpty()) {
+                QMessageBox::warning(parent, u8"无效输入",
+                                     QString(u8"条件表达式引用了未知参数：%1\n取值请写在方括号列表中或加引号。").arg(unknown.join(", ")));
+                return false;
+            }
+        } else if (val.isEmpty()) {
             QMessageBox::warning(parent, u8"无效输入", u8"控制值不能为空。");
             return false;
         }
@@ -316,7 +344,13 @@ bool RuleEditorDialog::editVisibilityRuleObject(QJsonObject& obj, QWidget* paren
                 newShow.append(it->text());
             }
         }
-        caseObj.insert("value", val);
+        if (when.isEmpty()) {
+            caseObj.insert("value", val);
+            caseObj.remove("when");
+        } else {
+            caseObj.insert("when", when);
+            caseObj.remove("value");
+        }
         caseObj.insert("show", newShow);
         return true;
     };
@@ -0,0 +1,551 @@
+﻿#include "RuleExpression.h"
+#include <QVarLengthArray>
+#include <cmath>
+
+// 递归下降：or := and (('||'|'or') and)*，and := unary (('&&'|'and') unary)*，
+// unary := ('!'|'not') unary | comparison，
+// comparison := sum [('=='|'!='|'<'|'<='|'>'|'>=') sum | ['not'] 'in' list]，
+// sum := product (('+'|'-') product)*，product := negation (('*'|'/') negation)*，negation := '-' negation | operand，
+// operand := '(' or ')' | 数字 | 字符串 | true | false | 参数ID，list := '[' [item (',' item)*] ']'，
+// item 为字符串或读到 , / ] 为止的原样文本
+class RuleExpressionParser {
+public:
+    RuleExpressionParser(const QString& text, RuleExpression& out)
+        : m_text(text), m_out(out) {}
+
+    bool parse(QString* error)
+    {
+        skipSpaces();
+        if (m_pos >= m_text.size()) {
+            if (error) *error = u8"表达式为空";
+            return false;
+        }
+        if (!parseOr()) {
+            if (error) *error = m_error;
+            return false;
+        }
+        skipSpaces();
+        if (m_pos < m_text.size()) {
+            if (error) *error = QString(u8"表达式第 %1 个字符无法识别: %2").arg(m_pos + 1).arg(m_text.at(m_pos));
+            return false;
+        }
+        return true;
+    }
+
+private:
+    typedef RuleExpression E;
+    const QString& m_text;
+    RuleExpression& m_out;
+    int m_pos = 0;
+    int m_depth = 0;
+    QString m_error;
+
+    static bool isWordStart(QChar c) { return c.isLetter() || c == '_'; }
+    static bool isWordChar(QChar c) { return c.isLetterOrNumber() || c == '_' || c == '.'; }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_text.size() && m_text.at(m_pos).isSpace()) {
+            ++m_pos;
+        }
+    }
+
+    bool fail(const QString& message)
+    {
+        if (m_error.isEmpty()) {
+            m_error = m_pos < m_text.size()
+                ? QString(u8"表达式第 %1 个字符处%2").arg(m_pos + 1).arg(message)
+                : QString(u8"表达式不完整：%1").arg(message);
+        }
+        return false;
+    }
+
+    bool takeSymbol(const char* symbol)
+    {
+        skipSpaces();
+        const QLatin1String s(symbol);
+        if (m_text.midRef(m_pos, s.size()) == s) {
+            m_pos += s.size();
+            return true;
+        }
+        return false;
+    }
+
+    QString peekWord()
+    {
+        skipSpaces();
+        int end = m_pos;
+        if (end < m_text.size() && isWordStart(m_text.at(end))) {
+            while (end < m_text.size() && isWordChar(m_text.at(end))) {
+                ++end;
+            }
+        }
+        return m_text.mid(m_pos, end - m_pos);
+    }
+
+    bool takeKeyword(const char* keyword)
+    {
+        const QString word = peekWord();
+        if (word == QLatin1String(keyword)) {
+            m_pos += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    void emitOp(E::OpCode code, int arg = 0)
+    {
+        E::Op op;
+        op.code = code;
+        op.arg = arg;
+        m_out.m_code.append(op);
+        if (code == E::PushConstant || code == E::PushVariable) {
+            m_out.m_maxDepth = qMax(m_out.m_maxDepth, ++m_depth);
+        } else if (code != E::Not && code != E::Neg && code != E::In && code != E::NotIn) {
+            --m_depth; // 二元运算弹出两个、压入一个
+        }
+    }
+
+    static E::Operand textOperand(const QString& text)
+    {
+        E::Operand operand;
+        operand.text = text;
+        operand.hasText = true;
+        operand.number = text.toDouble(&operand.isNumber);
+        return operand;
+    }
+
+    static E::Operand boolOperand(bool value)
+    {
+        E::Operand operand = textOperand(value ? QStringLiteral("true") : QStringLiteral("false"));
+        operand.number = value ? 1.0 : 0.0;
+        operand.isNumber = true;
+        return operand;
+    }
+
+    bool parseString(QString* out)
+    {
+        const QChar quote = m_text.at(m_pos++);
+        const int start = m_pos;
+        while (m_pos < m_text.size() && m_text.at(m_pos) != quote) {
+            ++m_pos;
+        }
+        if (m_pos >= m_text.size()) {
+            return fail(u8"字符串缺少结束引号");
+        }
+        *out = m_text.mid(start, m_pos - start);
+        ++m_pos;
+        return true;
+    }
+
+    bool parseNumber(QString* out)
+    {
+        const int start = m_pos;
+        if (m_text.at(m_pos) == '-' || m_text.at(m_pos) == '+') {
+            ++m_pos;
+        }
+        while (m_pos < m_text.size() && (m_text.at(m_pos).isDigit() || m_text.at(m_pos) == '.')) {
+            ++m_pos;
+        }
+        if (m_pos < m_text.size() && (m_text.at(m_pos) == 'e' || m_text.at(m_pos) == 'E')) {
+            ++m_pos;
+            if (m_pos < m_text.size() && (m_text.at(m_pos) == '-' || m_text.at(m_pos) == '+')) {
+                ++m_pos;
+            }
+            while (m_pos < m_text.size() && m_text.at(m_pos).isDigit()) {
+                ++m_pos;
+            }
+        }
+        *out = m_text.mid(start, m_pos - start);
+        bool ok = false;
+        out->toDouble(&ok);
+        if (!ok) {
+            m_pos = start;
+            return fail(u8"应为数字");
+        }
+        return true;
+    }
+
+    // 符号紧跟数字时才是数字字面量，否则 '-' 是取负或减号
+    bool startsNumber() const
+    {
+        const QChar c = m_text.at(m_pos);
+        if (c == '-' || c == '+') {
+            return m_pos + 1 < m_text.size() && (m_text.at(m_pos + 1).isDigit() || m_text.at(m_pos + 1) == '.');
+        }
+        return c.isDigit() || c == '.';
+    }
+
+    bool parseOr()
+    {
+        if (!parseAnd()) return false;
+        while (takeSymbol("||") || takeKeyword("or")) {
+            if (!parseAnd()) return false;
+            emitOp(E::Or);
+        }
+        return true;
+    }
+
+    bool parseAnd()
+    {
+        if (!parseUnary()) return false;
+        while (takeSymbol("&&") || takeKeyword("and")) {
+            if (!parseUnary()) return false;
+            emitOp(E::And);
+        }
+        return true;
+    }
+
+    bool parseUnary()
+    {
+        skipSpaces();
+        const bool bang = m_pos < m_text.size() && m_text.at(m_pos) == '!'
+            && !(m_pos + 1 < m_text.size() && m_text.at(m_pos + 1) == '=');
+        if (bang || takeKeyword("not")) {
+            if (bang) ++m_pos;
+            if (!parseUnary()) return false;
+            emitOp(E::Not);
+            return true;
+        }
+        return parseComparison();
+    }
+
+    bool parseComparison()
+    {
+        if (!parseSum()) return false;
+        // 先匹配两个字符的运算符
+        static const struct { const char* symbol; E::OpCode code; } kComparisons[] = {
+            { "==", E::Equal }, { "!=", E::NotEqual }, { "<=", E::LessEqual },
+            { ">=", E::GreaterEqual }, { "<", E::Less }, { ">", E::Greater }
+        };
+        for (const auto& cmp : kComparisons) {
+            if (takeSymbol(cmp.symbol)) {
+                if (!parseSum()) return false;
+                emitOp(cmp.code);
+                return true;
+            }
+        }
+        if (takeKeyword("in")) {
+            return parseList(E::In);
+        }
+        const int save = m_pos;
+        if (takeKeyword("not")) {
+            if (takeKeyword("in")) {
+                return parseList(E::NotIn);
+            }
+            m_pos = save;
+        }
+        return true;
+    }
+
+    bool parseSum()
+    {
+        if (!parseProduct()) return false;
+        for (;;) {
+            if (takeSymbol("+")) {
+                if (!parseProduct()) return false;
+                emitOp(E::Add);
+            } else if (takeSymbol("-")) {
+                if (!parseProduct()) return false;
+                emitOp(E::Sub);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool parseProduct()
+    {
+        if (!parseNegation()) return false;
+        for (;;) {
+            if (takeSymbol("*")) {
+                if (!parseNegation()) return false;
+                emitOp(E::Mul);
+            } else if (takeSymbol("/")) {
+                if (!parseNegation()) return false;
+                emitOp(E::Div);
+            } else {
+                return true;
+            }
+        }
+    }
+
+    bool parseNegation()
+    {
+        skipSpaces();
+        if (m_pos < m_text.size() && m_text.at(m_pos) == '-' && !startsNumber()) {
+            ++m_pos;
+            if (!parseNegation()) return false;
+            emitOp(E::Neg);
+            return true;
+        }
+        return parseOperand();
+    }
+
+    bool parseOperand()
+    {
+        skipSpaces();
+        if (m_pos >= m_text.size()) {
+            return fail(u8"缺少操作数");
+        }
+        const QChar c = m_text.at(m_pos);
+        if (c == '(') {
+            ++m_pos;
+            if (!parseOr()) return false;
+            if (!takeSymbol(")")) {
+                return fail(u8"缺少右括号");
+            }
+            return true;
+        }
+        if (c == '\'' || c == '"') {
+            QString text;
+            if (!parseString(&text)) return false;
+            m_out.m_constants.append(textOperand(text));
+            emitOp(E::PushConstant, m_out.m_constants.size() - 1);
+            return true;
+        }
+        if (startsNumber()) {
+            QString text;
+            if (!parseNumber(&text)) return false;
+            m_out.m_constants.append(textOperand(text));
+            emitOp(E::PushConstant, m_out.m_constants.size() - 1);
+            return true;
+        }
+        const QString word = peekWord();
+        if (word.isEmpty()) {
+            return fail(u8"应为参数ID、数字、字符串或括号");
+        }
+        if (word == QLatin1String("true") || word == QLatin1String("false")) {
+            m_pos += word.size();
+            m_out.m_constants.append(boolOperand(word == QLatin1String("true")));
+            emitOp(E::PushConstant, m_out.m_constants.size() - 1);
+            return true;
+        }
+        if (word == QLatin1String("and") || word == QLatin1String("or")
+            || word == QLatin1String("not") || word == QLatin1String("in")) {
+            return fail(QString(u8"关键字 %1 不能作为参数ID").arg(word));
+        }
+        m_pos += word.size();
+        int index = m_out.m_variables.indexOf(word);
+        if (index < 0) {
+            m_out.m_variables.append(word);
+            index = m_out.m_variables.size() - 1;
+        }
+        emitOp(E::PushVariable, index);
+        return true;
+    }
+
+    bool parseList(E::OpCode code)
+    {
+        if (!takeSymbol("[")) {
+            return fail(u8"in 之后应为 [ 开始的列表");
+        }
+        QVector<E::Operand> items;
+        if (!takeSymbol("]")) {
+            do {
+                skipSpaces();
+                if (m_pos >= m_text.size()) {
+                    return fail(u8"列表缺少 ]");
+                }
+                const QChar c = m_text.at(m_pos);
+                QString text;
+                if (c == '\'' || c == '"') {
+                    if (!parseString(&text)) return false;
+                } else {
+                    // 不加引号的项读到 , 或 ] 为止，枚举取值如 2-余弦函数、0x02-常规 整体作为一项
+                    const int start = m_pos;
+                    while (m_pos < m_text.size() && m_text.at(m_pos) != ',' && m_text.at(m_pos) != ']') {
+                        ++m_pos;
+                    }
+                    text = m_text.mid(start, m_pos - start).trimmed();
+                    if (text.isEmpty()) {
+                        return fail(u8"列表项不能为空");
+                    }
+                }
+                items.append(text == QLatin1String("true") || text == QLatin1String("false")
+                             ? boolOperand(text == QLatin1String("true"))
+                             : textOperand(text));
+            } while (takeSymbol(","));
+            if (!takeSymbol("]")) {
+                return fail(u8"列表缺少 ]");
+            }
+        }
+        m_out.m_lists.append(items);
+        emitOp(code, m_out.m_lists.size() - 1);
+        return true;
+    }
+};
+
+bool RuleExpression::compile(const QString& text, QString* error)
+{
+    m_text = text;
+    m_code.clear();
+    m_constants.clear();
+    m_lists.clear();
+    m_variables.clear();
+    m_maxDepth = 0;
+    RuleExpressionParser parser(text, *this);
+    if (!parser.parse(error)) {
+        m_code.clear();
+        return false;
+    }
+    return true;
+}
+
+RuleExpression::Operand RuleExpression::operandFromVariant(const QVariant& value)
+{
+    Operand operand;
+    switch (value.userType()) {
+    case QMetaType::Bool:
+        // 与字面量 true / false 一致，既可按数值比较，也可与 'true' 这样的字符串比较
+        operand.isNumber = true;
+        operand.number = value.toBool() ? 1.0 : 0.0;
+        operand.hasText = true;
+        operand.text = value.toBool() ? QStringLiteral("true") : QStringLiteral("false");
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Float:
+    case QMetaType::Double:
+        operand.number = value.toDouble();
+        operand.isNumber = true;
+        break;
+    default:
+        // 字符串取值共享原有数据，不复制
+        operand.text = value.toString();
+        operand.hasText = true;
+        operand.number = operand.text.toDouble(&operand.isNumber);
+        break;
+    }
+    return operand;
+}
+
+bool RuleExpression::equals(const Operand& a, const Operand& b)
+{
+    if (a.isNumber && b.isNumber) {
+        return a.number == b.number;
+    }
+    if (a.hasText && b.hasText) {
+        return a.text == b.text;
+    }
+    return false;
+}
+
+bool RuleExpression::truthy(const Operand& value)
+{
+    if (value.isNumber) {
+        return value.number != 0.0;
+    }
+    return value.hasText && !value.text.isEmpty()
+        && value.text.compare(QLatin1String("false"), Qt::CaseInsensitive) != 0;
+}
+
+bool RuleExpression::evaluate(const QVariantMap& values, const QVariantMap& fallback) const
+{
+    if (m_code.isEmpty()) {
+        return true;
+    }
+    return truthy(run(values, fallback));
+}
+
+bool RuleExpression::evaluateNumber(const QVariantMap& values, double* result, const QVariantMap& fallback) const
+{
+    if (m_code.isEmpty()) {
+        return false;
+    }
+    const Operand value = run(values, fallback);
+    if (!value.isNumber || !std::isfinite(value.number)) {
+        return false;
+    }
+    *result = value.number;
+    return true;
+}
+
+RuleExpression::Operand RuleExpression::run(const QVariantMap& values, const QVariantMap& fallback) const
+{
+    // 栈深度在编译时已知，常见规则不超过预留容量，求值过程不申请堆内存
+    QVarLengthArray<Operand, 16> stack;
+    stack.reserve(m_maxDepth);
+    for (const Op& op : m_code) {
+        switch (op.code) {
+        case PushConstant:
+            stack.append(m_constants.at(op.arg));
+            break;
+        case PushVariable: {
+            const QString& id = m_variables.at(op.arg);
+            auto it = values.constFind(id);
+            stack.append(operandFromVariant(it != values.constEnd() ? it.value() : fallback.value(id)));
+            break;
+        }
+        case Not: {
+            Operand& top = stack.last();
+            top.number = truthy(top) ? 0.0 : 1.0;
+            top.isNumber = true;
+            top.hasText = false;
+            break;
+        }
+        case Neg: {
+            // 非数值参与算术运算的结果既不是数值也不是字符串，比较一律不成立
+            Operand& top = stack.last();
+            top.number = -top.number;
+            top.hasText = false;
+            break;
+        }
+        case Add:
+        case Sub:
+        case Mul:
+        case Div: {
+            const Operand rhs = stack.last();
+            stack.removeLast();
+            Operand& lhs = stack.last();
+            if (op.code == Add) lhs.number += rhs.number;
+            else if (op.code == Sub) lhs.number -= rhs.number;
+            else if (op.code == Mul) lhs.number *= rhs.number;
+            else lhs.number /= rhs.number;
+            lhs.isNumber = lhs.isNumber && rhs.isNumber;
+            lhs.hasText = false;
+            break;
+        }
+        case In:
+        case NotIn: {
+            Operand& top = stack.last();
+            bool found = false;
+            for (const Operand& item : m_lists.at(op.arg)) {
+                if (equals(top, item)) {
+                    found = true;
+                    break;
+                }
+            }
+            top.number = (found == (op.code == In)) ? 1.0 : 0.0;
+            top.isNumber = true;
+            top.hasText = false;
+            break;
+        }
+        default: {
+            const Operand rhs = stack.last();
+            stack.removeLast();
+            Operand& lhs = stack.last();
+            const bool numeric = lhs.isNumber && rhs.isNumber;
+            bool result = false;
+            switch (op.code) {
+            case Equal:        result = equals(lhs, rhs); break;
+            case NotEqual:     result = !equals(lhs, rhs); break;
+            case Less:         result = numeric && lhs.number < rhs.number; break;
+            case LessEqual:    result = numeric && lhs.number <= rhs.number; break;
+            case Greater:      result = numeric && lhs.number > rhs.number; break;
+            case GreaterEqual: result = numeric && lhs.number >= rhs.number; break;
+            case And:          result = truthy(lhs) && truthy(rhs); break;
+            case Or:           result = truthy(lhs) || truthy(rhs); break;
+            default: break;
+            }
+            lhs.number = result ? 1.0 : 0.0;
+            lhs.isNumber = true;
+            lhs.hasText = false;
+            break;
+        }
+        }
+    }
+    return stack.last();
+}
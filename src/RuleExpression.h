@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+// 规则条件表达式，用于 validation_rules 的 when / expect 与 visibility_rules 分支的 when，例如：
+//   uhf_mode in [跳频, 扩频] && frequency_count > 64
+// 支持 == != < <= > >=、in [...] / not in [...]、&& || !（也可写 and or not）、+ - * / 与括号；
+// 字符串字面量用引号，方括号列表内的项可不加引号（读到 , 或 ] 为止）；其余不加引号的标识符都是参数ID，
+// 由加载规则的一方按已知参数检查。
+// 模板加载时编译一次为逆波兰字节码，参数ID收集到变量表，求值时只做取值查找与栈运算。
+// 变量按参数ID在取值表中查找而不预先绑定到槽位：模型中各工作状态的取值本身就是按ID存放的
+// QVariantMap，绑定槽位意味着每次求值前先把取值拷贝成数组，省下的查找抵不过这次拷贝。
+// 数值参数的取值在加载与编辑时已按类型转换（ParameterItem::coerce），求值时直接取数值，
+// 只有字符串取值才尝试解析数字。
+class RuleExpression {
+public:
+    bool compile(const QString& text, QString* error);
+    bool isValid() const { return !m_code.isEmpty(); }
+    const QString& text() const { return m_text; }
+    const QStringList& variables() const { return m_variables; } // 表达式引用的参数ID
+
+    // 参数取值先在 values 中查找，找不到再查 fallback（基本参数或默认值）；未编译的表达式视为成立
+    bool evaluate(const QVariantMap& values, const QVariantMap& fallback = QVariantMap()) const;
+    // 按数值求值（批量修改的算术表达式），结果不是有限数值时返回 false
+    bool evaluateNumber(const QVariantMap& values, double* result, const QVariantMap& fallback = QVariantMap()) const;
+
+private:
+    enum OpCode {
+        PushConstant, // arg: m_constants 下标
+        PushVariable, // arg: m_variables 下标
+        Equal, NotEqual, Less, LessEqual, Greater, GreaterEqual,
+        In, NotIn,    // arg: m_lists 下标
+        And, Or, Not,
+        Add, Sub, Mul, Div, Neg
+    };
+    struct Op {
+        OpCode code;
+        int arg;
+    };
+    // 操作数：数值取值与可解析为数字的字符串按数值比较，其余按字符串比较
+    struct Operand {
+        double number = 0.0;
+        bool isNumber = false;
+        bool hasText = false;
+        QString text;
+    };
+
+    QString m_text;
+    QVector<Op> m_code; // 逆波兰序
+    QVector<Operand> m_constants;
+    QVector<QVector<Operand>> m_lists;
+    QStringList m_variables;
+    int m_maxDepth = 0;
+
+    Operand run(const QVariantMap& values, const QVariantMap& fallback) const;
+    static Operand operandFromVariant(const QVariant& value);
+    static bool equals(const Operand& a, const Operand& b);
+    static bool truthy(const Operand& value);
+    friend class RuleExpressionParser;
+};
@@ -0,0 +1,411 @@
+﻿#include "SearchIndex.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include "ParameterItem.h"
+#include "WorkStateTemplate.h"
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QRegularExpression>
+#include <QDebug>
+#include <algorithm>
+
+SearchIndex::SearchIndex(QObject* parent)
+    : QObject(parent)
+{
+}
+
+QString SearchIndex::fieldKey(const QString& typeId, bool state, const QString& id)
+{
+    return typeId + QChar(0x1f) + (state ? QLatin1Char('s') : QLatin1Char('b')) + id;
+}
+
+QString SearchIndex::valueText(const QVariant& value)
+{
+    return value.toString().toLower();
+}
+
+void SearchIndex::clear()
+{
+    m_fields.clear();
+    m_fieldIds.clear();
+    m_cells.clear();
+    m_freeCells.clear();
+    m_devices.clear();
+    m_values.clear();
+    m_deviceKeys.clear();
+    emit changed();
+}
+
+void SearchIndex::scheduleChanged()
+{
+    if (m_changePending) {
+        return;
+    }
+    m_changePending = true;
+    QTimer::singleShot(0, this, [this]() {
+        m_changePending = false;
+        emit changed();
+    });
+}
+
+void SearchIndex::addDeviceKeys(const DeviceInstance* device)
+{
+    static const QRegularExpression separators(QStringLiteral("[\\s_\\-]+"));
+    QSet<QString> keys;
+    for (const QString& text : {device->getDeviceName().toLower(), device->getDeviceId().toLower()}) {
+        keys.insert(text);
+        for (const QString& part : text.split(separators, QString::SkipEmptyParts)) {
+            keys.insert(part);
+        }
+    }
+    for (const QString& key : keys) {
+        if (!key.isEmpty()) {
+            m_deviceKeys[key].append(device);
+        }
+    }
+}
+
+void SearchIndex::addFields(const EquipmentType* type)
+{
+    auto add = [this, type](const ParameterItem* param, bool state) {
+        Field field;
+        field.typeId = type->getTypeId();
+        field.typeName = type->getTypeName();
+        field.id = param->getId();
+        field.label = param->getLabel();
+        field.text = QString("%1 %2 %3").arg(param->getId(), param->getLabel(), param->getUnit()).toLower();
+        m_fieldIds.insert(fieldKey(field.typeId, state, field.id), m_fields.size());
+        m_fields.append(field);
+    };
+    for (const ParameterItem* param : type->getBasicParameters()) {
+        add(param, false);
+    }
+    if (const WorkStateTemplate* tmpl = type->getWorkStateTemplate()) {
+        for (const ParameterItem* param : tmpl->getParameters()) {
+            add(param, true);
+        }
+    }
+}
+
+void SearchIndex::rebuild(const QList<EquipmentType*>& types,
+                          const QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    QElapsedTimer timer;
+    timer.start();
+    blockSignals(true);
+    clear();
+    blockSignals(false);
+
+    int order = 0;
+    for (const EquipmentType* type : types) {
+        addFields(type);
+        for (const DeviceInstance* device : devices.value(type->getTypeId())) {
+            DeviceCells& cells = m_devices[device];
+            cells.order = order++;
+            addDeviceKeys(device);
+            const QVariantMap basicValues = device->getBasicValues();
+            for (auto it = basicValues.constBegin(); it != basicValues.constEnd(); ++it) {
+                const int field = m_fieldIds.value(fieldKey(type->getTypeId(), false, it.key()), -1);
+                if (field >= 0) {
+                    cells.basic.insert(it.key(), addCell(device, cells.order, field, -1, it.value()));
+                }
+            }
+            for (int i = 0; i < device->getWorkStateCount(); ++i) {
+                addStateCells(device, cells, i);
+            }
+        }
+    }
+    qDebug() << QString(u8"搜索索引重建：%1 个取值单元格，%2 个不同取值，用时 %3 ms")
+                    .arg(cellCount()).arg(m_values.size()).arg(timer.elapsed());
+    emit changed();
+}
+
+void SearchIndex::addStateCells(const DeviceInstance* device, DeviceCells& cells, int stateIndex)
+{
+    const QString typeId = device->getEquipmentType() ? device->getEquipmentType()->getTypeId() : QString();
+    QHash<QString, int> stateCells;
+    const QVariantMap values = device->getWorkStateValues(stateIndex);
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        const int field = m_fieldIds.value(fieldKey(typeId, true, it.key()), -1);
+        if (field >= 0) {
+            stateCells.insert(it.key(), addCell(device, cells.order, field, stateIndex, it.value()));
+        }
+    }
+    if (cells.states.size() <= stateIndex) {
+        cells.states.resize(stateIndex + 1);
+    }
+    cells.states[stateIndex] = stateCells;
+}
+
+int SearchIndex::addCell(const DeviceInstance* device, int deviceOrder, int field, int stateIndex, const QVariant& value)
+{
+    Cell cell;
+    cell.device = device;
+    cell.deviceOrder = deviceOrder;
+    cell.field = field;
+    cell.stateIndex = stateIndex;
+    cell.key = valueText(value);
+
+    int id;
+    if (!m_freeCells.isEmpty()) {
+        id = m_freeCells.takeLast();
+        m_cells[id] = cell;
+    } else {
+        id = m_cells.size();
+        m_cells.append(cell);
+    }
+    m_fields[field].cells.insert(id);
+    m_values[cell.key].insert(id);
+    return id;
+}
+
+void SearchIndex::removeCell(int id)
+{
+    Cell& cell = m_cells[id];
+    m_fields[cell.field].cells.remove(id);
+    auto it = m_values.find(cell.key);
+    if (it != m_values.end()) {
+        it.value().remove(id);
+        if (it.value().isEmpty()) {
+            m_values.erase(it);
+        }
+    }
+    cell = Cell();
+    m_freeCells.append(id);
+}
+
+void SearchIndex::setCellValue(int id, const QVariant& value)
+{
+    Cell& cell = m_cells[id];
+    const QString key = valueText(value);
+    if (key == cell.key) {
+        return;
+    }
+    auto it = m_values.find(cell.key);
+    if (it != m_values.end()) {
+        it.value().remove(id);
+        if (it.value().isEmpty()) {
+            m_values.erase(it);
+        }
+    }
+    cell.key = key;
+    m_values[key].insert(id);
+}
+
+void SearchIndex::basicValueChanged(const DeviceInstance* device, const QString& id, const QVariant& value)
+{
+    auto deviceIt = m_devices.find(device);
+    if (deviceIt == m_devices.end()) {
+        return;
+    }
+    DeviceCells& cells = deviceIt.value();
+    const int cell = cells.basic.value(id, -1);
+    if (cell >= 0 && !value.isValid()) {
+        removeCell(cell);
+        cells.basic.remove(id);
+    } else if (cell >= 0) {
+        setCellValue(cell, value);
+    } else if (value.isValid()) {
+        const QString typeId = device->getEquipmentType() ? device->getEquipmentType()->getTypeId() : QString();
+        const int field = m_fieldIds.value(fieldKey(typeId, false, id), -1);
+        if (field < 0) {
+            return;
+        }
+        cells.basic.insert(id, addCell(device, cells.order, field, -1, value));
+    }
+    scheduleChanged();
+}
+
+void SearchIndex::stateValueChanged(const DeviceInstance* device, int stateIndex, const QString& id, const QVariant& value)
+{
+    auto deviceIt = m_devices.find(device);
+    if (deviceIt == m_devices.end() || stateIndex < 0 || stateIndex >= deviceIt.value().states.size()) {
+        return;
+    }
+    QHash<QString, int>& stateCells = deviceIt.value().states[stateIndex];
+    const int cell = stateCells.value(id, -1);
+    if (cell >= 0 && !value.isValid()) {
+        removeCell(cell);
+        stateCells.remove(id);
+    } else if (cell >= 0) {
+        setCellValue(cell, value);
+    } else if (value.isValid()) {
+        const QString typeId = device->getEquipmentType() ? device->getEquipmentType()->getTypeId() : QString();
+        const int field = m_fieldIds.value(fieldKey(typeId, true, id), -1);
+        if (field < 0) {
+            return;
+        }
+        stateCells.insert(id, addCell(device, deviceIt.value().order, field, stateIndex, value));
+    }
+    scheduleChanged();
+}
+
+void SearchIndex::stateCountChanged(const DeviceInstance* device)
+{
+    auto deviceIt = m_devices.find(device);
+    if (deviceIt == m_devices.end()) {
+        return;
+    }
+    DeviceCells& cells = deviceIt.value();
+    const int stateCount = device->getWorkStateCount();
+    // 只处理尾部增删的状态，其余状态的单元格不变
+    while (cells.states.size() > stateCount) {
+        for (int cell : cells.states.last()) {
+            removeCell(cell);
+        }
+        cells.states.removeLast();
+    }
+    for (int i = cells.states.size(); i < stateCount; ++i) {
+        addStateCells(device, cells, i);
+    }
+    scheduleChanged();
+}
+
+QSet<int> SearchIndex::matchTerm(const QString& term) const
+{
+    QSet<int> result;
+    for (const Field& field : m_fields) {
+        if (field.text.contains(term)) {
+            result.unite(field.cells);
+        }
+    }
+    for (auto it = m_values.lowerBound(term); it != m_values.constEnd() && it.key().startsWith(term); ++it) {
+        result.unite(it.value());
+    }
+    // 设备名称/ID 按整体或其中一段的前缀匹配，只展开命中设备的单元格
+    QSet<const DeviceInstance*> devices;
+    for (auto it = m_deviceKeys.lowerBound(term); it != m_deviceKeys.constEnd() && it.key().startsWith(term); ++it) {
+        for (const DeviceInstance* device : it.value()) {
+            devices.insert(device);
+        }
+    }
+    for (const DeviceInstance* device : devices) {
+        auto it = m_devices.constFind(device);
+        if (it == m_devices.constEnd()) {
+            continue;
+        }
+        for (int cell : it.value().basic) {
+            result.insert(cell);
+        }
+        for (const QHash<QString, int>& stateCells : it.value().states) {
+            for (int cell : stateCells) {
+                result.insert(cell);
+            }
+        }
+    }
+    return result;
+}
+
+QSet<int> SearchIndex::matchComparison(const QString& fieldTerm, const QString& op, double operand) const
+{
+    QSet<int> result;
+    for (const Field& field : m_fields) {
+        if (!field.text.contains(fieldTerm)) {
+            continue;
+        }
+        for (int id : field.cells) {
+            bool ok = false;
+            const double value = m_cells.at(id).key.toDouble(&ok);
+            if (!ok) {
+                continue;
+            }
+            bool match = false;
+            if (op == ">") {
+                match = value > operand;
+            } else if (op == ">=") {
+                match = value >= operand;
+            } else if (op == "<") {
+                match = value < operand;
+            } else if (op == "<=") {
+                match = value <= operand;
+            } else if (op == "!=") {
+                match = !qFuzzyCompare(value + 1.0, operand + 1.0);
+            } else {
+                match = qFuzzyCompare(value + 1.0, operand + 1.0);
+            }
+            if (match) {
+                result.insert(id);
+            }
+        }
+    }
+    return result;
+}
+
+SearchIndex::Result SearchIndex::query(const QString& text, int maxHits) const
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+
+    // 先取出“参数 比较符 数值”条件，剩余部分按空格拆成普通词
+    static const QRegularExpression comparisonPattern(
+        QStringLiteral("([^\\s<>=!]+)\\s*(>=|<=|!=|==|=|>|<)\\s*(-?\\d+(?:\\.\\d+)?)"));
+    QString rest = text.toLower();
+    QList<QSet<int>> sets;
+    QRegularExpressionMatchIterator matches = comparisonPattern.globalMatch(rest);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        sets.append(matchComparison(match.captured(1), match.captured(2), match.captured(3).toDouble()));
+    }
+    rest.replace(comparisonPattern, QStringLiteral(" "));
+    for (const QString& term : rest.split(QRegularExpression(QStringLiteral("\\s+")), QString::SkipEmptyParts)) {
+        sets.append(matchTerm(term));
+    }
+    if (sets.isEmpty()) {
+        return result;
+    }
+
+    // 从最小的集合开始求交
+    std::sort(sets.begin(), sets.end(), [](const QSet<int>& a, const QSet<int>& b) { return a.size() < b.size(); });
+    QSet<int> cells = sets.first();
+    for (int i = 1; i < sets.size() && !cells.isEmpty(); ++i) {
+        cells.intersect(sets.at(i));
+    }
+    result.total = cells.size();
+
+    // 按设备加载顺序、状态、参数声明顺序排列；排序键先复制出来，
+    // 只把前 maxHits 条排好，其余命中只计入总数
+    struct SortKey {
+        int deviceOrder;
+        int stateIndex;
+        int field;
+        int cell;
+        bool operator<(const SortKey& other) const
+        {
+            if (deviceOrder != other.deviceOrder) {
+                return deviceOrder < other.deviceOrder;
+            }
+            if (stateIndex != other.stateIndex) {
+                return stateIndex < other.stateIndex;
+            }
+            return field < other.field;
+        }
+    };
+    QVector<SortKey> ordered;
+    ordered.reserve(cells.size());
+    for (int id : cells) {
+        const Cell& cell = m_cells.at(id);
+        ordered.append(SortKey{cell.deviceOrder, cell.stateIndex, cell.field, id});
+    }
+    const int count = qMin(ordered.size(), qMax(0, maxHits));
+    std::partial_sort(ordered.begin(), ordered.begin() + count, ordered.end());
+
+    result.hits.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const Cell& cell = m_cells.at(ordered.at(i).cell);
+        const Field& field = m_fields.at(cell.field);
+        Hit hit;
+        hit.typeName = field.typeName;
+        hit.typeId = field.typeId;
+        hit.deviceName = cell.device->getDeviceName();
+        hit.deviceId = cell.device->getDeviceId();
+        hit.stateIndex = cell.stateIndex;
+        hit.paramId = field.id;
+        hit.label = field.label;
+        hit.value = cell.stateIndex < 0 ? cell.device->getBasicValue(field.id).toString()
+                                        : cell.device->getWorkStateValues(cell.stateIndex).value(field.id).toString();
+        result.hits.append(hit);
+    }
+    result.elapsedUs = timer.nsecsElapsed() / 1000;
+    return result;
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+class EquipmentType;
+class DeviceInstance;
+
+// 全局搜索的倒排索引：每个取值单元格（设备 × 基本参数 / 工作状态参数）一条记录。
+// - 参数名称、ID、单位按参数（而非单元格）保存，查询时子串匹配，命中后展开为该参数的全部单元格；
+// - 当前取值按小写文本建有序倒排表，支持前缀查找；
+// - 设备实例通过 setSearchIndex 挂接，取值或工作状态数量变化时只更新受影响的单元格。
+// 查询语法：空格分隔的条件取交集；普通词匹配参数名称/ID、设备名称/ID 或取值前缀，
+// “参数 比较符 数值”（>、>=、<、<=、=、!=）按数值比较，如 antenna_gain > 30。
+class SearchIndex : public QObject {
+    Q_OBJECT
+
+public:
+    struct Hit {
+        QString typeName;
+        QString typeId;
+        QString deviceName;
+        QString deviceId;
+        int stateIndex = -1; // -1 为基本参数
+        QString paramId;
+        QString label;
+        QString value;
+    };
+
+    struct Result {
+        QVector<Hit> hits; // 按类型、设备、状态、参数的加载顺序排列，最多 maxHits 条
+        int total = 0;
+        qint64 elapsedUs = 0;
+    };
+
+    explicit SearchIndex(QObject* parent = nullptr);
+
+    void rebuild(const QList<EquipmentType*>& types,
+                 const QMap<QString, QList<DeviceInstance*>>& devices);
+    void clear();
+    int cellCount() const { return m_cells.size() - m_freeCells.size(); }
+
+    Result query(const QString& text, int maxHits) const;
+
+    // 由 DeviceInstance 在取值实际变化时调用
+    void basicValueChanged(const DeviceInstance* device, const QString& id, const QVariant& value);
+    void stateValueChanged(const DeviceInstance* device, int stateIndex, const QString& id, const QVariant& value);
+    void stateCountChanged(const DeviceInstance* device);
+
+signals:
+    // 重建或增量更新后发出，搜索面板据此刷新当前结果；
+    // 增量更新合并到回到事件循环时发出一次，批量编辑、回放等连续修改只触发一次刷新
+    void changed();
+
+private:
+    struct Field {
+        QString typeId;
+        QString typeName;
+        QString id;
+        QString label;
+        QString text; // 小写的 ID + 名称 + 单位，用于子串匹配
+        QSet<int> cells;
+    };
+
+    struct Cell {
+        const DeviceInstance* device = nullptr; // 空表示已回收
+        int deviceOrder = 0; // 设备的加载顺序，结果排序时不必再查设备表
+        int field = -1;
+        int stateIndex = -1;
+        QString key; // 小写取值，倒排表的键
+    };
+
+    struct DeviceCells {
+        int order = 0; // 加载顺序，结果排序用
+        QHash<QString, int> basic;
+        QVector<QHash<QString, int>> states;
+    };
+
+    QVector<Field> m_fields;
+    QHash<QString, int> m_fieldIds; // fieldKey -> m_fields 下标
+    QVector<Cell> m_cells;
+    QVector<int> m_freeCells;
+    QHash<const DeviceInstance*, DeviceCells> m_devices;
+    QMap<QString, QSet<int>> m_values; // 小写取值 -> 单元格，有序以便前缀查找
+    // 设备名称与 ID（整体及按空白、下划线、连字符拆开的各段）的小写文本 -> 设备，有序以便前缀查找；
+    // 设备名称与 ID 加载后不再变化
+    QMap<QString, QVector<const DeviceInstance*>> m_deviceKeys;
+    bool m_changePending = false;
+
+    static QString fieldKey(const QString& typeId, bool state, const QString& id);
+    static QString valueText(const QVariant& value);
+    void addFields(const EquipmentType* type);
+    int addCell(const DeviceInstance* device, int deviceOrder, int field, int stateIndex, const QVariant& value);
+    void removeCell(int cell);
+    void setCellValue(int cell, const QVariant& value);
+    void addStateCells(const DeviceInstance* device, DeviceCells& cells, int stateIndex);
+    void addDeviceKeys(const DeviceInstance* device);
+    void scheduleChanged();
+
+    QSet<int> matchTerm(const QString& term) const;
+    QSet<int> matchComparison(const QString& field, const QString& op, double operand) const;
+};
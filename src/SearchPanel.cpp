@@ -0,0 +1,156 @@
+﻿#include "SearchPanel.h"
+#include <QLabel>
+#include <QLineEdit>
+#include <QListView>
+#include <QTimer>
+#include <QVBoxLayout>
+#include <QWidget>
+
+SearchResultModel::SearchResultModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void SearchResultModel::setHits(const QVector<SearchIndex::Hit>& hits)
+{
+    beginResetModel();
+    m_hits = hits;
+    endResetModel();
+}
+
+const SearchIndex::Hit* SearchResultModel::hitAt(int row) const
+{
+    if (row < 0 || row >= m_hits.size()) {
+        return nullptr;
+    }
+    return &m_hits.at(row);
+}
+
+int SearchResultModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_hits.size();
+}
+
+QVariant SearchResultModel::data(const QModelIndex& index, int role) const
+{
+    const SearchIndex::Hit* hit = hitAt(index.row());
+    if (!hit) {
+        return QVariant();
+    }
+    const QString location = hit->stateIndex < 0
+        ? QString(u8"%1 / %2 / 基本参数").arg(hit->typeName, hit->deviceName)
+        : QString(u8"%1 / %2 / 工作状态 %3").arg(hit->typeName, hit->deviceName).arg(hit->stateIndex + 1);
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString(u8"%1 / %2 = %3").arg(location, hit->label, hit->value);
+    case Qt::ToolTipRole:
+        return QString(u8"%1\n参数: %2\n设备: %3").arg(location, hit->paramId, hit->deviceId);
+    default:
+        return QVariant();
+    }
+}
+
+SearchPanel::SearchPanel(QWidget* parent)
+    : QDockWidget(u8"搜索", parent)
+{
+    setObjectName(QStringLiteral("search_panel"));
+
+    bool ok = false;
+    const int envMax = qgetenv("SEARCH_MAX_RESULTS").toInt(&ok);
+    if (ok && envMax > 0) {
+        m_maxHits = envMax;
+    }
+
+    QWidget* content = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(content);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    m_input = new QLineEdit(content);
+    m_input->setPlaceholderText(u8"参数名称/ID、设备或取值，如：antenna_gain > 30");
+    m_input->setClearButtonEnabled(true);
+    m_summaryLabel = new QLabel(content);
+    m_model = new SearchResultModel(this);
+    m_view = new QListView(content);
+    m_view->setModel(m_model);
+    m_view->setUniformItemSizes(true);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    layout->addWidget(m_input);
+    layout->addWidget(m_summaryLabel);
+    layout->addWidget(m_view, 1);
+    setWidget(content);
+
+    // 输入停顿后再查询，连续输入时不逐字计算
+    m_queryTimer = new QTimer(this);
+    m_queryTimer->setSingleShot(true);
+    m_queryTimer->setInterval(150);
+    connect(m_queryTimer, &QTimer::timeout, this, &SearchPanel::runQuery);
+    connect(m_input, &QLineEdit::textChanged, m_queryTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    auto activateRow = [this](int row) {
+        const SearchIndex::Hit* hit = m_model->hitAt(row);
+        if (hit) {
+            emit resultActivated(hit->typeId, hit->deviceId, hit->stateIndex, hit->paramId);
+        }
+    };
+    // 回车直接跳到第一条结果
+    connect(m_input, &QLineEdit::returnPressed, this, [this, activateRow]() {
+        m_queryTimer->stop();
+        runQuery();
+        if (m_model->rowCount() > 0) {
+            m_view->setCurrentIndex(m_model->index(0));
+            activateRow(0);
+        }
+    });
+    connect(m_view, &QListView::activated, this, [activateRow](const QModelIndex& index) {
+        activateRow(index.row());
+    });
+}
+
+void SearchPanel::setIndex(SearchIndex* index)
+{
+    if (m_index) {
+        disconnect(m_index, nullptr, this, nullptr);
+    }
+    m_index = index;
+    if (m_index) {
+        // 编辑改变取值后刷新结果；面板隐藏或没有查询时不计算
+        connect(m_index, &SearchIndex::changed, this, [this]() {
+            if (isVisible() && !m_input->text().trimmed().isEmpty()) {
+                m_queryTimer->start();
+            }
+        });
+    }
+    runQuery();
+}
+
+void SearchPanel::focusSearch()
+{
+    show();
+    raise();
+    m_input->setFocus();
+    m_input->selectAll();
+}
+
+void SearchPanel::runQuery()
+{
+    const QString text = m_input->text().trimmed();
+    if (!m_index || text.isEmpty()) {
+        m_model->setHits(QVector<SearchIndex::Hit>());
+        m_summaryLabel->setText(m_index ? QString(u8"共索引 %1 个取值").arg(m_index->cellCount()) : QString());
+        return;
+    }
+
+    const SearchIndex::Result result = m_index->query(text, m_maxHits);
+    m_model->setHits(result.hits);
+    const QString elapsed = QString::number(result.elapsedUs / 1000.0, 'f', 1);
+    if (result.total > result.hits.size()) {
+        m_summaryLabel->setText(QString(u8"共 %1 条，仅列出前 %2 条（%3 ms，双击跳转）")
+                                    .arg(result.total).arg(result.hits.size()).arg(elapsed));
+    } else {
+        m_summaryLabel->setText(QString(u8"共 %1 条（%2 ms，双击跳转）").arg(result.total).arg(elapsed));
+    }
+}
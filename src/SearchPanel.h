@@ -0,0 +1,57 @@
+﻿#pragma once
+
+#include "SearchIndex.h"
+#include <QAbstractListModel>
+#include <QDockWidget>
+#include <QPointer>
+
+class QLabel;
+class QLineEdit;
+class QListView;
+class QTimer;
+
+// 搜索结果列表模型：只持有本次查询截取的条目。
+class SearchResultModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit SearchResultModel(QObject* parent = nullptr);
+
+    void setHits(const QVector<SearchIndex::Hit>& hits);
+    const SearchIndex::Hit* hitAt(int row) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    QVector<SearchIndex::Hit> m_hits;
+};
+
+// 可停靠的全局搜索面板：输入时防抖查询 SearchIndex，索引变化后自动刷新当前结果，
+// 双击（或回车）条目跳转到对应设备/状态的参数编辑器。
+class SearchPanel : public QDockWidget {
+    Q_OBJECT
+
+public:
+    explicit SearchPanel(QWidget* parent = nullptr);
+
+    void setIndex(SearchIndex* index);
+
+public slots:
+    void focusSearch(); // 显示面板并选中输入框
+
+signals:
+    void resultActivated(const QString& typeId, const QString& deviceId, int stateIndex, const QString& paramId);
+
+private slots:
+    void runQuery();
+
+private:
+    QPointer<SearchIndex> m_index;
+    SearchResultModel* m_model;
+    QLineEdit* m_input;
+    QListView* m_view;
+    QLabel* m_summaryLabel;
+    QTimer* m_queryTimer;
+    int m_maxHits = 500;
+};
@@ -0,0 +1,409 @@
+﻿#include "ShardedStorage.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QSet>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+const char* const kStorageKey = "storage";
+const char* const kSplitLayout = "split";
+
+struct ShardData {
+    QString file;
+    QString error;
+    QString typeId;
+    int offset = 0;
+    QJsonArray devices;
+};
+
+// QtConcurrent 在 Qt5.5 下要求函数对象声明 result_type
+struct ReadShardFunctor {
+    typedef ShardData result_type;
+    QDir baseDir;
+    explicit ReadShardFunctor(const QDir& dir) : baseDir(dir) {}
+    result_type operator()(const ShardedStorage::Shard& shard) const
+    {
+        ShardData data;
+        data.file = shard.file;
+        data.typeId = shard.typeId;
+        data.offset = shard.first;
+
+        QFile file(baseDir.filePath(shard.file));
+        if (!file.open(QIODevice::ReadOnly)) {
+            data.error = QString(u8"无法打开取值分片: %1").arg(shard.file);
+            return data;
+        }
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            data.error = QString(u8"取值分片 %1 解析错误: %2").arg(shard.file, parseError.errorString());
+            return data;
+        }
+        const QJsonArray typesArray = doc.object().value("equipment_config").toObject()
+                                          .value("equipment_types").toArray();
+        for (const QJsonValue& value : typesArray) {
+            const QJsonObject typeObj = value.toObject();
+            if (typeObj.value("type_id").toString() == shard.typeId) {
+                data.offset = typeObj.value("device_offset").toInt(shard.first);
+                data.devices = typeObj.value("device_instances").toArray();
+                return data;
+            }
+        }
+        data.error = QString(u8"取值分片 %1 中没有类型 %2").arg(shard.file, shard.typeId);
+        return data;
+    }
+};
+
+// schema 文件的内容只取决于根对象（含分片列表）、类型结构与各类型的设备数；
+// 类型加载后不再修改，重新加载或外部修改时序列化缓存中的签名会整体作废
+quint64 schemaSignature(const QJsonObject& root,
+                        const QList<EquipmentType*>& types,
+                        const QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    quint64 hash = 14695981039346656037ULL;
+    auto mix = [&hash](quint64 value) {
+        hash ^= value;
+        hash *= 1099511628211ULL;
+    };
+    mix(qHash(QJsonDocument(root).toJson(QJsonDocument::Compact)));
+    for (const EquipmentType* equipType : types) {
+        mix(reinterpret_cast<quintptr>(equipType));
+        mix(static_cast<quint64>(devices.value(equipType->getTypeId()).size()));
+    }
+    return hash;
+}
+
+QString safeFileName(const QString& typeId)
+{
+    QString name;
+    name.reserve(typeId.size());
+    for (const QChar c : typeId) {
+        name.append(c.isLetterOrNumber() || c == '_' || c == '-' ? c : QChar('_'));
+    }
+    return name.isEmpty() ? QStringLiteral("type") : name;
+}
+
+// planShards 给出的文件名加上代号：xxx.json -> xxx.g<代号>.json
+QString generationFileName(const QString& file, int generation)
+{
+    QString base = file;
+    if (base.endsWith(QLatin1String(".json"))) {
+        base.chop(5);
+    }
+    return QString("%1.g%2.json").arg(base).arg(generation);
+}
+
+QString shardKey(const ShardedStorage::Shard& shard)
+{
+    return QString("%1%2%3%2%4").arg(shard.typeId).arg(QChar(0x1f)).arg(shard.first).arg(shard.count);
+}
+}
+
+bool ShardedStorage::isSplit(const QJsonObject& root)
+{
+    const QJsonObject storage = root.value("equipment_config").toObject().value(kStorageKey).toObject();
+    return storage.value("layout").toString() == QLatin1String(kSplitLayout);
+}
+
+QJsonObject ShardedStorage::withLayout(const QJsonObject& root, bool split)
+{
+    QJsonObject result = root;
+    QJsonObject configObj = result.value("equipment_config").toObject();
+    if (split) {
+        QJsonObject storage = configObj.value(kStorageKey).toObject();
+        storage.insert("layout", QLatin1String(kSplitLayout));
+        configObj.insert(kStorageKey, storage);
+    } else {
+        configObj.remove(kStorageKey);
+    }
+    result.insert("equipment_config", configObj);
+    return result;
+}
+
+QList<ShardedStorage::Shard> ShardedStorage::shards(const QJsonObject& root)
+{
+    QList<Shard> result;
+    const QJsonArray shardsArray = root.value("equipment_config").toObject()
+                                       .value(kStorageKey).toObject().value("shards").toArray();
+    for (const QJsonValue& value : shardsArray) {
+        const QJsonObject obj = value.toObject();
+        Shard shard;
+        shard.typeId = obj.value("type_id").toString();
+        shard.file = obj.value("file").toString();
+        shard.first = obj.value("first").toInt();
+        shard.count = obj.value("count").toInt();
+        if (!shard.typeId.isEmpty() && !shard.file.isEmpty()) {
+            result.append(shard);
+        }
+    }
+    return result;
+}
+
+QString ShardedStorage::shardDirectoryName(const QString& schemaFile)
+{
+    return QFileInfo(schemaFile).completeBaseName() + QStringLiteral(".values");
+}
+
+int ShardedStorage::maxDevicesPerShard()
+{
+    bool ok = false;
+    const int value = qgetenv("SHARD_MAX_DEVICES").toInt(&ok);
+    return ok ? value : 1000;
+}
+
+QList<ShardedStorage::Shard> ShardedStorage::planShards(const QString& schemaFile,
+                                                        const QList<EquipmentType*>& types,
+                                                        const QMap<QString, QList<DeviceInstance*>>& devices,
+                                                        int maxDevices)
+{
+    const QString dirName = shardDirectoryName(schemaFile);
+    QList<Shard> result;
+    QSet<QString> usedNames; // 按小写去重，兼容不区分大小写的文件系统
+    for (const EquipmentType* equipType : types) {
+        const QString typeId = equipType->getTypeId();
+        if (!devices.contains(typeId)) {
+            continue;
+        }
+        QString base = safeFileName(typeId);
+        for (int n = 2; usedNames.contains(base.toLower()); ++n) {
+            base = QString("%1~%2").arg(safeFileName(typeId)).arg(n);
+        }
+        usedNames.insert(base.toLower());
+
+        const int total = devices.value(typeId).size();
+        const int perShard = maxDevices > 0 ? maxDevices : qMax(total, 1);
+        if (total <= perShard) {
+            Shard shard;
+            shard.typeId = typeId;
+            shard.file = QString("%1/%2.json").arg(dirName, base);
+            shard.count = total;
+            result.append(shard);
+            continue;
+        }
+        for (int first = 0; first < total; first += perShard) {
+            Shard shard;
+            shard.typeId = typeId;
+            shard.file = QString("%1/%2.%3.json").arg(dirName, base).arg(first);
+            shard.first = first;
+            shard.count = qMin(perShard, total - first);
+            result.append(shard);
+        }
+    }
+    return result;
+}
+
+bool ShardedStorage::loadShards(const QString& schemaFile,
+                                const QJsonObject& root,
+                                QJsonObject& configObj,
+                                QString* error)
+{
+    configObj = root.value("equipment_config").toObject();
+    if (!isSplit(root)) {
+        return true;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<Shard> shardList = shards(root);
+    const QDir baseDir = QFileInfo(schemaFile).absoluteDir();
+    // 分片之间互不依赖，读取与解析交给线程池并行完成
+    const QVector<ShardData> loaded =
+        QtConcurrent::blockingMapped<QVector<ShardData>>(shardList, ReadShardFunctor(baseDir));
+
+    QHash<QString, QList<const ShardData*>> byType;
+    int deviceCount = 0;
+    for (const ShardData& data : loaded) {
+        if (!data.error.isEmpty()) {
+            if (error) *error = data.error;
+            return false;
+        }
+        byType[data.typeId].append(&data);
+        deviceCount += data.devices.size();
+    }
+
+    QJsonArray typesArray = configObj.value("equipment_types").toArray();
+    for (int i = 0; i < typesArray.size(); ++i) {
+        QJsonObject typeObj = typesArray.at(i).toObject();
+        auto it = byType.find(typeObj.value("type_id").toString());
+        if (it == byType.end()) {
+            continue;
+        }
+        QList<const ShardData*>& parts = it.value();
+        std::sort(parts.begin(), parts.end(), [](const ShardData* a, const ShardData* b) {
+            return a->offset < b->offset;
+        });
+        QJsonArray devicesArray;
+        for (const ShardData* part : parts) {
+            for (const QJsonValue& device : part->devices) {
+                devicesArray.append(device);
+            }
+        }
+        typeObj.insert("device_instances", devicesArray);
+        typesArray[i] = typeObj;
+    }
+    configObj.insert("equipment_types", typesArray);
+
+    qDebug() << QString(u8"已并行读取 %1 个取值分片，共 %2 台设备，用时 %3 ms")
+                    .arg(shardList.size())
+                    .arg(deviceCount)
+                    .arg(timer.elapsed());
+    return true;
+}
+
+void ShardedStorage::markLoaded(ConfigSerializer& serializer,
+                                const QString& schemaFile,
+                                const QJsonObject& root,
+                                const QList<EquipmentType*>& types,
+                                const QMap<QString, QList<DeviceInstance*>>& devices)
+{
+    if (!isSplit(root)) {
+        return;
+    }
+    const QDir baseDir = QFileInfo(schemaFile).absoluteDir();
+    int marked = 0;
+    for (const Shard& shard : shards(root)) {
+        const QList<DeviceInstance*> slice = devices.value(shard.typeId).mid(shard.first, shard.count);
+        if (slice.size() == shard.count) {
+            serializer.markShardWritten(baseDir.filePath(shard.file), ConfigSerializer::shardSignature(slice, shard.first));
+            ++marked;
+        }
+    }
+    serializer.markShardWritten(QFileInfo(schemaFile).absoluteFilePath(), schemaSignature(root, types, devices));
+    qDebug() << QString(u8"已记录 %1 个取值分片的加载状态").arg(marked);
+}
+
+bool ShardedStorage::save(ConfigSerializer& serializer,
+                          const QString& schemaFile,
+                          QJsonObject& root,
+                          const QList<EquipmentType*>& types,
+                          const QMap<QString, QList<DeviceInstance*>>& devices,
+                          SaveStats* stats,
+                          QString* error)
+{
+    QElapsedTimer timer;
+    timer.start();
+    SaveStats total;
+    const QDir baseDir = QFileInfo(schemaFile).absoluteDir();
+    if (!baseDir.mkpath(shardDirectoryName(schemaFile))) {
+        if (error) *error = QString(u8"无法创建取值分片目录: %1").arg(baseDir.filePath(shardDirectoryName(schemaFile)));
+        return false;
+    }
+
+    // 1. 内容未变的分片沿用旧 schema 中的文件；变化的分片写入新代号的文件，
+    //    旧 schema 引用的文件一个都不改写
+    const QString ownPrefix = shardDirectoryName(schemaFile) + QLatin1Char('/');
+    const QList<Shard> previous = shards(root);
+    QHash<QString, QString> previousFiles; // 类型 + 起始序号 + 设备数 -> 本文件目录中的分片文件
+    for (const Shard& shard : previous) {
+        if (shard.file.startsWith(ownPrefix)) {
+            previousFiles.insert(shardKey(shard), shard.file);
+        }
+    }
+    QJsonObject configObj = root.value("equipment_config").toObject();
+    QJsonObject storage = configObj.value(kStorageKey).toObject();
+    const int generation = storage.value("generation").toInt() + 1;
+
+    const QList<Shard> planned = planShards(schemaFile, types, devices, maxDevicesPerShard());
+    QJsonArray shardsArray;
+    QSet<QString> referenced;
+    QStringList written;
+    auto discardWritten = [&written, &baseDir]() {
+        // 新 schema 未提交，本次写出的分片无人引用
+        for (const QString& file : written) {
+            QFile::remove(baseDir.filePath(file));
+        }
+    };
+    for (const Shard& plannedShard : planned) {
+        Shard shard = plannedShard;
+        const QList<DeviceInstance*> slice = devices.value(shard.typeId).mid(shard.first, shard.count);
+        const quint64 signature = ConfigSerializer::shardSignature(slice, shard.first);
+        const QString reusable = previousFiles.value(shardKey(shard));
+        if (!reusable.isEmpty()
+            && serializer.isShardCurrent(baseDir.filePath(reusable), signature)
+            && QFile::exists(baseDir.filePath(reusable))) {
+            shard.file = reusable;
+        } else {
+            shard.file = generationFileName(shard.file, generation);
+            const QString path = baseDir.filePath(shard.file);
+            AtomicFileWriter writer(path);
+            if (!(writer.open()
+                  && serializer.serializeShard(writer, shard.typeId, slice, shard.first)
+                  && writer.commit())) {
+                if (error) *error = writer.errorString();
+                discardWritten();
+                return false;
+            }
+            written.append(shard.file);
+            serializer.markShardWritten(path, signature);
+            ++total.shardsWritten;
+            total.serialize.devicesSerialized += serializer.lastStats().devicesSerialized;
+            total.write.bytes += writer.stats().bytes;
+        }
+        total.serialize.deviceCount += slice.size();
+        referenced.insert(shard.file);
+
+        QJsonObject obj;
+        obj.insert("type_id", shard.typeId);
+        obj.insert("file", shard.file);
+        obj.insert("first", shard.first);
+        obj.insert("count", shard.count);
+        shardsArray.append(obj);
+    }
+    total.shardCount = planned.size();
+
+    // 2. 新分片只被新 schema 引用；替换 schema 是唯一的提交点，之前任何一步失败或崩溃，
+    //    磁盘上的旧 schema 仍指向未被改动的旧分片。没有分片重写时代号不变，schema 不必重写
+    storage = QJsonObject();
+    storage.insert("layout", QLatin1String(kSplitLayout));
+    storage.insert("generation", written.isEmpty() ? generation - 1 : generation);
+    storage.insert("shards", shardsArray);
+    configObj.insert(kStorageKey, storage);
+    QJsonObject newRoot = root;
+    newRoot.insert("equipment_config", configObj);
+
+    const QString schemaPath = QFileInfo(schemaFile).absoluteFilePath();
+    const quint64 schemaSig = schemaSignature(newRoot, types, devices);
+    if (!serializer.isShardCurrent(schemaPath, schemaSig) || !QFile::exists(schemaPath)) {
+        AtomicFileWriter writer(schemaFile);
+        if (!(writer.open()
+              && serializer.serialize(writer, newRoot, types, devices, false)
+              && writer.commit())) {
+            if (error) *error = writer.errorString();
+            discardWritten();
+            return false;
+        }
+        serializer.markShardWritten(schemaPath, schemaSig);
+        total.schemaWritten = true;
+        total.serialize.typesSerialized = serializer.lastStats().typesSerialized;
+        total.write.bytes += writer.stats().bytes;
+    }
+    total.serialize.typeCount = types.size();
+    root = newRoot;
+
+    // 3. schema 提交后只删除旧 schema 引用过、新 schema 不再引用的分片，不触碰目录中的其他文件；
+    //    另存为时旧分片属于原文件，同样保留
+    for (const Shard& shard : previous) {
+        if (shard.file.startsWith(ownPrefix) && !referenced.contains(shard.file)) {
+            const QString path = baseDir.filePath(shard.file);
+            if (QFile::exists(path) && !QFile::remove(path)) {
+                qDebug() << QString(u8"无法删除不再使用的取值分片: %1").arg(path);
+            }
+        }
+    }
+    serializer.retainDevices(devices);
+
+    total.serialize.elapsedMs = timer.elapsed();
+    total.write.elapsedMs = total.serialize.elapsedMs;
+    if (stats) *stats = total;
+    return true;
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "ConfigSerializer.h"
+#include "AtomicFileWriter.h"
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QJsonObject>
+
+class EquipmentType;
+class DeviceInstance;
+
+// 分片存储布局：配置文件只保存结构（schema），各类型的设备取值保存在
+// <配置文件名>.values/ 目录下的分片文件中，设备很多的类型再按数量拆成多个分片。
+// 布局记录在 equipment_config.storage 中：
+//   {"layout":"split","generation":..,"shards":[{"type_id":..,"file":..,"first":..,"count":..}]}
+// 分片文件保持与单文件相同的嵌套结构，只含一个类型的 type_id、device_offset 与 device_instances。
+// 内容变化的分片写入带新代号的文件名（<类型>[.<起始序号>].g<代号>.json），从不覆盖当前 schema
+// 引用的分片，保存中途失败或崩溃时磁盘上的 schema 与其引用的分片始终一致。
+// 没有 storage 节点的文件即单文件布局，两种布局可以互相导入导出。
+class ShardedStorage {
+public:
+    struct Shard {
+        QString typeId;
+        QString file; // 相对配置文件所在目录
+        int first = 0;
+        int count = 0;
+    };
+
+    struct SaveStats {
+        int shardCount = 0;
+        int shardsWritten = 0; // 内容变化而重写的分片数
+        bool schemaWritten = false; // schema 内容变化而重写
+        ConfigSerializer::Stats serialize;
+        AtomicFileWriter::Stats write;
+    };
+
+    static bool isSplit(const QJsonObject& root);
+    // 返回切换到指定布局的根对象；切换到分片布局时分片列表在保存时生成
+    static QJsonObject withLayout(const QJsonObject& root, bool split);
+    static QList<Shard> shards(const QJsonObject& root);
+    static QString shardDirectoryName(const QString& schemaFile);
+    // 单个分片最多包含的设备数，SHARD_MAX_DEVICES 可覆盖（<=0 表示不拆分）
+    static int maxDevicesPerShard();
+    static QList<Shard> planShards(const QString& schemaFile,
+                                   const QList<EquipmentType*>& types,
+                                   const QMap<QString, QList<DeviceInstance*>>& devices,
+                                   int maxDevices);
+
+    // 并行读取 root 引用的全部分片，把设备数组合并回 configObj 的类型对象中，
+    // 得到与单文件布局相同的 equipment_config；单文件布局时直接返回原节点
+    static bool loadShards(const QString& schemaFile,
+                           const QJsonObject& root,
+                           QJsonObject& configObj,
+                           QString* error = nullptr);
+
+    // 加载后把磁盘上各分片与 schema 对应的签名记入序列化缓存，打开文件后的第一次保存
+    // 同样只重写内容变化的分片；单文件布局时不做任何事
+    static void markLoaded(ConfigSerializer& serializer,
+                           const QString& schemaFile,
+                           const QJsonObject& root,
+                           const QList<EquipmentType*>& types,
+                           const QMap<QString, QList<DeviceInstance*>>& devices);
+
+    // 先把内容变化的分片写成新代号的文件，schema 内容变化时最后原子替换 schema 文件，
+    // 提交后再删除旧 schema 引用、新 schema 不再引用的分片；root 的 storage 节点随之更新
+    static bool save(ConfigSerializer& serializer,
+                     const QString& schemaFile,
+                     QJsonObject& root,
+                     const QList<EquipmentType*>& types,
+                     const QMap<QString, QList<DeviceInstance*>>& devices,
+                     SaveStats* stats = nullptr,
+                     QString* error = nullptr);
+};
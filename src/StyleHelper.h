@@ -3,6 +3,58 @@
 #include <QString>
 
 namespace StyleHelper {
+// 旧版全局浅色样式表，仅在 APP_THEME=stylesheet 时使用（默认主题见 AppTheme）
+inline QString lightAppStyle()
+{
+    return QStringLiteral(R"(
+        QWidget { font-family: "Inter", "Microsoft YaHei", sans-serif; font-size: 12px; color: #111827; }
+        QMainWindow, QDialog, QTabWidget::pane, QScrollArea { background: #f8fafc; }
+        QGroupBox { border: 1px solid #d0d7e2; border-radius: 6px; margin-top: 10px; padding: 8px 10px 10px 10px; background: #ffffff; }
+        QGroupBox::title { subcontrol-origin: margin; left: 10px; padding: 0 4px; color: #0f172a; font-weight: 700; }
+        QLabel { color: #0f172a; font-weight: 600; }
+        QLineEdit, QComboBox, QSpinBox, QDoubleSpinBox { border: 1px solid #c3cfe2; border-radius: 5px; padding: 4px 6px; background: #ffffff; selection-background-color: #2563eb; selection-color: #ffffff; }
+        QLineEdit:focus, QComboBox:focus, QSpinBox:focus, QDoubleSpinBox:focus { border: 1px solid #2563eb; }
+        QLineEdit[invalid="true"], QComboBox[invalid="true"], QSpinBox[invalid="true"], QDoubleSpinBox[invalid="true"] { border: 1px solid #dc2626; background: #fef2f2; }
+        QComboBox::drop-down { border: none; width: 18px; }
+        QComboBox::down-arrow { image: none; border: none; }
+        QAbstractItemView {
+            background: #ffffff;
+            color: #111827;
+            selection-background-color: #2563eb;
+            selection-color: #ffffff;
+            outline: 0;
+        }
+        QPushButton { background: #2563eb; color: #ffffff; border: none; border-radius: 6px; padding: 6px 12px; font-weight: 600; }
+        QPushButton:hover { background: #1d4ed8; }
+        QPushButton:pressed { background: #1e40af; }
+        QPushButton:disabled { background: #a5b4fc; color: #f1f5f9; }
+        QTabBar::tab { background: #e5ecf6; padding: 8px 16px; margin: 2px; border-radius: 6px 6px 0 0; color: #0f172a; min-width: 130px; }
+        QTabBar::tab:selected { background: #ffffff; color: #2563eb; font-weight: 700; border: 1px solid #d0d7e2; border-bottom: 1px solid #ffffff; }
+        QTabBar::tab:hover { background: #f1f5fd; }
+        QTabBar::scroller { width: 22px; background: #e5ecf6; border-left: 1px solid #cbd5e1; }
+        QTabBar QToolButton { background: transparent; border: none; color: #0f172a; padding: 0 4px; }
+        QTabBar QToolButton:hover { background: #cbd5e1; color: #0f172a; }
+        QTabWidget::pane { border: 1px solid #d0d7e2; top: -1px; }
+        QMenu { background: #0f172a; color: #e2e8f0; border: 1px solid #1f2937; }
+        QMenu::item:selected { background: #2563eb; color: #f8fafc; }
+        QMenu::separator { height: 1px; background: #1f2937; margin: 4px 0; }
+        QScrollBar:vertical { background: transparent; width: 10px; margin: 4px; }
+        QScrollBar::handle:vertical { background: #c3d0e8; border-radius: 5px; }
+        QScrollBar::handle:vertical:hover { background: #9fb6e1; }
+        QScrollBar::add-line:vertical, QScrollBar::sub-line:vertical {
+            background: #e5ecf6;
+            border: 1px solid #cbd5e1;
+            height: 12px;
+        }
+        QScrollBar::add-line:vertical:hover, QScrollBar::sub-line:vertical:hover {
+            background: #cbd5e1;
+            border: 1px solid #94a3b8;
+        }
+        QScrollBar::add-page:vertical, QScrollBar::sub-page:vertical { background: none; }
+        QStatusBar { background: #e5ecf6; }
+    )");
+}
+
 // 现代深色面板风格，便于多处复用，避免 main.cpp 硬编码。
 inline QString darkPanelStyle()
 {
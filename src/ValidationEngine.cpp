@@ -0,0 +1,548 @@
+﻿#include "ValidationEngine.h"
+#include "EquipmentType.h"
+#include "DeviceInstance.h"
+#include "ParameterItem.h"
+#include <algorithm>
+
+namespace {
+const double kEps = 1e-6;
+// 组合唯一键的分隔符，取一个不会出现在单行文本中的控制字符
+const QChar kKeySeparator(0x1f);
+}
+
+ValidationEngine::ValidationEngine(const QList<EquipmentType*>& types,
+                                   const QMap<QString, QList<DeviceInstance*>>& devices)
+    : m_types(types), m_devices(devices)
+{
+}
+
+bool ValidationEngine::run(ValidationReport& report)
+{
+    m_report = &report;
+    normalizeAndCheckParameters();
+    applyRules();
+    m_report = nullptr;
+    return report.isEmpty();
+}
+
+bool ValidationEngine::parseFrequencies(const QString& text, QList<double>& out)
+{
+    QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        return true;
+    }
+    if (!trimmed.startsWith('[') || !trimmed.endsWith(']')) {
+        return false;
+    }
+    trimmed = trimmed.mid(1, trimmed.size() - 2).trimmed();
+    if (trimmed.isEmpty()) {
+        return true;
+    }
+    const QStringList parts = trimmed.split(',', QString::SkipEmptyParts);
+    for (const QString& p : parts) {
+        bool ok = false;
+        double v = p.trimmed().toDouble(&ok);
+        if (!ok) {
+            return false;
+        }
+        out.append(v);
+    }
+    return true;
+}
+
+QVariant ValidationEngine::normalizeValue(const ParameterItem* param, const QVariant& value)
+{
+    QVariant normalized = value;
+    const QString type = param->getType();
+
+    if (!normalized.isValid() || (type == "string" && normalized.toString().isEmpty())) {
+        if (type == "string" && param->isArrayLike()) {
+            normalized = QStringLiteral("[]");
+        } else {
+            normalized = param->getDefaultValue();
+        }
+    }
+
+    if (type == "int" || type == "Byte") {
+        bool ok = false;
+        int v = normalized.toInt(&ok);
+        if (!ok) {
+            v = param->getDefaultValue().toInt();
+        }
+        int minVal = static_cast<int>(param->getMinValue());
+        int maxVal = static_cast<int>(param->getMaxValue());
+        if (v < minVal) v = minVal;
+        if (v > maxVal) v = maxVal;
+        normalized = v;
+    } else if (type == "double") {
+        bool ok = false;
+        double v = normalized.toDouble(&ok);
+        if (!ok) {
+            v = param->getDefaultValue().toDouble();
+        }
+        double minVal = param->getMinValue();
+        double maxVal = param->getMaxValue();
+        if (v < minVal) v = minVal;
+        if (v > maxVal) v = maxVal;
+        normalized = v;
+    } else if (type == "enum") {
+        QString v = normalized.toString();
+        if (!param->getOptions().contains(v)) {
+            QString def = param->getDefaultValue().toString();
+            if (param->getOptions().contains(def)) {
+                v = def;
+            } else if (!param->getOptions().isEmpty()) {
+                v = param->getOptions().first();
+            }
+        }
+        normalized = v;
+    } else if (type == "string") {
+        QString v = normalized.toString();
+        if (!ParameterItem::stringAllowedPattern().match(v).hasMatch()) {
+            v = param->getDefaultValue().toString();
+        }
+        normalized = v;
+    }
+
+    return normalized;
+}
+
+void ValidationEngine::normalizeAndCheckParameters()
+{
+    for (EquipmentType* equipType : m_types) {
+        const auto& basicParams = equipType->getBasicParameters();
+        WorkStateTemplate* wsTemplate = equipType->getWorkStateTemplate();
+        const QList<DeviceInstance*> devices = m_devices.value(equipType->getTypeId());
+        for (DeviceInstance* device : devices) {
+            // 基本参数校验
+            for (ParameterItem* param : basicParams) {
+                const QVariant original = device->getBasicValue(param->getId());
+                QVariant val = normalizeValue(param, original);
+                if (m_normalizations && (!original.isValid() || val != original)) {
+                    Normalization change;
+                    change.typeId = equipType->getTypeId();
+                    change.deviceId = device->getDeviceId();
+                    change.paramId = param->getId();
+                    change.before = original;
+                    change.after = val;
+                    m_normalizations->append(change);
+                }
+                device->setBasicValue(param->getId(), val); // 回写自动填充或校正的值
+                if (!param->validate(val)) {
+                    Entry entry;
+                    entry.device = device;
+                    ValidationIssue issue = makeIssue(ValidationIssue::InvalidBasicValue, entry, QString());
+                    issue.paramId = param->getId();
+                    issue.paramLabel = param->getLabel();
+                    m_report->add(issue);
+                }
+            }
+
+            // 工作状态参数校验
+            if (wsTemplate) {
+                for (int stateIdx = 0; stateIdx < device->getWorkStateCount(); ++stateIdx) {
+                    QVariantMap stateValues = device->getWorkStateValues(stateIdx);
+                    for (ParameterItem* param : wsTemplate->getParameters()) {
+                        const QVariant original = stateValues.value(param->getId());
+                        QVariant val = normalizeValue(param, original.isValid() ? original : param->getDefaultValue());
+                        if (m_normalizations && (!original.isValid() || val != original)) {
+                            Normalization change;
+                            change.typeId = equipType->getTypeId();
+                            change.deviceId = device->getDeviceId();
+                            change.stateIndex = stateIdx;
+                            change.paramId = param->getId();
+                            change.before = original;
+                            change.after = val;
+                            m_normalizations->append(change);
+                        }
+                        stateValues[param->getId()] = val; // 回写自动填充或校正的值
+                        if (!param->validate(val)) {
+                            Entry entry;
+                            entry.device = device;
+                            entry.stateIndex = stateIdx;
+                            ValidationIssue issue = makeIssue(ValidationIssue::InvalidStateValue, entry, QString());
+                            issue.paramId = param->getId();
+                            issue.paramLabel = param->getLabel();
+                            m_report->add(issue);
+                        }
+                    }
+                    device->setWorkStateValues(stateIdx, stateValues);
+                }
+            }
+        }
+    }
+}
+
+void ValidationEngine::applyRules()
+{
+    // global 约束按“规则ID + 约束内容”归组，不同设备类型声明同一规则即共享索引
+    QHash<QString, UniqueIndex> globalUnique;
+    QHash<QString, IntervalIndex> globalIntervals;
+    QStringList globalOrder; // 按首次出现顺序输出区间检查结果，保证报错顺序稳定
+
+    for (EquipmentType* equipType : m_types) {
+        WorkStateTemplate* wsTemplate = equipType->getWorkStateTemplate();
+        if (!wsTemplate) continue;
+        const QVector<ValidationRule>& rules = wsTemplate->getCompiledValidationRules();
+        if (rules.isEmpty()) continue;
+
+        const QList<DeviceInstance*> devices = m_devices.value(equipType->getTypeId());
+        for (DeviceInstance* device : devices) {
+            const QVariantMap basicVals = device->getBasicValues();
+            QList<QVariantMap> states;
+            const int stateCount = device->getWorkStateCount();
+            states.reserve(stateCount);
+            for (int stateIdx = 0; stateIdx < stateCount; ++stateIdx) {
+                states.append(device->getWorkStateValues(stateIdx));
+            }
+
+            for (const ValidationRule& rule : rules) {
+                for (const ValidationConstraint& c : rule.constraints) {
+                    if (!c.isCrossEntry()) {
+                        for (int stateIdx = 0; stateIdx < states.size(); ++stateIdx) {
+                            const QVariantMap& vals = states.at(stateIdx);
+                            ValidationIssue issue;
+                            if (matchWhen(c, vals, basicVals) &&
+                                !checkStateConstraint(rule, c, device, stateIdx, vals, basicVals, issue)) {
+                                m_report->add(issue);
+                            }
+                        }
+                        continue;
+                    }
+
+                    const bool basicLevel = isBasicLevel(equipType, c);
+                    if (rule.scope == ValidationRule::PerDevice) {
+                        UniqueIndex unique;
+                        IntervalIndex intervals;
+                        unique.ruleId = intervals.ruleId = rule.id;
+                        unique.keys = intervals.keys = c.keys;
+                        const bool isUnique = c.kind == ValidationConstraint::Unique;
+                        collectCrossEntries(c, basicLevel, device, basicVals, states,
+                                            isUnique ? &unique : nullptr,
+                                            isUnique ? nullptr : &intervals);
+                        sweepIntervals(intervals);
+                    } else {
+                        const QString groupKey = QString("%1|%2|%3").arg(rule.id).arg(int(c.kind)).arg(c.keys.join(','));
+                        if (c.kind == ValidationConstraint::Unique) {
+                            UniqueIndex& unique = globalUnique[groupKey];
+                            unique.ruleId = rule.id;
+                            unique.keys = c.keys;
+                            collectCrossEntries(c, basicLevel, device, basicVals, states, &unique, nullptr);
+                        } else {
+                            if (!globalIntervals.contains(groupKey)) {
+                                globalOrder << groupKey;
+                            }
+                            IntervalIndex& intervals = globalIntervals[groupKey];
+                            intervals.ruleId = rule.id;
+                            intervals.keys = c.keys;
+                            collectCrossEntries(c, basicLevel, device, basicVals, states, nullptr, &intervals);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // 区间类 global 约束需要全部条目收集完成后统一排序扫描
+    for (const QString& groupKey : globalOrder) {
+        sweepIntervals(globalIntervals[groupKey]);
+    }
+}
+
+bool ValidationEngine::checkStateConstraint(const ValidationRule& rule,
+                                            const ValidationConstraint& c,
+                                            DeviceInstance* device,
+                                            int stateIdx,
+                                            const QVariantMap& vals,
+                                            const QVariantMap& basicVals,
+                                            ValidationIssue& issue)
+{
+    Entry entry;
+    entry.device = device;
+    entry.stateIndex = stateIdx;
+    switch (c.kind) {
+    case ValidationConstraint::Equal: {
+        double a = number(vals, basicVals, c.keys.at(0));
+        double b = number(vals, basicVals, c.keys.at(1));
+        if (qAbs(a - b) > kEps) {
+            issue = makeIssue(ValidationIssue::NotEqual, entry, rule.id);
+            issue.paramId = c.keys.at(0);
+            issue.keys = c.keys;
+            return false;
+        }
+        break;
+    }
+    case ValidationConstraint::Less: {
+        double a = number(vals, basicVals, c.keys.at(0));
+        double b = number(vals, basicVals, c.keys.at(1));
+        if (!(a < b)) {
+            issue = makeIssue(ValidationIssue::NotLess, entry, rule.id);
+            issue.paramId = c.keys.at(0);
+            issue.keys = c.keys;
+            return false;
+        }
+        break;
+    }
+    case ValidationConstraint::Min: {
+        double v = number(vals, basicVals, c.keys.at(0));
+        if (v + kEps < c.threshold) {
+            issue = makeIssue(ValidationIssue::BelowMin, entry, rule.id);
+            issue.paramId = c.keys.at(0);
+            issue.keys = c.keys;
+            issue.v1 = c.threshold;
+            return false;
+        }
+        break;
+    }
+    case ValidationConstraint::MinEndByInterval: {
+        double start = number(vals, basicVals, c.keys.at(0));
+        double end = number(vals, basicVals, c.keys.at(1));
+        int count = lookup(vals, basicVals, c.keys.at(2)).toInt();
+        double interval = number(vals, basicVals, c.keys.at(3));
+        double minEnd = start + static_cast<double>(count) * interval;
+        if (end + kEps < minEnd) {
+            issue = makeIssue(ValidationIssue::EndBelowInterval, entry, rule.id);
+            issue.paramId = c.keys.at(1);
+            issue.keys = c.keys;
+            issue.v1 = minEnd;
+            issue.v2 = end;
+            return false;
+        }
+        break;
+    }
+    case ValidationConstraint::ListBetween: {
+        const QString& listK = c.keys.at(0);
+        QList<double> listVals;
+        if (!parseFrequencies(lookup(vals, basicVals, listK).toString(), listVals)) {
+            issue = makeIssue(ValidationIssue::ListFormat, entry, rule.id);
+            issue.paramId = listK;
+            issue.keys = c.keys;
+            return false;
+        } else {
+            double minV = number(vals, basicVals, c.keys.at(1));
+            double maxV = number(vals, basicVals, c.keys.at(2));
+            for (double f : listVals) {
+                if (!(f > minV && f < maxV)) {
+                    issue = makeIssue(ValidationIssue::ListOutOfRange, entry, rule.id);
+                    issue.paramId = listK;
+                    issue.keys = c.keys;
+                    issue.v1 = f;
+                    issue.v2 = minV;
+                    issue.v3 = maxV;
+                    return false;
+                }
+            }
+        }
+        break;
+    }
+    case ValidationConstraint::Expect: {
+        if (!c.expect.evaluate(vals, basicVals)) {
+            issue = makeIssue(ValidationIssue::ExpectFailed, entry, rule.id);
+            issue.paramId = c.keys.value(0);
+            issue.keys = c.keys;
+            issue.expression = c.expect.text();
+            return false;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return true;
+}
+
+QHash<int, ValidationIssue> ValidationEngine::checkStateSlots(DeviceInstance* device,
+                                                              int stateIdx,
+                                                              const QVariantMap& vals,
+                                                              const QSet<int>& slotIndexes)
+{
+    return checkStateSlots(device, stateIdx, vals, device ? device->getBasicValues() : QVariantMap(), slotIndexes);
+}
+
+QHash<int, ValidationIssue> ValidationEngine::checkStateSlots(DeviceInstance* device,
+                                                              int stateIdx,
+                                                              const QVariantMap& vals,
+                                                              const QVariantMap& basicVals,
+                                                              const QSet<int>& slotIndexes)
+{
+    QHash<int, ValidationIssue> failed;
+    EquipmentType* equipType = device ? device->getEquipmentType() : nullptr;
+    WorkStateTemplate* tmpl = equipType ? equipType->getWorkStateTemplate() : nullptr;
+    if (!tmpl) {
+        return failed;
+    }
+    const QVector<ValidationRule>& rules = tmpl->getCompiledValidationRules();
+    const ValidationDependencyIndex& deps = tmpl->getValidationDependencies();
+    for (int slotIndex : slotIndexes) {
+        if (slotIndex < 0 || slotIndex >= deps.constraintSlots.size()) {
+            continue;
+        }
+        const ValidationDependencyIndex::Slot& slot = deps.constraintSlots.at(slotIndex);
+        const ValidationRule& rule = rules.at(slot.rule);
+        const ValidationConstraint& c = rule.constraints.at(slot.constraint);
+        ValidationIssue issue;
+        if (matchWhen(c, vals, basicVals) &&
+            !checkStateConstraint(rule, c, device, stateIdx, vals, basicVals, issue)) {
+            failed.insert(slotIndex, issue);
+        }
+    }
+    return failed;
+}
+
+void ValidationEngine::collectCrossEntries(const ValidationConstraint& c,
+                                           bool basicLevel,
+                                           DeviceInstance* device,
+                                           const QVariantMap& basicVals,
+                                           const QList<QVariantMap>& states,
+                                           UniqueIndex* unique,
+                                           IntervalIndex* intervals)
+{
+    auto collect = [&](const QVariantMap& vals, int stateIdx) {
+        if (!matchWhen(c, vals, basicVals)) {
+            return;
+        }
+        Entry entry;
+        entry.device = device;
+        entry.stateIndex = stateIdx;
+        if (unique) {
+            QStringList values;
+            for (const QString& key : c.keys) {
+                QString v = lookup(vals, basicVals, key).toString().trimmed();
+                if (v.isEmpty()) {
+                    return; // 未填写的值不参与唯一性比较
+                }
+                values << v;
+            }
+            insertUnique(*unique, values, entry);
+        }
+        if (intervals) {
+            bool okLo = false;
+            bool okHi = false;
+            double lo = lookup(vals, basicVals, c.keys.at(0)).toDouble(&okLo);
+            double hi = lookup(vals, basicVals, c.keys.at(1)).toDouble(&okHi);
+            if (!okLo || !okHi) {
+                return;
+            }
+            Interval iv;
+            iv.lo = qMin(lo, hi);
+            iv.hi = qMax(lo, hi);
+            iv.entry = entry;
+            intervals->items.append(iv);
+        }
+    };
+
+    if (basicLevel) {
+        collect(QVariantMap(), -1);
+        return;
+    }
+    for (int stateIdx = 0; stateIdx < states.size(); ++stateIdx) {
+        collect(states.at(stateIdx), stateIdx);
+    }
+}
+
+void ValidationEngine::insertUnique(UniqueIndex& index, const QStringList& values, const Entry& entry)
+{
+    const QString key = values.join(kKeySeparator);
+    auto it = index.seen.constFind(key);
+    if (it == index.seen.constEnd()) {
+        index.seen.insert(key, entry);
+        return;
+    }
+    ValidationIssue issue = makeIssue(ValidationIssue::Duplicate, entry, index.ruleId);
+    issue.paramId = index.keys.first();
+    issue.keys = index.keys;
+    issue.values = values;
+    issue.otherDeviceName = it.value().device->getDeviceName();
+    issue.otherStateIndex = it.value().stateIndex;
+    m_report->add(issue);
+}
+
+void ValidationEngine::sweepIntervals(IntervalIndex& index)
+{
+    if (index.items.size() < 2) {
+        return;
+    }
+    std::sort(index.items.begin(), index.items.end(), [](const Interval& a, const Interval& b) {
+        return a.lo < b.lo || (a.lo == b.lo && a.hi < b.hi);
+    });
+
+    // 扫描线：只与当前右端点最大的区间比较，每个区间最多报告一次
+    int holder = 0;
+    for (int i = 1; i < index.items.size(); ++i) {
+        const Interval& cur = index.items.at(i);
+        const Interval& prev = index.items.at(holder);
+        // 闭区间比较；两个非单点区间仅端点相接不算重叠
+        bool overlap = cur.lo < prev.hi ||
+                       (cur.lo == prev.hi && (cur.lo == cur.hi || prev.lo == prev.hi));
+        if (overlap) {
+            ValidationIssue issue = makeIssue(ValidationIssue::Overlap, cur.entry, index.ruleId);
+            issue.paramId = index.keys.at(0);
+            issue.keys = index.keys;
+            issue.v1 = cur.lo;
+            issue.v2 = cur.hi;
+            issue.v3 = prev.lo;
+            issue.v4 = prev.hi;
+            issue.otherDeviceName = prev.entry.device->getDeviceName();
+            issue.otherStateIndex = prev.entry.stateIndex;
+            m_report->add(issue);
+        }
+        if (cur.hi > prev.hi) {
+            holder = i;
+        }
+    }
+}
+
+QVariant ValidationEngine::lookup(const QVariantMap& vals, const QVariantMap& basicVals, const QString& key)
+{
+    auto it = vals.constFind(key);
+    if (it != vals.constEnd()) {
+        return it.value();
+    }
+    return basicVals.value(key);
+}
+
+bool ValidationEngine::matchWhen(const ValidationConstraint& c, const QVariantMap& vals, const QVariantMap& basicVals)
+{
+    for (auto it = c.when.constBegin(); it != c.when.constEnd(); ++it) {
+        QVariant v = lookup(vals, basicVals, it.key());
+        QString cur = v.isValid() ? v.toString() : QString();
+        if (!it.value().contains(cur)) {
+            return false;
+        }
+    }
+    return c.condition.evaluate(vals, basicVals);
+}
+
+double ValidationEngine::number(const QVariantMap& vals, const QVariantMap& basicVals, const QString& key)
+{
+    bool ok = false;
+    double d = lookup(vals, basicVals, key).toDouble(&ok);
+    return ok ? d : 0.0;
+}
+
+ValidationIssue ValidationEngine::makeIssue(ValidationIssue::Code code, const Entry& entry, const QString& ruleId)
+{
+    ValidationIssue issue;
+    issue.code = code;
+    issue.typeId = entry.device->getEquipmentType() ? entry.device->getEquipmentType()->getTypeId() : QString();
+    issue.deviceId = entry.device->getDeviceId();
+    issue.deviceName = entry.device->getDeviceName();
+    issue.stateIndex = entry.stateIndex;
+    issue.ruleId = ruleId;
+    return issue;
+}
+
+bool ValidationEngine::isBasicLevel(const EquipmentType* type, const ValidationConstraint& c)
+{
+    // 约束引用的参数全部属于基本参数时，每台设备只贡献一个条目
+    WorkStateTemplate* tmpl = type->getWorkStateTemplate();
+    for (const QString& key : c.keys) {
+        if (tmpl && tmpl->getParameter(key)) {
+            return false;
+        }
+        if (!type->getBasicParameter(key)) {
+            return false;
+        }
+    }
+    return !c.keys.isEmpty();
+}
@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#include "ValidationRule.h"
+#include "ValidationReport.h"
+#include <QList>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+
+class EquipmentType;
+class DeviceInstance;
+class ParameterItem;
+
+// 全量校验：参数取值规范化 + validation_rules 业务校验。
+// 只依赖数据模型，不涉及任何界面对象。
+//   per_state  ：逐工作状态检查
+//   per_device ：同一设备的各工作状态之间比较（unique / no_overlap）
+//   global     ：所有声明了同一规则 ID 的设备之间比较，可跨设备类型
+// 跨状态/跨设备的比较基于哈希集合与排序区间，整体接近线性复杂度。
+class ValidationEngine {
+public:
+    ValidationEngine(const QList<EquipmentType*>& types,
+                     const QMap<QString, QList<DeviceInstance*>>& devices);
+
+    // 返回 false 表示存在错误；规范化后的取值会回写到设备实例
+    bool run(ValidationReport& report);
+
+    // 规范化实际改动的取值（补默认值、截断到范围、非法取值回退），
+    // 在快照上校验时据此把同样的改动同步回界面中的模型
+    struct Normalization {
+        QString typeId;
+        QString deviceId;
+        int stateIndex = -1; // -1 表示基本参数
+        QString paramId;
+        QVariant before;     // 规范化前的取值（不存在时无效）
+        QVariant after;
+    };
+    void setNormalizationLog(QVector<Normalization>* log) { m_normalizations = log; }
+
+    // 编辑时的即时校验：只检查模板依赖索引中给定槽位的单状态约束，
+    // 返回违反约束的槽位 -> 问题；vals 为该状态当前（可能尚未写回设备的）取值
+    static QHash<int, ValidationIssue> checkStateSlots(DeviceInstance* device,
+                                                       int stateIdx,
+                                                       const QVariantMap& vals,
+                                                       const QSet<int>& slotIndexes);
+    // 同上，基本参数取值由调用方给出（批量修改在写入前用改动后的基本参数试算）
+    static QHash<int, ValidationIssue> checkStateSlots(DeviceInstance* device,
+                                                       int stateIdx,
+                                                       const QVariantMap& vals,
+                                                       const QVariantMap& basicVals,
+                                                       const QSet<int>& slotIndexes);
+
+    static QVariant normalizeValue(const ParameterItem* param, const QVariant& value);
+    static bool parseFrequencies(const QString& text, QList<double>& out);
+
+private:
+    // 参与跨条目比较的一个条目：stateIndex 为 -1 表示设备的基本参数
+    struct Entry {
+        DeviceInstance* device = nullptr;
+        int stateIndex = -1;
+    };
+    struct Interval {
+        double lo = 0.0;
+        double hi = 0.0;
+        Entry entry;
+    };
+    struct UniqueIndex {
+        QString ruleId;
+        QStringList keys;
+        QHash<QString, Entry> seen;
+    };
+    struct IntervalIndex {
+        QString ruleId;
+        QStringList keys;
+        QVector<Interval> items;
+    };
+
+    const QList<EquipmentType*>& m_types;
+    const QMap<QString, QList<DeviceInstance*>>& m_devices;
+    ValidationReport* m_report = nullptr;
+    QVector<Normalization>* m_normalizations = nullptr;
+
+    void normalizeAndCheckParameters();
+    void applyRules();
+
+    // 返回 false 表示违反约束，问题写入 issue
+    static bool checkStateConstraint(const ValidationRule& rule,
+                                     const ValidationConstraint& c,
+                                     DeviceInstance* device,
+                                     int stateIdx,
+                                     const QVariantMap& vals,
+                                     const QVariantMap& basicVals,
+                                     ValidationIssue& issue);
+    void collectCrossEntries(const ValidationConstraint& c,
+                             bool basicLevel,
+                             DeviceInstance* device,
+                             const QVariantMap& basicVals,
+                             const QList<QVariantMap>& states,
+                             UniqueIndex* unique,
+                             IntervalIndex* intervals);
+    void insertUnique(UniqueIndex& index, const QStringList& values, const Entry& entry);
+    void sweepIntervals(IntervalIndex& index);
+
+    static QVariant lookup(const QVariantMap& vals, const QVariantMap& basicVals, const QString& key);
+    static bool matchWhen(const ValidationConstraint& c, const QVariantMap& vals, const QVariantMap& basicVals);
+    static double number(const QVariantMap& vals, const QVariantMap& basicVals, const QString& key);
+    static ValidationIssue makeIssue(ValidationIssue::Code code, const Entry& entry, const QString& ruleId);
+    static bool isBasicLevel(const EquipmentType* type, const ValidationConstraint& c);
+};
@@ -0,0 +1,94 @@
+﻿#include "ValidationPanel.h"
+#include <QListView>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QWidget>
+
+ValidationIssueModel::ValidationIssueModel(QObject* parent)
+    : QAbstractListModel(parent)
+{
+}
+
+void ValidationIssueModel::setReport(const ValidationReport& report)
+{
+    beginResetModel();
+    m_report = report;
+    endResetModel();
+}
+
+const ValidationIssue* ValidationIssueModel::issueAt(int row) const
+{
+    if (row < 0 || row >= m_report.issues().size()) {
+        return nullptr;
+    }
+    return &m_report.issues().at(row);
+}
+
+int ValidationIssueModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_report.issues().size();
+}
+
+QVariant ValidationIssueModel::data(const QModelIndex& index, int role) const
+{
+    const ValidationIssue* issue = issueAt(index.row());
+    if (!issue) {
+        return QVariant();
+    }
+    switch (role) {
+    case Qt::DisplayRole:
+        return issue->message();
+    case Qt::ToolTipRole:
+        return issue->ruleId.isEmpty()
+            ? QString(u8"%1\n参数: %2").arg(issue->location(), issue->paramId)
+            : QString(u8"%1\n参数: %2\n规则: %3").arg(issue->location(), issue->paramId, issue->ruleId);
+    default:
+        return QVariant();
+    }
+}
+
+ValidationPanel::ValidationPanel(QWidget* parent)
+    : QDockWidget(u8"校验结果", parent)
+{
+    setObjectName(QStringLiteral("validation_panel"));
+
+    QWidget* content = new QWidget(this);
+    QVBoxLayout* layout = new QVBoxLayout(content);
+    layout->setContentsMargins(4, 4, 4, 4);
+
+    m_summaryLabel = new QLabel(u8"尚未校验", content);
+    m_model = new ValidationIssueModel(this);
+    m_view = new QListView(content);
+    m_view->setModel(m_model);
+    m_view->setUniformItemSizes(true); // 大量条目时避免逐行计算尺寸
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setSelectionMode(QAbstractItemView::SingleSelection);
+
+    layout->addWidget(m_summaryLabel);
+    layout->addWidget(m_view, 1);
+    setWidget(content);
+
+    connect(m_view, &QListView::activated, this, [this](const QModelIndex& index) {
+        const ValidationIssue* issue = m_model->issueAt(index.row());
+        if (issue) {
+            emit issueActivated(*issue);
+        }
+    });
+}
+
+void ValidationPanel::setReport(const ValidationReport& report)
+{
+    m_model->setReport(report);
+    if (report.isEmpty()) {
+        m_summaryLabel->setText(u8"校验通过，未发现问题");
+    } else if (report.isTruncated()) {
+        m_summaryLabel->setText(QString(u8"共 %1 条问题，仅列出前 %2 条（双击跳转）")
+                                    .arg(report.totalCount())
+                                    .arg(report.issues().size()));
+    } else {
+        m_summaryLabel->setText(QString(u8"共 %1 条问题（双击跳转）").arg(report.totalCount()));
+    }
+}
@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include "ValidationReport.h"
+#include <QAbstractListModel>
+#include <QDockWidget>
+
+class QListView;
+class QLabel;
+
+// 校验结果列表模型：持有结构化报告，文本只在视图请求显示时格式化。
+class ValidationIssueModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit ValidationIssueModel(QObject* parent = nullptr);
+
+    void setReport(const ValidationReport& report);
+    const ValidationReport& report() const { return m_report; }
+    const ValidationIssue* issueAt(int row) const;
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+private:
+    ValidationReport m_report;
+};
+
+// 可停靠的校验结果面板，双击条目跳转到对应设备/状态的参数编辑器。
+class ValidationPanel : public QDockWidget {
+    Q_OBJECT
+
+public:
+    explicit ValidationPanel(QWidget* parent = nullptr);
+
+    void setReport(const ValidationReport& report);
+
+signals:
+    void issueActivated(const ValidationIssue& issue);
+
+private:
+    ValidationIssueModel* m_model;
+    QListView* m_view;
+    QLabel* m_summaryLabel;
+};
@@ -0,0 +1,122 @@
+﻿#include "ValidationReport.h"
+
+namespace {
+QString entityText(const QString& deviceName, int stateIndex)
+{
+    if (stateIndex < 0) {
+        return QString(u8"设备[%1] 基本参数").arg(deviceName);
+    }
+    return QString(u8"设备[%1] 工作状态%2").arg(deviceName).arg(stateIndex + 1);
+}
+
+QString ruleText(const QString& ruleId)
+{
+    return ruleId.isEmpty() ? QStringLiteral("未知") : ruleId;
+}
+}
+
+QString ValidationIssue::location() const
+{
+    return entityText(deviceName, stateIndex);
+}
+
+QString ValidationIssue::codeName() const
+{
+    switch (code) {
+    case InvalidBasicValue: return QStringLiteral("invalid_basic_value");
+    case InvalidStateValue: return QStringLiteral("invalid_state_value");
+    case NotEqual:          return QStringLiteral("equal");
+    case NotLess:           return QStringLiteral("less");
+    case BelowMin:          return QStringLiteral("min");
+    case EndBelowInterval:  return QStringLiteral("min_end_by_interval");
+    case ListFormat:        return QStringLiteral("list_format");
+    case ListOutOfRange:    return QStringLiteral("list_between");
+    case Duplicate:         return QStringLiteral("unique");
+    case Overlap:           return QStringLiteral("no_overlap");
+    case ExpectFailed:      return QStringLiteral("expect");
+    }
+    return QString();
+}
+
+QString ValidationIssue::message() const
+{
+    const QString prefix = QString(u8"设备[%1] 工作状态%2 规则[%3]")
+                               .arg(deviceName)
+                               .arg(stateIndex + 1)
+                               .arg(ruleText(ruleId));
+    switch (code) {
+    case InvalidBasicValue:
+        return QString(u8"设备[%1] 基本参数[%2] 输入非法或超出范围").arg(deviceName, paramLabel);
+    case InvalidStateValue:
+        return QString(u8"设备[%1] 工作状态%2 参数[%3] 输入非法或超出范围")
+            .arg(deviceName)
+            .arg(stateIndex + 1)
+            .arg(paramLabel);
+    case NotEqual:
+        return QString(u8"%1：%2 与 %3 应相等").arg(prefix, keys.value(0), keys.value(1));
+    case NotLess:
+        return QString(u8"%1：%2 应小于 %3").arg(prefix, keys.value(0), keys.value(1));
+    case BelowMin:
+        return QString(u8"%1：%2 应≥%3").arg(prefix, paramId).arg(v1);
+    case EndBelowInterval:
+        return QString(u8"%1：%2 应≥%3（当前 %4，期望≥%5）")
+            .arg(prefix, paramId)
+            .arg(v1, 0, 'g', 12)
+            .arg(v2, 0, 'g', 12)
+            .arg(v1, 0, 'g', 12);
+    case ListFormat:
+        return QString(u8"%1：%2 频率数组格式错误，应为形如[1,2,3]").arg(prefix, paramId);
+    case ListOutOfRange:
+        return QString(u8"%1：%2 中的频率%3 应在 (%4, %5) 内")
+            .arg(prefix, paramId)
+            .arg(v1, 0, 'g', 12)
+            .arg(v2, 0, 'g', 12)
+            .arg(v3, 0, 'g', 12);
+    case Duplicate:
+        return QString(u8"规则[%1]：%2 的 %3=%4 与 %5 重复")
+            .arg(ruleText(ruleId),
+                 entityText(deviceName, stateIndex),
+                 keys.join('+'),
+                 values.join(','),
+                 entityText(otherDeviceName, otherStateIndex));
+    case Overlap:
+        return QString(u8"规则[%1]：%2 的 %3~%4 区间[%5, %6] 与 %7 的区间[%8, %9] 重叠")
+            .arg(ruleText(ruleId), entityText(deviceName, stateIndex), keys.value(0), keys.value(1))
+            .arg(v1, 0, 'g', 12)
+            .arg(v2, 0, 'g', 12)
+            .arg(entityText(otherDeviceName, otherStateIndex))
+            .arg(v3, 0, 'g', 12)
+            .arg(v4, 0, 'g', 12);
+    case ExpectFailed:
+        return QString(u8"%1：应满足 %2").arg(prefix, expression);
+    }
+    return QString();
+}
+
+void ValidationReport::add(const ValidationIssue& issue)
+{
+    ++m_totalCount;
+    if (m_maxIssues <= 0 || m_issues.size() < m_maxIssues) {
+        m_issues.append(issue);
+    }
+}
+
+void ValidationReport::clear()
+{
+    m_totalCount = 0;
+    m_issues.clear();
+}
+
+QString ValidationReport::summary(int maxLines) const
+{
+    QStringList lines;
+    const int shown = qMin(maxLines, m_issues.size());
+    lines.reserve(shown + 1);
+    for (int i = 0; i < shown; ++i) {
+        lines << m_issues.at(i).message();
+    }
+    if (m_totalCount > shown) {
+        lines << QString(u8"……共 %1 条问题，其余请在“校验结果”面板中查看").arg(m_totalCount);
+    }
+    return lines.join("\n");
+}
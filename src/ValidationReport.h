@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// 单条校验问题：只记录结构化字段，展示文本在需要时才格式化。
+struct ValidationIssue {
+    enum Code {
+        InvalidBasicValue,   // 基本参数非法或超出范围
+        InvalidStateValue,   // 工作状态参数非法或超出范围
+        NotEqual,            // equal
+        NotLess,             // less
+        BelowMin,            // min
+        EndBelowInterval,    // min_end_by_interval
+        ListFormat,          // list_between：数组格式错误
+        ListOutOfRange,      // list_between：频点越界
+        Duplicate,           // unique
+        Overlap,             // no_overlap
+        ExpectFailed         // expect：表达式不成立
+    };
+
+    Code code = InvalidBasicValue;
+    QString typeId;
+    QString deviceId;
+    QString deviceName;
+    int stateIndex = -1;      // -1 表示基本参数
+    QString paramId;          // 定位编辑器用的参数ID
+    QString paramLabel;
+    QString ruleId;
+    QStringList keys;         // 约束引用的参数
+    QStringList values;       // unique 的取值
+    QString expression;       // ExpectFailed 的表达式原文
+    double v1 = 0.0;          // 数值参数，含义随 code 变化
+    double v2 = 0.0;
+    double v3 = 0.0;
+    double v4 = 0.0;
+    QString otherDeviceName;  // Duplicate / Overlap 冲突的另一方
+    int otherStateIndex = -1;
+
+    QString message() const;
+    QString location() const;
+    QString codeName() const; // 稳定的英文标识，供命令行等机器可读输出使用
+};
+
+// 一次校验的结果。最多保留 maxIssues 条（<=0 表示不限制），超出部分只计数，
+// 避免导入异常配置时产生海量条目与格式化开销。
+class ValidationReport {
+public:
+    explicit ValidationReport(int maxIssues = 500) : m_maxIssues(maxIssues) {}
+
+    void add(const ValidationIssue& issue);
+    void clear();
+
+    bool isEmpty() const { return m_totalCount == 0; }
+    bool isTruncated() const { return m_totalCount > m_issues.size(); }
+    int totalCount() const { return m_totalCount; }
+    int maxIssues() const { return m_maxIssues; }
+    void setMaxIssues(int maxIssues) { m_maxIssues = maxIssues; }
+    const QVector<ValidationIssue>& issues() const { return m_issues; }
+
+    // 面向消息框/状态栏的摘要：只格式化前 maxLines 条
+    QString summary(int maxLines = 20) const;
+
+private:
+    int m_maxIssues;
+    int m_totalCount = 0;
+    QVector<ValidationIssue> m_issues;
+};
@@ -0,0 +1,200 @@
+﻿#include "ValidationRule.h"
+#include <QDebug>
+
+QStringList ValidationConstraint::dependencies() const
+{
+    QStringList deps = keys;
+    QStringList whenKeys = when.keys();
+    whenKeys << condition.variables();
+    for (const QString& key : whenKeys) {
+        if (!deps.contains(key)) {
+            deps << key;
+        }
+    }
+    return deps;
+}
+
+ValidationRule::Scope ValidationRule::scopeFromString(const QString& scope)
+{
+    if (scope == "per_device") {
+        return PerDevice;
+    }
+    if (scope == "global") {
+        return Global;
+    }
+    return PerState;
+}
+
+QVector<ValidationRule> ValidationRule::compile(const QJsonArray& rules, const QSet<QString>& knownIds)
+{
+    QVector<ValidationRule> compiled;
+    for (const auto& rv : rules) {
+        QJsonObject ro = rv.toObject();
+        ValidationRule rule;
+        rule.id = ro.value("id").toString();
+        rule.description = ro.value("description").toString();
+        rule.scope = scopeFromString(ro.value("scope").toString());
+
+        QJsonArray constraints = ro.value("constraints").toArray();
+        for (const auto& cv : constraints) {
+            QJsonObject co = cv.toObject();
+
+            // 同一个约束对象可以同时写多种判断，它们共用 when 条件；
+            // when 可以是 参数ID -> 允许取值 的对象，也可以是条件表达式
+            ValidationConstraint base;
+            const QJsonValue whenValue = co.value("when");
+            if (whenValue.isString()) {
+                QString error;
+                if (!base.condition.compile(whenValue.toString(), &error)) {
+                    qDebug() << QString(u8"规则[%1] when 表达式无效，忽略该约束：%2").arg(rule.id, error);
+                    continue;
+                }
+            }
+            QJsonObject whenObj = whenValue.toObject();
+            for (auto it = whenObj.begin(); it != whenObj.end(); ++it) {
+                QStringList allowed;
+                for (const auto& v : it.value().toArray()) {
+                    allowed << v.toString();
+                }
+                base.when.insert(it.key(), allowed);
+            }
+
+            auto pairKeys = [](const QJsonValue& v) {
+                QStringList keys;
+                QJsonArray arr = v.toArray();
+                if (arr.size() == 2) {
+                    keys << arr.at(0).toString() << arr.at(1).toString();
+                }
+                return keys;
+            };
+
+            if (co.contains("equal")) {
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::Equal;
+                c.keys = pairKeys(co.value("equal"));
+                if (c.keys.size() == 2) rule.constraints.append(c);
+            }
+            if (co.contains("less")) {
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::Less;
+                c.keys = pairKeys(co.value("less"));
+                if (c.keys.size() == 2) rule.constraints.append(c);
+            }
+            if (co.contains("min")) {
+                QJsonObject mo = co.value("min").toObject();
+                for (auto it = mo.begin(); it != mo.end(); ++it) {
+                    ValidationConstraint c = base;
+                    c.kind = ValidationConstraint::Min;
+                    c.keys << it.key();
+                    c.threshold = it.value().toDouble();
+                    rule.constraints.append(c);
+                }
+            }
+            if (co.contains("min_end_by_interval")) {
+                QJsonObject mo = co.value("min_end_by_interval").toObject();
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::MinEndByInterval;
+                c.keys << mo.value("start").toString()
+                       << mo.value("end").toString()
+                       << mo.value("count").toString()
+                       << mo.value("interval").toString();
+                rule.constraints.append(c);
+            }
+            if (co.contains("list_between")) {
+                QJsonObject lo = co.value("list_between").toObject();
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::ListBetween;
+                c.keys << lo.value("list").toString()
+                       << lo.value("min_from").toString()
+                       << lo.value("max_from").toString();
+                rule.constraints.append(c);
+            }
+            if (co.contains("expect")) {
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::Expect;
+                QString error;
+                if (c.expect.compile(co.value("expect").toString(), &error)) {
+                    c.keys = c.expect.variables();
+                    rule.constraints.append(c);
+                } else {
+                    qDebug() << QString(u8"规则[%1] expect 表达式无效，忽略：%2").arg(rule.id, error);
+                }
+            }
+            if (co.contains("unique")) {
+                // 兼容 "unique": "id" 与 "unique": ["a", "b"]（组合唯一）
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::Unique;
+                QJsonValue uv = co.value("unique");
+                if (uv.isArray()) {
+                    for (const auto& k : uv.toArray()) {
+                        c.keys << k.toString();
+                    }
+                } else {
+                    c.keys << uv.toString();
+                }
+                c.keys.removeAll(QString());
+                if (!c.keys.isEmpty()) rule.constraints.append(c);
+            }
+            if (co.contains("no_overlap")) {
+                QJsonObject no = co.value("no_overlap").toObject();
+                ValidationConstraint c = base;
+                c.kind = ValidationConstraint::NoOverlap;
+                c.keys << no.value("start").toString() << no.value("end").toString();
+                if (!c.keys.at(0).isEmpty() && !c.keys.at(1).isEmpty()) rule.constraints.append(c);
+            }
+        }
+
+        if (rule.scope == PerState) {
+            // 单个工作状态内无法比较“重复/重叠”，这类约束需要声明 per_device 或 global
+            for (int i = rule.constraints.size() - 1; i >= 0; --i) {
+                if (rule.constraints.at(i).isCrossEntry()) {
+                    qDebug() << QString(u8"规则[%1] 作用范围为 per_state，忽略 unique/no_overlap 约束").arg(rule.id);
+                    rule.constraints.remove(i);
+                }
+            }
+        }
+
+        if (!knownIds.isEmpty()) {
+            // 表达式中拼错的参数ID或漏写引号的取值会被当作参数，加载时报告，不让它恒成立或恒不成立
+            for (int i = rule.constraints.size() - 1; i >= 0; --i) {
+                QStringList unknown;
+                for (const QString& key : rule.constraints.at(i).dependencies()) {
+                    if (!key.isEmpty() && !knownIds.contains(key)) {
+                        unknown << key;
+                    }
+                }
+                if (!unknown.isEmpty()) {
+                    qWarning() << QString(u8"规则[%1] 引用了未知参数 %2，忽略该约束").arg(rule.id, unknown.join(", "));
+                    rule.constraints.remove(i);
+                }
+            }
+        }
+
+        if (!rule.constraints.isEmpty()) {
+            compiled.append(rule);
+        }
+    }
+    return compiled;
+}
+
+ValidationDependencyIndex ValidationDependencyIndex::build(const QVector<ValidationRule>& rules)
+{
+    ValidationDependencyIndex index;
+    for (int r = 0; r < rules.size(); ++r) {
+        const QVector<ValidationConstraint>& constraints = rules.at(r).constraints;
+        for (int c = 0; c < constraints.size(); ++c) {
+            if (constraints.at(c).isCrossEntry()) {
+                continue;
+            }
+            Slot slot;
+            slot.rule = r;
+            slot.constraint = c;
+            const int slotIndex = index.constraintSlots.size();
+            index.constraintSlots.append(slot);
+            for (const QString& key : constraints.at(c).dependencies()) {
+                index.byParameter[key].append(slotIndex);
+            }
+        }
+    }
+    return index;
+}
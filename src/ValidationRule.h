@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "RuleExpression.h"
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QJsonArray>
+#include <QJsonObject>
+
+// validation_rules 的编译结果：模板加载时解析一次，校验时不再遍历 JSON。
+struct ValidationConstraint {
+    enum Kind {
+        Equal,            // keys: a, b
+        Less,             // keys: a, b
+        Min,              // keys: param; threshold
+        MinEndByInterval, // keys: start, end, count, interval
+        ListBetween,      // keys: list, min_from, max_from
+        Unique,           // keys: 组成唯一键的参数（per_device / global）
+        NoOverlap,        // keys: start, end（per_device / global）
+        Expect            // keys: 表达式引用的参数；expect 表达式不成立即违反
+    };
+
+    Kind kind = Equal;
+    QMap<QString, QStringList> when; // 参数ID -> 允许的取值
+    RuleExpression condition;        // when 写成表达式字符串时
+    RuleExpression expect;
+    QStringList keys;
+    double threshold = 0.0;
+
+    // 跨状态/跨设备约束需要建立索引，单状态约束逐状态直接判断
+    bool isCrossEntry() const { return kind == Unique || kind == NoOverlap; }
+    // 约束读取的全部参数：比较的 keys 加上 when 条件引用的参数
+    QStringList dependencies() const;
+};
+
+struct ValidationRule {
+    enum Scope { PerState, PerDevice, Global };
+
+    QString id;
+    QString description;
+    Scope scope = PerState;
+    QVector<ValidationConstraint> constraints;
+
+    // knownIds 为规则可以引用的参数ID（模板参数与基本参数），非空时引用了其他名称的约束报告后忽略
+    static QVector<ValidationRule> compile(const QJsonArray& rules, const QSet<QString>& knownIds = QSet<QString>());
+    static Scope scopeFromString(const QString& scope);
+};
+
+// 编辑时即时校验用的反向依赖索引：参数ID -> 读取该参数的单状态约束槽位。
+// 跨状态/跨设备约束需要全量数据，仍留给保存时的完整校验。
+struct ValidationDependencyIndex {
+    struct Slot {
+        int rule = 0;
+        int constraint = 0;
+    };
+    QVector<Slot> constraintSlots;
+    QHash<QString, QVector<int>> byParameter;
+
+    static ValidationDependencyIndex build(const QVector<ValidationRule>& rules);
+};
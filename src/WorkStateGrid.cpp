@@ -0,0 +1,339 @@
+﻿#include "WorkStateGrid.h"
+#include "DeviceInstance.h"
+#include "EquipmentType.h"
+#include "ParameterFormModel.h"
+#include "ParameterItem.h"
+#include "ParameterRuleSet.h"
+#include "WorkStateTemplate.h"
+#include <QAction>
+#include <QColor>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QItemSelectionModel>
+#include <QLabel>
+#include <QPushButton>
+#include <QSet>
+#include <QTableView>
+#include <QVBoxLayout>
+#include <QDebug>
+
+WorkStateGridModel::WorkStateGridModel(DeviceInstance* device, QObject* parent)
+    : QAbstractTableModel(parent), m_device(device)
+{
+    EquipmentType* equipType = m_device ? m_device->getEquipmentType() : nullptr;
+    if (equipType && equipType->getWorkStateTemplate()) {
+        m_template = equipType->getWorkStateTemplate();
+        m_rules = &m_template->getRules();
+        m_params = m_template->getParameters();
+    }
+    for (int row = 0; row < m_params.size(); ++row) {
+        m_rows.insert(m_params.at(row)->getId(), row);
+    }
+    m_stateCount = m_device ? m_device->getWorkStateCount() : 0;
+}
+
+const ParameterItem* WorkStateGridModel::parameterAt(int row) const
+{
+    return row >= 0 && row < m_params.size() ? m_params.at(row) : nullptr;
+}
+
+QVariant WorkStateGridModel::value(int row, int stateIndex) const
+{
+    const ParameterItem* param = parameterAt(row);
+    if (!param || !m_device) {
+        return QVariant();
+    }
+    const QVariant stored = m_device->getWorkStateValues(stateIndex).value(param->getId());
+    return stored.isValid() ? stored : param->getDefaultValue();
+}
+
+QStringList WorkStateGridModel::options(int row, int stateIndex) const
+{
+    const ParameterItem* param = parameterAt(row);
+    if (!param) {
+        return QStringList();
+    }
+    // 与表单使用同一份编译后的选项规则
+    if (m_rules) {
+        const QStringList opts = m_rules->optionsFor(row, m_device->getWorkStateValues(stateIndex));
+        if (!opts.isEmpty()) {
+            return opts;
+        }
+    }
+    return param->getOptions();
+}
+
+bool WorkStateGridModel::isCellHidden(int row, int stateIndex) const
+{
+    if (!parameterAt(row) || !m_template || stateIndex < 0 || stateIndex >= m_stateCount) {
+        return false;
+    }
+    return hiddenMask(stateIndex).testBit(row);
+}
+
+const QBitArray& WorkStateGridModel::hiddenMask(int stateIndex) const
+{
+    // 与表单使用同一份编译后的规则
+    if (m_hiddenMasks.size() != m_stateCount) {
+        m_hiddenMasks.resize(m_stateCount);
+        m_hiddenMaskValid.fill(false, m_stateCount);
+    }
+    if (!m_hiddenMaskValid.at(stateIndex)) {
+        m_hiddenMasks[stateIndex] = m_template->hiddenMask(m_device->getWorkStateValues(stateIndex));
+        m_hiddenMaskValid[stateIndex] = true;
+    }
+    return m_hiddenMasks.at(stateIndex);
+}
+
+void WorkStateGridModel::invalidateHidden(int stateIndex)
+{
+    if (stateIndex >= 0 && stateIndex < m_hiddenMaskValid.size()) {
+        m_hiddenMaskValid[stateIndex] = false;
+    }
+}
+
+bool WorkStateGridModel::isCellValid(int row, int stateIndex) const
+{
+    const ParameterItem* param = parameterAt(row);
+    if (!param) {
+        return true;
+    }
+    if (param->getType() == "enum") {
+        return options(row, stateIndex).contains(value(row, stateIndex).toString());
+    }
+    return param->validate(value(row, stateIndex));
+}
+
+bool WorkStateGridModel::writeCell(int row, int stateIndex, const QVariant& newValue)
+{
+    const ParameterItem* param = parameterAt(row);
+    if (!param || !m_device || stateIndex < 0 || stateIndex >= m_stateCount) {
+        return false;
+    }
+    const QVariant coerced = param->coerce(newValue);
+    if (value(row, stateIndex) == coerced) {
+        return false;
+    }
+    m_device->setWorkStateValue(stateIndex, param->getId(), coerced);
+    invalidateHidden(stateIndex);
+
+    // 控制参数变化后，目标枚举的取值不在新选项中时改为第一项（与表单行为一致）
+    if (m_rules) {
+        for (int targetRow : m_rules->optionTargets(param->getId())) {
+            const QStringList opts = options(targetRow, stateIndex);
+            if (!opts.isEmpty() && !opts.contains(value(targetRow, stateIndex).toString())) {
+                writeCell(targetRow, stateIndex, opts.first());
+            }
+        }
+    }
+    return true;
+}
+
+int WorkStateGridModel::fillFromState(const QModelIndexList& targets, int sourceState)
+{
+    QSet<int> changedStates;
+    int changed = 0;
+    for (const QModelIndex& target : targets) {
+        const int row = target.row();
+        const int stateIndex = target.column();
+        if (stateIndex == sourceState || isCellHidden(row, stateIndex)) {
+            continue;
+        }
+        const QVariant source = value(row, sourceState);
+        const ParameterItem* param = parameterAt(row);
+        if (param && param->getType() == "enum" && !options(row, stateIndex).contains(source.toString())) {
+            continue; // 目标状态当前不允许该选项
+        }
+        if (writeCell(row, stateIndex, source)) {
+            changedStates.insert(stateIndex);
+            ++changed;
+        }
+    }
+    for (int stateIndex : changedStates) {
+        emit dataChanged(index(0, stateIndex), index(m_params.size() - 1, stateIndex));
+        emit stateValuesChanged(stateIndex);
+    }
+    return changed;
+}
+
+void WorkStateGridModel::resetStates()
+{
+    beginResetModel();
+    m_stateCount = m_device ? m_device->getWorkStateCount() : 0;
+    m_hiddenMasks.clear();
+    m_hiddenMaskValid.clear();
+    endResetModel();
+}
+
+void WorkStateGridModel::refreshState(int stateIndex)
+{
+    invalidateHidden(stateIndex);
+    if (stateIndex >= 0 && stateIndex < m_stateCount && !m_params.isEmpty()) {
+        emit dataChanged(index(0, stateIndex), index(m_params.size() - 1, stateIndex));
+    }
+}
+
+int WorkStateGridModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_params.size();
+}
+
+int WorkStateGridModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_stateCount;
+}
+
+QVariant WorkStateGridModel::data(const QModelIndex& index, int role) const
+{
+    const ParameterItem* param = parameterAt(index.row());
+    if (!param || index.column() >= m_stateCount) {
+        return QVariant();
+    }
+    const int row = index.row();
+    const int stateIndex = index.column();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        return ParameterDelegate::displayText(param->getType(), value(row, stateIndex));
+    case Qt::EditRole:
+        return value(row, stateIndex);
+    case Qt::ForegroundRole:
+        return isCellHidden(row, stateIndex) ? QVariant(QColor("#94a3b8")) : QVariant();
+    case Qt::BackgroundRole:
+        return isCellValid(row, stateIndex) ? QVariant() : QVariant(QColor("#fef2f2"));
+    case Qt::ToolTipRole:
+        if (isCellHidden(row, stateIndex)) {
+            return QString(u8"该状态下此参数被可见性规则隐藏");
+        }
+        return isCellValid(row, stateIndex) ? QVariant()
+                                            : QVariant(QString(u8"%1 输入非法或超出范围").arg(param->getLabel()));
+    case ParameterDelegate::TypeRole:
+        return param->getType();
+    case ParameterDelegate::MinimumRole:
+        return param->getMinValue();
+    case ParameterDelegate::MaximumRole:
+        return param->getMaxValue();
+    case ParameterDelegate::OptionsRole:
+        return options(row, stateIndex);
+    case ParameterDelegate::InvalidRole:
+        return !isCellValid(row, stateIndex);
+    default:
+        return QVariant();
+    }
+}
+
+bool WorkStateGridModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (role != Qt::EditRole || !index.isValid() || !writeCell(index.row(), index.column(), value)) {
+        return false;
+    }
+    // 同列其他参数的可见性与选项可能随之变化，整列刷新
+    refreshState(index.column());
+    emit stateValuesChanged(index.column());
+    return true;
+}
+
+Qt::ItemFlags WorkStateGridModel::flags(const QModelIndex& index) const
+{
+    const ParameterItem* param = parameterAt(index.row());
+    if (!param) {
+        return Qt::NoItemFlags;
+    }
+    Qt::ItemFlags result = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    const QString type = param->getType();
+    if (!isCellHidden(index.row(), index.column()) &&
+        (type == "int" || type == "Byte" || type == "double" || type == "string" || type == "enum")) {
+        result |= Qt::ItemIsEditable;
+    }
+    return result;
+}
+
+QVariant WorkStateGridModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole && role != Qt::ToolTipRole) {
+        return QVariant();
+    }
+    if (orientation == Qt::Horizontal) {
+        const QStringList titles = m_template ? m_template->getStateTabTitles() : QStringList();
+        return section < titles.size() && !titles.at(section).isEmpty() ? titles.at(section)
+                                                                        : QString(u8"工作状态 %1").arg(section + 1);
+    }
+    const ParameterItem* param = parameterAt(section);
+    if (!param) {
+        return QVariant();
+    }
+    if (role == Qt::ToolTipRole) {
+        return param->getId();
+    }
+    return param->getUnit().isEmpty() ? param->getLabel()
+                                      : QString("%1 (%2)").arg(param->getLabel(), param->getUnit());
+}
+
+WorkStateGridWidget::WorkStateGridWidget(DeviceInstance* device, QWidget* parent)
+    : QWidget(parent)
+{
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    m_model = new WorkStateGridModel(device, this);
+    m_view = new QTableView(this);
+    m_view->setModel(m_model);
+    m_view->setItemDelegate(new ParameterDelegate(m_view));
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_view->setSelectionBehavior(QAbstractItemView::SelectItems);
+    m_view->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed |
+                            QAbstractItemView::AnyKeyPressed);
+    m_view->setWordWrap(false);
+    m_view->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_view->horizontalHeader()->setDefaultSectionSize(110);
+
+    // 整列/整行选择后即可填充
+    QAction* fillAction = new QAction(u8"用当前列填充所选单元格", m_view);
+    fillAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_D));
+    fillAction->setShortcutContext(Qt::WidgetShortcut);
+    connect(fillAction, &QAction::triggered, this, &WorkStateGridWidget::fillSelection);
+    QAction* copyAction = new QAction(u8"复制当前列到全部状态", m_view);
+    connect(copyAction, &QAction::triggered, this, &WorkStateGridWidget::copyCurrentStateToAll);
+    m_view->addAction(fillAction);
+    m_view->addAction(copyAction);
+    m_view->setContextMenuPolicy(Qt::ActionsContextMenu);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout;
+    QLabel* hintLabel = new QLabel(u8"双击单元格编辑；选中若干单元格后可用当前列（焦点所在状态）的取值填充");
+    hintLabel->setWordWrap(true);
+    QPushButton* fillButton = new QPushButton(fillAction->text());
+    connect(fillButton, &QPushButton::clicked, fillAction, &QAction::trigger);
+    QPushButton* copyButton = new QPushButton(copyAction->text());
+    connect(copyButton, &QPushButton::clicked, copyAction, &QAction::trigger);
+    buttonLayout->addWidget(hintLabel, 1);
+    buttonLayout->addWidget(fillButton);
+    buttonLayout->addWidget(copyButton);
+
+    mainLayout->addLayout(buttonLayout);
+    mainLayout->addWidget(m_view, 1);
+}
+
+void WorkStateGridWidget::fillSelection()
+{
+    const QModelIndex current = m_view->currentIndex();
+    if (!current.isValid()) {
+        return;
+    }
+    const int changed = m_model->fillFromState(m_view->selectionModel()->selectedIndexes(), current.column());
+    qDebug() << QString(u8"表格填充：从工作状态 %1 填充 %2 个单元格").arg(current.column() + 1).arg(changed);
+}
+
+void WorkStateGridWidget::copyCurrentStateToAll()
+{
+    const QModelIndex current = m_view->currentIndex();
+    if (!current.isValid()) {
+        return;
+    }
+    QModelIndexList targets;
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        for (int column = 0; column < m_model->columnCount(); ++column) {
+            targets.append(m_model->index(row, column));
+        }
+    }
+    const int changed = m_model->fillFromState(targets, current.column());
+    qDebug() << QString(u8"表格复制：工作状态 %1 复制到全部状态，修改 %2 个单元格").arg(current.column() + 1).arg(changed);
+}
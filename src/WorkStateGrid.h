@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <QAbstractTableModel>
+#include <QBitArray>
+#include <QHash>
+#include <QWidget>
+#include <QList>
+#include <QModelIndexList>
+#include <QStringList>
+#include <QVector>
+
+class DeviceInstance;
+class ParameterItem;
+class ParameterRuleSet;
+class WorkStateTemplate;
+class QTableView;
+
+// 单台设备全部工作状态的表格模型：行 = 模板参数，列 = 工作状态。
+// 取值直接读写 DeviceInstance；类型、范围与可选项通过 ParameterDelegate 的角色提供，
+// 选项联动与可见性规则按列（状态）分别计算，被规则隐藏的单元格置灰且不可编辑。
+class WorkStateGridModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    explicit WorkStateGridModel(DeviceInstance* device, QObject* parent = nullptr);
+
+    const ParameterItem* parameterAt(int row) const;
+    QVariant value(int row, int stateIndex) const;
+    QStringList options(int row, int stateIndex) const;
+    bool isCellHidden(int row, int stateIndex) const;
+    bool isCellValid(int row, int stateIndex) const;
+
+    // 用 sourceState 列同一参数的取值填充 targets 中的单元格，一次性通知；返回实际修改的单元格数
+    int fillFromState(const QModelIndexList& targets, int sourceState);
+
+    // 状态数量变化后重建列；某个状态在表格之外被修改后刷新该列
+    void resetStates();
+    void refreshState(int stateIndex);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    // 表格中的编辑写入设备后按状态通知一次，供对应的状态页刷新
+    void stateValuesChanged(int stateIndex);
+
+private:
+    DeviceInstance* m_device;
+    const WorkStateTemplate* m_template = nullptr;
+    const ParameterRuleSet* m_rules = nullptr; // 模板编译后的联动规则，与表单共用
+    QList<ParameterItem*> m_params;
+    QHash<QString, int> m_rows;
+    int m_stateCount = 0;
+    // 每个状态被可见性规则隐藏的行，按需计算；该状态取值变化或状态数量变化时失效
+    mutable QVector<QBitArray> m_hiddenMasks;
+    mutable QVector<bool> m_hiddenMaskValid;
+
+    const QBitArray& hiddenMask(int stateIndex) const;
+    void invalidateHidden(int stateIndex);
+    int rowOf(const QString& parameterId) const { return m_rows.value(parameterId, -1); }
+    bool writeCell(int row, int stateIndex, const QVariant& value);
+};
+
+// 设备的“全部状态”页：一张表格替代逐个状态页签的表单，支持整列复制与批量填充
+class WorkStateGridWidget : public QWidget {
+    Q_OBJECT
+
+public:
+    explicit WorkStateGridWidget(DeviceInstance* device, QWidget* parent = nullptr);
+
+    WorkStateGridModel* model() const { return m_model; }
+
+private slots:
+    void fillSelection();
+    void copyCurrentStateToAll();
+
+private:
+    WorkStateGridModel* m_model;
+    QTableView* m_view;
+};
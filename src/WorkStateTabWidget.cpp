@@ -1,224 +1,78 @@
 ﻿#include "WorkStateTabWidget.h"
 #include "ParameterItem.h"
+#include "ParameterFormModel.h"
 #include "EquipmentConfigWidget.h"
+#include "ValidationEngine.h"
+#include "AtomicFileWriter.h"
+#include "JsonWriter.h"
 #include <QVBoxLayout>
-#include <QFormLayout>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QGroupBox>
 #include <QPushButton>
 #include <QTimer>
-#include <QComboBox>
-#include <QSignalBlocker>
 #include <QDebug>
 #include <QFileDialog>
-#include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
-#include <QFile>
 #include <QMessageBox>
+#include <QElapsedTimer>
+
+namespace {
+// 即时校验的防抖间隔：连续输入期间只记录变化，停顿后统一检查
+const int kLiveValidationDelayMs = 300;
+}
 
 WorkStateTabWidget::WorkStateTabWidget(DeviceInstance* device, int stateIndex, const QString& displayTitle, QWidget* parent)
-    : QScrollArea(parent), m_device(device), m_stateIndex(stateIndex), m_displayTitle(displayTitle), m_saveButton(nullptr)
+    : QWidget(parent), m_device(device), m_stateIndex(stateIndex), m_displayTitle(displayTitle), m_saveButton(nullptr)
 {
-    setWidgetResizable(true);
-    setHorizontalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
+    m_validationTimer = new QTimer(this);
+    m_validationTimer->setSingleShot(true);
+    m_validationTimer->setInterval(kLiveValidationDelayMs);
+    connect(m_validationTimer, &QTimer::timeout, this, &WorkStateTabWidget::runLiveValidation);
     
     createParameterWidgets();
     createSaveButton();
+    
+    // 打开页签后先对全部参数做一次即时校验，已有错误直接标出
+    if (m_model) {
+        for (const ParameterItem* param : m_model->parameters()) {
+            scheduleValidation(param->getId());
+        }
+    }
 }
 
 void WorkStateTabWidget::createParameterWidgets()
 {
-    m_contentWidget = new QWidget;
-    QVBoxLayout* mainLayout = new QVBoxLayout(m_contentWidget);
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
     
     if (!m_device || !m_device->getEquipmentType() || !m_device->getEquipmentType()->getWorkStateTemplate()) {
         QLabel* errorLabel = new QLabel(u8"无工作状态模板");
         mainLayout->addWidget(errorLabel);
-        setWidget(m_contentWidget);
+        mainLayout->addStretch();
         return;
     }
     
-    WorkStateTemplate* tmpl = m_device->getEquipmentType()->getWorkStateTemplate();
-    
     // 创建参数组
     QString groupTitle = m_displayTitle.isEmpty() ? QString(u8"工作状态 %1 参数").arg(m_stateIndex + 1)
                                                   : QString(u8"%1 参数").arg(m_displayTitle);
     QGroupBox* paramGroup = new QGroupBox(groupTitle);
-    QFormLayout* formLayout = new QFormLayout(paramGroup);
-    
-    // 获取当前状态的值
-    QVariantMap currentValues = m_device->getWorkStateValues(m_stateIndex);
-    
-    // 为每个参数创建独立的编辑器
-    const auto& templateParameters = tmpl->getParameters();
-    for (ParameterItem* templateParam : templateParameters) {
-        // 为每个工作状态创建独立的ParameterItem实例
-        ParameterItem* param = new ParameterItem(templateParam->getId(), 
-                                                 templateParam->getLabel(), 
-                                                 templateParam->getType());
-        param->setParent(this);
-        param->setUnit(templateParam->getUnit());
-        param->setDefaultValue(templateParam->getDefaultValue());
-        
-        // 复制约束条件
-        if (templateParam->getType() == "int" || templateParam->getType() == "double") {
-            param->setRange(templateParam->getMinValue(), templateParam->getMaxValue());
-        } else if (templateParam->getType() == "enum") {
-            param->setOptions(templateParam->getOptions());
-        }
-        
-        QWidget* editor = param->createEditor(paramGroup);
-        
-        // 设置当前值
-        QVariant valueToSet;
-        if (currentValues.contains(param->getId())) {
-            valueToSet = currentValues[param->getId()];
-        } else {
-            valueToSet = param->getDefaultValue();
-            // 如果没有值，设置默认值到设备实例中
-            currentValues[param->getId()] = valueToSet;
-        }
-        
-        param->setValue(valueToSet);
-        
-        QString labelText = param->getLabel();
-        if (!param->getUnit().isEmpty()) {
-            labelText += QString(" (%1)").arg(param->getUnit());
-        }
-        QLabel* labelWidget = new QLabel(labelText);
-        QWidget* rowContainer = new QWidget(paramGroup);
-        QHBoxLayout* rowLayout = new QHBoxLayout(rowContainer);
-        rowLayout->setContentsMargins(0, 0, 0, 0);
-        rowLayout->setSpacing(8);
-        rowLayout->addWidget(labelWidget);
-        rowLayout->addWidget(editor, 1);
-        formLayout->addRow(rowContainer);
-        
-        // 存储参数引用以便后续更新
-        m_parameterInstances[param->getId()] = param;
-        m_labelWidgets[param->getId()] = labelWidget;
-        m_rowWidgets[param->getId()] = rowContainer;
-        
-        qDebug() << QString(u8"创建参数编辑器: %1, 值: %2").arg(param->getLabel()).arg(valueToSet.toString());
-    }
-    
-    // 统一标签宽度，确保对齐
-    int maxLabelWidth = 0;
-    for (auto it = m_labelWidgets.begin(); it != m_labelWidgets.end(); ++it) {
-        maxLabelWidth = qMax(maxLabelWidth, it.value()->sizeHint().width());
-    }
-    for (auto it = m_labelWidgets.begin(); it != m_labelWidgets.end(); ++it) {
-        it.value()->setMinimumWidth(maxLabelWidth);
-        it.value()->setMaximumWidth(maxLabelWidth);
-    }
-    
-    // 确保设备实例有这个状态的值
-    if (!currentValues.isEmpty()) {
-        m_device->setWorkStateValues(m_stateIndex, currentValues);
-    }
+    QVBoxLayout* groupLayout = new QVBoxLayout(paramGroup);
     
-    mainLayout->addWidget(paramGroup);
-    mainLayout->addStretch();
+    // 模型计算可见性/选项联动；编辑器只在编辑某个单元格时由委托创建
+    m_model = new ParameterFormModel(m_device, m_stateIndex, this);
+    m_view = new ParameterFormView(m_model, paramGroup);
+    groupLayout->addWidget(m_view);
+    connect(m_model, &ParameterFormModel::valueChanged, this, &WorkStateTabWidget::scheduleValidation);
+    connect(m_model, &ParameterFormModel::valueChanged, this, &WorkStateTabWidget::parameterChanged);
     
-    setWidget(m_contentWidget);
-    
-    // 启动定时器定期更新状态值
-    QTimer* updateTimer = new QTimer(this);
-    connect(updateTimer, &QTimer::timeout, this, &WorkStateTabWidget::updateStateValues);
-    updateTimer->start(1000); // 每秒更新一次
-    
-    // 可见性规则联动
-    const auto& rules = tmpl->getVisibilityRules();
-    for (const auto& rule : rules) {
-        ParameterItem* controllerParam = m_parameterInstances.value(rule.controllerId, nullptr);
-        if (!controllerParam) {
-            continue;
-        }
-        QComboBox* controllerBox = qobject_cast<QComboBox*>(controllerParam->createEditor(paramGroup));
-        if (!controllerBox) {
-            continue;
-        }
-        
-        auto applyRule = [this, rule](const QString& currentValue) {
-            // 找到匹配的case
-            QStringList showIds;
-            for (const auto& c : rule.cases) {
-                if (c.value == currentValue) {
-                    showIds = c.showIds;
-                    break;
-                }
-            }
-            // 如果没有匹配，默认全部显示
-            bool hideOthers = !showIds.isEmpty();
-            for (const QString& pid : rule.affectedIds) {
-                if (!m_parameterInstances.contains(pid)) {
-                    continue;
-                }
-                bool visible = !hideOthers || showIds.contains(pid);
-                m_parameterInstances[pid]->setVisible(visible);
-                if (m_labelWidgets.contains(pid)) {
-                    m_labelWidgets[pid]->setVisible(visible);
-                }
-                if (m_rowWidgets.contains(pid)) {
-                    m_rowWidgets[pid]->setVisible(visible);
-                }
-            }
-        };
-        
-        connect(controllerBox, &QComboBox::currentTextChanged, this, applyRule);
-        // 初始化一次
-        applyRule(controllerParam->getValue().toString());
-    }
-    
-    // 选项联动规则：根据控制项值刷新目标枚举的可选项
-    const auto& optionRules = tmpl->getOptionRules();
-    for (const auto& rule : optionRules) {
-        ParameterItem* controllerParam = m_parameterInstances.value(rule.controllerId, nullptr);
-        ParameterItem* targetParam = m_parameterInstances.value(rule.targetId, nullptr);
-        if (!controllerParam || !targetParam) {
-            continue;
-        }
-        QComboBox* controllerBox = qobject_cast<QComboBox*>(controllerParam->createEditor(paramGroup));
-        QComboBox* targetBox = qobject_cast<QComboBox*>(targetParam->createEditor(paramGroup));
-        if (!controllerBox || !targetBox) {
-            continue;
-        }
-        
-        auto applyOptions = [targetParam, targetBox, rule](const QString& currentValue) {
-            QStringList opts = rule.optionsByValue.value(currentValue);
-            if (opts.isEmpty()) {
-                return; // 没有匹配时保持现有选项
-            }
-            const QSignalBlocker blocker(targetBox);
-            targetBox->clear();
-            targetBox->addItems(opts);
-            targetParam->setOptions(opts);
-            QString current = targetParam->getValue().toString();
-            int idx = opts.indexOf(current);
-            if (idx < 0 && !opts.isEmpty()) {
-                targetParam->setValue(opts.first());
-                targetBox->setCurrentIndex(0);
-            } else if (idx >= 0) {
-                targetBox->setCurrentIndex(idx);
-            }
-        };
-        
-        connect(controllerBox, &QComboBox::currentTextChanged, this, applyOptions);
-        applyOptions(controllerParam->getValue().toString());
-    }
+    mainLayout->addWidget(paramGroup, 1);
 }
 
 void WorkStateTabWidget::createSaveButton()
 {
-    if (!m_contentWidget) {
-        return;
-    }
-    
-    QVBoxLayout* mainLayout = qobject_cast<QVBoxLayout*>(m_contentWidget->layout());
-    if (!mainLayout) {
+    QVBoxLayout* mainLayout = qobject_cast<QVBoxLayout*>(layout());
+    if (!mainLayout || !m_model) {
         return;
     }
     
@@ -233,20 +87,118 @@ void WorkStateTabWidget::createSaveButton()
     buttonLayout->addWidget(m_saveButton);
     buttonLayout->addStretch();
     
-    // 插入到最后一个stretch之前
-    mainLayout->insertLayout(mainLayout->count() - 1, buttonLayout);
+    mainLayout->addLayout(buttonLayout);
 }
 
-void WorkStateTabWidget::onParameterValueChanged()
+void WorkStateTabWidget::focusParameter(const QString& parameterId)
 {
-    updateStateValues();
+    if (m_view) {
+        m_view->focusParameter(parameterId);
+    }
 }
 
-void WorkStateTabWidget::onSaveButtonClicked()
+void WorkStateTabWidget::refreshValues()
 {
-    // 先更新当前值
-    updateStateValues();
+    if (!m_model) {
+        return;
+    }
+    m_model->refresh();
+    for (const ParameterItem* param : m_model->parameters()) {
+        scheduleValidation(param->getId());
+    }
+}
+
+void WorkStateTabWidget::scheduleValidation(const QString& parameterId)
+{
+    // 输入过程中只做集合插入与定时器重启，保证每次按键的开销为常数
+    m_pendingValidationIds.insert(parameterId);
+    m_validationTimer->start();
+}
+
+void WorkStateTabWidget::runLiveValidation()
+{
+    if (!m_device || m_pendingValidationIds.isEmpty()) {
+        return;
+    }
+    WorkStateTemplate* tmpl = m_device->getEquipmentType() ? m_device->getEquipmentType()->getWorkStateTemplate() : nullptr;
+    if (!tmpl) {
+        return;
+    }
     
+    QElapsedTimer timer;
+    timer.start();
+    
+    // 通过反向依赖索引找出读取了变化参数的约束，同时做单字段校验
+    const ValidationDependencyIndex& deps = tmpl->getValidationDependencies();
+    QSet<int> affectedSlots;
+    for (const QString& pid : m_pendingValidationIds) {
+        for (int slotIndex : deps.byParameter.value(pid)) {
+            affectedSlots.insert(slotIndex);
+        }
+        const int row = m_model ? m_model->rowOf(pid) : -1;
+        if (row >= 0) {
+            if (m_model->validateRow(row)) {
+                m_fieldErrors.remove(pid);
+            } else {
+                m_fieldErrors.insert(pid, QString(u8"%1 输入非法或超出范围").arg(m_model->parameterAt(row)->getLabel()));
+            }
+        }
+    }
+    m_pendingValidationIds.clear();
+    
+    if (!affectedSlots.isEmpty()) {
+        // 编辑提交时已写回设备实例，直接使用设备中的取值
+        const QVariantMap currentValues = m_device->getWorkStateValues(m_stateIndex);
+        for (int slotIndex : affectedSlots) {
+            m_liveIssues.remove(slotIndex);
+        }
+        const QHash<int, ValidationIssue> failed =
+            ValidationEngine::checkStateSlots(m_device, m_stateIndex, currentValues, affectedSlots);
+        for (auto it = failed.constBegin(); it != failed.constEnd(); ++it) {
+            m_liveIssues.insert(it.key(), it.value());
+        }
+    }
+    
+    refreshInvalidMarks();
+    
+    if (timer.elapsed() > 16) {
+        qDebug() << QString(u8"即时校验耗时 %1 ms（约束 %2 条）").arg(timer.elapsed()).arg(affectedSlots.size());
+    }
+}
+
+void WorkStateTabWidget::refreshInvalidMarks()
+{
+    // 汇总每个参数的问题描述：约束问题标记到约束引用的全部参数上
+    QHash<QString, QStringList> messages;
+    for (auto it = m_fieldErrors.constBegin(); it != m_fieldErrors.constEnd(); ++it) {
+        messages[it.key()] << it.value();
+    }
+    for (auto it = m_liveIssues.constBegin(); it != m_liveIssues.constEnd(); ++it) {
+        const ValidationIssue& issue = it.value();
+        const QString text = issue.message();
+        const QStringList keys = issue.keys.isEmpty() ? QStringList(issue.paramId) : issue.keys;
+        for (const QString& key : keys) {
+            if (m_model->rowOf(key) >= 0) {
+                messages[key] << text;
+            }
+        }
+    }
+    
+    QSet<QString> newInvalid;
+    for (auto it = messages.constBegin(); it != messages.constEnd(); ++it) {
+        newInvalid.insert(it.key());
+        m_model->setInvalid(it.key(), true, it.value().join("\n"));
+    }
+    for (const QString& pid : m_invalidIds) {
+        if (!newInvalid.contains(pid)) {
+            m_model->setInvalid(pid, false);
+        }
+    }
+    m_invalidIds = newInvalid;
+}
+
+void WorkStateTabWidget::onSaveButtonClicked()
+{
     // 获取主配置Widget来执行自动保存
     EquipmentConfigWidget* mainConfig = nullptr;
     QWidget* parent = this->parentWidget();
@@ -260,12 +212,8 @@ void WorkStateTabWidget::onSaveButtonClicked()
     
     if (mainConfig) {
         if (mainConfig->hasCurrentFile()) {
-            // 自动保存到当前文件
-            if (mainConfig->autoSave()) {
-                QMessageBox::information(this, u8"保存成功", 
-                                         QString(u8"工作状态 %1 已保存到当前配置文件")
-                                             .arg(m_stateIndex + 1));
-            }
+            // 自动保存到当前文件，写盘在后台完成，结果显示在主窗口状态栏
+            mainConfig->autoSave();
         } else {
             // 如果没有当前文件，提供单独保存选项
             QString fileName = QFileDialog::getSaveFileName(this, 
@@ -289,9 +237,6 @@ void WorkStateTabWidget::onSaveButtonClicked()
 
 bool WorkStateTabWidget::saveStateToJson(const QString& fileName)
 {
-    // 先更新当前值
-    updateStateValues();
-    
     QJsonObject rootObj;
     QJsonObject stateObj;
     
@@ -304,20 +249,20 @@ bool WorkStateTabWidget::saveStateToJson(const QString& fileName)
     QJsonObject valuesObj;
     QVariantMap currentValues = m_device->getWorkStateValues(m_stateIndex);
     for (auto it = currentValues.begin(); it != currentValues.end(); ++it) {
-        valuesObj[it.key()] = it.value().toString();
+        valuesObj[it.key()] = JsonWriter::fromVariant(it.value());
     }
     stateObj["parameter_values"] = valuesObj;
     
     // 保存参数定义（方便查看）
     QJsonArray paramDefsArray;
-    for (auto it = m_parameterInstances.begin(); it != m_parameterInstances.end(); ++it) {
-        ParameterItem* param = it.value();
+    for (int row = 0; m_model && row < m_model->rowCount(); ++row) {
+        const ParameterItem* param = m_model->parameterAt(row);
         QJsonObject paramObj;
         paramObj["id"] = param->getId();
         paramObj["label"] = param->getLabel();
         paramObj["type"] = param->getType();
         paramObj["unit"] = param->getUnit();
-        paramObj["current_value"] = param->getValue().toString();
+        paramObj["current_value"] = JsonWriter::fromVariant(m_model->value(row));
         
         paramDefsArray.append(paramObj);
     }
@@ -326,35 +271,12 @@ bool WorkStateTabWidget::saveStateToJson(const QString& fileName)
     rootObj["work_state"] = stateObj;
     
     // 写入文件
-    QFile file(fileName);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(this, u8"保存失败", 
-                             QString(u8"无法创建文件: %1").arg(fileName));
+    QString error;
+    if (!AtomicFileWriter::writeFile(fileName, JsonWriter::toJson(rootObj), &error)) {
+        QMessageBox::warning(this, u8"保存失败", error);
         return false;
     }
     
-    QJsonDocument doc(rootObj);
-    file.write(doc.toJson());
-    file.close();
-    
     qDebug() << QString(u8"工作状态 %1 保存完成: %2").arg(m_stateIndex + 1).arg(fileName);
     return true;
 }
-
-void WorkStateTabWidget::updateStateValues()
-{
-    if (!m_device) {
-        return;
-    }
-    
-    QVariantMap newValues;
-    
-    // 收集所有参数的当前值
-    for (auto it = m_parameterInstances.begin(); it != m_parameterInstances.end(); ++it) {
-        ParameterItem* param = it.value();
-        newValues[param->getId()] = param->getValue();
-    }
-    
-    // 更新设备实例中的状态值
-    m_device->setWorkStateValues(m_stateIndex, newValues);
-} 
@@ -1,41 +1,55 @@
 ﻿#pragma once
 
 #include "DeviceInstance.h"
-#include <QScrollArea>
+#include "ValidationReport.h"
 #include <QWidget>
-#include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QPushButton>
 
-class ParameterItem;
 class EquipmentConfigWidget;
-class QLabel;
+class ParameterFormModel;
+class ParameterFormView;
+class QTimer;
 
-class WorkStateTabWidget : public QScrollArea {
+class WorkStateTabWidget : public QWidget {
     Q_OBJECT
 
 public:
     explicit WorkStateTabWidget(DeviceInstance* device, int stateIndex, const QString& displayTitle, QWidget* parent = nullptr);
+    
+    int getStateIndex() const { return m_stateIndex; }
+    void focusParameter(const QString& parameterId);
+    // 设备取值在本页之外被修改后刷新显示
+    void refreshValues();
+
+public slots:
+    // 记录发生变化的参数，防抖后只重新检查读取了这些参数的约束
+    void scheduleValidation(const QString& parameterId);
 
 signals:
     void parameterChanged(const QString& parameterId, const QVariant& value);
     void saveRequested(int stateIndex);
 
 private slots:
-    void onParameterValueChanged();
     void onSaveButtonClicked();
+    void runLiveValidation();
 
 private:
     DeviceInstance* m_device;
     int m_stateIndex;
     QString m_displayTitle;
-    QWidget* m_contentWidget;
-    QMap<QString, ParameterItem*> m_parameterInstances; // 存储每个参数的实例
-    QMap<QString, QLabel*> m_labelWidgets; // 存储label以便联动显隐
-    QMap<QString, QWidget*> m_rowWidgets; // 存储行容器以便整体显隐
+    ParameterFormModel* m_model = nullptr; // 取值直接读写设备实例
+    ParameterFormView* m_view = nullptr;   // 只为正在编辑的单元格创建编辑器
     QPushButton* m_saveButton;
+    QTimer* m_validationTimer;
+    QSet<QString> m_pendingValidationIds; // 等待即时校验的参数
+    QHash<int, ValidationIssue> m_liveIssues; // 约束槽位 -> 当前违反的问题
+    QHash<QString, QString> m_fieldErrors; // 参数ID -> 单字段校验失败原因
+    QSet<QString> m_invalidIds; // 当前已标红的参数
     
     void createParameterWidgets();
-    void updateStateValues();
     void createSaveButton();
     bool saveStateToJson(const QString& fileName);
+    void refreshInvalidMarks();
 }; 
@@ -3,6 +3,7 @@
 #include <QFormLayout>
 #include <QLabel>
 #include <QJsonArray>
+#include <QElapsedTimer>
 #include <QDebug>
 
 WorkStateTemplate::WorkStateTemplate(const QString& templateId, const QString& name)
@@ -90,7 +91,7 @@ void WorkStateTemplate::setStateValues(int stateIndex, const QVariantMap& values
     }
 }
 
-WorkStateTemplate* WorkStateTemplate::fromJson(const QJsonObject& json)
+WorkStateTemplate* WorkStateTemplate::fromJson(const QJsonObject& json, const QList<ParameterItem*>& basicParameters)
 {
     QString templateId = json["template_id"].toString();
     QString name = json.contains("template_name") ? json["template_name"].toString() : json["name"].toString();
@@ -108,65 +109,34 @@ WorkStateTemplate* WorkStateTemplate::fromJson(const QJsonObject& json)
         }
     }
     
-    // 可见性规则：controller -> cases(value -> showIds)
-    if (json.contains("visibility_rules")) {
-        QJsonArray rules = json["visibility_rules"].toArray();
-        for (const auto& ruleVal : rules) {
-            QJsonObject ruleObj = ruleVal.toObject();
-            VisibilityRule rule;
-            rule.controllerId = ruleObj["controller"].toString();
-            
-            if (ruleObj.contains("cases")) {
-                QJsonArray cases = ruleObj["cases"].toArray();
-                for (const auto& caseVal : cases) {
-                    QJsonObject caseObj = caseVal.toObject();
-                    VisibilityCase c;
-                    c.value = caseObj["value"].toString();
-                    if (caseObj.contains("show")) {
-                        QJsonArray showArray = caseObj["show"].toArray();
-                        for (const auto& sid : showArray) {
-                            c.showIds << sid.toString();
-                            rule.affectedIds.insert(sid.toString());
-                        }
-                    }
-                    rule.cases.append(c);
-                }
-            }
-            
-            if (!rule.controllerId.isEmpty() && !rule.cases.isEmpty()) {
-                tmpl->m_visibilityRules.append(rule);
-            }
+    // 可见性与选项规则，按模板参数编译
+    QElapsedTimer compileTimer;
+    compileTimer.start();
+    tmpl->m_rules.load(json, tmpl->m_parameters);
+
+    // 校验规则：保留原始 JSON 便于序列化，同时编译一份供校验引擎直接使用
+    if (json.contains("validation_rules")) {
+        tmpl->m_validationRules = json["validation_rules"].toArray();
+        QSet<QString> knownIds;
+        for (const ParameterItem* param : tmpl->m_parameters + basicParameters) {
+            knownIds.insert(param->getId());
         }
+        tmpl->m_compiledValidationRules = ValidationRule::compile(tmpl->m_validationRules, knownIds);
+        tmpl->m_validationDependencies = ValidationDependencyIndex::build(tmpl->m_compiledValidationRules);
     }
-    
-    // 选项规则：controller -> target -> options
-    if (json.contains("option_rules")) {
-        QJsonArray rules = json["option_rules"].toArray();
-        for (const auto& ruleVal : rules) {
-            QJsonObject ruleObj = ruleVal.toObject();
-            OptionRule rule;
-            rule.controllerId = ruleObj["controller"].toString();
-            rule.targetId = ruleObj["target"].toString();
-            if (ruleObj.contains("options_by_value")) {
-                QJsonObject mapObj = ruleObj["options_by_value"].toObject();
-                for (auto it = mapObj.begin(); it != mapObj.end(); ++it) {
-                    QStringList opts;
-                    QJsonArray arr = it.value().toArray();
-                    for (const auto& o : arr) {
-                        opts << o.toString();
-                    }
-                    rule.optionsByValue[it.key()] = opts;
-                }
-            }
-            if (!rule.controllerId.isEmpty() && !rule.targetId.isEmpty() && !rule.optionsByValue.isEmpty()) {
-                tmpl->m_optionRules.append(rule);
-            }
+
+    // 含条件表达式的模板记录一次规则编译用时，便于对比规则改写前后的加载开销
+    int expressions = tmpl->m_rules.expressionCount();
+    for (const ValidationRule& rule : tmpl->m_compiledValidationRules) {
+        for (const ValidationConstraint& c : rule.constraints) {
+            expressions += (c.condition.isValid() ? 1 : 0) + (c.expect.isValid() ? 1 : 0);
         }
     }
-
-    // 校验说明规则：保存原始 JSON，便于后续序列化与校验
-    if (json.contains("validation_rules")) {
-        tmpl->m_validationRules = json["validation_rules"].toArray();
+    if (expressions > 0) {
+        qDebug() << QString(u8"模板[%1] 规则编译：%2 个条件表达式，用时 %3 微秒")
+                        .arg(templateId)
+                        .arg(expressions)
+                        .arg(compileTimer.nsecsElapsed() / 1000);
     }
     
     // 自定义状态标签和可选的数量覆盖
@@ -182,57 +152,3 @@ WorkStateTemplate* WorkStateTemplate::fromJson(const QJsonObject& json)
     
     return tmpl;
 }
-
-QJsonArray WorkStateTemplate::getVisibilityRulesJson() const
-{
-    QJsonArray arr;
-    for (const auto& rule : m_visibilityRules) {
-        if (rule.controllerId.isEmpty()) {
-            continue;
-        }
-        QJsonObject obj;
-        obj.insert("controller", rule.controllerId);
-        QJsonArray casesArr;
-        for (const auto& c : rule.cases) {
-            QJsonObject caseObj;
-            caseObj.insert("value", c.value);
-            QJsonArray showArr;
-            for (const auto& sid : c.showIds) {
-                showArr.append(sid);
-            }
-            caseObj.insert("show", showArr);
-            casesArr.append(caseObj);
-        }
-        if (!casesArr.isEmpty()) {
-            obj.insert("cases", casesArr);
-            arr.append(obj);
-        }
-    }
-    return arr;
-}
-
-QJsonArray WorkStateTemplate::getOptionRulesJson() const
-{
-    QJsonArray arr;
-    for (const auto& rule : m_optionRules) {
-        if (rule.controllerId.isEmpty() || rule.targetId.isEmpty() || rule.optionsByValue.isEmpty()) {
-            continue;
-        }
-        QJsonObject obj;
-        obj.insert("controller", rule.controllerId);
-        obj.insert("target", rule.targetId);
-        QJsonObject mapObj;
-        for (auto it = rule.optionsByValue.begin(); it != rule.optionsByValue.end(); ++it) {
-            QJsonArray opts;
-            for (const auto& v : it.value()) {
-                opts.append(v);
-            }
-            mapObj.insert(it.key(), opts);
-        }
-        if (!mapObj.isEmpty()) {
-            obj.insert("options_by_value", mapObj);
-            arr.append(obj);
-        }
-    }
-    return arr;
-}
@@ -1,6 +1,8 @@
 ﻿#pragma once
 
 #include "ParameterItem.h"
+#include "ValidationRule.h"
+#include "ParameterRuleSet.h"
 #include <QList>
 #include <QJsonObject>
 #include <QJsonArray>
@@ -30,30 +32,24 @@ public:
     QVariantMap getStateValues(int stateIndex) const;
     void setStateValues(int stateIndex, const QVariantMap& values);
     
-    // 从JSON加载
-    static WorkStateTemplate* fromJson(const QJsonObject& json);
+    // 从JSON加载；basicParameters 为所属类型的基本参数，校验规则可以引用
+    static WorkStateTemplate* fromJson(const QJsonObject& json,
+                                       const QList<ParameterItem*>& basicParameters = QList<ParameterItem*>());
     
-    struct VisibilityCase {
-        QString value;
-        QStringList showIds;
-    };
-    struct VisibilityRule {
-        QString controllerId;
-        QList<VisibilityCase> cases;
-        QSet<QString> affectedIds;
-    };
-    struct OptionRule {
-        QString controllerId;
-        QString targetId;
-        QMap<QString, QStringList> optionsByValue;
-    };
+    using VisibilityCase = ParameterRuleSet::VisibilityCase;
+    using VisibilityRule = ParameterRuleSet::VisibilityRule;
+    using OptionRule = ParameterRuleSet::OptionRule;
     QStringList getStateTabTitles() const { return m_stateTabTitles; }
     int getStateTabCountOverride() const { return m_stateTabCountOverride; }
-    const QVector<VisibilityRule>& getVisibilityRules() const { return m_visibilityRules; }
-    const QVector<OptionRule>& getOptionRules() const { return m_optionRules; }
-    QJsonArray getVisibilityRulesJson() const;
-    QJsonArray getOptionRulesJson() const;
+    const ParameterRuleSet& getRules() const { return m_rules; }
+    const QVector<VisibilityRule>& getVisibilityRules() const { return m_rules.visibilityRules(); }
+    const QVector<OptionRule>& getOptionRules() const { return m_rules.optionRules(); }
+    QBitArray hiddenMask(const QVariantMap& values) const { return m_rules.hiddenMask(values); }
+    QJsonArray getVisibilityRulesJson() const { return m_rules.visibilityRulesJson(); }
+    QJsonArray getOptionRulesJson() const { return m_rules.optionRulesJson(); }
     QJsonArray getValidationRulesJson() const { return m_validationRules; }
+    const QVector<ValidationRule>& getCompiledValidationRules() const { return m_compiledValidationRules; }
+    const ValidationDependencyIndex& getValidationDependencies() const { return m_validationDependencies; }
 
 private:
     QString m_templateId;
@@ -62,9 +58,10 @@ private:
     
     // 存储每个状态实例的参数值 stateIndex -> (parameterId -> value)
     mutable QMap<int, QVariantMap> m_stateValues;
-    QVector<VisibilityRule> m_visibilityRules;
-    QVector<OptionRule> m_optionRules;
+    ParameterRuleSet m_rules; // 可见性与选项规则（加载时编译）
     QJsonArray m_validationRules;
+    QVector<ValidationRule> m_compiledValidationRules;
+    ValidationDependencyIndex m_validationDependencies;
     QStringList m_stateTabTitles;
     int m_stateTabCountOverride = -1;
 };
@@ -1,4 +1,10 @@
 ﻿#include "EquipmentConfigWidget.h"
+#include "ValidationPanel.h"
+#include "SearchPanel.h"
+#include "BulkEditDialog.h"
+#include "BatchValidator.h"
+#include "AppTheme.h"
+#include "PerfLog.h"
 #include <QApplication>
 #include <QMainWindow>
 #include <QVBoxLayout>
@@ -13,6 +19,10 @@
 #include <QApplication>
 #include <QPalette>
 #include <QTextStream>
+#include <QLabel>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QPlainTextEdit>
 
 class MainWindow : public QMainWindow {
     Q_OBJECT
@@ -46,7 +56,7 @@ private slots:
         if (m_configWidget->hasCurrentFile()) {
             // 如果有当前文件，直接保存
             if (m_configWidget->autoSave()) {
-                statusBar()->showMessage(QString(u8"已保存配置文件: %1").arg(m_configWidget->getCurrentFilePath()), 3000);
+                statusBar()->showMessage(QString(u8"正在保存配置文件: %1").arg(m_configWidget->getCurrentFilePath()));
             }
         } else {
             // 如果没有当前文件，弹出另存为对话框
@@ -57,14 +67,27 @@ private slots:
     void saveAsConfigFile() {
         QString fileName = QFileDialog::getSaveFileName(this, u8"保存配置文件", "", u8"JSON文件 (*.json)");
         if (!fileName.isEmpty()) {
-            if (m_configWidget->saveToJson(fileName)) {
-                m_configWidget->setCurrentFilePath(fileName);
-                statusBar()->showMessage(QString(u8"已保存配置文件: %1").arg(fileName), 3000);
-                updateWindowTitle();
+            // 当前文件与窗口标题在保存成功后才切换（filePathChanged）
+            if (m_configWidget->saveAs(fileName)) {
+                statusBar()->showMessage(QString(u8"正在保存配置文件: %1").arg(fileName));
             }
         }
     }
     
+    void exportSingleFile() {
+        QString fileName = QFileDialog::getSaveFileName(this, u8"导出为单文件", "", u8"JSON文件 (*.json)");
+        if (!fileName.isEmpty() && m_configWidget->exportSingleFile(fileName)) {
+            statusBar()->showMessage(QString(u8"正在导出配置文件: %1").arg(fileName));
+        }
+    }
+    
+    void saveAsSplitLayout() {
+        QString fileName = QFileDialog::getSaveFileName(this, u8"另存为分片布局", "", u8"JSON文件 (*.json)");
+        if (!fileName.isEmpty() && m_configWidget->saveAsSplit(fileName)) {
+            statusBar()->showMessage(QString(u8"正在保存配置文件: %1").arg(fileName));
+        }
+    }
+    
     void onConfigChanged() {
         statusBar()->showMessage(u8"配置已修改", 2000);
         updateWindowTitle();
@@ -75,10 +98,84 @@ private slots:
         statusBar()->showMessage(QString(u8"错误: %1").arg(message), 5000);
     }
     
+    void onSaveFinished(const QString& filePath, bool ok) {
+        if (ok) {
+            statusBar()->showMessage(QString(u8"已保存配置文件: %1").arg(filePath), 3000);
+        } else {
+            // 失败原因已通过 validationError 显示，这里只更新状态栏
+            statusBar()->showMessage(QString(u8"保存失败: %1").arg(filePath), 5000);
+        }
+    }
+    
+    void onSaveSuperseded(const QString& filePath) {
+        statusBar()->showMessage(QString(u8"保存请求已由之后对同一文件的保存接续: %1").arg(filePath), 3000);
+    }
+    
+    void onEditsRecovered(const QString& filePath, int count) {
+        QMessageBox::information(this, u8"恢复未保存的修改",
+            QString(u8"已从编辑日志恢复 %1 处未保存的修改：\n%2\n\n这些修改会在稍后自动保存，也可以立即保存。")
+                .arg(count)
+                .arg(filePath));
+    }
+    
     void onFilePathChanged(const QString& filePath) {
         updateWindowTitle();
     }
     
+    void bulkEdit() {
+        BulkEditDialog dialog(m_configWidget->equipmentTypes(), m_configWidget->deviceInstances(), this);
+        // 失败时保持对话框打开并显示原因，全部写入后再关闭
+        while (dialog.exec() == QDialog::Accepted) {
+            const BulkEdit::Outcome outcome = m_configWidget->applyBulkEdit(dialog.request());
+            if (outcome.ok) {
+                statusBar()->showMessage(QString(u8"批量修改完成：%1 处取值变化（共 %2 处，%3 ms）")
+                                             .arg(outcome.changed)
+                                             .arg(outcome.cells)
+                                             .arg(outcome.elapsedMs), 5000);
+                break;
+            }
+            dialog.setError(outcome.errors.join("\n"));
+        }
+    }
+    
+    void onTimingRecorded(const PerfLog::Entry& entry) {
+        // 常驻标签不会被临时消息覆盖，自动保存也只更新这里
+        QString text = QString(u8"%1 %2 ms%3")
+                           .arg(entry.operation)
+                           .arg(entry.totalMs)
+                           .arg(entry.ok ? QString() : QString(u8"（未完成）"));
+        if (entry.hasCounts()) {
+            text += QString(u8" · 控件 %1 / 对象 %2").arg(entry.widgetCount).arg(entry.objectCount);
+        }
+        m_timingLabel->setText(text);
+        m_timingLabel->setToolTip(entry.details());
+    }
+    
+    void showPerfLog() {
+        QStringList blocks;
+        const QList<PerfLog::Entry> entries = PerfLog::recent();
+        for (int i = entries.size() - 1; i >= 0; --i) {
+            blocks << entries.at(i).details();
+        }
+        QDialog dialog(this);
+        dialog.setWindowTitle(u8"性能记录");
+        dialog.resize(640, 480);
+        QVBoxLayout* layout = new QVBoxLayout(&dialog);
+        const QString path = PerfLog::filePath();
+        QLabel* pathLabel = new QLabel(path.isEmpty() ? QString(u8"日志文件不可用")
+                                                      : QString(u8"滚动日志：%1").arg(path));
+        pathLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+        QPlainTextEdit* text = new QPlainTextEdit;
+        text->setReadOnly(true);
+        text->setPlainText(blocks.isEmpty() ? QString(u8"尚无记录") : blocks.join("\n\n"));
+        QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Close);
+        connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+        layout->addWidget(pathLabel);
+        layout->addWidget(text, 1);
+        layout->addWidget(buttons);
+        dialog.exec();
+    }
+    
     void showAbout() {
         QMessageBox::about(this, u8"关于", 
             u8"装备参数配置工具 v1.0\n\n"
@@ -114,6 +211,17 @@ private:
         });
         m_configWidget->addAction(contextNewAction);
         
+        // 校验结果面板，默认隐藏，校验出现问题时自动弹出
+        m_validationPanel = new ValidationPanel(this);
+        addDockWidget(Qt::BottomDockWidgetArea, m_validationPanel);
+        m_validationPanel->hide();
+        
+        // 全局搜索面板，默认隐藏，Ctrl+F 打开
+        m_searchPanel = new SearchPanel(this);
+        addDockWidget(Qt::RightDockWidgetArea, m_searchPanel);
+        m_searchPanel->setIndex(m_configWidget->searchIndex());
+        m_searchPanel->hide();
+        
         // 创建菜单
         QMenuBar* menuBar = this->menuBar();
         
@@ -131,6 +239,12 @@ private:
         saveAsAction->setShortcut(QKeySequence::SaveAs);
         connect(saveAsAction, &QAction::triggered, this, &MainWindow::saveAsConfigFile);
         
+        QAction* exportAction = fileMenu->addAction(u8"导出为单文件...");
+        connect(exportAction, &QAction::triggered, this, &MainWindow::exportSingleFile);
+        
+        QAction* saveSplitAction = fileMenu->addAction(u8"另存为分片布局...");
+        connect(saveSplitAction, &QAction::triggered, this, &MainWindow::saveAsSplitLayout);
+        
         QAction* editModeAction = fileMenu->addAction(u8"结构编辑模式(&E)...");
         connect(editModeAction, &QAction::triggered, this, [this]() {
             m_configWidget->openStructureEditor();
@@ -141,12 +255,35 @@ private:
         exitAction->setShortcut(QKeySequence::Quit);
         connect(exitAction, &QAction::triggered, this, &QWidget::close);
         
+        QMenu* editMenu = menuBar->addMenu(u8"编辑(&E)");
+        QAction* bulkEditAction = editMenu->addAction(u8"批量修改参数(&B)...");
+        connect(bulkEditAction, &QAction::triggered, this, &MainWindow::bulkEdit);
+        
+        QMenu* viewMenu = menuBar->addMenu(u8"视图(&V)");
+        viewMenu->addAction(m_validationPanel->toggleViewAction());
+        viewMenu->addAction(m_searchPanel->toggleViewAction());
+        QAction* searchAction = viewMenu->addAction(u8"搜索参数(&F)...");
+        searchAction->setShortcut(QKeySequence::Find);
+        connect(searchAction, &QAction::triggered, m_searchPanel, &SearchPanel::focusSearch);
+        QAction* validateAction = viewMenu->addAction(u8"立即校验(&C)");
+        connect(validateAction, &QAction::triggered, this, [this]() {
+            if (m_configWidget->validateAll()) {
+                statusBar()->showMessage(u8"校验通过", 3000);
+            }
+        });
+        
+        viewMenu->addSeparator();
+        QAction* perfAction = viewMenu->addAction(u8"性能记录(&P)...");
+        connect(perfAction, &QAction::triggered, this, &MainWindow::showPerfLog);
+        
         QMenu* helpMenu = menuBar->addMenu(u8"帮助(&H)");
         QAction* aboutAction = helpMenu->addAction(u8"关于(&A)");
         connect(aboutAction, &QAction::triggered, this, &MainWindow::showAbout);
         
-        // 创建状态栏
+        // 创建状态栏；右侧常驻最近一次加载/校验/保存的用时，悬停显示分阶段明细
         statusBar()->showMessage(u8"就绪");
+        m_timingLabel = new QLabel(this);
+        statusBar()->addPermanentWidget(m_timingLabel);
         
         updateWindowTitle();
     }
@@ -158,6 +295,25 @@ private:
                 this, &MainWindow::onValidationError);
         connect(m_configWidget, &EquipmentConfigWidget::filePathChanged,
                 this, &MainWindow::onFilePathChanged);
+        connect(m_configWidget, &EquipmentConfigWidget::saveFinished,
+                this, &MainWindow::onSaveFinished);
+        connect(m_configWidget, &EquipmentConfigWidget::saveSuperseded,
+                this, &MainWindow::onSaveSuperseded);
+        connect(m_configWidget, &EquipmentConfigWidget::editsRecovered,
+                this, &MainWindow::onEditsRecovered);
+        connect(m_configWidget, &EquipmentConfigWidget::timingRecorded,
+                this, &MainWindow::onTimingRecorded);
+        connect(m_configWidget, &EquipmentConfigWidget::validationReportChanged,
+                this, [this](const ValidationReport& report) {
+            m_validationPanel->setReport(report);
+            if (!report.isEmpty()) {
+                m_validationPanel->show();
+            }
+        });
+        connect(m_validationPanel, &ValidationPanel::issueActivated,
+                m_configWidget, &EquipmentConfigWidget::focusIssue);
+        connect(m_searchPanel, &SearchPanel::resultActivated,
+                m_configWidget, &EquipmentConfigWidget::focusParameter);
     }
     
     void updateWindowTitle() {
@@ -171,64 +327,13 @@ private:
 
 private:
     EquipmentConfigWidget* m_configWidget;
+    ValidationPanel* m_validationPanel;
+    SearchPanel* m_searchPanel;
+    QLabel* m_timingLabel;
 };
 
-// 全局样式，支持通过环境变量 DISABLE_CUSTOM_STYLE 一键关闭
-static void applyGlobalStyle()
-{
-    if (!qEnvironmentVariableIsEmpty("DISABLE_CUSTOM_STYLE")) {
-        return;
-    }
-
-    QString style = R"(
-        QWidget { font-family: "Inter", "Microsoft YaHei", sans-serif; font-size: 12px; color: #111827; }
-        QMainWindow, QDialog, QTabWidget::pane, QScrollArea { background: #f8fafc; }
-        QGroupBox { border: 1px solid #d0d7e2; border-radius: 6px; margin-top: 10px; padding: 8px 10px 10px 10px; background: #ffffff; }
-        QGroupBox::title { subcontrol-origin: margin; left: 10px; padding: 0 4px; color: #0f172a; font-weight: 700; }
-        QLabel { color: #0f172a; font-weight: 600; }
-        QLineEdit, QComboBox, QSpinBox, QDoubleSpinBox { border: 1px solid #c3cfe2; border-radius: 5px; padding: 4px 6px; background: #ffffff; selection-background-color: #2563eb; selection-color: #ffffff; }
-        QLineEdit:focus, QComboBox:focus, QSpinBox:focus, QDoubleSpinBox:focus { border: 1px solid #2563eb; }
-        QComboBox::drop-down { border: none; width: 18px; }
-        QComboBox::down-arrow { image: none; border: none; }
-        QAbstractItemView {
-            background: #ffffff;
-            color: #111827;
-            selection-background-color: #2563eb;
-            selection-color: #ffffff;
-            outline: 0;
-        }
-        QPushButton { background: #2563eb; color: #ffffff; border: none; border-radius: 6px; padding: 6px 12px; font-weight: 600; }
-        QPushButton:hover { background: #1d4ed8; }
-        QPushButton:pressed { background: #1e40af; }
-        QPushButton:disabled { background: #a5b4fc; color: #f1f5f9; }
-        QTabBar::tab { background: #e5ecf6; padding: 8px 16px; margin: 2px; border-radius: 6px 6px 0 0; color: #0f172a; min-width: 130px; }
-        QTabBar::tab:selected { background: #ffffff; color: #2563eb; font-weight: 700; border: 1px solid #d0d7e2; border-bottom: 1px solid #ffffff; }
-        QTabBar::tab:hover { background: #f1f5fd; }
-        QTabBar::scroller { width: 22px; background: #e5ecf6; border-left: 1px solid #cbd5e1; }
-        QTabBar QToolButton { background: transparent; border: none; color: #0f172a; padding: 0 4px; }
-        QTabBar QToolButton:hover { background: #cbd5e1; color: #0f172a; }
-        QTabWidget::pane { border: 1px solid #d0d7e2; top: -1px; }
-        QMenu { background: #0f172a; color: #e2e8f0; border: 1px solid #1f2937; }
-        QMenu::item:selected { background: #2563eb; color: #f8fafc; }
-        QMenu::separator { height: 1px; background: #1f2937; margin: 4px 0; }
-        QScrollBar:vertical { background: transparent; width: 10px; margin: 4px; }
-        QScrollBar::handle:vertical { background: #c3d0e8; border-radius: 5px; }
-        QScrollBar::handle:vertical:hover { background: #9fb6e1; }
-        QScrollBar::add-line:vertical, QScrollBar::sub-line:vertical {
-            background: #e5ecf6;
-            border: 1px solid #cbd5e1;
-            height: 12px;
-        }
-        QScrollBar::add-line:vertical:hover, QScrollBar::sub-line:vertical:hover {
-            background: #cbd5e1;
-            border: 1px solid #94a3b8;
-        }
-        QScrollBar::add-page:vertical, QScrollBar::sub-page:vertical { background: none; }
-        QStatusBar { background: #e5ecf6; }
-    )";
-
-    qApp->setStyleSheet(style);
-}
+// 批量校验模式下标准输出只留给机器可读结果，日志全部改走标准错误
+static bool s_logToStderr = false;
 
 // 简易日志过滤：默认屏蔽 qDebug（避免控制台乱码和刷屏），
 // 设置环境变量 ENABLE_DEBUG_LOG 可重新启用
@@ -240,7 +345,7 @@ static void installMessageHandler()
             return;
         }
         QByteArray utf8 = msg.toUtf8();
-        FILE* out = (type == QtDebugMsg || type == QtInfoMsg) ? stdout : stderr;
+        FILE* out = (!s_logToStderr && (type == QtDebugMsg || type == QtInfoMsg)) ? stdout : stderr;
         fprintf(out, "%s\n", utf8.constData());
         fflush(out);
         Q_UNUSED(ctx);
@@ -249,10 +354,20 @@ static void installMessageHandler()
 
 int main(int argc, char *argv[])
 {
+    // 命令行批量校验：只创建 QCoreApplication，不加载任何界面
+    if (BatchValidator::isRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        app.setApplicationName("EquipmentConfig");
+        app.setApplicationVersion("1.0");
+        s_logToStderr = true;
+        installMessageHandler();
+        return BatchValidator::run(app.arguments());
+    }
+
     QApplication app(argc, argv);
 
     installMessageHandler();
-    applyGlobalStyle();
+    AppTheme::apply(app); // DISABLE_CUSTOM_STYLE / APP_THEME 见 AppTheme.h
     
     app.setApplicationName("EquipmentConfig");
     app.setApplicationVersion("1.0");